@@ -0,0 +1,47 @@
+using SeeSharp.Experiments;
+using SeeSharp.Images;
+using SeeSharp.Integrators;
+using SimpleImageIO;
+using System;
+
+namespace SeeSharp.Benchmark {
+    public class AdaptiveSamplingBench {
+        /// <summary>
+        /// Renders with uniform and with adaptive sampling at the same total sample count and reports the
+        /// relMSE to the reference, the render time, and their product. The ratio of the products is the
+        /// efficiency gain of adaptive sampling.
+        /// </summary>
+        public static void BenchRelMSEPerTime(string sceneName, int spp, int maxDepth = 5) {
+            var config = SceneRegistry.LoadScene(sceneName, maxDepth: maxDepth);
+            var scene = config.MakeScene();
+            var reference = config.GetReferenceImage(512, 512);
+
+            (double RelMSE, double Seconds) Run(bool adaptive) {
+                scene.FrameBuffer = new(512, 512, "", FrameBuffer.Flags.EstimatePixelVariance);
+                scene.Prepare();
+                new PathTracer() {
+                    TotalSpp = spp,
+                    MaxDepth = maxDepth,
+                    EnableDenoiser = false,
+                    EnableAdaptiveSampling = adaptive,
+                }.Render(scene);
+                return (Metrics.RelMSE_OutlierRejection(scene.FrameBuffer.Image, reference),
+                    scene.FrameBuffer.RenderTimeMs / 1000.0);
+            }
+
+            // Dry run to eliminate JIT overhead
+            Run(false);
+            Run(true);
+
+            var uniform = Run(false);
+            var adaptive = Run(true);
+            Console.WriteLine($"Adaptive sampling, {sceneName}, {spp}spp:");
+            Console.WriteLine($"    uniform:  relMSE {uniform.RelMSE:G4} in {uniform.Seconds:F2}s, " +
+                $"relMSE x s {uniform.RelMSE * uniform.Seconds:G4}");
+            Console.WriteLine($"    adaptive: relMSE {adaptive.RelMSE:G4} in {adaptive.Seconds:F2}s, " +
+                $"relMSE x s {adaptive.RelMSE * adaptive.Seconds:G4}");
+            Console.WriteLine($"    efficiency gain: " +
+                $"{uniform.RelMSE * uniform.Seconds / (adaptive.RelMSE * adaptive.Seconds):F2}x");
+        }
+    }
+}
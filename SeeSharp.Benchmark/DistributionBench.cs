@@ -0,0 +1,56 @@
+using SeeSharp.Sampling;
+using System;
+using System.Diagnostics;
+
+namespace SeeSharp.Benchmark {
+    public class DistributionBench {
+        /// <summary>
+        /// Times sampling of discrete distributions of different sizes: the previous Array.BinarySearch based
+        /// approach, the branchless search (single and batched), and the alias table.
+        /// </summary>
+        public static void BenchSampling(int numSamples) {
+            RNG rng = new(42);
+            var u = new float[numSamples];
+            for (int i = 0; i < numSamples; ++i)
+                u[i] = rng.NextFloat();
+            var idx = new int[numSamples];
+
+            foreach (int size in new[] { 16, 1024, 1 << 20 }) {
+                var weights = new float[size];
+                for (int i = 0; i < size; ++i)
+                    weights[i] = rng.NextFloat() < 0.1f ? 0 : rng.NextFloat();
+                var pdf = new PiecewiseConstantPDF(weights);
+                var alias = new AliasTable(weights);
+                var cdf = pdf.Cdf.ToArray();
+
+                Console.WriteLine($"Sampling {numSamples} times from {size} bins:");
+
+                Time("Array.BinarySearch", () => {
+                    for (int i = 0; i < numSamples; ++i) {
+                        int k = Array.BinarySearch(cdf, u[i]);
+                        if (k < 0) k = ~k;
+                        else for (; k > 0 && cdf[k - 1] == u[i]; --k) { }
+                        idx[i] = k;
+                    }
+                });
+                Time("PiecewiseConstantPDF.Sample", () => {
+                    for (int i = 0; i < numSamples; ++i)
+                        idx[i] = pdf.Sample(u[i]).BinIndex;
+                });
+                Time("PiecewiseConstantPDF batch", () => pdf.Sample(u, idx));
+                Time("AliasTable.Sample", () => {
+                    for (int i = 0; i < numSamples; ++i)
+                        idx[i] = alias.Sample(u[i]);
+                });
+                Time("AliasTable batch", () => alias.Sample(u, idx));
+            }
+        }
+
+        static void Time(string name, Action action) {
+            action(); // Dry run to eliminate JIT overhead
+            var stop = Stopwatch.StartNew();
+            action();
+            Console.WriteLine($"    {name}: {stop.ElapsedMilliseconds}ms");
+        }
+    }
+}
@@ -0,0 +1,80 @@
+using SeeSharp.Sampling;
+using SimpleImageIO;
+using System;
+using System.Diagnostics;
+using System.Numerics;
+using System.Threading.Tasks;
+
+namespace SeeSharp.Benchmark {
+    public class EnvMapSamplingBench {
+        /// <summary>
+        /// Luminance of a synthetic sky: a smooth gradient with a small, very bright sun
+        /// </summary>
+        static float[] MakeSky(int width, int height) {
+            var luminance = new float[width * height];
+            Parallel.For(0, height, row => {
+                for (int col = 0; col < width; ++col) {
+                    float dx = (col - width * 0.3f) / width, dy = (row - height * 0.25f) / height;
+                    float sun = dx * dx + dy * dy < 1e-5f ? 50000 : 0;
+                    luminance[row * width + col] = 1 - row / (float)height + sun;
+                }
+            });
+            return luminance;
+        }
+
+        static (float[], int, int) LoadLuminance(string filename) {
+            var image = new RgbImage(filename);
+            var luminance = new float[image.Width * image.Height];
+            Parallel.For(0, image.Height, row => {
+                for (int col = 0; col < image.Width; ++col)
+                    luminance[row * image.Width + col] = image.GetPixel(col, row).Luminance;
+            });
+            return (luminance, image.Width, image.Height);
+        }
+
+        /// <summary>
+        /// Compares the previous row / column CDF grid with the hierarchical grid used by the environment map
+        /// </summary>
+        /// <param name="width">Width of the synthetic map, ignored if a file is given</param>
+        /// <param name="height">Height of the synthetic map, ignored if a file is given</param>
+        /// <param name="numSamples">Number of samples to time</param>
+        /// <param name="filename">Optional HDR image to use instead of the synthetic sky</param>
+        public static void BenchSampling(int width, int height, int numSamples, string filename = null) {
+            float[] luminance;
+            if (filename != null)
+                (luminance, width, height) = LoadLuminance(filename);
+            else
+                luminance = MakeSky(width, height);
+
+            Stopwatch stop = Stopwatch.StartNew();
+            var regular = new RegularGrid2d(width, height);
+            for (int row = 0; row < height; ++row)
+                for (int col = 0; col < width; ++col)
+                    regular.Splat(col, row, luminance[row * width + col]);
+            regular.Normalize();
+            Console.WriteLine($"Building RegularGrid2d ({width}x{height}) took {stop.ElapsedMilliseconds}ms");
+
+            stop.Restart();
+            var hierarchical = new HierarchicalGrid2d(width, height);
+            for (int row = 0; row < height; ++row)
+                for (int col = 0; col < width; ++col)
+                    hierarchical.Splat(col, row, luminance[row * width + col]);
+            hierarchical.Normalize();
+            Console.WriteLine($"Building HierarchicalGrid2d ({width}x{height}) took {stop.ElapsedMilliseconds}ms");
+
+            RNG rng = new(1337);
+            Vector2 checksum = Vector2.Zero;
+            stop.Restart();
+            for (int i = 0; i < numSamples; ++i)
+                checksum += regular.Sample(rng.NextFloat2D());
+            Console.WriteLine($"{numSamples} samples from RegularGrid2d took {stop.ElapsedMilliseconds}ms ({checksum})");
+
+            rng = new(1337);
+            checksum = Vector2.Zero;
+            stop.Restart();
+            for (int i = 0; i < numSamples; ++i)
+                checksum += hierarchical.Sample(rng.NextFloat2D());
+            Console.WriteLine($"{numSamples} samples from HierarchicalGrid2d took {stop.ElapsedMilliseconds}ms ({checksum})");
+        }
+    }
+}
@@ -0,0 +1,81 @@
+using SeeSharp.IO;
+using System;
+using System.Buffers.Binary;
+using System.Diagnostics;
+using System.IO;
+using System.Text;
+
+namespace SeeSharp.Benchmark {
+    public class PlyLoadingBench {
+        /// <summary>
+        /// Writes a binary .ply with a grid of gridSize x gridSize vertices (position, normal, uv) and two
+        /// triangles per grid cell.
+        /// </summary>
+        static string WriteGrid(int gridSize, bool bigEndian) {
+            string filename = Path.Join(Path.GetTempPath(), $"bench-grid-{gridSize}-{(bigEndian ? "be" : "le")}.ply");
+            int numVerts = gridSize * gridSize;
+            int numFaces = 2 * (gridSize - 1) * (gridSize - 1);
+
+            using var stream = new BufferedStream(File.Create(filename), 1 << 20);
+            string header = "ply\n"
+                + $"format {(bigEndian ? "binary_big_endian" : "binary_little_endian")} 1.0\n"
+                + $"element vertex {numVerts}\n"
+                + "property float x\nproperty float y\nproperty float z\n"
+                + "property float nx\nproperty float ny\nproperty float nz\n"
+                + "property float u\nproperty float v\n"
+                + $"element face {numFaces}\n"
+                + "property list uchar int vertex_indices\n"
+                + "end_header\n";
+            stream.Write(Encoding.ASCII.GetBytes(header));
+
+            byte[] buffer = new byte[4];
+            void WriteInt(int value) {
+                if (bigEndian) BinaryPrimitives.WriteInt32BigEndian(buffer, value);
+                else BinaryPrimitives.WriteInt32LittleEndian(buffer, value);
+                stream.Write(buffer);
+            }
+            void WriteFloat(float value) => WriteInt(BitConverter.SingleToInt32Bits(value));
+
+            for (int y = 0; y < gridSize; ++y) {
+                for (int x = 0; x < gridSize; ++x) {
+                    WriteFloat(x); WriteFloat(y); WriteFloat(0);
+                    WriteFloat(0); WriteFloat(0); WriteFloat(1);
+                    WriteFloat(x / (float)gridSize); WriteFloat(y / (float)gridSize);
+                }
+            }
+
+            for (int y = 0; y < gridSize - 1; ++y) {
+                for (int x = 0; x < gridSize - 1; ++x) {
+                    int i = y * gridSize + x;
+                    stream.WriteByte(3); WriteInt(i); WriteInt(i + 1); WriteInt(i + gridSize + 1);
+                    stream.WriteByte(3); WriteInt(i); WriteInt(i + gridSize + 1); WriteInt(i + gridSize);
+                }
+            }
+
+            return filename;
+        }
+
+        public static void BenchBinaryPly(int gridSize, int numTrials) {
+            foreach (bool bigEndian in new[] { false, true }) {
+                string filename = WriteGrid(gridSize, bigEndian);
+                long fileSize = new FileInfo(filename).Length;
+
+                // Dry run to eliminate JIT overhead
+                new PlyFile().ParseFile(filename);
+
+                Stopwatch stop = Stopwatch.StartNew();
+                int numTriangles = 0;
+                for (int i = 0; i < numTrials; ++i) {
+                    PlyFile file = new();
+                    file.ParseFile(filename);
+                    numTriangles = file.Indices.Length / 3;
+                }
+                double ms = stop.ElapsedMilliseconds / (double)numTrials;
+                Console.WriteLine($"Loading binary .ply ({(bigEndian ? "big" : "little")} endian, " +
+                    $"{numTriangles} triangles, {fileSize >> 20} MB) took {ms}ms");
+
+                File.Delete(filename);
+            }
+        }
+    }
+}
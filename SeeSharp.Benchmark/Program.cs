@@ -3,19 +3,36 @@ using SeeSharp.Benchmark;
 using SeeSharp.Experiments;
 using SeeSharp.Integrators;
 using SeeSharp.Integrators.Bidir;
+using SeeSharp.Integrators.Common;
 
 SceneRegistry.AddSourceRelativeToScript("../data/scenes");
 
+PlyLoadingBench.BenchBinaryPly(2048, 5);
+EnvMapSamplingBench.BenchSampling(8192, 4096, 10000000);
+DistributionBench.BenchSampling(10000000);
+
 BenchRender("PathTracer - 16spp", new PathTracer() {
     TotalSpp = 16,
 });
 
+AdaptiveSamplingBench.BenchRelMSEPerTime("CornellBox", 64);
+
 BenchRender("BDPT - 8spp", new VertexCacheBidir() {
     NumIterations = 8,
 });
 
-BenchRender("VCM - 8spp", new VertexConnectionAndMerging() {
+// Compare the merge acceleration structures side by side
+foreach (var accel in new[] { PhotonMapType.MortonTree, PhotonMapType.HashGrid }) {
+    BenchRender($"VCM - 8spp - {accel}", new VertexConnectionAndMerging() {
+        NumIterations = 8,
+        MergeAccelerator = accel,
+    });
+}
+
+// Build and query times of all merge acceleration structures on the same photons and queries
+BenchRender("VCM - 8spp - all accelerators", new VertexConnectionAndMerging() {
     NumIterations = 8,
+    CompareMergeAccelerators = true,
 });
 
 void BenchRender(string name, Integrator integrator) {
@@ -36,6 +53,11 @@ void BenchRender(string name, Integrator integrator) {
         total += scene.FrameBuffer.RenderTimeMs;
     }
     Console.WriteLine($"{name}: {total / (double)num}");
+    if (scene.FrameBuffer.MetaData.TryGetValue("MergeAccelStatsAll", out var all)) {
+        foreach (var backend in (PhotonMapStats[])all)
+            Console.WriteLine($"    {backend}");
+    } else if (scene.FrameBuffer.MetaData.TryGetValue("MergeAccelStats", out var stats))
+        Console.WriteLine($"    {stats}");
 
     scene.FrameBuffer.WriteToFile(name + ".exr");
 }
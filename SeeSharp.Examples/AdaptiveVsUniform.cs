@@ -0,0 +1,17 @@
+using SeeSharp.Experiments;
+using SeeSharp.Integrators;
+using System.Collections.Generic;
+
+namespace SeeSharp.Examples;
+
+/// <summary>
+/// Compares a path tracer with uniform and with variance-driven adaptive sample distribution, at the same
+/// total number of samples. The overview page lists the relMSE, time, and speed-up of both.
+/// Requires a frame buffer with the <see cref="Images.FrameBuffer.Flags.EstimatePixelVariance"/> flag.
+/// </summary>
+class AdaptiveVsUniform : Experiment {
+    public override List<Method> MakeMethods() => [
+        new("Uniform", new PathTracer() { TotalSpp = 32 }),
+        new("Adaptive", new PathTracer() { TotalSpp = 32, EnableAdaptiveSampling = true })
+    ];
+}
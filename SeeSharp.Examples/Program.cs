@@ -17,6 +17,10 @@ Benchmark benchmark = new(new PathVsVcm(), [
 // Render the images
 benchmark.Run();
 
+// To compare uniform and adaptive sampling instead, the frame buffer needs to estimate the pixel variance:
+// new Benchmark(new AdaptiveVsUniform(), [SceneRegistry.LoadScene("CornellBox", maxDepth: 5)],
+//     "Results/AdaptiveVsUniform", 512, 512, FrameBuffer.Flags.EstimatePixelVariance).Run();
+
 // Optional, but usually a good idea: assemble the rendering results in an overview
 // figure using a Python script.
 Process.Start("python", "./SeeSharp.Examples/MakeFigure.py Results/PathVsVcm PathTracer Vcm")
@@ -19,6 +19,8 @@ class Program {
     /// <param name="algo">One of: PT, VCM</param>
     /// <param name="denoise">Whether to run Open Image Denoise on the flattened output image</param>
     /// <param name="interactive">If true, the image is displayed and continuously updated in the tev viewer.</param>
+    /// <param name="workers">If greater than one, renders with this many worker processes that each render a range of the samples</param>
+    /// <param name="job">Runs as a worker of a distributed rendering with the given job file, all other options are ignored</param>
     static int Main(
         FileInfo scene,
         int samples = 8,
@@ -29,8 +31,15 @@ class Program {
         bool flatten = true,
         string algo = "PT",
         bool denoise = true,
-        bool interactive = false
+        bool interactive = false,
+        int workers = 0,
+        FileInfo job = null
     ) {
+        if (job != null) {
+            Experiments.DistributedRender.RunWorker(job.FullName);
+            return 0;
+        }
+
         if (scene == null) {
             Logger.Error("Please provide a scene filename via --scene [file.json]");
             return -1;
@@ -41,21 +50,39 @@ class Program {
         sc.FrameBuffer = new(resx, resy, output, flags);
         sc.Prepare();
 
+        Integrator integrator;
         if (algo == "PT") {
-            new PathTracer() {
+            integrator = new PathTracer() {
                 MaxDepth = maxdepth,
                 TotalSpp = samples,
-            }.Render(sc);
+            };
         } else if (algo == "VCM") {
-            new VertexConnectionAndMerging() {
+            integrator = new VertexConnectionAndMerging() {
                 MaxDepth = maxdepth,
                 NumIterations = samples,
-            }.Render(sc);
+            };
         } else {
             Logger.Error($"Unknown rendering algorithm: {algo}. Use PT or VCM");
             return -1;
         }
 
+        if (workers > 1) {
+            // The workers write their results next to the output file
+            var distributed = new Experiments.DistributedRender(Path.ChangeExtension(output, null) + "-ranges");
+            distributed.CreateJob(scene.FullName, integrator, samples, resx, resy, workers, flags);
+            var processes = distributed.LaunchWorkers(workers, System.Environment.ProcessPath, "--job");
+            if (!distributed.WaitForRanges(workers: processes)) {
+                Logger.Error("Some workers failed, see their output above");
+                return -1;
+            }
+
+            var denoiseBuffers = denoise ? new Integrators.Util.DenoiseBuffers(sc.FrameBuffer) : null;
+            distributed.Merge(sc.FrameBuffer);
+            denoiseBuffers?.Denoise();
+        } else {
+            integrator.Render(sc);
+        }
+
         if (flatten && denoise)
             sc.FrameBuffer.GetLayer("denoised").Image.WriteToFile(output);
         else if (flatten)
@@ -1,3 +1,4 @@
+using System.Linq;
 using System.Text.Json;
 using System.Text.Json.Nodes;
 
@@ -54,4 +55,186 @@ public class FrameBufferTests {
         Assert.Equal(13, warnings[1].Pixel.Col);
         Assert.Equal(200, warnings[1].Pixel.Row);
     }
-}
\ No newline at end of file
+
+    [Fact]
+    public void GCPausesAreTrackedPerIteration() {
+        FrameBuffer frameBuffer = new(16, 16, "");
+        for (int i = 0; i < 3; ++i) {
+            frameBuffer.StartIteration();
+            if (i == 1) GC.Collect();
+            frameBuffer.EndIteration();
+        }
+
+        Assert.Same(frameBuffer.GCPauses, frameBuffer.MetaData["GCPauses"]);
+        Assert.Equal(3, frameBuffer.GCPauses.PerIterationMs.Count);
+        Assert.True(frameBuffer.GCPauses.NumGen2Collections >= 1);
+        Assert.Equal(frameBuffer.GCPauses.PerIterationMs.Sum(), frameBuffer.GCPauses.TotalMs, 6);
+    }
+
+    static RgbImage RenderRandomSplats(FrameBuffer.Flags flags) {
+        FrameBuffer frameBuffer = new(64, 32, "", flags);
+        RenderRandomSplats(frameBuffer, 0, 2);
+        return frameBuffer.Image;
+    }
+
+    static void RenderRandomSplats(FrameBuffer frameBuffer, uint first, uint end) {
+        for (uint iter = first; iter < end; ++iter) {
+            frameBuffer.StartIteration();
+            frameBuffer.ParallelFor(10000, idx => {
+                RNG rng = new(13, (uint)idx, iter);
+                int col = rng.NextInt(64);
+                int row = rng.NextInt(32);
+                frameBuffer.Splat(col, row, new RgbColor(rng.NextFloat(), rng.NextFloat() * 1e-4f, rng.NextFloat() * 1e4f));
+            }, blockSize: 100);
+            frameBuffer.EndIteration();
+        }
+    }
+
+    [Fact]
+    public void LocalAccumulationIsDeterministic() {
+        var first = RenderRandomSplats(FrameBuffer.Flags.LocalAccumulation);
+        var second = RenderRandomSplats(FrameBuffer.Flags.LocalAccumulation);
+        for (int row = 0; row < 32; ++row) {
+            for (int col = 0; col < 64; ++col) {
+                Assert.Equal(first.GetPixel(col, row), second.GetPixel(col, row));
+            }
+        }
+    }
+
+    [Fact]
+    public void LocalAccumulationMatchesAtomic() {
+        var local = RenderRandomSplats(FrameBuffer.Flags.LocalAccumulation);
+        var atomic = RenderRandomSplats(FrameBuffer.Flags.None);
+        for (int row = 0; row < 32; ++row) {
+            for (int col = 0; col < 64; ++col) {
+                var a = local.GetPixel(col, row);
+                var b = atomic.GetPixel(col, row);
+                Assert.Equal(b.R, a.R, 3);
+                Assert.Equal(b.G * 1e4f, a.G * 1e4f, 3);
+                Assert.Equal(1.0f, a.B / b.B, 3);
+            }
+        }
+    }
+
+    [Fact]
+    public void CheckpointResumesExactly() {
+        var flags = FrameBuffer.Flags.LocalAccumulation | FrameBuffer.Flags.EstimatePixelVariance;
+        FrameBuffer expected = new(64, 32, "", flags);
+        RenderRandomSplats(expected, 0, 4);
+
+        FrameBuffer interrupted = new(64, 32, "", flags);
+        RenderRandomSplats(interrupted, 0, 3);
+        interrupted.WriteCheckpoint("checkpointtest.checkpoint");
+
+        FrameBuffer resumed = new(64, 32, "", flags);
+        resumed.LoadCheckpoint("checkpointtest.checkpoint");
+        Assert.Equal(3, resumed.ResumeIteration);
+        RenderRandomSplats(resumed, (uint)resumed.ResumeIteration, 4);
+
+        Assert.Equal(4, resumed.CurIteration);
+        Assert.Equal(0, resumed.ResumeIteration);
+        for (int row = 0; row < 32; ++row) {
+            for (int col = 0; col < 64; ++col) {
+                Assert.Equal(expected.Image.GetPixel(col, row), resumed.Image.GetPixel(col, row));
+                Assert.Equal(expected.PixelVariance.Image[col, row, 0], resumed.PixelVariance.Image[col, row, 0]);
+                Assert.Equal(expected.OutlierCache.GetPixelOutlier(new(col, row)).Count,
+                    resumed.OutlierCache.GetPixelOutlier(new(col, row)).Count);
+            }
+        }
+    }
+
+    [Fact]
+    public void CheckpointRenderTimeCountsTowardsBudget() {
+        FrameBuffer interrupted = new(64, 32, "");
+        RenderRandomSplats(interrupted, 0, 2);
+        interrupted.WriteCheckpoint("budgettest.checkpoint");
+
+        FrameBuffer resumed = new(64, 32, "");
+        resumed.LoadCheckpoint("budgettest.checkpoint");
+        Assert.Equal(interrupted.RenderTimeMs, resumed.ResumeRenderTimeMs);
+
+        RenderTimer timer = new(resumed.ResumeRenderTimeMs, resumed.ResumeIteration);
+        Assert.Equal(interrupted.RenderTimeMs, timer.RenderTime);
+        Assert.Equal(interrupted.RenderTimeMs / 2, timer.PerIterationCost);
+    }
+
+    [Fact]
+    public void AsynchronousWritesMatchSynchronous() {
+        var flags = FrameBuffer.Flags.WriteContinously | FrameBuffer.Flags.EstimatePixelVariance
+            | FrameBuffer.Flags.LocalAccumulation;
+        FrameBuffer sync = new(64, 32, "asynctest-sync.exr", flags);
+        RenderRandomSplats(sync, 0, 3);
+
+        FrameBuffer background = new(64, 32, "asynctest.exr", flags | FrameBuffer.Flags.WriteAsynchronously) {
+            CheckpointInterval = TimeSpan.FromTicks(1),
+            MaxPendingWrites = 1,
+        };
+        RenderRandomSplats(background, 0, 3);
+        background.FlushWrites();
+
+        // Three images and three checkpoints, none of which is dropped
+        Assert.Equal(6, background.AsyncWrites.NumWrites);
+        Assert.Equal(0, background.AsyncWrites.NumDropped);
+        Assert.Same(background.AsyncWrites, background.MetaData["AsyncWrites"]);
+        Assert.True(background.AsyncWrites.CopyMs <= background.AsyncWrites.SnapshotMs);
+
+        background.SetFrameBufferTime(42);
+        Assert.Equal(42L, (long)background.MetaData["FrameBufferTime"]);
+        Assert.Equal((long)background.AsyncWrites.SavedMs, (long)background.MetaData["FrameBufferTimeSaved"]);
+        Assert.True(File.Exists("asynctest.exr"));
+        Assert.True(File.Exists("asynctest.json"));
+
+        FrameBuffer resumed = new(64, 32, "", flags);
+        resumed.LoadCheckpoint("asynctest.checkpoint");
+        Assert.Equal(3, resumed.ResumeIteration);
+
+        for (int row = 0; row < 32; ++row)
+            for (int col = 0; col < 64; ++col)
+                Assert.Equal(sync.Image.GetPixel(col, row), background.Image.GetPixel(col, row));
+    }
+
+    [Fact]
+    public void PixelVarianceMatchesReference() {
+        // Not a multiple of the SIMD width, and more rows than a single band
+        int width = 37, height = 21, numIterations = 3;
+        VarianceLayer layer = new();
+        layer.Init(width, height);
+
+        double[,] mean = new double[width, height], moment = new double[width, height];
+        for (int iter = 1; iter <= numIterations; ++iter) {
+            layer.OnStartIteration(iter);
+            for (int row = 0; row < height; ++row) {
+                for (int col = 0; col < width; ++col) {
+                    RNG rng = new(7, (uint)(row * width + col), (uint)iter);
+                    float value = rng.NextFloat() * (col + 1);
+                    layer.Splat(col + 0.5f, row + 0.5f, new RgbColor(value, value, value));
+                    mean[col, row] += value / numIterations;
+                    moment[col, row] += value * value / numIterations;
+                }
+            }
+            layer.OnEndIteration(iter);
+        }
+
+        double average = 0;
+        for (int row = 0; row < height; ++row) {
+            for (int col = 0; col < width; ++col) {
+                // Box filter with radius 1 that only averages the pixels within the image
+                double m = 0, m2 = 0;
+                int n = 0;
+                for (int r = Math.Max(row - 1, 0); r <= Math.Min(row + 1, height - 1); ++r) {
+                    for (int c = Math.Max(col - 1, 0); c <= Math.Min(col + 1, width - 1); ++c) {
+                        m += mean[c, r];
+                        m2 += moment[c, r];
+                        n++;
+                    }
+                }
+                m /= n;
+                m2 /= n;
+                double expected = (m2 - m * m) / (m * m + 0.001);
+                average += expected / (width * height);
+                Assert.Equal(expected, layer.Image[col, row, 0], 3);
+            }
+        }
+        Assert.Equal(average, layer.Average, 3);
+    }
+}
@@ -0,0 +1,25 @@
+namespace SeeSharp.Tests.Core;
+
+public class FramePoolTests {
+    [Fact]
+    public void ReturnsZeroedImages() {
+        var image = FramePool.RentMonochrome(13, 7);
+        image[3, 4, 0] = 42;
+        FramePool.Return(image);
+
+        var reused = FramePool.RentMonochrome(13, 7);
+        Assert.Equal(0f, reused[3, 4, 0]);
+        FramePool.Return(reused);
+    }
+
+    [Fact]
+    public void ClearDropsPooledImages() {
+        var image = FramePool.RentRgb(17, 3);
+        FramePool.Return(image);
+        FramePool.Clear();
+
+        var fresh = FramePool.RentRgb(17, 3);
+        Assert.NotSame(image, fresh);
+        FramePool.Return(fresh);
+    }
+}
@@ -63,6 +63,92 @@ public class PlyFiles_Import {
         Assert.Equal(8, mesh.NumVertices);
     }
 
+    [Fact]
+    public void LargeAsciiPly_ParsedInChunks() {
+        // A grid of quads, big enough to be split into several chunks that are parsed in parallel
+        int n = 300;
+        StringBuilder ply = new();
+        ply.Append($"ply\nformat ascii 1.0\nelement vertex {n * n}\nproperty float x\nproperty float y\n");
+        ply.Append($"property float z\nelement face {(n - 1) * (n - 1)}\nproperty list uchar int vertex_indices\n");
+        ply.Append("end_header\n");
+        for (int y = 0; y < n; ++y)
+            for (int x = 0; x < n; ++x)
+                ply.Append($"{x}.5 {y} 1.25e-1\n");
+        for (int y = 0; y < n - 1; ++y)
+            for (int x = 0; x < n - 1; ++x)
+                ply.Append($"4 {y * n + x} {y * n + x + 1} {(y + 1) * n + x + 1} {(y + 1) * n + x}\n");
+        System.IO.File.WriteAllText("large.ply", ply.ToString());
+        Assert.True(ply.Length > 2 << 20);
+
+        PlyFile file = new();
+        Assert.True(file.ParseFile("large.ply"));
+        var mesh = file.ToMesh();
+
+        Assert.Equal(n * n, mesh.NumVertices);
+        Assert.Equal(2 * (n - 1) * (n - 1), mesh.NumFaces);
+        Assert.Equal(new Vector3(7.5f, 123, 0.125f), file.Vertices[123 * n + 7]);
+
+        // Fan triangulation of the last quad
+        int last = (n - 2) * n + n - 2;
+        Assert.Equal(new[] { last, last + 1, last + n + 1, last, last + n + 1, last + n }, file.Indices[^6..]);
+    }
+
+    [Fact]
+    public void BinaryPly_OppositeEndiannessIsSwapped() {
+        // The data is written in the byte order that does not match this machine, so the parser has to swap
+        string format = BitConverter.IsLittleEndian ? "binary_big_endian" : "binary_little_endian";
+        string plyHeader = $@"ply
+format {format} 1.0
+element vertex 4
+property float x
+property float y
+property float z
+property float nx
+property float ny
+property float nz
+property float u
+property float v
+element face 2
+property list uchar int vertex_indices
+end_header
+";
+        float[][] vertices = [
+            [0, 0, 0, 0, 0, 1, 0, 0],
+            [2, 0, 0, 0, 0, 1, 1, 0],
+            [2, 3, 0, 0, 1, 0, 1, 1],
+            [0, 3, 0.5f, 1, 0, 0, 0, 0.25f],
+        ];
+
+        List<byte> data = new();
+        data.AddRange(Encoding.ASCII.GetBytes(plyHeader));
+        void AddSwapped(byte[] bytes) {
+            Array.Reverse(bytes);
+            data.AddRange(bytes);
+        }
+        foreach (var vertex in vertices)
+            foreach (float value in vertex)
+                AddSwapped(BitConverter.GetBytes(value));
+
+        data.Add(4);
+        foreach (int idx in new[] { 0, 1, 2, 3 })
+            AddSwapped(BitConverter.GetBytes(idx));
+        data.Add(3);
+        foreach (int idx in new[] { 3, 2, 1 })
+            AddSwapped(BitConverter.GetBytes(idx));
+        System.IO.File.WriteAllBytes("swapped.ply", data.ToArray());
+
+        PlyFile file = new();
+        Assert.True(file.ParseFile("swapped.ply"));
+
+        Assert.Equal(new Vector3(2, 3, 0), file.Vertices[2]);
+        Assert.Equal(new Vector3(0, 3, 0.5f), file.Vertices[3]);
+        Assert.Equal(new Vector3(0, 1, 0), file.Normals[2]);
+        Assert.Equal(new Vector3(1, 0, 0), file.Normals[3]);
+        Assert.Equal(new Vector2(1, 0), file.Texcoords[1]);
+        Assert.Equal(new Vector2(0, 0.25f), file.Texcoords[3]);
+        Assert.Equal(new[] { 0, 1, 2, 0, 2, 3, 3, 2, 1 }, file.Indices);
+    }
+
     static void CreateTestAsciiPly() {
         string plyCode = @"ply
 format ascii 1.0
@@ -0,0 +1,52 @@
+namespace SeeSharp.Tests.Core.Geometry;
+
+public class RaytracerBatch_Occlusion {
+    static Raytracer MakeScene(out Mesh floor, out Mesh blocker) {
+        floor = new Mesh(
+            [new(-10, 0, -10), new(10, 0, -10), new(10, 0, 10), new(-10, 0, 10)],
+            [0, 2, 1, 0, 3, 2]
+        );
+
+        // Small quad at height 1 that shadows the floor around the origin
+        blocker = new Mesh(
+            [new(-1, 1, -1), new(1, 1, -1), new(1, 1, 1), new(-1, 1, 1)],
+            [0, 2, 1, 0, 3, 2]
+        );
+
+        Raytracer raytracer = new();
+        raytracer.AddMesh(floor);
+        raytracer.AddMesh(blocker);
+        raytracer.CommitScene();
+        return raytracer;
+    }
+
+    static SurfacePoint Trace(Raytracer raytracer, Vector3 origin, Vector3 target)
+    => raytracer.Trace(new Ray { Origin = origin, Direction = Vector3.Normalize(target - origin) });
+
+    [Fact]
+    public void ShadowRaysAreBlockedByQuad() {
+        var raytracer = MakeScene(out var floor, out _);
+        var below = Trace(raytracer, new(0.5f, 0.5f, 0.5f), new(0.5f, 0, 0.5f));
+        var outside = Trace(raytracer, new(5, 0.5f, 5), new(5, 0, 5));
+        Assert.Same(floor, below.Mesh);
+        Assert.Same(floor, outside.Mesh);
+
+        ShadowRay[] rays = [
+            Raytracer.MakeBackgroundShadowRay(below, Vector3.UnitY),
+            Raytracer.MakeBackgroundShadowRay(outside, Vector3.UnitY),
+            Raytracer.MakeShadowRay(below, new Vector3(0.5f, 0.9f, 0.5f)),
+        ];
+        bool[] occluded = new bool[rays.Length];
+        raytracer.IsOccluded(rays, occluded);
+
+        Assert.True(occluded[0]);
+        Assert.False(occluded[1]);
+        Assert.False(occluded[2]);
+    }
+
+    [Fact]
+    public void OutputTooShort_Throws() {
+        var raytracer = MakeScene(out _, out _);
+        Assert.Throws<ArgumentException>(() => raytracer.IsOccluded(new ShadowRay[2], new bool[1]));
+    }
+}
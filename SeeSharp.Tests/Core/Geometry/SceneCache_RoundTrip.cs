@@ -0,0 +1,103 @@
+using SeeSharp.IO;
+
+namespace SeeSharp.Tests.Core.Geometry;
+
+public class SceneCache_RoundTrip {
+    const string SceneJson = """
+    {
+        "transforms": [ { "name": "camera", "position": [0, 0, 5] } ],
+        "cameras": [ { "name": "default", "type": "perspective", "fov": 40, "transform": "camera" } ],
+        "materials": [
+            { "name": "white", "type": "diffuse", "baseColor": { "type": "rgb", "value": [0.8, 0.8, 0.8] } },
+            {
+                "name": "light", "type": "diffuse", "baseColor": { "type": "rgb", "value": [0, 0, 0] },
+                "emission": { "type": "rgb", "value": [5, 4, 3] }
+            }
+        ],
+        "objects": [
+            {
+                "name": "quad", "type": "trimesh", "material": "white",
+                "vertices": [ 0, 0, 0,  2, 0, 0,  2, 1, 0,  0, 1, 0 ],
+                "indices": [ 0, 1, 2,  0, 2, 3 ],
+                "uv": [ 0, 0,  1, 0,  1, 1,  0, 1 ]
+            },
+            {
+                "name": "lamp", "type": "trimesh", "material": "light",
+                "vertices": [ 0, 0, 1,  1, 0, 1,  0, 3, 1 ],
+                "indices": [ 0, 1, 2 ],
+                "normals": [ 0, 0, 1,  0, 0, 1,  0, 0, 1 ]
+            }
+        ]
+    }
+    """;
+
+    [Fact]
+    public void CachedSceneMatchesSource() {
+        string dir = Path.Join(Path.GetTempPath(), "SceneCache_RoundTrip");
+        Directory.CreateDirectory(dir);
+        string path = Path.Join(dir, "scene.json");
+        File.WriteAllText(path, SceneJson);
+        File.Delete(SceneCache.GetCachePath(path));
+
+        var source = Scene.LoadFromFile(path);
+        Assert.True(File.Exists(SceneCache.GetCachePath(path)));
+        var cached = Scene.LoadFromFile(path);
+
+        Assert.Equal(source.Meshes.Count, cached.Meshes.Count);
+        for (int i = 0; i < source.Meshes.Count; ++i) {
+            Mesh a = source.Meshes[i], b = cached.Meshes[i];
+            Assert.Equal(a.Name, b.Name);
+            Assert.Equal(a.Material.Name, b.Material.Name);
+            Assert.Equal(a.Vertices, b.Vertices);
+            Assert.Equal(a.Indices, b.Indices);
+            Assert.Equal(a.HasShadingNormals, b.HasShadingNormals);
+            Assert.Equal(a.TextureCoordinates, b.TextureCoordinates);
+            Assert.Equal(a.TriangleDistribution.Cdf.ToArray(), b.TriangleDistribution.Cdf.ToArray());
+        }
+
+        Assert.Single(cached.Emitters);
+        var emitter = Assert.IsType<DiffuseEmitter>(cached.Emitters[0]);
+        Assert.Equal(new RgbColor(5, 4, 3), emitter.Radiance);
+        Assert.Same(cached.Meshes[1], emitter.Mesh);
+
+        // Editing the scene invalidates the cache
+        File.WriteAllText(path, SceneJson.Replace("[ 0, 0, 0,  2, 0, 0", "[ 0, 0, 0,  4, 0, 0"));
+        var edited = Scene.LoadFromFile(path);
+        Assert.Equal(new Vector3(4, 0, 0), edited.Meshes[0].Vertices[1]);
+    }
+
+    [Fact]
+    public void EditingMtlInvalidatesCache() {
+        string dir = Path.Join(Path.GetTempPath(), "SceneCache_Mtl");
+        Directory.CreateDirectory(dir);
+        string path = Path.Join(dir, "scene.json");
+        File.WriteAllText(path, """
+        {
+            "transforms": [ { "name": "camera", "position": [0, 0, 5] } ],
+            "cameras": [ { "name": "default", "type": "perspective", "fov": 40, "transform": "camera" } ],
+            "materials": [
+                { "name": "lamp", "type": "diffuse", "baseColor": { "type": "rgb", "value": [0, 0, 0] } }
+            ],
+            "objects": [ { "name": "lamp", "type": "obj", "relativePath": "lamp.obj" } ]
+        }
+        """);
+        File.WriteAllText(Path.Join(dir, "lamp.obj"), """
+        mtllib lamp.mtl
+        v 0 0 1
+        v 1 0 1
+        v 0 3 1
+        usemtl lamp
+        f 1 2 3
+        """);
+        File.WriteAllText(Path.Join(dir, "lamp.mtl"), "newmtl lamp\nKe 1 1 1\n");
+        File.Delete(SceneCache.GetCachePath(path));
+
+        var source = Scene.LoadFromFile(path);
+        Assert.Equal(new RgbColor(1, 1, 1), Assert.IsType<DiffuseEmitter>(source.Emitters[0]).Radiance);
+
+        File.WriteAllText(Path.Join(dir, "lamp.mtl"), "newmtl lamp\nKe 2 2 2\n");
+        File.SetLastWriteTimeUtc(Path.Join(dir, "lamp.mtl"), DateTime.UtcNow.AddMinutes(1));
+        var edited = Scene.LoadFromFile(path);
+        Assert.Equal(new RgbColor(2, 2, 2), Assert.IsType<DiffuseEmitter>(edited.Emitters[0]).Radiance);
+    }
+}
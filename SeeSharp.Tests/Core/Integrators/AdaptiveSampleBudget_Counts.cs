@@ -0,0 +1,53 @@
+namespace SeeSharp.Tests.Core.Integrators;
+
+public class AdaptiveSampleBudget_Counts {
+    static VarianceLayer MakeVariance(int width, int height, Func<int, int, float> value) {
+        VarianceLayer layer = new();
+        layer.Init(width, height);
+        for (int row = 0; row < height; ++row)
+            for (int col = 0; col < width; ++col)
+                layer.Image[col, row, 0] = value(col, row);
+        return layer;
+    }
+
+    [Fact]
+    public void TotalMatchesBudget() {
+        var variance = MakeVariance(64, 64, (col, row) => col < 8 ? 4.0f : 0.01f);
+        AdaptiveSampleBudget budget = new();
+
+        long total = 0;
+        for (uint iter = 0; iter < 100; ++iter) {
+            budget.Update(variance, 64 * 64, 7, iter);
+            total += budget.TotalSamples;
+        }
+        Assert.InRange(total / 100.0, 64 * 64 * 0.99, 64 * 64 * 1.01);
+    }
+
+    [Fact]
+    public void NoisyPixelsGetMoreSamples() {
+        var variance = MakeVariance(64, 64, (col, row) => col < 8 ? 4.0f : 0.01f);
+        AdaptiveSampleBudget budget = new();
+        budget.Update(variance, 64 * 64, 7, 0);
+
+        // The weights are the inverse expected counts, which follow the standard deviation
+        float noisy = 1 / budget.SampleWeights[0];
+        float smooth = 1 / budget.SampleWeights[63];
+        Assert.True(noisy > 4 * smooth);
+
+        for (int i = 0; i < budget.NumActive; ++i)
+            Assert.True(budget.SampleCounts[budget.ActivePixels[i]] > 0);
+    }
+
+    [Fact]
+    public void ZeroVarianceIsUniform() {
+        var variance = MakeVariance(16, 8, (col, row) => 0);
+        AdaptiveSampleBudget budget = new();
+        budget.Update(variance, 16 * 8 * 2, 7, 0);
+
+        Assert.Equal(16 * 8, budget.NumActive);
+        for (int i = 0; i < 16 * 8; ++i) {
+            Assert.Equal(2, budget.SampleCounts[i]);
+            Assert.Equal(0.5f, budget.SampleWeights[i]);
+        }
+    }
+}
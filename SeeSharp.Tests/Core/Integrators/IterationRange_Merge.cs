@@ -0,0 +1,146 @@
+using System.Linq;
+
+namespace SeeSharp.Tests.Core.Integrators;
+
+public class IterationRange_Merge {
+    const FrameBuffer.Flags Flags = FrameBuffer.Flags.LocalAccumulation | FrameBuffer.Flags.EstimatePixelVariance;
+
+    static Scene MakeScene() {
+        var scene = new Scene();
+
+        // Diffuse floor facing up
+        scene.Meshes.Add(new Mesh(
+            [new(-1, 0, -1), new(1, 0, -1), new(1, 0, 1), new(-1, 0, 1)],
+            [0, 2, 1, 0, 3, 2]
+        ));
+        scene.Meshes[^1].Material = new DiffuseMaterial(new() { BaseColor = new(new RgbColor(0.8f, 0.5f, 0.2f)) });
+
+        // Area light facing down
+        scene.Meshes.Add(new Mesh(
+            [new(-0.5f, 2, -0.5f), new(0.5f, 2, -0.5f), new(0.5f, 2, 0.5f), new(-0.5f, 2, 0.5f)],
+            [0, 1, 2, 0, 2, 3]
+        ));
+        scene.Meshes[^1].Material = new DiffuseMaterial(new() { BaseColor = new(RgbColor.Black) });
+        scene.Emitters.AddRange(DiffuseEmitter.MakeFromMesh(scene.Meshes[^1], new RgbColor(5, 5, 5)));
+
+        scene.Camera = new PerspectiveCamera(Matrix4x4.CreateLookAt(new Vector3(0, 1, 0),
+            new Vector3(0, 0, 0), new Vector3(0, 0, 1)), 90);
+        scene.FrameBuffer = new FrameBuffer(12, 10, "", Flags);
+        scene.Prepare();
+        return scene;
+    }
+
+    static void CheckMergeMatchesSingleRun(Func<Integrator> makeIntegrator) {
+        var full = MakeScene();
+        makeIntegrator().Render(full);
+
+        // Render the iterations in uneven ranges, like separate workers would
+        int[] rangeStarts = [0, 1, 4, 6];
+        List<string> files = [];
+        for (int i = 0; i < rangeStarts.Length - 1; ++i) {
+            var part = MakeScene();
+            part.FrameBuffer.FirstIteration = rangeStarts[i];
+            part.FrameBuffer.IterationLimit = rangeStarts[i + 1];
+            makeIntegrator().Render(part);
+            Assert.Equal(rangeStarts[i + 1] - rangeStarts[i], part.FrameBuffer.CurIteration);
+
+            files.Add($"rangetest-{i}.checkpoint");
+            part.FrameBuffer.WriteCheckpoint(files[^1]);
+        }
+
+        FrameBuffer merged = new(12, 10, "", Flags);
+        merged.MergeCheckpoints(files);
+        Assert.Equal(6, merged.CurIteration);
+
+        Assert.True(full.FrameBuffer.Image.GetPixel(6, 5).Average > 0);
+        for (int row = 0; row < 10; ++row) {
+            for (int col = 0; col < 12; ++col) {
+                var a = merged.Image.GetPixel(col, row);
+                var b = full.FrameBuffer.Image.GetPixel(col, row);
+                Assert.Equal(b.R, a.R, 4);
+                Assert.Equal(b.G, a.G, 4);
+                Assert.Equal(b.B, a.B, 4);
+                Assert.Equal(full.FrameBuffer.PixelVariance.Image[col, row, 0], merged.PixelVariance.Image[col, row, 0], 3);
+
+                var expectedOutliers = full.FrameBuffer.OutlierCache.GetPixelOutlier(new(col, row)).UnorderedItems
+                    .Select(i => i.Priority).Order();
+                var actualOutliers = merged.OutlierCache.GetPixelOutlier(new(col, row)).UnorderedItems
+                    .Select(i => i.Priority).Order();
+                Assert.Equal(expectedOutliers, actualOutliers);
+            }
+        }
+    }
+
+    [Fact]
+    public void PathTracer_MatchesSingleRun() => CheckMergeMatchesSingleRun(() => new PathTracer {
+        TotalSpp = 6, MaxDepth = 4, EnableDenoiser = false
+    });
+
+    [Fact]
+    public void VertexCacheBidir_MatchesSingleRun() => CheckMergeMatchesSingleRun(() => new VertexCacheBidir {
+        NumIterations = 6, MaxDepth = 4, EnableDenoiser = false
+    });
+
+    [Fact]
+    public void VertexConnectionAndMerging_MatchesSingleRun() => CheckMergeMatchesSingleRun(() => new VertexConnectionAndMerging {
+        NumIterations = 6, MaxDepth = 4, EnableDenoiser = false
+    });
+
+    [Fact]
+    public void Resume_CompleteCheckpointRestoresImage() {
+        var full = MakeScene();
+        new PathTracer { TotalSpp = 3, MaxDepth = 4, EnableDenoiser = false }.Render(full);
+        full.FrameBuffer.WriteCheckpoint("completetest.checkpoint");
+
+        // The checkpoint covers all iterations, so the render loop does not run at all
+        var resumed = MakeScene();
+        new PathTracer { TotalSpp = 3, MaxDepth = 4, EnableDenoiser = false }.Resume(resumed, "completetest.checkpoint");
+
+        Assert.Equal(3, resumed.FrameBuffer.CurIteration);
+        Assert.Equal(full.FrameBuffer.RenderTimeMs, resumed.FrameBuffer.RenderTimeMs);
+        Assert.True(resumed.FrameBuffer.Image.GetPixel(6, 5).Average > 0);
+        for (int row = 0; row < 10; ++row)
+            for (int col = 0; col < 12; ++col)
+                Assert.Equal(full.FrameBuffer.Image.GetPixel(col, row), resumed.FrameBuffer.Image.GetPixel(col, row));
+    }
+
+    [Fact]
+    public void PathTracer_AdaptiveRejectsPartialRange() {
+        var part = MakeScene();
+        part.FrameBuffer.FirstIteration = 2;
+        part.FrameBuffer.IterationLimit = 4;
+        Assert.Throws<NotSupportedException>(() => new PathTracer {
+            TotalSpp = 6, MaxDepth = 4, EnableDenoiser = false, EnableAdaptiveSampling = true
+        }.Render(part));
+    }
+
+    [Fact]
+    public void PathTracer_AdaptiveResumesExactly() {
+        static PathTracer MakeIntegrator(int spp) => new() {
+            TotalSpp = spp, MaxDepth = 4, EnableDenoiser = false, EnableAdaptiveSampling = true,
+            AdaptiveWarmupIterations = 2
+        };
+
+        var full = MakeScene();
+        MakeIntegrator(5).Render(full);
+
+        // Interrupted after the first adaptive iteration, so the warm-up must count the restored ones
+        var interrupted = MakeScene();
+        MakeIntegrator(3).Render(interrupted);
+        interrupted.FrameBuffer.WriteCheckpoint("adaptivetest.checkpoint");
+
+        var resumed = MakeScene();
+        MakeIntegrator(5).Resume(resumed, "adaptivetest.checkpoint");
+        Assert.Equal(5, resumed.FrameBuffer.CurIteration);
+
+        for (int row = 0; row < 10; ++row) {
+            for (int col = 0; col < 12; ++col) {
+                var a = resumed.FrameBuffer.Image.GetPixel(col, row);
+                var b = full.FrameBuffer.Image.GetPixel(col, row);
+                Assert.Equal(b.R, a.R, 4);
+                Assert.Equal(b.G, a.G, 4);
+                Assert.Equal(b.B, a.B, 4);
+            }
+        }
+    }
+}
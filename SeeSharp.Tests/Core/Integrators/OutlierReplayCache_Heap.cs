@@ -0,0 +1,57 @@
+using System.Linq;
+
+namespace SeeSharp.Tests.Core.Integrators;
+
+public class OutlierReplayCache_Heap {
+    [Fact]
+    public void KeepsLargestPerPixel() {
+        using OutlierReplayCache cache = new(8, 4, 3);
+
+        // Many more contributions than tracked, from multiple threads and in shuffled order
+        Parallel.For(0, 100, i => {
+            int iter = (i * 37) % 100;
+            cache.Notify(new(5, 2), new() { Weight = new(iter, iter, iter), Iteration = iter });
+            cache.Notify(new(1, 3), new() { Weight = new(-iter, -iter, -iter), Iteration = iter });
+        });
+        cache.Notify(new(0, 0), new() { Weight = new(float.NaN, 0, 0), Iteration = 1 });
+
+        var iterations = cache.GetOutliers(new(5, 2)).Iterations.ToArray().Order();
+        Assert.Equal(new[] { 97, 98, 99 }, iterations);
+
+        iterations = cache.GetOutliers(new(1, 3)).Iterations.ToArray().Order();
+        Assert.Equal(new[] { 0, 1, 2 }, iterations);
+
+        Assert.Equal(0, cache.GetOutliers(new(0, 0)).Count);
+        Assert.Equal(99f, cache.GetPixelOutlier(new(5, 2)).UnorderedItems.Max(i => i.Priority));
+    }
+
+    [Fact]
+    public void FewerThanTracked() {
+        using OutlierReplayCache cache = new(2, 2, 4);
+        cache.Notify(new(1, 1), new() { Weight = new(2, 2, 2), Iteration = 7 });
+        cache.Notify(new(1, 1), new() { Weight = new(1, 1, 1), Iteration = 3 });
+
+        var outliers = cache.GetPixelOutlier(new(1, 1));
+        Assert.Equal(2, outliers.Count);
+        Assert.Equal(3, outliers.Dequeue().Iteration);
+        Assert.Equal(7, outliers.Dequeue().Iteration);
+    }
+
+    [Fact]
+    public void IterationImagesAreSortedDescending() {
+        using OutlierReplayCache cache = new(3, 2, 3);
+        float[] weights = [0.5f, 4, 2, 8, 1];
+        for (int i = 0; i < weights.Length; ++i)
+            cache.NotifyExclusive(new(2, 1), new() { Weight = new(weights[i], weights[i], weights[i]), Iteration = i });
+        cache.NotifyExclusive(new(0, 0), new() { Weight = new(1, 1, 1), Iteration = 9 });
+
+        MonochromeImage[] images = [new(3, 2), new(3, 2), new(3, 2)];
+        cache.WriteIterationImages(images);
+
+        Assert.Equal(3f, images[0][2, 1, 0]);
+        Assert.Equal(1f, images[1][2, 1, 0]);
+        Assert.Equal(2f, images[2][2, 1, 0]);
+        Assert.Equal(9f, images[0][0, 0, 0]);
+        Assert.Equal(0f, images[1][0, 0, 0]);
+    }
+}
@@ -0,0 +1,176 @@
+namespace SeeSharp.Tests.Core.Integrators;
+
+public class PathCache_Layout {
+    static PathCache MakeCache(Mesh mesh) {
+        PathCache cache = new(3, 4);
+        for (int p = 0; p < 3; ++p) {
+            var vertices = new PathVertex[p + 2];
+            for (int v = 0; v < vertices.Length; ++v) {
+                vertices[v] = new() {
+                    Point = new() {
+                        Position = new(p, v, 1.5f),
+                        Normal = Vector3.Normalize(new(1, v, 2)),
+                        BarycentricCoords = new(0.25f, 0.5f),
+                        Mesh = v == 0 ? null : mesh,
+                        PrimId = (uint)v,
+                        ErrorOffset = 1e-4f,
+                        Distance = 3.0f,
+                    },
+                    PdfFromAncestor = 10 * p + v + 0.5f,
+                    PdfReverseAncestor = 100 * p + v + 0.25f,
+                    PdfNextEventAncestor = v == 1 ? 7 : 0,
+                    DirToAncestor = Vector3.UnitY,
+                    JacobianToAncestor = 0.75f,
+                    Weight = new(p, v, 1),
+                    PathId = p,
+                    Depth = (byte)v,
+                    MaximumRoughness = 0.5f,
+                    FromBackground = p == 1,
+                };
+            }
+            cache.Commit(p, vertices);
+        }
+        cache.Prepare();
+        return cache;
+    }
+
+    [Fact]
+    public void VerticesRoundTrip() {
+        var mesh = new Mesh([new(0, 0, 0), new(1, 0, 0), new(0, 1, 0)], [0, 1, 2]);
+        var cache = MakeCache(mesh);
+
+        Assert.Equal(2 + 3 + 4, cache.NumVertices);
+        var vertex = cache[2, 3];
+        Assert.Equal(new Vector3(2, 3, 1.5f), vertex.Point.Position);
+        Assert.Equal(Vector3.Normalize(new(1, 3, 2)), vertex.Point.Normal);
+        Assert.Equal(new Vector2(0.25f, 0.5f), vertex.Point.BarycentricCoords);
+        Assert.Same(mesh, vertex.Point.Mesh);
+        Assert.Null(cache[2, 0].Point.Mesh);
+        Assert.Equal(3u, vertex.Point.PrimId);
+        Assert.Equal(3.0f, vertex.Point.Distance);
+        Assert.Equal(23.5f, vertex.PdfFromAncestor);
+        Assert.Equal(203.25f, vertex.PdfReverseAncestor);
+        Assert.Equal(Vector3.UnitY, vertex.DirToAncestor);
+        Assert.Equal(new RgbColor(2, 3, 1), vertex.Weight);
+        Assert.Equal(3, vertex.Depth);
+        Assert.Equal(0.5f, vertex.MaximumRoughness);
+        Assert.False(vertex.FromBackground);
+        Assert.True(cache[1, 1].FromBackground);
+
+        // Global indices skip over the paths in order
+        Assert.Equal(new Vector3(1, 0, 1.5f), cache[2].Point.Position);
+
+        int idx = cache.GetPathVertexIndex(2, 3);
+        Assert.Equal(vertex.Point.Position, cache.Positions[idx]);
+        Assert.Equal(cache[2, 2].PdfFromAncestor, cache.PdfsFromAncestor[idx - 1]);
+    }
+
+    [Fact]
+    public void GrazingJacobiansMatchFullPrecision() {
+        // Nearly tangential normals and directions, where any quantization of the cosine shows up
+        var normal = Vector3.Normalize(new(1, 1e-3f, 0.3f));
+        var dir = Vector3.Normalize(new(-0.3f, 2e-3f, 1));
+        PathVertex original = new() {
+            Point = new() { Position = new(0.1f, 0.2f, 0.3f), Normal = normal },
+            DirToAncestor = dir,
+        };
+        PathCache cache = new(1, 1);
+        cache.Commit(0, [original]);
+        cache.Prepare();
+        var cached = cache[0, 0];
+
+        Assert.Equal(normal, cached.Point.Normal);
+        Assert.Equal(dir, cached.DirToAncestor);
+
+        SurfacePoint from = new() { Position = new(0.1f, 5, 0.3f) };
+        float expected = SampleWarp.SurfaceAreaToSolidAngle(from, original.Point);
+        float actual = SampleWarp.SurfaceAreaToSolidAngle(from, cached.Point);
+        Assert.Equal(expected, actual, expected * 1e-6f);
+        Assert.Equal(Vector3.Dot(original.Point.Normal, original.DirToAncestor),
+            Vector3.Dot(cached.Point.Normal, cached.DirToAncestor));
+    }
+
+    [Fact]
+    public void GatherLightPdfsStreamsAncestors() {
+        var cache = MakeCache(null);
+        var lightVertex = cache[2, 3];
+
+        // Two camera vertices, the light vertex, and its three ancestors
+        int numPdfs = 6;
+        BidirPathPdfs pdfs = new(new float[numPdfs], new float[numPdfs]);
+        pdfs.GatherLightPdfs(cache, lightVertex, 1);
+
+        Assert.Equal(23.5f, pdfs.PdfsLightToCamera[2]);
+        Assert.Equal(22.5f, pdfs.PdfsLightToCamera[3]);
+        Assert.Equal(21.5f, pdfs.PdfsLightToCamera[4]);
+        Assert.Equal(1, pdfs.PdfsLightToCamera[5]);
+        Assert.Equal(203.25f, pdfs.PdfsCameraToLight[4]);
+        Assert.Equal(202.25f, pdfs.PdfsCameraToLight[5]);
+        Assert.Equal(0, pdfs.PdfNextEvent);
+    }
+
+    [Fact]
+    public void GlobalIndexSkipsEmptyPaths() {
+        PathCache cache = new(4, 4);
+
+        // Commit in reverse order so the memory layout differs from the global order
+        for (int p = 3; p >= 0; --p) {
+            var vertices = new PathVertex[p % 2 == 0 ? 0 : p];
+            for (int v = 0; v < vertices.Length; ++v)
+                vertices[v] = new() { PathId = p, Depth = (byte)v, Point = new() { Position = new(p, v, 0) } };
+            cache.Commit(p, vertices);
+        }
+        cache.Prepare();
+
+        Assert.Equal(4, cache.NumVertices);
+        (int, int)[] expected = [(1, 0), (3, 0), (3, 1), (3, 2)];
+        for (int i = 0; i < expected.Length; ++i) {
+            Assert.Equal(expected[i], cache.GetVertexPath(i));
+            Assert.Equal(new Vector3(expected[i].Item1, expected[i].Item2, 0), cache[i].Point.Position);
+            Assert.Equal(cache.GetPathVertexIndex(expected[i].Item1, expected[i].Item2), cache.GetVertexOffset(i));
+        }
+    }
+
+    static void CommitLongPaths(PathCache cache, int length) {
+        Parallel.For(0, cache.NumPaths, p => {
+            var vertices = new PathVertex[length];
+            for (int v = 0; v < length; ++v)
+                vertices[v] = new() { PathId = p, PdfFromAncestor = v, Point = new() { Position = new(p, v, 0) } };
+            cache.Commit(p, vertices);
+        });
+        cache.Prepare();
+    }
+
+    [Fact]
+    public void GrowsInsteadOfDroppingPaths() {
+        // Far more vertices than the initial capacity, spread over multiple slabs
+        PathCache cache = new(400, 1);
+        CommitLongPaths(cache, 300);
+
+        Assert.Equal(400 * 300, cache.NumVertices);
+        var positions = cache.Positions;
+        var pdfs = cache.PdfsFromAncestor;
+        for (int p = 0; p < cache.NumPaths; ++p) {
+            Assert.Equal(300, cache.Length(p));
+            for (int v = 0; v < 300; ++v) {
+                int idx = cache.GetPathVertexIndex(p, v);
+                Assert.Equal(new Vector3(p, v, 0), positions[idx]);
+                Assert.Equal(v, pdfs[idx]);
+            }
+        }
+
+        var stats = cache.Stats;
+        Assert.True(stats.NumSlabs > 1);
+        Assert.True(stats.UsedBytes <= stats.AllocatedBytes);
+        Assert.Equal(stats.UsedBytes, stats.PeakUsedBytes);
+
+        // The slabs are reused after clearing
+        cache.Clear();
+        CommitLongPaths(cache, 100);
+        Assert.Equal(400 * 100, cache.NumVertices);
+        Assert.Equal(new Vector3(7, 99, 0), cache[7, 99].Point.Position);
+        Assert.Equal(stats.NumSlabs, cache.Stats.NumSlabs);
+        Assert.Equal(stats.PeakUsedBytes, cache.Stats.PeakUsedBytes);
+        Assert.True(cache.Stats.UsedBytes < stats.UsedBytes);
+    }
+}
@@ -0,0 +1,147 @@
+namespace SeeSharp.Tests.Core.Integrators;
+
+public class PhotonMap_Queries {
+    static Vector3[] RandomPoints(int n, uint seed) {
+        RNG rng = new(seed);
+        var points = new Vector3[n];
+        for (int i = 0; i < n; ++i)
+            points[i] = new Vector3(rng.NextFloat(), rng.NextFloat(), rng.NextFloat()) * 10 - Vector3.One * 5;
+        return points;
+    }
+
+    static List<int> BruteForce(Vector3[] points, Vector3 pos, int k, float radius) {
+        List<int> result = new();
+        for (int i = 0; i < points.Length; ++i)
+            if (Vector3.Distance(points[i], pos) <= radius) result.Add(i);
+        result.Sort((a, b) => Vector3.Distance(points[a], pos).CompareTo(Vector3.Distance(points[b], pos)));
+        if (result.Count > k) result.RemoveRange(k, result.Count - k);
+        result.Sort();
+        return result;
+    }
+
+    [Theory]
+    [InlineData(PhotonMapType.MortonTree, 1, 0.5f)]
+    [InlineData(PhotonMapType.MortonTree, 8, 1.0f)]
+    [InlineData(PhotonMapType.MortonTree, int.MaxValue, 1.5f)]
+    [InlineData(PhotonMapType.HashGrid, 1, 0.5f)]
+    [InlineData(PhotonMapType.HashGrid, 8, 1.0f)]
+    [InlineData(PhotonMapType.HashGrid, int.MaxValue, 1.5f)]
+    public void MatchesBruteForce(PhotonMapType type, int k, float radius) {
+        var points = RandomPoints(20000, 3);
+        var map = PhotonMap<int>.Create(type);
+        map.MaxQueryRadius = 1.0f;
+        map.Resize(points.Length);
+        Parallel.For(0, points.Length, i => map.SetPoint(i, points[i], i));
+        map.Build();
+        Assert.Equal(points.Length, map.NumPoints);
+
+        var queries = RandomPoints(50, 7);
+        foreach (var q in queries) {
+            List<int> found = new();
+            float furthest = 0;
+            map.ForAllNearest(q, k, radius, (pos, idx, dist, numFound, distToFurthest) => {
+                Assert.Equal(points[idx], pos);
+                Assert.Equal(Vector3.Distance(pos, q), dist, 3);
+                furthest = distToFurthest;
+                found.Add(idx);
+            });
+            found.Sort();
+
+            var expected = BruteForce(points, q, k, radius);
+            Assert.Equal(string.Join(",", expected), string.Join(",", found));
+            float expectedFurthest = 0;
+            foreach (int i in expected)
+                expectedFurthest = MathF.Max(expectedFurthest, Vector3.Distance(points[i], q));
+            if (found.Count > 0)
+                Assert.Equal(expectedFurthest, furthest, 3);
+        }
+    }
+
+    [Theory]
+    [InlineData(PhotonMapType.MortonTree)]
+    [InlineData(PhotonMapType.HashGrid)]
+    public void AddPointAndRebuild(PhotonMapType type) {
+        var map = PhotonMap<int>.Create(type);
+        map.AddPoint(new(0, 0, 0), 0);
+        map.AddPoint(new(1, 0, 0), 1);
+        map.AddPoint(new(0, 2, 0), 2);
+        map.Build();
+
+        int count = 0;
+        map.ForAllNearest(Vector3.Zero, 10, 1.5f, (_, idx, _, numFound, _) => {
+            Assert.True(idx < 2);
+            Assert.Equal(2, numFound);
+            count++;
+        });
+        Assert.Equal(2, count);
+
+        map.Clear();
+        map.Build();
+        map.ForAllNearest(Vector3.Zero, 10, 10, (_, _, _, _, _) => Assert.True(false, "map should be empty"));
+    }
+
+    [Theory]
+    [InlineData(PhotonMapType.MortonTree)]
+    [InlineData(PhotonMapType.HashGrid)]
+    public void BuildFromPathCache(PhotonMapType type) {
+        PathCache cache = new(100, 5);
+        for (int p = 0; p < 100; ++p) {
+            var vertices = new PathVertex[p % 5];
+            for (int v = 0; v < vertices.Length; ++v) {
+                vertices[v].Point.Position = new(p, v, 0);
+                vertices[v].Weight = v % 2 == 0 ? RgbColor.White : RgbColor.Black;
+                vertices[v].Depth = (byte)v;
+            }
+            cache.Commit(p, vertices);
+        }
+        cache.Prepare();
+
+        var map = PhotonMap<(int, int)>.Create(type);
+        map.Build(cache, (in PathVertex v) => v.Weight != RgbColor.Black, (p, v) => (p, v));
+
+        // Paths with length 3 and 4 each contain one vertex with index > 0 and white weight
+        Assert.Equal(40, map.NumPoints);
+        map.ForAllNearest(new(42, 2, 0), 1, 0.1f, (pos, data, _, numFound, _) => {
+            Assert.Equal((42, 2), data);
+            Assert.Equal(new Vector3(42, 2, 0), pos);
+        });
+    }
+
+    [Fact]
+    public void HashGridFindsPointsAcrossCellBorders() {
+        var map = PhotonMap<int>.Create(PhotonMapType.HashGrid);
+        map.MaxQueryRadius = 0.1f;
+        map.AddPoint(new(0, 0, 0), 0);
+        map.AddPoint(new(0.099f, 0.099f, 0.099f), 1);
+        map.AddPoint(new(0.101f, 0.101f, 0.101f), 2);
+        map.AddPoint(new(5, 5, 5), 3);
+        map.Build();
+
+        List<int> found = new();
+        map.ForAllNearest(new(0.1f, 0.1f, 0.1f), int.MaxValue, 0.05f, (_, idx, _, _, _) => found.Add(idx));
+        found.Sort();
+        Assert.Equal(new List<int> { 1, 2 }, found);
+
+        // Radius larger than the cells
+        found.Clear();
+        map.ForAllNearest(new(0.1f, 0.1f, 0.1f), int.MaxValue, 1.0f, (_, idx, _, _, _) => found.Add(idx));
+        found.Sort();
+        Assert.Equal(new List<int> { 0, 1, 2 }, found);
+
+        var stats = map.Stats;
+        Assert.Equal("HashGrid", stats.Backend);
+        Assert.Equal(1, stats.NumBuilds);
+        Assert.Equal(2, stats.NumQueries);
+    }
+
+    [Fact]
+    public void HashGridCellsCoverMaxRadiusQuery() {
+        // The bounding box of a query with the maximum radius must fit in a single cell, so it overlaps
+        // at most two cells per axis
+        var map = new HashGridPhotonMap<int> { MaxQueryRadius = 0.25f };
+        map.AddPoint(new(0, 0, 0), 0);
+        map.AddPoint(new(3, 3, 3), 1);
+        map.Build();
+        Assert.Equal(0.5f, map.CellSize);
+    }
+}
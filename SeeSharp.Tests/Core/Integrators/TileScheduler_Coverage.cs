@@ -0,0 +1,45 @@
+namespace SeeSharp.Tests.Core.Integrators;
+
+public class TileScheduler_Coverage {
+    static int[] CountVisits(int width, int height, int tileSize, TileOrder order, int numWorkers) {
+        TileScheduler scheduler = new(width, height, tileSize, order, numWorkers);
+        int[] visits = new int[width * height];
+        scheduler.Run((col, row) => System.Threading.Interlocked.Increment(ref visits[row * width + col]));
+        return visits;
+    }
+
+    [Theory]
+    [InlineData(TileOrder.Scanline)]
+    [InlineData(TileOrder.Morton)]
+    [InlineData(TileOrder.Hilbert)]
+    public void EveryPixelOnce(TileOrder order) {
+        var visits = CountVisits(37, 21, 8, order, 4);
+        Assert.All(visits, v => Assert.Equal(1, v));
+    }
+
+    [Fact]
+    public void MoreWorkersThanTiles() {
+        var visits = CountVisits(5, 3, 16, TileOrder.Morton, 64);
+        Assert.All(visits, v => Assert.Equal(1, v));
+    }
+
+    [Fact]
+    public void RepeatedRunsCoverAgain() {
+        TileScheduler scheduler = new(20, 20, 4, TileOrder.Hilbert, 3);
+        int[] visits = new int[400];
+        for (int i = 0; i < 3; ++i)
+            scheduler.Run((col, row) => System.Threading.Interlocked.Increment(ref visits[row * 20 + col]));
+        Assert.All(visits, v => Assert.Equal(3, v));
+        Assert.Equal(25, scheduler.Stats.NumTiles);
+    }
+
+    [Fact]
+    public void MortonOrderIsLocal() {
+        TileScheduler scheduler = new(64, 64, 16, TileOrder.Morton);
+        // The first four tiles form the top left 2x2 block
+        for (int i = 0; i < 4; ++i) {
+            Assert.True(scheduler.Tiles[i].MinCol < 32);
+            Assert.True(scheduler.Tiles[i].MinRow < 32);
+        }
+    }
+}
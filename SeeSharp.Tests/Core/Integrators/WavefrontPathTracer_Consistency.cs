@@ -0,0 +1,73 @@
+namespace SeeSharp.Tests.Core.Integrators;
+
+public class WavefrontPathTracer_Consistency {
+    static Scene MakeScene(bool textured = false) {
+        var scene = new Scene();
+
+        // Diffuse floor facing up
+        scene.Meshes.Add(new Mesh(
+            [new(-1, 0, -1), new(1, 0, -1), new(1, 0, 1), new(-1, 0, 1)],
+            [0, 2, 1, 0, 3, 2],
+            textureCoordinates: [new(0, 0), new(1, 0), new(1, 1), new(0, 1)]
+        ));
+        scene.Meshes[^1].Material = new DiffuseMaterial(new() { BaseColor = textured
+            ? MakeCheckerboard()
+            : new(new RgbColor(0.8f, 0.5f, 0.2f)) });
+
+        // Area light facing down
+        scene.Meshes.Add(new Mesh(
+            [new(-0.5f, 2, -0.5f), new(0.5f, 2, -0.5f), new(0.5f, 2, 0.5f), new(-0.5f, 2, 0.5f)],
+            [0, 1, 2, 0, 2, 3]
+        ));
+        scene.Meshes[^1].Material = new DiffuseMaterial(new() { BaseColor = new(RgbColor.Black) });
+        scene.Emitters.AddRange(DiffuseEmitter.MakeFromMesh(scene.Meshes[^1], new RgbColor(5, 5, 5)));
+
+        scene.Camera = new PerspectiveCamera(Matrix4x4.CreateLookAt(new Vector3(0, 1, 0),
+            new Vector3(0, 0, 0), new Vector3(0, 0, 1)), 90);
+        scene.FrameBuffer = new FrameBuffer(12, 10, "", FrameBuffer.Flags.None);
+        scene.Prepare();
+        return scene;
+    }
+
+    /// <summary>
+    /// Checkerboard that is much finer than a pixel, so the result depends on the filter footprint
+    /// </summary>
+    static TextureRgb MakeCheckerboard() {
+        RgbImage image = new(256, 256);
+        for (int row = 0; row < 256; ++row)
+            for (int col = 0; col < 256; ++col)
+                image.SetPixel(col, row, (row + col) % 2 == 0 ? new RgbColor(0.9f, 0.6f, 0.1f) : new RgbColor(0.1f, 0.2f, 0.7f));
+        return new(image) { Filter = ImageTexture.FilterMode.Trilinear };
+    }
+
+    static RgbImage Render(Integrator integrator, bool textured = false) {
+        var scene = MakeScene(textured);
+        integrator.Render(scene);
+        return scene.FrameBuffer.Image;
+    }
+
+    [Theory]
+    [InlineData(false)]
+    [InlineData(true)]
+    public void MatchesPathTracer(bool textured) {
+        var expected = Render(new PathTracer {
+            TotalSpp = 4, MaxDepth = 6, NumShadowRays = 2, EnableDenoiser = false
+        }, textured);
+        var actual = Render(new WavefrontPathTracer {
+            TotalSpp = 4, MaxDepth = 6, NumShadowRays = 2, EnableDenoiser = false, TileSize = 8
+        }, textured);
+
+        // The floor below the light must be lit, otherwise the comparison is meaningless
+        Assert.True(expected.GetPixel(6, 5).Average > 0);
+
+        for (int row = 0; row < 10; ++row) {
+            for (int col = 0; col < 12; ++col) {
+                var a = actual.GetPixel(col, row);
+                var b = expected.GetPixel(col, row);
+                Assert.Equal(b.R, a.R, 3);
+                Assert.Equal(b.G, a.G, 3);
+                Assert.Equal(b.B, a.B, 3);
+            }
+        }
+    }
+}
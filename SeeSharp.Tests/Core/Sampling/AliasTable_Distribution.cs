@@ -0,0 +1,39 @@
+namespace SeeSharp.Tests.Core.Sampling;
+
+public class AliasTable_Distribution {
+    [Fact]
+    public void Pdfs_ShouldBeProportional() {
+        var dist = new AliasTable(1, 1, 2, 2, 0);
+
+        Assert.Equal(1.0f / 6.0f, dist.Probability(0), 3);
+        Assert.Equal(1.0f / 6.0f, dist.Probability(1), 3);
+        Assert.Equal(2.0f / 6.0f, dist.Probability(2), 3);
+        Assert.Equal(2.0f / 6.0f, dist.Probability(3), 3);
+        Assert.Equal(0.0f, dist.Probability(4), 3);
+    }
+
+    [Fact]
+    public void AsymptoticDistribution() {
+        var weights = new float[] { 1, 5, 0, 2, 0.5f, 3 };
+        var dist = new AliasTable(weights);
+
+        var counters = new float[weights.Length];
+        int numSteps = 100000;
+        for (int i = 0; i < numSteps; ++i) {
+            float u = (i + 0.5f) / numSteps;
+            counters[dist.Sample(u)] += 1.0f / numSteps;
+        }
+
+        for (int i = 0; i < weights.Length; ++i)
+            Assert.Equal(dist.Probability(i), counters[i], 3);
+        Assert.Equal(0.0f, counters[2]);
+    }
+
+    [Fact]
+    public void AllZero_ShouldBeUniform() {
+        var dist = new AliasTable(0, 0, 0, 0);
+        for (int i = 0; i < 4; ++i)
+            Assert.Equal(0.25f, dist.Probability(i), 4);
+        Assert.Equal(3, dist.Sample(0.9999f));
+    }
+}
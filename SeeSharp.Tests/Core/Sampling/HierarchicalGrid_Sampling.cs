@@ -0,0 +1,46 @@
+namespace SeeSharp.Tests.Core.Sampling;
+
+public class HierarchicalGrid_Sampling {
+    static HierarchicalGrid2d MakeGrid() {
+        // Not a power of two, and with empty cells
+        var grid = new HierarchicalGrid2d(5, 3);
+        float[] values = [1, 0, 2, 4, 1, 0, 0, 3, 1, 1, 5, 2, 0, 1, 2];
+        for (int i = 0; i < values.Length; ++i)
+            grid.Splat(i % 5, i / 5, values[i]);
+        grid.Normalize();
+        return grid;
+    }
+
+    [Fact]
+    public void Histogram_MatchesPdf() {
+        var grid = MakeGrid();
+
+        var counters = new float[15];
+        int n = 300;
+        for (int y = 0; y < n; ++y) {
+            for (int x = 0; x < n; ++x) {
+                var pos = grid.Sample(new((x + 0.5f) / n, (y + 0.5f) / n));
+                int col = (int)(pos.X * 5), row = (int)(pos.Y * 3);
+                counters[row * 5 + col] += 1.0f / (n * n);
+            }
+        }
+
+        for (int i = 0; i < 15; ++i) {
+            var center = new Vector2((i % 5 + 0.5f) / 5, (i / 5 + 0.5f) / 3);
+            Assert.Equal(grid.Pdf(center) / 15, counters[i], 2);
+        }
+        Assert.Equal(0.0f, counters[1]);
+    }
+
+    [Fact]
+    public void SampleInverse_RoundTrips() {
+        var grid = MakeGrid();
+
+        foreach (var primary in new Vector2[] { new(0.1f, 0.2f), new(0.5f, 0.5f), new(0.93f, 0.71f) }) {
+            var pos = grid.Sample(primary);
+            var inverse = grid.SampleInverse(pos);
+            Assert.Equal(primary.X, inverse.X, 3);
+            Assert.Equal(primary.Y, inverse.Y, 3);
+        }
+    }
+}
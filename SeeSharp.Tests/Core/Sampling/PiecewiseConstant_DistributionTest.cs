@@ -73,6 +73,30 @@ namespace SeeSharp.Tests.Core.Sampling {
             Assert.Equal(0.0001f * 6.0f, rel, 6);
         }
 
+        [Fact]
+        public void Search_MatchesLinearScan() {
+            // Sizes below and above the threshold for the SIMD search, with zero-probability runs
+            foreach (int n in new[] { 5, 32, 33, 1000 }) {
+                var weights = new float[n];
+                for (int i = 0; i < n; ++i)
+                    weights[i] = i % 7 < 3 ? 0 : i % 5 + 1;
+                var dist = new PiecewiseConstantPDF(weights);
+
+                var u = new float[203];
+                for (int i = 0; i < u.Length; ++i)
+                    u[i] = i / (float)(u.Length - 1);
+                var batch = new int[u.Length];
+                dist.Sample(u, batch);
+
+                for (int i = 0; i < u.Length; ++i) {
+                    int expected = 0;
+                    while (expected < n - 1 && dist.Cdf[expected] < u[i]) expected++;
+                    Assert.Equal(expected, dist.Sample(u[i]).BinIndex);
+                    Assert.Equal(expected, batch[i]);
+                }
+            }
+        }
+
         [Fact]
         public void Singularity_ShouldBeSampledExclusively() {
             var weights = new float[] {283, 0, 0, 0, 0};
@@ -22,15 +22,24 @@ namespace SeeSharp.Tests.Core.Shading {
             return bgn;
         }
 
+        /// <summary>
+        /// Direction through the center of a pixel, where the bilinear interpolation is exact
+        /// </summary>
+        static Vector3 PixelCenterDirection(int col, int row, int width, int height) {
+            float phi = (col + 0.5f) / width * 2 * MathF.PI;
+            float theta = (row + 0.5f) / height * MathF.PI;
+            return new(MathF.Sin(theta) * MathF.Cos(phi), MathF.Cos(theta), MathF.Sin(theta) * MathF.Sin(phi));
+        }
+
         [Fact]
         public void Radiance_ShouldBeTen() {
             var map = MakeSimpleMap();
 
-            var val = map.EmittedRadiance(Vector3.UnitY + Vector3.UnitZ);
+            var val = map.EmittedRadiance(PixelCenterDirection(128, 64, 512, 256));
 
-            Assert.Equal(10.0f, val.R);
-            Assert.Equal(10.0f, val.G);
-            Assert.Equal(10.0f, val.B);
+            Assert.Equal(10.0f, val.R, 3);
+            Assert.Equal(10.0f, val.G, 3);
+            Assert.Equal(10.0f, val.B, 3);
         }
 
         [Fact]
@@ -62,11 +71,16 @@ namespace SeeSharp.Tests.Core.Shading {
             bgn.SceneCenter = new Vector3(1, 2, 3);
             bgn.SceneRadius = 42;
 
-            var xclr = bgn.EmittedRadiance(new(1, 0, 0));
-            var zclr = bgn.EmittedRadiance(new(0, 0, 1));
+            var xclr = bgn.EmittedRadiance(PixelCenterDirection(0, 128, 512, 256));
+            var zclr = bgn.EmittedRadiance(PixelCenterDirection(128, 128, 512, 256));
+
+            Assert.Equal(10.0f, xclr.R, 3);
+            Assert.Equal(5.0f, zclr.R, 3);
 
-            Assert.Equal(RgbColor.White * 10, xclr);
-            Assert.Equal(RgbColor.White * 5, zclr);
+            // Halfway between the pixel centers, the radiance is interpolated
+            var between = bgn.EmittedRadiance(PixelCenterDirection(0, 128, 512, 256)
+                + PixelCenterDirection(1, 128, 512, 256));
+            Assert.Equal(5.0f, between.R, 2);
         }
 
         [Fact]
@@ -0,0 +1,75 @@
+using System.Linq;
+
+namespace SeeSharp.Tests.Core.Shading;
+
+public class LightBvh_Sampling {
+    static Mesh MakeQuad(Vector3 center, float size, bool facingUp) {
+        var vertices = new Vector3[] {
+            center + new Vector3(-size, 0, -size),
+            center + new Vector3( size, 0, -size),
+            center + new Vector3( size, 0,  size),
+            center + new Vector3(-size, 0,  size),
+        };
+        int[] indices = facingUp ? [0, 2, 1, 0, 3, 2] : [0, 1, 2, 0, 2, 3];
+        return new Mesh(vertices, indices);
+    }
+
+    static List<Emitter> MakeEmitters() {
+        List<Emitter> emitters = [];
+        RNG rng = new(1337);
+        for (int i = 0; i < 50; ++i) {
+            var pos = new Vector3(rng.NextFloat(-10, 10), 5, rng.NextFloat(-10, 10));
+            var quad = MakeQuad(pos, rng.NextFloat(0.1f, 1.0f), facingUp: false);
+            emitters.AddRange(DiffuseEmitter.MakeFromMesh(quad, RgbColor.White * rng.NextFloat(1, 10)));
+        }
+        return emitters;
+    }
+
+    [Fact]
+    public void Probabilities_ShouldSumToOne() {
+        var emitters = MakeEmitters();
+        LightBvh bvh = new(emitters);
+
+        Vector3 pos = new(1, 0, 2);
+        Vector3 normal = Vector3.UnitY;
+        float sum = 0;
+        for (int i = 0; i < emitters.Count; ++i)
+            sum += bvh.Probability(pos, normal, i);
+
+        Assert.Equal(1.0f, sum, 3);
+    }
+
+    [Fact]
+    public void SampledPmf_ShouldMatchProbability() {
+        var emitters = MakeEmitters();
+        LightBvh bvh = new(emitters);
+
+        Vector3 pos = new(-3, 1, 4);
+        Vector3 normal = Vector3.Normalize(new(0.2f, 1, 0));
+        float[] histogram = new float[emitters.Count];
+        int numSamples = 100000;
+        for (int k = 0; k < numSamples; ++k) {
+            var (idx, pmf) = bvh.Sample(pos, normal, (k + 0.5f) / numSamples);
+            Assert.Equal(bvh.Probability(pos, normal, idx), pmf, 4);
+            histogram[idx] += 1.0f / numSamples;
+        }
+
+        for (int i = 0; i < emitters.Count; ++i)
+            Assert.Equal(bvh.Probability(pos, normal, i), histogram[i], 2);
+    }
+
+    [Fact]
+    public void BackFacingEmitter_ShouldNotBeSelected() {
+        var front = DiffuseEmitter.MakeFromMesh(MakeQuad(new(0, 5, 0), 1, facingUp: false), RgbColor.White);
+        var back = DiffuseEmitter.MakeFromMesh(MakeQuad(new(3, 5, 0), 1, facingUp: true), RgbColor.White);
+        var emitters = front.Concat(back).ToList();
+        LightBvh bvh = new(emitters);
+
+        Vector3 pos = Vector3.Zero;
+        for (int i = 0; i < emitters.Count; ++i) {
+            float p = bvh.Probability(pos, Vector3.UnitY, i);
+            if (i < front.Count()) Assert.True(p > 0);
+            else Assert.Equal(0.0f, p);
+        }
+    }
+}
@@ -0,0 +1,63 @@
+namespace SeeSharp.Tests.Core.Shading;
+
+public class Texture_Cache {
+    static (RgbImage, string) MakeImage(string name) {
+        RgbImage image = new(20, 12);
+        for (int row = 0; row < image.Height; ++row)
+            for (int col = 0; col < image.Width; ++col)
+                image.SetPixel(col, row, new RgbColor(col / 20.0f, row / 12.0f, 0.5f));
+
+        string dir = Path.Join(Path.GetTempPath(), "Texture_Cache");
+        Directory.CreateDirectory(dir);
+        string path = Path.Join(dir, name);
+        image.WriteToFile(path);
+
+        // Compare against the image as it was stored, in case the file format is lossy
+        return (new RgbImage(path), path);
+    }
+
+    [Fact]
+    public void TilesMatchImageWithinBudget() {
+        var (image, path) = MakeImage("float.exr");
+        using TextureCache cache = new() {
+            TileSize = 4,
+            BudgetBytes = 3 * 4 * 4 * 3 * sizeof(float),
+            Directory = Path.Join(Path.GetTempPath(), "Texture_Cache", "tiles"),
+        };
+        TextureRgb texture = new(path, cache) { Filter = ImageTexture.FilterMode.Nearest };
+
+        // Visit the texels tile by tile, so each tile only needs to be loaded once
+        for (int tile = 0; tile < 5 * 3; ++tile) {
+            for (int i = 0; i < 4 * 4; ++i) {
+                int col = tile % 5 * 4 + i % 4;
+                int row = tile / 5 * 4 + i / 4;
+                var uv = new Vector2((col + 0.5f) / image.Width, (row + 0.5f) / image.Height);
+                Assert.Equal(image.GetPixel(col, row), texture.Lookup(uv));
+            }
+        }
+
+        var stats = cache.Stats;
+        Assert.Equal(5ul * 3, stats.NumMisses);
+        Assert.Equal(20ul * 12 - 15, stats.NumHits);
+        Assert.True(stats.NumEvictions > 0);
+        Assert.True(stats.ResidentBytes <= (ulong)cache.BudgetBytes);
+    }
+
+    [Fact]
+    public void CompactFormats() {
+        var (image, path) = MakeImage("compact.exr");
+        foreach (var format in new[] { TileFormat.Half, TileFormat.Srgb8 }) {
+            using TextureCache cache = new() {
+                TileSize = 8,
+                Format = format,
+                Directory = Path.Join(Path.GetTempPath(), "Texture_Cache", "tiles"),
+            };
+            TextureRgb texture = new(path, cache) { Filter = ImageTexture.FilterMode.Nearest };
+            var expected = image.GetPixel(13, 7);
+            var actual = texture.Lookup(new((13 + 0.5f) / image.Width, (7 + 0.5f) / image.Height));
+            Assert.Equal(expected.R, actual.R, 2);
+            Assert.Equal(expected.G, actual.G, 2);
+            Assert.Equal(expected.B, actual.B, 2);
+        }
+    }
+}
@@ -0,0 +1,59 @@
+namespace SeeSharp.Tests.Core.Shading;
+
+public class Texture_Filtering {
+    static TextureMono MakeCheckerboard(int size) {
+        MonochromeImage image = new(size, size);
+        for (int row = 0; row < size; ++row)
+            for (int col = 0; col < size; ++col)
+                image[col, row, 0] = (row + col) % 2;
+        return new TextureMono(image);
+    }
+
+    [Fact]
+    public void MipPyramid_AveragesTexels() {
+        var texture = MakeCheckerboard(4);
+
+        Assert.Equal(3, texture.NumMipLevels);
+        Assert.Equal(2, texture.GetMipLevel(1).Width);
+        Assert.Equal(1, texture.GetMipLevel(2).Width);
+        Assert.Equal(0.5f, texture.GetMipLevel(1)[1, 0, 0]);
+        Assert.Equal(0.5f, texture.GetMipLevel(2)[0, 0, 0]);
+    }
+
+    [Fact]
+    public void Bilinear_InterpolatesBetweenTexelCenters() {
+        var texture = MakeCheckerboard(4);
+        texture.Filter = ImageTexture.FilterMode.Bilinear;
+
+        Assert.Equal(1.0f, texture.Lookup(new(1.5f / 4, 0.5f / 4)), 4);
+        Assert.Equal(0.0f, texture.Lookup(new(0.5f / 4, 0.5f / 4)), 4);
+        Assert.Equal(0.5f, texture.Lookup(new(1.0f / 4, 0.5f / 4)), 4);
+    }
+
+    [Fact]
+    public void Trilinear_WideFootprintIsAverage() {
+        var texture = MakeCheckerboard(8);
+        texture.Filter = ImageTexture.FilterMode.Trilinear;
+
+        Assert.Equal(0.5f, texture.Lookup(new(0.3f, 0.7f), 1.0f), 4);
+        Assert.Equal(0.5f, texture.Lookup(new(0.3f, 0.7f), 0.3f), 4);
+
+        texture.Filter = ImageTexture.FilterMode.Nearest;
+        Assert.Equal(1.0f, texture.Lookup(new(0.3f, 0.7f), 1.0f));
+    }
+
+    [Fact]
+    public void CameraDifferential_MatchesPixelSize() {
+        var camTransform = Matrix4x4.CreateLookAt(Vector3.Zero, new Vector3(0, 0, 10), Vector3.UnitY);
+        var camera = new PerspectiveCamera(camTransform, 90);
+        camera.UpdateResolution(100, 100);
+
+        RNG rng = new();
+        var sample = camera.GenerateRay(new Vector2(50, 50), ref rng);
+
+        // The film spans 20 units at a distance of 10, so one pixel covers 0.2 units on the plane z = 10
+        float distance = 10 / sample.Ray.Direction.Z;
+        float footprint = sample.Differential.ComputeFootprint(sample.Ray, distance, -Vector3.UnitZ);
+        Assert.Equal(0.2f, footprint, 2);
+    }
+}
@@ -234,6 +234,9 @@ namespace SeeSharpToMitsuba {
                 return 1;
             }
 
+            // The textures are written back to files, so we need the full images in memory
+            TextureCache.Shared = null;
+
             var sceneData = Scene.LoadFromFile(scene.FullName);
             if (sceneData == null) {
                 Logger.Log($"Scene file '{scene.FullName}' is an invalid scene", Verbosity.Error);
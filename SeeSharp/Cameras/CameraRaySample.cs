@@ -32,5 +32,11 @@ namespace SeeSharp.Cameras {
         /// Same unit as <see cref="PdfRay" />.
         /// </summary>
         public float PdfConnect;
+
+        /// <summary>
+        /// Change of the ray when moving one pixel on the film, used to compute texture footprints.
+        /// Zero if the camera does not support ray differentials.
+        /// </summary>
+        public RayDifferential Differential;
     }
 }
@@ -64,18 +64,19 @@ public class PerspectiveCamera : Camera {
     public override CameraRaySample GenerateRay(Vector2 filmPos, ref RNG rng) {
         Debug.Assert(Width != 0 && Height != 0);
 
-        // Transform the direction from film to world space.
-        // The view space is vertically flipped compared to the film.
-        var view = new Vector3(2 * filmPos.X / Width - 1, 1 - 2 * filmPos.Y / Height, 0);
-        var localDir = Vector3.Transform(view, viewToCamera);
-        var dirHomo = Vector4.Transform(new Vector4(localDir, 0), cameraToWorld);
-        var dir = new Vector3(dirHomo.X, dirHomo.Y, dirHomo.Z);
+        var dir = FilmToWorldDirection(filmPos);
 
         // Compute the camera position
         var pos = Vector3.Transform(new Vector3(0, 0, 0), cameraToWorld);
 
         var ray = new Ray { Direction = Vector3.Normalize(dir), MinDistance = 0, Origin = pos };
 
+        // Differentials of the pinhole ray w.r.t. a one pixel offset on the film
+        RayDifferential differential = new() {
+            DxDirection = Vector3.Normalize(FilmToWorldDirection(filmPos + Vector2.UnitX)) - ray.Direction,
+            DyDirection = Vector3.Normalize(FilmToWorldDirection(filmPos + Vector2.UnitY)) - ray.Direction,
+        };
+
         // Sample depth of field
         float pdfLens = 1;
         if (lensRadius > 0) {
@@ -97,10 +98,23 @@ public class PerspectiveCamera : Camera {
             Weight = RgbColor.White,
             Point = new SurfacePoint { Position = Position, Normal = Direction },
             PdfRay = SolidAngleToPixelJacobian(pos + dir) * pdfLens,
-            PdfConnect = pdfLens
+            PdfConnect = pdfLens,
+            Differential = differential
         };
     }
 
+    /// <summary>
+    /// Transforms the direction from film to world space.
+    /// </summary>
+    /// <returns>The (not normalized) world space direction through the film position</returns>
+    Vector3 FilmToWorldDirection(Vector2 filmPos) {
+        // The view space is vertically flipped compared to the film.
+        var view = new Vector3(2 * filmPos.X / Width - 1, 1 - 2 * filmPos.Y / Height, 0);
+        var localDir = Vector3.Transform(view, viewToCamera);
+        var dirHomo = Vector4.Transform(new Vector4(localDir, 0), cameraToWorld);
+        return new Vector3(dirHomo.X, dirHomo.Y, dirHomo.Z);
+    }
+
     /// <summary>
     /// Samples a point on the camera lens that sees the given surface point. Returns an invalid
     /// sample if there is no such point.
@@ -0,0 +1,40 @@
+namespace SeeSharp.Cameras;
+
+/// <summary>
+/// Change of a ray's origin and direction when moving one pixel on the film in x or y direction.
+/// </summary>
+public struct RayDifferential {
+    /// <summary>
+    /// Change of the origin per pixel in x / y direction
+    /// </summary>
+    public Vector3 DxOrigin, DyOrigin;
+
+    /// <summary>
+    /// Change of the (normalized) direction per pixel in x / y direction
+    /// </summary>
+    public Vector3 DxDirection, DyDirection;
+
+    /// <summary>
+    /// The angle by which the ray widens per unit distance, i.e., the spread of a ray cone
+    /// </summary>
+    public readonly float Spread => MathF.Max(DxDirection.Length(), DyDirection.Length());
+
+    /// <summary>
+    /// Transfers the differentials to the tangent plane at an intersection, following Igehy's
+    /// "Tracing Ray Differentials"
+    /// </summary>
+    /// <param name="ray">The ray that found the intersection</param>
+    /// <param name="distance">Distance along the ray to the intersection</param>
+    /// <param name="normal">Surface normal at the intersection</param>
+    /// <returns>Width of the pixel footprint on the surface, in world space units</returns>
+    public readonly float ComputeFootprint(in Ray ray, float distance, Vector3 normal) {
+        float cosine = Vector3.Dot(ray.Direction, normal);
+        if (MathF.Abs(cosine) < 1e-4f) cosine = MathF.CopySign(1e-4f, cosine);
+
+        var dpdx = DxOrigin + distance * DxDirection;
+        var dpdy = DyOrigin + distance * DyDirection;
+        dpdx -= Vector3.Dot(dpdx, normal) / cosine * ray.Direction;
+        dpdy -= Vector3.Dot(dpdy, normal) / cosine * ray.Direction;
+        return MathF.Max(dpdx.Length(), dpdy.Length());
+    }
+}
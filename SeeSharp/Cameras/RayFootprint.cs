@@ -0,0 +1,37 @@
+namespace SeeSharp.Cameras;
+
+/// <summary>
+/// Tracks the width of a pixel's footprint along a path that starts at the camera. The primary hit uses
+/// the exact ray differentials, after that the footprint grows like a ray cone with the spread of the
+/// camera ray. The default value (e.g., for light paths) has a zero footprint everywhere, i.e., textures
+/// are looked up at full resolution.
+/// </summary>
+public struct RayFootprint {
+    RayDifferential differential;
+    bool isPrimary;
+    float width;
+    float spread;
+
+    /// <param name="differential">Differentials of the camera ray</param>
+    public RayFootprint(in RayDifferential differential) {
+        this.differential = differential;
+        isPrimary = true;
+        spread = differential.Spread;
+    }
+
+    /// <summary>
+    /// Advances the footprint to the next intersection along the path
+    /// </summary>
+    /// <param name="ray">The ray that found the intersection</param>
+    /// <param name="hit">The intersection</param>
+    /// <returns>Width of the footprint at the intersection in world space</returns>
+    public float Advance(in Ray ray, in SurfacePoint hit) {
+        if (isPrimary) {
+            width = differential.ComputeFootprint(ray, hit.Distance, hit.Normal);
+            isPrimary = false;
+        } else {
+            width += spread * hit.Distance;
+        }
+        return width;
+    }
+}
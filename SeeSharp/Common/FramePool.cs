@@ -0,0 +1,92 @@
+using System.Collections.Concurrent;
+
+namespace SeeSharp.Common;
+
+/// <summary>
+/// Pool of frame-sized images that are only needed for a while, e.g., scratch buffers within an iteration
+/// or the technique images of a single rendering. Such images live on the large object heap, which is only
+/// cleaned up by full (gen2) collections. Renting them from here instead of allocating new ones avoids
+/// these collections and the long pauses they cause on machines with many cores.
+/// </summary>
+public static class FramePool {
+    /// <summary>
+    /// Maximum total size in bytes of the unused images that are kept. Returned images beyond that are
+    /// left to the garbage collector.
+    /// </summary>
+    public static long MaxPooledBytes = 1L << 30;
+
+    /// <summary>
+    /// Size in bytes of the unused images that <see cref="Trim"/> keeps, e.g., between two renderings
+    /// </summary>
+    public static long MaxRetainedBytes = 1L << 28;
+
+    /// <summary>
+    /// Total size in bytes of the images that are currently in the pool
+    /// </summary>
+    public static long PooledBytes => Interlocked.Read(ref pooledBytes);
+    static long pooledBytes;
+
+    static readonly ConcurrentDictionary<(bool IsRgb, int Width, int Height), ConcurrentBag<Image>> pool = new();
+
+    static long SizeInBytes(Image image) => (long)image.Width * image.Height * image.NumChannels * sizeof(float);
+
+    /// <param name="width">Width in pixels</param>
+    /// <param name="height">Height in pixels</param>
+    /// <param name="clear">If false, the pixels of a reused image keep their values, e.g., for copies</param>
+    /// <returns>A monochrome image, with all pixels set to zero if <paramref name="clear"/> is true</returns>
+    public static MonochromeImage RentMonochrome(int width, int height, bool clear = true)
+    => Rent(false, width, height, clear) as MonochromeImage ?? new(width, height);
+
+    /// <param name="width">Width in pixels</param>
+    /// <param name="height">Height in pixels</param>
+    /// <param name="clear">If false, the pixels of a reused image keep their values, e.g., for copies</param>
+    /// <returns>An RGB image, with all pixels set to zero if <paramref name="clear"/> is true</returns>
+    public static RgbImage RentRgb(int width, int height, bool clear = true)
+    => Rent(true, width, height, clear) as RgbImage ?? new(width, height);
+
+    /// <summary>
+    /// Puts an image back into the pool. The caller must not use it afterwards.
+    /// </summary>
+    public static void Return(Image image) {
+        if (image is not (RgbImage or MonochromeImage)) return;
+        long size = SizeInBytes(image);
+        if (Interlocked.Add(ref pooledBytes, size) > MaxPooledBytes) {
+            Interlocked.Add(ref pooledBytes, -size);
+            return;
+        }
+        pool.GetOrAdd((image is RgbImage, image.Width, image.Height), _ => []).Add(image);
+    }
+
+    /// <summary>
+    /// Drops pooled images until at most <see cref="MaxRetainedBytes"/> are left. Called at the end of
+    /// a rendering, so the scratch images of a large frame do not stay alive for the rest of the process.
+    /// </summary>
+    public static void Trim() => TrimTo(MaxRetainedBytes);
+
+    /// <summary>
+    /// Drops all pooled images, so they can be garbage collected
+    /// </summary>
+    public static void Clear() => TrimTo(0);
+
+    static void TrimTo(long maxBytes) {
+        foreach (var bag in pool.Values) {
+            while (PooledBytes > maxBytes && bag.TryTake(out var image))
+                Interlocked.Add(ref pooledBytes, -SizeInBytes(image));
+        }
+    }
+
+    static Image Rent(bool isRgb, int width, int height, bool clear) {
+        if (!pool.TryGetValue((isRgb, width, height), out var bag) || !bag.TryTake(out var image))
+            return null;
+        Interlocked.Add(ref pooledBytes, -SizeInBytes(image));
+        if (!clear)
+            return image;
+
+        Parallel.For(0, height, row => {
+            for (int col = 0; col < width; ++col)
+                for (int chan = 0; chan < image.NumChannels; ++chan)
+                    image[col, row, chan] = 0;
+        });
+        return image;
+    }
+}
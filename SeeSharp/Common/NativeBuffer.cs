@@ -0,0 +1,61 @@
+using System.Runtime.InteropServices;
+
+namespace SeeSharp.Common;
+
+/// <summary>
+/// Zero-initialized array of unmanaged values that lives outside of the managed heap. The garbage
+/// collector neither scans nor moves it, so large buffers that stay alive for the whole rendering do not
+/// add to the duration of full collections. The memory is released by <see cref="Dispose" />, or by the
+/// finalizer if that is never called.
+/// </summary>
+/// <typeparam name="T">Element type, must not contain references</typeparam>
+public sealed unsafe class NativeBuffer<T> : IDisposable where T : unmanaged {
+    T* data;
+
+    /// <summary> Number of elements </summary>
+    public long Length { get; }
+
+    /// <param name="length">Number of elements, all of which are initialized to zero</param>
+    public NativeBuffer(long length) {
+        Length = length;
+        data = (T*)NativeMemory.AllocZeroed((nuint)length, (nuint)sizeof(T));
+        if (SizeInBytes > 0)
+            GC.AddMemoryPressure(SizeInBytes);
+    }
+
+    /// <summary> Size of the allocation in bytes </summary>
+    public long SizeInBytes => Length * sizeof(T);
+
+    /// <summary> Reference to an element, no bounds checks are done in release builds </summary>
+    public ref T this[long idx] {
+        get {
+            Debug.Assert(idx >= 0 && idx < Length);
+            return ref data[idx];
+        }
+    }
+
+    /// <returns> A span over a range of elements </returns>
+    public Span<T> Slice(long start, int length) {
+        Debug.Assert(start >= 0 && start + length <= Length);
+        return new(data + start, length);
+    }
+
+    /// <summary> Sets all elements to zero </summary>
+    public void Clear() => NativeMemory.Clear(data, (nuint)SizeInBytes);
+
+    /// <summary> Releases the memory, the buffer must not be used afterwards </summary>
+    public void Dispose() {
+        Free();
+        GC.SuppressFinalize(this);
+    }
+
+    ~NativeBuffer() => Free();
+
+    void Free() {
+        if (data == null) return;
+        NativeMemory.Free(data);
+        data = null;
+        if (SizeInBytes > 0)
+            GC.RemoveMemoryPressure(SizeInBytes);
+    }
+}
@@ -29,6 +29,12 @@ public class Benchmark {
         this.computeErrorMetrics = computeErrorMetrics;
     }
 
+    /// <summary>
+    /// If greater than zero, the state of each method's rendering is checkpointed at this interval. Runs
+    /// that were interrupted continue from their last checkpoint when the benchmark is run again.
+    /// </summary>
+    public TimeSpan CheckpointInterval { get; init; } = TimeSpan.Zero;
+
     /// <summary>
     /// Renders all scenes with all methods, generating one result directory per scene.
     /// If the reference images do not exist yet, they are also rendered. Each method's
@@ -76,6 +82,7 @@ public class Benchmark {
 
             Logger.Log($"Rendering {sceneConfig.Name} with {method.Name}");
             scene.FrameBuffer = MakeFrameBuffer(Path.Join(dir, $"{method.Name}.exr"));
+            scene.FrameBuffer.CheckpointInterval = CheckpointInterval;
             method.Integrator.MaxDepth = sceneConfig.MaxDepth;
             method.Integrator.MinDepth = sceneConfig.MinDepth;
 
@@ -85,11 +92,12 @@ public class Benchmark {
             scene.Raytracer.ResetStats();
             ShadingStatCounter.Reset();
 
-            method.Integrator.Render(scene);
+            method.Integrator.Resume(scene);
 
             scene.FrameBuffer.MetaData["RayStats"] = scene.Raytracer.Stats;
             scene.FrameBuffer.MetaData["ShadeStats"] = ShadingStatCounter.Current;
             scene.FrameBuffer.WriteToFile();
+            File.Delete(scene.FrameBuffer.CheckpointFilename);
 
             if (experiment.DeleteMethodAfterRun) {
                 methods.RemoveAt(i);
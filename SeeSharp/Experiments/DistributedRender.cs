@@ -0,0 +1,232 @@
+using System.Linq;
+using System.Text.Json.Nodes;
+using System.Text.Json.Serialization;
+
+namespace SeeSharp.Experiments;
+
+/// <summary>
+/// Renders a scene with multiple processes, on one or many machines, that each render a range of the
+/// iterations. Every iteration is seeded by its index, so the merged image equals that of a single
+/// process, up to floating point rounding. All communication happens through files in a shared job
+/// directory: the job description, a claim file for each range that is being rendered, and frame buffer
+/// checkpoints with the results.
+/// </summary>
+/// <remarks>
+/// Workers are started by running a program that calls <see cref="RunWorker(string)"/> with the
+/// <see cref="JobFile"/>, e.g., "SeeSharp.PreviewRender --job [file]". Any number of them can be started
+/// on any machine that sees the job directory and the scene under the same path. Each worker claims and
+/// renders ranges until none are left.
+/// </remarks>
+public class DistributedRender {
+    /// <summary>
+    /// Everything a worker needs to render its ranges
+    /// </summary>
+    public class Job {
+        /// <summary> Path to the .json file of the scene </summary>
+        public string SceneFile { get; set; }
+
+        /// <summary> Width of the image in pixels </summary>
+        public int Width { get; set; }
+
+        /// <summary> Height of the image in pixels </summary>
+        public int Height { get; set; }
+
+        /// <summary> Flags of the worker frame buffers, output flags are ignored </summary>
+        public FrameBuffer.Flags Flags { get; set; }
+
+        /// <summary> Full type name of the integrator </summary>
+        public string Integrator { get; set; }
+
+        /// <summary> Serialized settings of the integrator </summary>
+        public JsonNode Settings { get; set; }
+
+        /// <summary> Index of the first iteration in each range, followed by the total number of iterations </summary>
+        public int[] RangeStarts { get; set; }
+
+        /// <summary> How often workers checkpoint their progress, zero disables checkpoints </summary>
+        public TimeSpan CheckpointInterval { get; set; }
+
+        /// <summary> Number of iteration ranges </summary>
+        [JsonIgnore] public int NumRanges => RangeStarts.Length - 1;
+    }
+
+    /// <summary>
+    /// The shared directory with the job description and results
+    /// </summary>
+    public string Directory { get; }
+
+    /// <summary>
+    /// The job description that is passed to the workers
+    /// </summary>
+    public string JobFile => Path.Join(Directory, "Job.json");
+
+    /// <param name="directory">The shared directory, created if it does not exist</param>
+    public DistributedRender(string directory) {
+        Directory = Path.GetFullPath(directory);
+        System.IO.Directory.CreateDirectory(Directory);
+    }
+
+    /// <summary>
+    /// Splits the iterations into ranges of roughly equal size and writes the job description. Results
+    /// of a previous job in the same directory are deleted.
+    /// </summary>
+    /// <param name="sceneFile">Path to the .json file of the scene</param>
+    /// <param name="integrator">The integrator with all its settings</param>
+    /// <param name="numIterations">
+    ///     Total number of iterations, i.e., the TotalSpp or NumIterations setting of the integrator
+    /// </param>
+    /// <param name="width">Width of the image in pixels</param>
+    /// <param name="height">Height of the image in pixels</param>
+    /// <param name="numRanges">Number of ranges, at least the number of workers</param>
+    /// <param name="flags">Frame buffer flags, must match those of the frame buffer that is merged into</param>
+    /// <param name="checkpointInterval">How often workers checkpoint, zero disables checkpoints</param>
+    public void CreateJob(string sceneFile, Integrator integrator, int numIterations, int width, int height,
+                          int numRanges, FrameBuffer.Flags flags = FrameBuffer.Flags.Recommended,
+                          TimeSpan checkpointInterval = default) {
+        numRanges = Math.Clamp(numRanges, 1, numIterations);
+        Job job = new() {
+            SceneFile = Path.GetFullPath(sceneFile),
+            Width = width,
+            Height = height,
+            Flags = flags & ~(FrameBuffer.Flags.WriteIntermediate | FrameBuffer.Flags.WriteContinously
+                | FrameBuffer.Flags.SendToTev),
+            Integrator = integrator.GetType().FullName,
+            Settings = JsonSerializer.SerializeToNode(integrator, integrator.GetType(), serializerOptions),
+            RangeStarts = Enumerable.Range(0, numRanges + 1).Select(i => (int)((long)i * numIterations / numRanges)).ToArray(),
+            CheckpointInterval = checkpointInterval,
+        };
+
+        foreach (string file in System.IO.Directory.EnumerateFiles(Directory, "Range*"))
+            File.Delete(file);
+
+        string tempName = JobFile + ".tmp";
+        File.WriteAllText(tempName, JsonSerializer.Serialize(job, serializerOptions));
+        File.Move(tempName, JobFile, true);
+        Logger.Log($"Created job with {numRanges} ranges of {numIterations} iterations in {Directory}");
+    }
+
+    /// <summary>
+    /// Starts worker processes on this machine. The path to the <see cref="JobFile"/> is appended to the
+    /// given arguments.
+    /// </summary>
+    /// <param name="numWorkers">Number of processes to start</param>
+    /// <param name="executable">The worker program</param>
+    /// <param name="arguments">Arguments before the job file, e.g., "--job"</param>
+    /// <returns>The started processes</returns>
+    public Process[] LaunchWorkers(int numWorkers, string executable, params string[] arguments) {
+        var processes = new Process[numWorkers];
+        for (int i = 0; i < numWorkers; ++i) {
+            ProcessStartInfo info = new(executable, [.. arguments, JobFile]) {
+                UseShellExecute = false
+            };
+            processes[i] = Process.Start(info);
+        }
+        return processes;
+    }
+
+    /// <summary>
+    /// Blocks until all ranges are rendered, or the timeout expires
+    /// </summary>
+    /// <param name="timeout">Maximum time to wait, infinite if not given</param>
+    /// <param name="workers">
+    ///     If given, waiting stops as soon as all of these processes have exited, even if ranges are missing
+    /// </param>
+    /// <returns>True if all ranges are done</returns>
+    public bool WaitForRanges(TimeSpan? timeout = null, Process[] workers = null) {
+        var job = LoadJob(JobFile);
+        var timer = Stopwatch.StartNew();
+        int numReported = -1;
+        while (true) {
+            int numDone = Enumerable.Range(0, job.NumRanges).Count(r => File.Exists(ResultFile(Directory, r)));
+            if (numDone != numReported) {
+                Logger.Log($"{numDone} of {job.NumRanges} ranges done");
+                numReported = numDone;
+            }
+            if (numDone == job.NumRanges)
+                return true;
+            if (timer.Elapsed > timeout || (workers != null && workers.All(w => w.HasExited)))
+                return false;
+            Thread.Sleep(1000);
+        }
+    }
+
+    /// <summary>
+    /// Combines the results of all ranges, see <see cref="FrameBuffer.MergeCheckpoints"/>
+    /// </summary>
+    /// <param name="frameBuffer">An unused frame buffer with the same resolution as the job</param>
+    public void Merge(FrameBuffer frameBuffer) {
+        var job = LoadJob(JobFile);
+        var files = Enumerable.Range(0, job.NumRanges).Select(r => ResultFile(Directory, r)).ToArray();
+        var missing = files.Where(f => !File.Exists(f)).ToArray();
+        if (missing.Length > 0)
+            throw new InvalidOperationException($"Missing results of {missing.Length} ranges, e.g., {missing[0]}");
+        frameBuffer.MergeCheckpoints(files);
+    }
+
+    /// <summary>
+    /// Renders ranges of a job until all of them are claimed by this or other workers
+    /// </summary>
+    /// <param name="jobFile">The job description written by <see cref="CreateJob"/></param>
+    public static void RunWorker(string jobFile) {
+        var job = LoadJob(jobFile);
+        string dir = Path.GetDirectoryName(Path.GetFullPath(jobFile));
+        for (int range = 0; range < job.NumRanges; ++range) {
+            // Creating the claim file fails if another worker was first
+            try {
+                using var claim = new FileStream(ClaimFile(dir, range), FileMode.CreateNew, FileAccess.Write);
+                using StreamWriter writer = new(claim);
+                writer.Write($"{Environment.MachineName} {Environment.ProcessId}");
+            } catch (IOException) {
+                continue;
+            }
+            RenderRange(job, dir, range);
+        }
+    }
+
+    /// <summary>
+    /// Renders a single range of a job, regardless of whether it was claimed already. Continues from the
+    /// checkpoint of a previous attempt if there is one. Use this to recover from crashed workers.
+    /// </summary>
+    /// <param name="jobFile">The job description written by <see cref="CreateJob"/></param>
+    /// <param name="range">Index of the range</param>
+    public static void RunWorker(string jobFile, int range)
+    => RenderRange(LoadJob(jobFile), Path.GetDirectoryName(Path.GetFullPath(jobFile)), range);
+
+    static void RenderRange(Job job, string dir, int range) {
+        int first = job.RangeStarts[range], end = job.RangeStarts[range + 1];
+        Logger.Log($"Rendering iterations {first} to {end - 1} of {job.SceneFile}");
+
+        var integrator = CreateIntegrator(job);
+        using var scene = Scene.LoadFromFile(job.SceneFile);
+        scene.FrameBuffer = new(job.Width, job.Height, Path.Join(dir, $"Range{range:D4}.exr"), job.Flags) {
+            FirstIteration = first,
+            IterationLimit = end,
+            CheckpointInterval = job.CheckpointInterval
+        };
+        scene.Prepare();
+        integrator.Resume(scene);
+
+        scene.FrameBuffer.WriteCheckpoint(ResultFile(dir, range));
+        File.Delete(scene.FrameBuffer.CheckpointFilename);
+    }
+
+    static Integrator CreateIntegrator(Job job) {
+        foreach (var a in AppDomain.CurrentDomain.GetAssemblies()) {
+            var type = a.GetType(job.Integrator);
+            if (type != null && type.IsAssignableTo(typeof(Integrator)))
+                return job.Settings.Deserialize(type, serializerOptions) as Integrator;
+        }
+        throw new InvalidOperationException($"No such integrator: {job.Integrator}");
+    }
+
+    static Job LoadJob(string jobFile)
+    => JsonSerializer.Deserialize<Job>(File.ReadAllText(jobFile), serializerOptions);
+
+    static string ResultFile(string dir, int range) => Path.Join(dir, $"Range{range:D4}.result");
+    static string ClaimFile(string dir, int range) => Path.Join(dir, $"Range{range:D4}.claim");
+
+    static readonly JsonSerializerOptions serializerOptions = new() {
+        IncludeFields = true,
+        WriteIndented = true
+    };
+}
@@ -27,6 +27,13 @@ public class SceneFromFile : SceneConfig {
     /// </summary>
     public string SourceDirectory => Path.GetFullPath(file.DirectoryName);
 
+    /// <summary>
+    /// How often the state of a reference rendering is checkpointed. If the rendering is interrupted,
+    /// the next call to <see cref="GetReferenceImage" /> continues from the last checkpoint.
+    /// Defaults to ten minutes, zero disables checkpoints.
+    /// </summary>
+    public TimeSpan ReferenceCheckpointInterval { get; set; } = TimeSpan.FromMinutes(10);
+
     /// <summary>
     /// Creates a shallow copy of this scene configuration under a new name.
     /// </summary>
@@ -160,9 +167,11 @@ IntegratorLoaded:
             FrameBuffer.Flags.IgnoreNanAndInf |
             FrameBuffer.Flags.WriteContinously |
             FrameBuffer.Flags.WriteExponentially); // output intermediate results exponentially to avoid loosing everything on a crash
+        scn.FrameBuffer.CheckpointInterval = ReferenceCheckpointInterval;
         scn.Prepare();
-        refIntegrator.Render(scn);
+        refIntegrator.Resume(scn);
         scn.FrameBuffer.WriteToFile();
+        File.Delete(scn.FrameBuffer.CheckpointFilename);
 
         return InpaintNaNs(scn.FrameBuffer.Image);
     }
@@ -40,6 +40,30 @@ public class Mesh : TriangleMesh {
         triangleDistribution = new PiecewiseConstantPDF(surfaceAreas);
     }
 
+    /// <summary>
+    /// Creates a new mesh with a precomputed area sampling distribution, e.g., loaded from a
+    /// <see cref="IO.SceneCache"/>
+    /// </summary>
+    /// <param name="vertices">List of vertices</param>
+    /// <param name="indices">
+    ///     Three integers for each triangle that identify which vertices form that triangle
+    /// </param>
+    /// <param name="shadingNormals">Shading normals for each vertex, or null</param>
+    /// <param name="textureCoordinates">Texture coordinates for each vertex, or null</param>
+    /// <param name="triangleDistribution">
+    ///     Distribution to select a triangle proportional to its surface area
+    /// </param>
+    public Mesh(Vector3[] vertices, int[] indices, Vector3[] shadingNormals, Vector2[] textureCoordinates,
+                PiecewiseConstantPDF triangleDistribution)
+        : base(vertices, indices, shadingNormals, textureCoordinates) {
+        this.triangleDistribution = triangleDistribution;
+    }
+
+    /// <summary>
+    /// Distribution to select a triangle proportional to its surface area
+    /// </summary>
+    public PiecewiseConstantPDF TriangleDistribution => triangleDistribution;
+
     /// <summary>
     /// Computes a sufficient offset around a point on the surface that ensures no self-intersections will
     /// be reported when tracing a ray from this point.
@@ -59,6 +83,26 @@ public class Mesh : TriangleMesh {
         return errorDiagonal.Length() * 32.0f * 1.19209e-07f;
     }
 
+    /// <summary>
+    /// Computes how much a length on a triangle is scaled when mapped to texture space
+    /// </summary>
+    /// <param name="faceIdx">Index of a triangle within the mesh</param>
+    /// <returns>Square root of the ratio of texture space and world space area, zero if there are no uvs</returns>
+    public float ComputeTextureScale(int faceIdx) {
+        if (TextureCoordinates == null)
+            return 0;
+
+        int i1 = Indices[faceIdx * 3 + 0], i2 = Indices[faceIdx * 3 + 1], i3 = Indices[faceIdx * 3 + 2];
+        float area = Vector3.Cross(Vertices[i2] - Vertices[i1], Vertices[i3] - Vertices[i1]).Length();
+        if (area == 0)
+            return 0;
+
+        Vector2 e1 = TextureCoordinates[i2] - TextureCoordinates[i1];
+        Vector2 e2 = TextureCoordinates[i3] - TextureCoordinates[i1];
+        float uvArea = MathF.Abs(e1.X * e2.Y - e1.Y * e2.X);
+        return MathF.Sqrt(uvArea / area);
+    }
+
     /// <summary>
     /// Samples a point uniformly distributed on the mesh surface
     /// </summary>
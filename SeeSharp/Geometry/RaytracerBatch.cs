@@ -0,0 +1,40 @@
+namespace SeeSharp.Geometry;
+
+/// <summary>
+/// Queries for a whole batch of rays. Integrators that collect their rays in queues (like
+/// <see cref="WavefrontPathTracer" />) go through these, so a native stream traversal can be used later on
+/// without changing the callers. TinyEmbree currently only exposes single-ray queries, so each ray is
+/// still one native call: the batch keeps the traversal coherent, but does not amortize the call overhead.
+/// </summary>
+public static class RaytracerBatch {
+    /// <summary>
+    /// Finds the closest intersection of every ray in the batch
+    /// </summary>
+    /// <param name="raytracer">The scene to trace against</param>
+    /// <param name="rays">The rays to trace</param>
+    /// <param name="hits">Receives the closest hit of each ray, must be at least as long as the rays</param>
+    public static void Trace(this Raytracer raytracer, ReadOnlySpan<Ray> rays, Span<Hit> hits) {
+        if (hits.Length < rays.Length)
+            throw new ArgumentException("Output span is too short", nameof(hits));
+
+        // The batch is traversed in order, one native call per ray. Because the rays are submitted
+        // back-to-back without any shading in between, the BVH nodes touched by coherent rays are still
+        // hot in cache.
+        for (int i = 0; i < rays.Length; ++i)
+            hits[i] = raytracer.Trace(rays[i]);
+    }
+
+    /// <summary>
+    /// Tests every shadow ray in the batch for occlusion
+    /// </summary>
+    /// <param name="raytracer">The scene to trace against</param>
+    /// <param name="rays">The shadow rays to test</param>
+    /// <param name="occluded">Set to true for each ray that is blocked, must be at least as long as the rays</param>
+    public static void IsOccluded(this Raytracer raytracer, ReadOnlySpan<ShadowRay> rays, Span<bool> occluded) {
+        if (occluded.Length < rays.Length)
+            throw new ArgumentException("Output span is too short", nameof(occluded));
+
+        for (int i = 0; i < rays.Length; ++i)
+            occluded[i] = raytracer.IsOccluded(rays[i]);
+    }
+}
@@ -68,6 +68,27 @@ public struct SurfacePoint {
     /// </summary>
     public Vector2 TextureCoordinates => hit.TextureCoordinates;
 
+    /// <summary>
+    /// Width of the area on the surface covered by one pixel, in world space. Zero if unknown, e.g., for
+    /// points that were not found by tracing a camera path. See <see cref="RayFootprint"/>.
+    /// Setting it also computes the <see cref="TextureFootprint"/>, so the mesh and primitive must be set.
+    /// </summary>
+    public float FootprintWidth {
+        get => footprintWidth;
+        set {
+            footprintWidth = value;
+            textureFootprint = value == 0 ? 0 : value * Mesh.ComputeTextureScale((int)PrimId);
+        }
+    }
+    float footprintWidth;
+
+    /// <summary>
+    /// Width of the pixel footprint in texture coordinates, used to filter texture lookups. Computed once
+    /// when the <see cref="FootprintWidth"/> is set.
+    /// </summary>
+    public float TextureFootprint => textureFootprint;
+    float textureFootprint;
+
     /// <summary>
     /// The material of the intersected mesh
     /// </summary>
@@ -66,6 +66,11 @@ public struct Triangle {
     /// <returns>The PDF of sampling this point</returns>
     public float PdfUniformArea(in SurfacePoint point) => invSurfaceArea;
 
+    /// <summary>
+    /// Surface area of the triangle
+    /// </summary>
+    public float SurfaceArea => 1.0f / invSurfaceArea;
+
     /// <summary>
     /// Computes the solid angle of the projection of this triangle onto the unit sphere around a given point.
     /// </summary>
@@ -0,0 +1,104 @@
+using System.Buffers.Text;
+using System.Globalization;
+
+namespace SeeSharp.IO;
+
+/// <summary>
+/// Allocation-free tokenizer for whitespace separated ASCII text, like the data in .ply and .obj files.
+/// Numbers are parsed directly from the raw bytes.
+/// </summary>
+internal ref struct AsciiTokenizer {
+    ReadOnlySpan<byte> text;
+
+    public AsciiTokenizer(ReadOnlySpan<byte> text) {
+        this.text = text;
+    }
+
+    public static bool IsWhiteSpace(byte c) => c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+
+    /// <summary>
+    /// The remaining text, without leading and trailing white space
+    /// </summary>
+    public readonly ReadOnlySpan<byte> Rest {
+        get {
+            int start = 0, end = text.Length;
+            while (start < end && IsWhiteSpace(text[start])) start++;
+            while (end > start && IsWhiteSpace(text[end - 1])) end--;
+            return text[start..end];
+        }
+    }
+
+    /// <returns>The next white space separated token, or an empty span at the end of the text</returns>
+    public ReadOnlySpan<byte> NextToken() {
+        int start = 0;
+        while (start < text.Length && IsWhiteSpace(text[start])) start++;
+        int end = start;
+        while (end < text.Length && !IsWhiteSpace(text[end])) end++;
+        var token = text[start..end];
+        text = text[end..];
+        return token;
+    }
+
+    public bool TryReadFloat(out float value) => TryParseFloat(NextToken(), out value);
+
+    public bool TryReadInt(out int value) => TryParseInt(NextToken(), out value);
+
+    public static bool TryParseFloat(ReadOnlySpan<byte> token, out float value) {
+        if (Utf8Parser.TryParse(token, out value, out int consumed) && consumed == token.Length)
+            return true;
+        // Less common notations like ".5" or "1." are handled by the slower general parser
+        return float.TryParse(token, NumberStyles.Float, CultureInfo.InvariantCulture, out value);
+    }
+
+    public static bool TryParseInt(ReadOnlySpan<byte> token, out int value)
+    => Utf8Parser.TryParse(token, out value, out int consumed) && consumed == token.Length;
+
+    /// <summary>
+    /// Splits off the next line, without the line break
+    /// </summary>
+    /// <returns>False if the text is empty</returns>
+    public static bool NextLine(ref ReadOnlySpan<byte> text, out ReadOnlySpan<byte> line) {
+        if (text.IsEmpty) {
+            line = default;
+            return false;
+        }
+        int end = text.IndexOf((byte)'\n');
+        if (end < 0) {
+            line = text;
+            text = default;
+        } else {
+            line = text[..end];
+            text = text[(end + 1)..];
+        }
+        return true;
+    }
+
+    /// <summary>
+    /// Splits a range of the file into chunks of roughly equal size, that each end after a line break (or at
+    /// the end of the file), so they can be parsed independently.
+    /// </summary>
+    /// <param name="file">The file</param>
+    /// <param name="start">Offset of the first byte of the text in the file</param>
+    /// <param name="chunkSize">Desired number of bytes in each chunk</param>
+    /// <returns>The offset of each chunk in the file, followed by the length of the file</returns>
+    public static long[] SplitLines(MappedFile file, long start, long chunkSize) {
+        List<long> boundaries = [start];
+        long pos = start;
+        while (file.Length - pos > chunkSize) {
+            int newline = file.SliceToEnd(pos + chunkSize).IndexOf((byte)'\n');
+            if (newline < 0) break;
+            pos += chunkSize + newline + 1;
+            boundaries.Add(pos);
+        }
+        if (boundaries[^1] != file.Length)
+            boundaries.Add(file.Length);
+        return boundaries.ToArray();
+    }
+
+    /// <summary>
+    /// Chunk size that splits large files into enough work for all cores, small enough to be addressed by
+    /// a span
+    /// </summary>
+    public static long ChunkSize(long textLength)
+    => Math.Clamp(textLength / (4 * Environment.ProcessorCount) + 1, 1 << 20, 1 << 28);
+}
@@ -14,7 +14,13 @@ public static class JsonScene {
     }
     static IMeshLoader[] _knownLoaders;
 
-    private static void ReadMeshes(string path, Scene resultScene, JsonElement root,
+    /// <summary>
+    /// If true (the default), the meshes are loaded from and written to a <see cref="SceneCache"/> next to
+    /// the .json file.
+    /// </summary>
+    public static bool UseSceneCache { get; set; } = true;
+
+    private static void ReadMeshes(string path, string jsonString, Scene resultScene, JsonElement root,
                                    Dictionary<string, Material> namedMaterials,
                                    Dictionary<string, EmissionParameters> emissiveMaterials) {
         var meshes = root.GetProperty("objects");
@@ -24,14 +30,23 @@ public static class JsonScene {
 
         var meshSets = new IEnumerable<Mesh>[meshes.GetArrayLength()];
         var emitterSets = new IEnumerable<Emitter>[meshes.GetArrayLength()];
+
+        string cachePath = SceneCache.GetCachePath(path);
+        byte[] cacheKey = UseSceneCache ? SceneCache.ComputeKey(path, jsonString, meshes) : null;
+        bool[] fromCache = UseSceneCache
+            ? SceneCache.TryLoad(cachePath, cacheKey, namedMaterials, meshSets, emitterSets)
+            : null;
+
         Parallel.For(0, meshes.GetArrayLength(), i => {
             JsonElement m = meshes[i];
             string name = m.GetProperty("name").GetString();
-            string type = m.GetProperty("type").GetString();
 
-            var loader = Array.Find(KnownLoaders, l => l.Type == type);
-            (meshSets[i], emitterSets[i]) = loader.LoadMesh(namedMaterials, emissiveMaterials, m,
-                Path.GetDirectoryName(path));
+            if (fromCache == null || !fromCache[i]) {
+                string type = m.GetProperty("type").GetString();
+                var loader = Array.Find(KnownLoaders, l => l.Type == type);
+                (meshSets[i], emitterSets[i]) = loader.LoadMesh(namedMaterials, emissiveMaterials, m,
+                    Path.GetDirectoryName(path));
+            }
 
             if (meshSets[i] != null) {
                 var iter = meshSets[i].GetEnumerator();
@@ -46,6 +61,9 @@ public static class JsonScene {
             lock (progressBar) progressBar.ReportDone(1);
         });
 
+        if (UseSceneCache && fromCache == null)
+            SceneCache.Write(cachePath, cacheKey, namedMaterials, meshSets, emitterSets);
+
         foreach (var m in meshSets) if (m != null) resultScene.Meshes.AddRange(m);
         foreach (var e in emitterSets) if (e != null) resultScene.Emitters.AddRange(e);
     }
@@ -206,7 +224,7 @@ public static class JsonScene {
             ReadCameras(resultScene, root, namedTransforms);
             ReadBackground(path, resultScene, root);
             ReadMaterials(path, root, out var namedMaterials, out var emissiveMaterials);
-            ReadMeshes(path, resultScene, root, namedMaterials, emissiveMaterials);
+            ReadMeshes(path, jsonString, resultScene, root, namedMaterials, emissiveMaterials);
 
             if (root.TryGetProperty("exposure", out var exposure))
                 resultScene.RecommendedExposure = exposure.GetSingle();
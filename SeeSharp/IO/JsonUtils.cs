@@ -26,7 +26,14 @@ public static class JsonUtils {
         } else if (type == "image") {
             var texturePath = json.GetProperty("filename").GetString();
             texturePath = Path.Join(Path.GetDirectoryName(path), texturePath);
-            return new TextureRgb(texturePath);
+            var texture = new TextureRgb(texturePath);
+            if (json.TryGetProperty("filter", out var filter)) {
+                if (Enum.TryParse(filter.GetString(), true, out ImageTexture.FilterMode mode))
+                    texture.Filter = mode;
+                else
+                    Logger.Log($"Unknown texture filter '{filter.GetString()}', using nearest", Verbosity.Warning);
+            }
+            return texture;
         } else {
             Logger.Log($"Invalid texture specification: {json}", Verbosity.Error);
             return new TextureRgb(new RgbColor(1, 0, 1));
@@ -0,0 +1,54 @@
+using System.IO.MemoryMappedFiles;
+
+namespace SeeSharp.IO;
+
+/// <summary>
+/// Read-only memory-mapped view of an entire file. The mesh parsers read their input through this, so
+/// files are paged in by the OS as they are parsed, and are not limited to the 2 GB of a managed array.
+/// Spans can only address 2 GB, so larger files are accessed in slices.
+/// </summary>
+internal sealed unsafe class MappedFile : IDisposable {
+    readonly MemoryMappedFile file;
+    readonly MemoryMappedViewAccessor view;
+
+    /// <summary>
+    /// Pointer to the first byte of the file, null if the file is empty
+    /// </summary>
+    public byte* Pointer { get; }
+
+    /// <summary>
+    /// Size of the file in bytes
+    /// </summary>
+    public long Length { get; }
+
+    public MappedFile(string filename) {
+        Length = new FileInfo(filename).Length;
+        if (Length == 0) return; // Empty files cannot be mapped
+
+        file = MemoryMappedFile.CreateFromFile(filename, FileMode.Open, null, 0, MemoryMappedFileAccess.Read);
+        view = file.CreateViewAccessor(0, Length, MemoryMappedFileAccess.Read);
+        byte* ptr = null;
+        view.SafeMemoryMappedViewHandle.AcquirePointer(ref ptr);
+        Pointer = ptr + view.PointerOffset;
+    }
+
+    /// <returns>The given range of bytes</returns>
+    public ReadOnlySpan<byte> Slice(long start, long length) {
+        if (start < 0 || length < 0 || start + length > Length)
+            throw new ArgumentOutOfRangeException(nameof(start));
+        if (length > int.MaxValue)
+            throw new InvalidDataException("Cannot address more than 2 GB of a file at once");
+        return new(Pointer + start, (int)length);
+    }
+
+    /// <returns>All bytes from the given position to the end of the file, at most 2 GB</returns>
+    public ReadOnlySpan<byte> SliceToEnd(long start) => Slice(start, Math.Min(Length - start, int.MaxValue));
+
+    public void Dispose() {
+        if (view != null) {
+            view.SafeMemoryMappedViewHandle.ReleasePointer();
+            view.Dispose();
+            file.Dispose();
+        }
+    }
+}
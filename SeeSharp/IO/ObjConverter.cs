@@ -121,17 +121,18 @@ public class ObjConverter : IMeshLoader {
                     triangleGroups[^1].TryAdd(mtl_idx, new List<TriIdx>());
 
                     // Check if any vertex has a normal or uv coordinate
-                    for (int i = 0; i < face.Indices.Count; i++) {
-                        has_normals |= (face.Indices[i].NormalIndex != 0);
-                        has_texcoords |= (face.Indices[i].TextureIndex != 0);
+                    var faceIndices = mesh.Contents.GetIndices(face);
+                    for (int i = 0; i < faceIndices.Length; i++) {
+                        has_normals |= (faceIndices[i].NormalIndex != 0);
+                        has_texcoords |= (faceIndices[i].TextureIndex != 0);
                     }
 
                     // Compute the triangle indices for every n-gon
                     int v0 = 0;
                     int prev = 1;
-                    for (int i = 1; i < face.Indices.Count - 1; i++) {
+                    for (int i = 1; i < faceIndices.Length - 1; i++) {
                         int next = i + 1;
-                        triangleGroups[^1][mtl_idx].Add(new TriIdx(face.Indices[v0], face.Indices[prev], face.Indices[next]));
+                        triangleGroups[^1][mtl_idx].Add(new TriIdx(faceIndices[v0], faceIndices[prev], faceIndices[next]));
                         prev = next;
 
                         empty = false;
@@ -1,4 +1,5 @@
-﻿using System.Text.RegularExpressions;
+﻿using System.Text;
+using System.Text.RegularExpressions;
 
 using MaterialLib = System.Collections.Generic.Dictionary<string, SeeSharp.IO.ObjMesh.Material>;
 
@@ -9,14 +10,14 @@ namespace SeeSharp.IO;
 /// </summary>
 public class ObjMesh {
     /// <summary>A reference to a vertex/normal/texture coord. of the model.</summary>
-    public class Index {
+    public struct Index : IEquatable<Index> {
         /// <summary> Vertex, normal and texture indices(0 means not present) </summary>
         public int VertexIndex, NormalIndex, TextureIndex;
 
         /// <summary>
         /// Computes a hash for the index by combining hashes of the three integer values
         /// </summary>
-        public override int GetHashCode() {
+        public override readonly int GetHashCode() {
             uint h = 0, g;
 
             h = (h << 4) + (uint)this.VertexIndex;
@@ -37,22 +38,26 @@ public class ObjMesh {
             return (int)h;
         }
 
-        /// <returns>True if the other object is an Index with all values equal</returns>
-        public override bool Equals(object other) {
-            if (other is not Index b) return false;
+        /// <returns>True if all values are equal</returns>
+        public readonly bool Equals(Index b)
+        => VertexIndex == b.VertexIndex
+            && NormalIndex == b.NormalIndex
+            && TextureIndex == b.TextureIndex;
 
-            return VertexIndex == b.VertexIndex
-                && NormalIndex == b.NormalIndex
-                && TextureIndex == b.TextureIndex;
-        }
+        /// <returns>True if the other object is an Index with all values equal</returns>
+        public override readonly bool Equals(object other) => other is Index b && Equals(b);
     }
 
     /// <summary>
-    /// A face with arbitrarily many vertices, given by a list of indices, and a material index
+    /// A face with arbitrarily many vertices, given by a range in <see cref="File.Indices"/>, and a material
+    /// index
     /// </summary>
-    public class Face {
-        /// <summary> Indices of the face </summary>
-        public List<Index> Indices = new();
+    public struct Face {
+        /// <summary> Position of the first index of the face in <see cref="File.Indices"/> </summary>
+        public int FirstIndex;
+
+        /// <summary> Number of vertices of the face </summary>
+        public int NumIndices;
 
         /// <summary> Index into the material names of the model </summary>
         public int Material;
@@ -128,19 +133,27 @@ public class ObjMesh {
         public List<Object> Objects = new();
 
         /// <summary>
-        /// All vertices in the entire file
+        /// All vertices in the entire file. The first entry is a dummy, as indices start at one.
         /// </summary>
-        public List<Vector3> Vertices = new();
+        public Vector3[] Vertices = [Vector3.Zero];
 
         /// <summary>
-        /// Shading normals of all vertices
+        /// Shading normals of all vertices. The first entry is a dummy, as indices start at one.
         /// </summary>
-        public List<Vector3> Normals = new();
+        public Vector3[] Normals = [Vector3.Zero];
 
         /// <summary>
-        /// Texture coordinates of all vertices
+        /// Texture coordinates of all vertices. The first entry is a dummy, as indices start at one.
         /// </summary>
-        public List<Vector2> Texcoords = new();
+        public Vector2[] Texcoords = [Vector2.Zero];
+
+        /// <summary>
+        /// Vertex indices of all faces, see <see cref="Face.FirstIndex"/>
+        /// </summary>
+        public Index[] Indices = [];
+
+        /// <returns>The vertex indices of the given face</returns>
+        public ReadOnlySpan<Index> GetIndices(Face face) => Indices.AsSpan(face.FirstIndex, face.NumIndices);
 
         /// <summary>
         /// Names of all materials in the file
@@ -189,7 +202,7 @@ public class ObjMesh {
         var watch = System.Diagnostics.Stopwatch.StartNew();
         Logger.Log($"Parsing {filename}...", Verbosity.Debug);
         // Parse the .obj itself
-        using (var file = new StreamReader(filename))
+        using (MappedFile file = new(filename))
             mesh.Errors.AddRange(mesh.ParseObjFile(file));
         watch.Stop();
         Logger.Log($"Done parsing .obj after {watch.ElapsedMilliseconds}ms.", Verbosity.Debug);
@@ -210,7 +223,90 @@ public class ObjMesh {
         return mesh;
     }
 
-    private List<string> ParseObjFile(StreamReader stream) {
+    record struct ParseError(int Line, string Message, string Suffix = ".");
+
+    enum CommandType { Group, Object, UseMaterial, MaterialLib }
+
+    /// <summary>
+    /// A face as seen by the parser of a chunk. Relative indices are resolved later, based on the number of
+    /// vertices, normals, and texture coordinates before the face.
+    /// </summary>
+    struct ChunkFace {
+        public int FirstIndex, NumIndices, Line;
+        public int NumVertices, NumNormals, NumTexcoords;
+    }
+
+    /// <summary>
+    /// Parsed content of a range of lines in the .obj. The commands that change the state of the parser
+    /// (groups, objects, materials) are recorded along with the number of faces before them, and replayed
+    /// in order when the chunks are merged.
+    /// </summary>
+    class ObjChunk {
+        public List<Vector3> Vertices = new();
+        public List<Vector3> Normals = new();
+        public List<Vector2> Texcoords = new();
+        public List<Index> Indices = new();
+        public List<ChunkFace> Faces = new();
+        public List<(int NumFaces, CommandType Type, string Argument)> Commands = new();
+        public List<ParseError> Errors = new();
+        public int NumLines;
+    }
+
+    private List<string> ParseObjFile(MappedFile file) {
+        // Skip the UTF-8 byte order mark, if any
+        long start = file.Slice(0, Math.Min(file.Length, 3)).StartsWith("\uFEFF"u8) ? 3 : 0;
+
+        // Parse chunks of whole lines in parallel
+        long[] boundaries = AsciiTokenizer.SplitLines(file, start, AsciiTokenizer.ChunkSize(file.Length - start));
+        var chunks = new ObjChunk[boundaries.Length - 1];
+        Parallel.For(0, chunks.Length, c => {
+            chunks[c] = ParseObjChunk(file.Slice(boundaries[c], boundaries[c + 1] - boundaries[c]));
+        });
+
+        // Prefix sums give the position of each chunk's data in the merged arrays. The first vertex, normal,
+        // and texture coordinate is a dummy, since indices start at one.
+        int numChunks = chunks.Length;
+        int[] firstVertex = new int[numChunks + 1], firstNormal = new int[numChunks + 1];
+        int[] firstTexcoord = new int[numChunks + 1], firstIndex = new int[numChunks + 1];
+        int[] firstLine = new int[numChunks + 1];
+        firstVertex[0] = firstNormal[0] = firstTexcoord[0] = 1;
+        for (int c = 0; c < numChunks; ++c) {
+            firstVertex[c + 1] = firstVertex[c] + chunks[c].Vertices.Count;
+            firstNormal[c + 1] = firstNormal[c] + chunks[c].Normals.Count;
+            firstTexcoord[c + 1] = firstTexcoord[c] + chunks[c].Texcoords.Count;
+            firstIndex[c + 1] = firstIndex[c] + chunks[c].Indices.Count;
+            firstLine[c + 1] = firstLine[c] + chunks[c].NumLines;
+        }
+
+        Contents.Vertices = new Vector3[firstVertex[numChunks]];
+        Contents.Normals = new Vector3[firstNormal[numChunks]];
+        Contents.Texcoords = new Vector2[firstTexcoord[numChunks]];
+        Contents.Indices = new Index[firstIndex[numChunks]];
+
+        // Copy the data and convert relative indices to absolute ones
+        var validFaces = new bool[numChunks][];
+        Parallel.For(0, numChunks, c => {
+            var chunk = chunks[c];
+            chunk.Vertices.CopyTo(Contents.Vertices, firstVertex[c]);
+            chunk.Normals.CopyTo(Contents.Normals, firstNormal[c]);
+            chunk.Texcoords.CopyTo(Contents.Texcoords, firstTexcoord[c]);
+
+            validFaces[c] = new bool[chunk.Faces.Count];
+            for (int f = 0; f < chunk.Faces.Count; ++f) {
+                var face = chunk.Faces[f];
+                bool valid = true;
+                for (int i = face.FirstIndex; i < face.FirstIndex + face.NumIndices; ++i) {
+                    var idx = chunk.Indices[i];
+                    if (idx.VertexIndex < 0) idx.VertexIndex += firstVertex[c] + face.NumVertices;
+                    if (idx.TextureIndex < 0) idx.TextureIndex += firstTexcoord[c] + face.NumTexcoords;
+                    if (idx.NormalIndex < 0) idx.NormalIndex += firstNormal[c] + face.NumNormals;
+                    valid &= idx.VertexIndex > 0 && idx.TextureIndex >= 0 && idx.NormalIndex >= 0;
+                    Contents.Indices[firstIndex[c] + i] = idx;
+                }
+                validFaces[c][f] = valid;
+            }
+        });
+
         // Add an empty object to the scene
         int cur_object = 0;
         Contents.Objects.Add(new Object(""));
@@ -223,157 +319,150 @@ public class ObjMesh {
         int cur_mtl = 0;
         Contents.Materials.Add("");
 
-        // Add dummy vertex, normal, and texcoord
-        Contents.Vertices.Add(Vector3.Zero);
-        Contents.Normals.Add(Vector3.Zero);
-        Contents.Texcoords.Add(Vector2.Zero);
-
-        List<string> errors = new();
-        int cur_line = 0;
-        string line;
+        // Replay the commands and sort the faces into groups, in the order of the file
+        List<ParseError> errors = new();
+        for (int c = 0; c < numChunks; ++c) {
+            var chunk = chunks[c];
+            int nextCommand = 0;
+            for (int f = 0; f <= chunk.Faces.Count; ++f) {
+                for (; nextCommand < chunk.Commands.Count && chunk.Commands[nextCommand].NumFaces == f; ++nextCommand) {
+                    var (_, type, argument) = chunk.Commands[nextCommand];
+                    if (type == CommandType.Group) {
+                        Contents.Objects[cur_object].Groups.Add(new Group(argument));
+                        cur_group++;
+                    } else if (type == CommandType.Object) {
+                        Contents.Objects.Add(new Object(argument));
+                        cur_object++;
+                        Contents.Objects[cur_object].Groups.Add(new Group(""));
+                        cur_group = 0;
+                    } else if (type == CommandType.UseMaterial) {
+                        cur_mtl = Contents.Materials.FindIndex(x => x == argument);
+                        if (cur_mtl < 0) {
+                            Contents.Materials.Add(argument);
+                            cur_mtl = Contents.Materials.Count - 1;
+                        }
+                    } else {
+                        Contents.MtlFiles.Add(argument);
+                    }
+                }
 
-        Vector3 ParseVector3() {
-            Vector3 v = new();
-            var matches = regexFloat.Matches(line);
-            if (matches.Count != 3)
-                errors.Add($"Invalid vector (line {cur_line}).");
-            v.X = float.Parse(matches[0].Value);
-            v.Y = float.Parse(matches[1].Value);
-            v.Z = float.Parse(matches[2].Value);
-            return v;
-        }
+                if (f == chunk.Faces.Count) break;
 
-        Vector2 ParseVector2() {
-            Vector2 v = new();
-            var matches = regexFloat.Matches(line);
-            if (matches.Count != 2) {
-                errors.Add($"Invalid vector (line {cur_line}) '{line}'. Replaced by (0,0).");
-                return Vector2.Zero;
+                var face = chunk.Faces[f];
+                if (validFaces[c][f]) {
+                    Contents.Objects[cur_object].Groups[cur_group].Faces.Add(new() {
+                        FirstIndex = firstIndex[c] + face.FirstIndex,
+                        NumIndices = face.NumIndices,
+                        Material = cur_mtl
+                    });
+                } else {
+                    errors.Add(new(face.Line + firstLine[c], "Invalid indices in face definition"));
+                }
             }
-            v.X = float.Parse(matches[0].Value);
-            v.Y = float.Parse(matches[1].Value);
-            return v;
-        }
-
-        List<Index> ReadFace() {
-            var matches = regexIndex.Matches(line);
-
-            var indices = new List<Index>(matches.Count);
-            for (int i = 0; i < matches.Count; ++i) {
-                if (matches[i].Groups[1].Value == "") // vertex index is mandatory
-                    errors.Add($"Invalid face (line {cur_line}).");
 
-                Index idx = new() {
-                    VertexIndex = int.Parse(matches[i].Groups[1].Value)
-                };
-                if (matches[i].Groups[2].Value != "") // texture is optional
-                    idx.TextureIndex = int.Parse(matches[i].Groups[2].Value);
-                if (matches[i].Groups[3].Value != "") // normal is optional
-                    idx.NormalIndex = int.Parse(matches[i].Groups[3].Value);
-
-                indices.Add(idx);
-            }
+            foreach (var e in chunk.Errors)
+                errors.Add(e with { Line = e.Line + firstLine[c] });
+        }
 
-            if (matches.Count == 0)
-                errors.Add($"Invalid face (line {cur_line}).");
+        errors.Sort((a, b) => a.Line.CompareTo(b.Line));
+        return errors.ConvertAll(e => $"{e.Message} (line {e.Line}){e.Suffix}");
+    }
 
-            return indices;
-        }
+    /// <summary>
+    /// Parses a range of whole lines in the .obj file
+    /// </summary>
+    static ObjChunk ParseObjChunk(ReadOnlySpan<byte> text) {
+        ObjChunk chunk = new();
+        int cur_line = 0;
 
-        while ((line = stream.ReadLine()) != null) {
+        while (AsciiTokenizer.NextLine(ref text, out var lineBytes)) {
             cur_line++;
 
             // Strip white space
-            line = line.Trim();
+            AsciiTokenizer tokens = new(lineBytes);
+            var line = tokens.Rest;
 
             // Skip comments and empty lines
             if (line.Length == 0 || line[0] == '#')
                 continue;
 
             // Test each command in turn, the most frequent first
-            if (line[0] == 'v') {
-                switch (line[1]) {
-                    case ' ':
-                    case '\t': // vertices
-                        Contents.Vertices.Add(ParseVector3());
-                        break;
-                    case 'n': // normals
-                        Contents.Normals.Add(ParseVector3());
-                        break;
-                    case 't': // uvs
-                        Contents.Texcoords.Add(ParseVector2());
-                        break;
-                    default:
-                        errors.Add($"Invalid vertex (line {cur_line}).");
-                        break;
+            var command = tokens.NextToken();
+            if (command.SequenceEqual("v"u8) || command.SequenceEqual("vn"u8)) {
+                bool valid = tokens.TryReadFloat(out float x);
+                valid &= tokens.TryReadFloat(out float y);
+                valid &= tokens.TryReadFloat(out float z);
+                if (!valid)
+                    chunk.Errors.Add(new(cur_line, "Invalid vector"));
+                if (command.Length == 1)
+                    chunk.Vertices.Add(new(x, y, z));
+                else
+                    chunk.Normals.Add(new(x, y, z));
+            } else if (command.SequenceEqual("vt"u8)) {
+                if (tokens.TryReadFloat(out float u) && tokens.TryReadFloat(out float v)) {
+                    chunk.Texcoords.Add(new(u, v));
+                } else {
+                    chunk.Errors.Add(new(cur_line, "Invalid vector",
+                        $" '{Encoding.UTF8.GetString(line)}'. Replaced by (0,0)."));
+                    chunk.Texcoords.Add(Vector2.Zero);
                 }
-            } else if (line[0] == 'f' && char.IsWhiteSpace(line[1])) {
-                Face f = new() {
-                    Material = cur_mtl,
-                    Indices = ReadFace()
+            } else if (command[0] == 'v') {
+                chunk.Errors.Add(new(cur_line, "Invalid vertex"));
+            } else if (command.SequenceEqual("f"u8)) {
+                ChunkFace face = new() {
+                    FirstIndex = chunk.Indices.Count,
+                    Line = cur_line,
+                    NumVertices = chunk.Vertices.Count,
+                    NumNormals = chunk.Normals.Count,
+                    NumTexcoords = chunk.Texcoords.Count,
                 };
 
-                if (f.Indices.Count < 3) {
-                    errors.Add($"Invalid face (line {cur_line}).");
-                } else {
-                    // Convert relative indices to absolute
-                    for (int i = 0; i < f.Indices.Count; i++) {
-                        f.Indices[i].VertexIndex = (f.Indices[i].VertexIndex < 0) ? Contents.Vertices.Count + f.Indices[i].VertexIndex : f.Indices[i].VertexIndex;
-                        f.Indices[i].TextureIndex = (f.Indices[i].TextureIndex < 0) ? Contents.Texcoords.Count + f.Indices[i].TextureIndex : f.Indices[i].TextureIndex;
-                        f.Indices[i].NormalIndex = (f.Indices[i].NormalIndex < 0) ? Contents.Normals.Count + f.Indices[i].NormalIndex : f.Indices[i].NormalIndex;
-                    }
-
-                    // Check if the indices are valid or not
-                    bool valid = true;
-                    for (int i = 0; i < f.Indices.Count; i++) {
-                        if (f.Indices[i].VertexIndex <= 0 || f.Indices[i].TextureIndex < 0 || f.Indices[i].NormalIndex < 0) {
-                            valid = false;
-                            break;
-                        }
-                    }
-
-                    if (valid) {
-                        Contents.Objects[cur_object].Groups[cur_group].Faces.Add(f);
-                    } else {
-                        errors.Add($"Invalid indices in face definition (line {cur_line} ).");
+                bool valid = true;
+                for (var corner = tokens.NextToken(); !corner.IsEmpty; corner = tokens.NextToken()) {
+                    // Vertex index is mandatory, texture and normal are optional: v, v/t, v//n, or v/t/n
+                    Index idx = new();
+                    int slash = corner.IndexOf((byte)'/');
+                    valid &= AsciiTokenizer.TryParseInt(slash < 0 ? corner : corner[..slash], out idx.VertexIndex);
+                    if (slash >= 0) {
+                        corner = corner[(slash + 1)..];
+                        slash = corner.IndexOf((byte)'/');
+                        var texture = slash < 0 ? corner : corner[..slash];
+                        if (!texture.IsEmpty)
+                            valid &= AsciiTokenizer.TryParseInt(texture, out idx.TextureIndex);
+                        if (slash >= 0)
+                            valid &= AsciiTokenizer.TryParseInt(corner[(slash + 1)..], out idx.NormalIndex);
                     }
+                    chunk.Indices.Add(idx);
                 }
-            } else if (line[0] == 'g' && char.IsWhiteSpace(line[1])) {
-                string groupName = line[2..].Trim();
-                Contents.Objects[cur_object].Groups.Add(new Group(groupName));
-                cur_group++;
-            } else if (line[0] == 'o' && char.IsWhiteSpace(line[1])) {
-                string objectName = line[2..].Trim();
-                Contents.Objects.Add(new Object(objectName));
-                cur_object++;
-                Contents.Objects[cur_object].Groups.Add(new Group(""));
-                cur_group = 0;
-            } else if (line.StartsWith("usemtl") && char.IsWhiteSpace(line[6])) {
-                line = line[6..];
-                string mtl_name = line.Trim();
-
-                cur_mtl = Contents.Materials.FindIndex(x => x == mtl_name);
-                if (cur_mtl < 0) {
-                    Contents.Materials.Add(mtl_name);
-                    cur_mtl = Contents.Materials.Count - 1;
+                face.NumIndices = chunk.Indices.Count - face.FirstIndex;
+
+                if (!valid || face.NumIndices < 3) {
+                    chunk.Errors.Add(new(cur_line, "Invalid face"));
+                    chunk.Indices.RemoveRange(face.FirstIndex, face.NumIndices);
+                } else {
+                    chunk.Faces.Add(face);
                 }
-            } else if (line.StartsWith("mtllib") && char.IsWhiteSpace(line[6])) {
-                line = line[6..];
-                string lib_name = line.Trim();
-                Contents.MtlFiles.Add(lib_name);
-            } else if (line[0] == 's' && char.IsWhiteSpace(line[1])) {
+            } else if (command.SequenceEqual("g"u8)) {
+                chunk.Commands.Add((chunk.Faces.Count, CommandType.Group, Encoding.UTF8.GetString(tokens.Rest)));
+            } else if (command.SequenceEqual("o"u8)) {
+                chunk.Commands.Add((chunk.Faces.Count, CommandType.Object, Encoding.UTF8.GetString(tokens.Rest)));
+            } else if (command.SequenceEqual("usemtl"u8)) {
+                chunk.Commands.Add((chunk.Faces.Count, CommandType.UseMaterial, Encoding.UTF8.GetString(tokens.Rest)));
+            } else if (command.SequenceEqual("mtllib"u8)) {
+                chunk.Commands.Add((chunk.Faces.Count, CommandType.MaterialLib, Encoding.UTF8.GetString(tokens.Rest)));
+            } else if (command.SequenceEqual("s"u8)) {
                 // Ignore smooth commands
             } else {
-                errors.Add($"Unknown command '{line}' (line {cur_line}).");
+                chunk.Errors.Add(new(cur_line, $"Unknown command '{Encoding.UTF8.GetString(line)}'"));
             }
         }
 
-        return errors;
+        chunk.NumLines = cur_line;
+        return chunk;
     }
 
     // Common regular expressions for extracting values
     readonly Regex regexFloat = new(@"([+-]?([0-9]+([.][0-9]*)?|[.][0-9]+))", RegexOptions.Compiled);
-    readonly Regex regexIndex = new(@"([+-]?[0-9]+)/?([+-]?[0-9]+)?/?([+-]?[0-9]+)?", RegexOptions.Compiled);
 
     private List<string> ParseMtlFile(StreamReader stream) {
         var errors = new List<string>();
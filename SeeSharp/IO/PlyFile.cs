@@ -1,4 +1,6 @@
-﻿using System.Linq;
+﻿using System.Buffers.Binary;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
 using System.Text;
 
 namespace SeeSharp.IO;
@@ -8,34 +10,26 @@ namespace SeeSharp.IO;
 /// Note, we ignore vertex color or other auxilary information
 /// </summary>
 public class PlyFile {
-
     /// <summary>
-    /// A face with arbitrarily many vertices, given by a list of indices
-    /// </summary>
-    public class Face {
-        /// <summary> Indices of the face </summary>
-        public List<int> Indices = new();
-    }
-
-    /// <summary>
-    /// All faces in the file
+    /// All vertices in the entire file
     /// </summary>
-    public List<Face> Faces = new();
+    public Vector3[] Vertices = [];
 
     /// <summary>
-    /// All vertices in the entire file
+    /// Shading normals of all vertices, or null
     /// </summary>
-    public List<Vector3> Vertices = new();
+    public Vector3[] Normals;
 
     /// <summary>
-    /// Shading normals of all vertices
+    /// Texture coordinates of all vertices, or null
     /// </summary>
-    public List<Vector3> Normals = new();
+    public Vector2[] Texcoords;
 
     /// <summary>
-    /// Texture coordinates of all vertices
+    /// Three vertex indices per triangle. Polygons are triangulated as a fan, which assumes that they are
+    /// convex.
     /// </summary>
-    public List<Vector2> Texcoords = new();
+    public int[] Indices = [];
 
     /// <summary>
     /// Loads .ply file and returns list of errors
@@ -46,10 +40,9 @@ public class PlyFile {
         var watch = System.Diagnostics.Stopwatch.StartNew();
         Logger.Log($"Parsing {filename}...", Verbosity.Debug);
 
-        bool success = false;
-        // Parse the .ply itself
-        using (var file = new MixReader(filename, Encoding.ASCII))
-            success = ParsePlyFile(file);
+        bool success;
+        using (MappedFile file = new(filename))
+            success = ParsePlyFile(file, filename);
         watch.Stop();
         Logger.Log($"Done parsing .ply after {watch.ElapsedMilliseconds}ms.", Verbosity.Debug);
 
@@ -60,156 +53,7 @@ public class PlyFile {
     /// Constructs mesh from previously loaded file content
     /// </summary>
     /// <returns>A mesh</returns>
-    public Mesh ToMesh() {
-        return new(Vertices.ToArray(), ToTriangleList().ToArray(),
-               Normals.Count == 0 ? null : Normals.ToArray(),
-               Texcoords.Count == 0 ? null : Texcoords.ToArray());
-    }
-
-    /// <summary>
-    /// Construct list of triangle indices from convex polygons
-    /// </summary>
-    private List<int> ToTriangleList() {
-        List<int> list = new();
-        bool warn_face = false;
-        foreach (Face f in Faces) {
-            if (f.Indices.Count == 3) {
-                list.AddRange(f.Indices);
-            } else if (f.Indices.Count < 3) {
-                warn_face = true;
-            } else { // Fan triangulation, only works for convex polygons
-                int pin = f.Indices[0];
-                for (int i = 2; i < f.Indices.Count; ++i) {
-                    list.AddRange(new int[3] { pin, f.Indices[i - 1], f.Indices[i] });
-                }
-            }
-        }
-
-        if (warn_face) Logger.Log("Mesh contains invalid faces. Skipping them.", Verbosity.Warning);
-
-        return list;
-    }
-
-    /// <summary>
-    /// Interface to read binary and ascii based data region
-    /// </summary>
-    private interface IDataReader {
-        public (Vector3, Vector3, Vector2) ReadPerVertexLine();
-        public Face ReadFaceLine();
-    }
-
-    /// <summary>
-    /// Data reader for ascii based files
-    /// </summary>
-    private class AsciiDataReader : IDataReader {
-        public AsciiDataReader(PlyHeader header, MixReader stream) {
-            Header = header;
-            Stream = stream;
-        }
-
-        public Face ReadFaceLine() {
-            bool eos = false;// Ignore
-            string[] parts = Stream.ReadLineAsString(ref eos).Split();
-            int count = int.Parse(parts[0]);
-            return new() { Indices = parts.Skip(1).Take(count).Select(p => int.Parse(p)).ToList() };
-        }
-
-        public (Vector3, Vector3, Vector2) ReadPerVertexLine() {
-            bool eos = false;// Ignore
-            string[] parts = Stream.ReadLineAsString(ref eos).Split();
-
-            float GetPart(int elem) {
-                if (elem != -1 && elem < parts.Length)
-                    return float.Parse(parts[elem]);
-                else
-                    return 0;
-            }
-
-            float x = GetPart(Header.XElem);
-            float y = GetPart(Header.YElem);
-            float z = GetPart(Header.ZElem);
-            float nx = GetPart(Header.NXElem);
-            float ny = GetPart(Header.NYElem);
-            float nz = GetPart(Header.NZElem);
-            float u = GetPart(Header.UElem);
-            float v = GetPart(Header.VElem);
-
-            return (new(x, y, z), new(nx, ny, nz), new(u, v));
-        }
-
-        private readonly PlyHeader Header;
-        private readonly MixReader Stream;
-    }
-
-    /// <summary>
-    /// Data reader for binary based files
-    /// </summary>
-    private class BinaryDataReader : IDataReader {
-        public BinaryDataReader(PlyHeader header, MixReader stream) {
-            Header = header;
-            Stream = stream;
-            IsBigEndian = header.IsBigEndian;
-        }
-
-        private int GetIndex() {
-            bool swap = IsBigEndian == BitConverter.IsLittleEndian;
-            int val = Stream.ReadInt32();
-            if (swap) {
-                byte[] bytes = BitConverter.GetBytes(val);
-                Array.Reverse(bytes);
-                return BitConverter.ToInt32(bytes);
-            } else {
-                return val;
-            }
-        }
-
-        private float GetSingle() {
-            bool swap = IsBigEndian == BitConverter.IsLittleEndian;
-            float val = Stream.ReadSingle();
-            if (swap) {
-                byte[] bytes = BitConverter.GetBytes(val);
-                Array.Reverse(bytes);
-                return BitConverter.ToSingle(bytes);
-            } else {
-                return val;
-            }
-        }
-
-        public Face ReadFaceLine() {
-            byte elemcount = Stream.ReadByte();
-
-            Face face = new();
-            for (byte i = 0; i < elemcount; ++i) {
-                face.Indices.Add(GetIndex());
-            }
-
-            return face;
-        }
-
-        public (Vector3, Vector3, Vector2) ReadPerVertexLine() {
-            float x = 0, y = 0, z = 0;
-            float nx = 0, ny = 0, nz = 0;
-            float u = 0, v = 0;
-
-            for (int i = 0; i < Header.VertexPropCount; ++i) {
-                float val = GetSingle();
-                if (i == Header.XElem) x = val;
-                if (i == Header.YElem) y = val;
-                if (i == Header.ZElem) z = val;
-                if (i == Header.NXElem) nx = val;
-                if (i == Header.NYElem) ny = val;
-                if (i == Header.NZElem) nz = val;
-                if (i == Header.UElem) u = val;
-                if (i == Header.VElem) v = val;
-            }
-
-            return (new(x, y, z), new(nx, ny, nz), new(u, v));
-        }
-
-        private readonly PlyHeader Header;
-        private readonly MixReader Stream;
-        private readonly bool IsBigEndian;
-    }
+    public Mesh ToMesh() => new(Vertices, Indices, Normals, Texcoords);
 
     /// <summary>
     /// Essential informations from the .ply header which is always given in ascii format
@@ -263,24 +107,25 @@ public class PlyFile {
     /// <summary>
     /// Will parse the header and populate the PlyHeader structure
     /// </summary>
-    /// <param name="stream"></param>
+    /// <param name="data">Content of the file, advanced to the start of the data region</param>
+    /// <param name="path">Path of the file, for error messages</param>
     /// <returns>PlyHeader or null if error</returns>
-    private static PlyHeader ParsePlyHeader(MixReader stream) {
+    private static PlyHeader ParsePlyHeader(ref ReadOnlySpan<byte> data, string path) {
         PlyHeader header = new();
 
-        bool eos = false;
-        string magic = stream.ReadLineAsString(ref eos);
+        AsciiTokenizer.NextLine(ref data, out var magicLine);
+        string magic = Encoding.ASCII.GetString(magicLine).TrimEnd('\r');
         if (magic != "ply") {
-            throw new MeshLoadException("Trying to load invalid .ply file.", stream.Path);
+            throw new MeshLoadException("Trying to load invalid .ply file.", path);
         }
 
-        if (eos) {
-            throw new MeshLoadException("Trying to load empty header .ply file.", stream.Path);
+        if (data.IsEmpty) {
+            throw new MeshLoadException("Trying to load empty header .ply file.", path);
         }
 
         int facePropCounter = 0;
-        while (!eos) {
-            string line = stream.ReadLineAsString(ref eos);
+        while (AsciiTokenizer.NextLine(ref data, out var lineBytes)) {
+            string line = Encoding.ASCII.GetString(lineBytes).TrimEnd('\r');
             string[] parts = line.Split();
             if (parts.Length == 0)
                 continue;
@@ -290,7 +135,7 @@ public class PlyFile {
                 continue;
             } else if (action == "format") {
                 if (!IsAllowedMethod(parts[1])) {
-                    Logger.Log($"In '{stream.Path}' unknown format '{parts[1]}' given. Ignoring it.", Verbosity.Warning);
+                    Logger.Log($"In '{path}' unknown format '{parts[1]}' given. Ignoring it.", Verbosity.Warning);
                     continue;
                 }
 
@@ -302,7 +147,7 @@ public class PlyFile {
                 else if (type == "face")
                     header.FaceCount = int.Parse(parts[2]);
                 else
-                    Logger.Log($"In '{stream.Path}' unknown element type '{type}' given. Ignoring it.", Verbosity.Warning);
+                    Logger.Log($"In '{path}' unknown element type '{type}' given. Ignoring it.", Verbosity.Warning);
             } else if (action == "property") {
                 string type = parts[1];
                 if (type == "float") {
@@ -332,25 +177,25 @@ public class PlyFile {
                     string name = parts[4];
 
                     if (!IsAllowedVertCountType(countType)) {
-                        Logger.Log($"In '{stream.Path}' only 'property list uchar int' is supported. Ignoring '{countType}'.", Verbosity.Warning);
+                        Logger.Log($"In '{path}' only 'property list uchar int' is supported. Ignoring '{countType}'.", Verbosity.Warning);
                         continue;
                     }
 
                     if (!IsAllowedVertIndType(indType)) {
-                        Logger.Log($"In '{stream.Path}' only 'property list uchar int' is supported. Ignoring '{indType}'.", Verbosity.Warning);
+                        Logger.Log($"In '{path}' only 'property list uchar int' is supported. Ignoring '{indType}'.", Verbosity.Warning);
                         continue;
                     }
 
                     if (name == "vertex_indices" || name == "vertex_index")
                         header.IndElem = facePropCounter - 1;
                 } else {
-                    Logger.Log($"In '{stream.Path}' only float or list properties allowed. Ignoring '{type}'.", Verbosity.Warning);
+                    Logger.Log($"In '{path}' only float or list properties allowed. Ignoring '{type}'.", Verbosity.Warning);
                     ++header.VertexPropCount;
                 }
             } else if (action == "end_header") {
                 break;
             } else {
-                Logger.Log($"In '{stream.Path}' unknown header entry '{action}'.", Verbosity.Warning);
+                Logger.Log($"In '{path}' unknown header entry '{action}'.", Verbosity.Warning);
             }
         }
 
@@ -360,52 +205,248 @@ public class PlyFile {
     /// <summary>
     /// Will parse the whole file, starting with the header and following up with the data region
     /// </summary>
-    /// <param name="stream"></param>
+    /// <param name="file">The mapped file</param>
+    /// <param name="path">Path of the file, for error messages</param>
     /// <returns>True if successful</returns>
-    private bool ParsePlyFile(MixReader stream) {
-
-        PlyHeader header = ParsePlyHeader(stream);
+    private bool ParsePlyFile(MappedFile file, string path) {
+        ReadOnlySpan<byte> data = file.SliceToEnd(0);
+        int headerLength = data.Length;
+        PlyHeader header = ParsePlyHeader(ref data, path);
+        long dataStart = headerLength - data.Length;
 
         // Error in header, return false
         if (header == null)
             return false;
 
         if (!header.HasVertices || !header.HasIndices) {
-            throw new MeshLoadException("Ply file has no data.", stream.Path);
+            throw new MeshLoadException("Ply file has no data.", path);
         }
 
-        // Setup reader
-        IDataReader reader;
-        if (header.IsBinary) {
-            reader = new BinaryDataReader(header, stream);
-        } else {
-            reader = new AsciiDataReader(header, stream);
+        if (header.IndElem != 0) {
+            Logger.Log($"In '{path}' no support for multiple face properties. Assuming first entry to be the list of indices.", Verbosity.Warning);
         }
 
-        // Reserve memory
-        Vertices.Capacity = header.VertexCount;
-        if (header.HasNormals) Normals.Capacity = header.VertexCount;
-        if (header.HasUVs) Texcoords.Capacity = header.VertexCount;
+        Vertices = new Vector3[header.VertexCount];
+        Normals = header.HasNormals ? new Vector3[header.VertexCount] : null;
+        Texcoords = header.HasUVs ? new Vector2[header.VertexCount] : null;
+
+        bool invalidFaces;
+        if (header.IsBinary)
+            invalidFaces = ParseBinaryData(header, file, dataStart, path);
+        else
+            invalidFaces = ParseAsciiData(header, file, dataStart, path);
 
-        // Read per vertex stuff
-        for (int i = 0; i < header.VertexCount; ++i) {
-            (Vector3 vertex, Vector3 normal, Vector2 tex) = reader.ReadPerVertexLine();
+        if (invalidFaces) Logger.Log("Mesh contains invalid faces. Skipping them.", Verbosity.Warning);
+
+        return true;
+    }
 
-            Vertices.Add(vertex);
-            if (header.HasNormals) Normals.Add(normal);
-            if (header.HasUVs) Texcoords.Add(tex);
+    void SetVertex(PlyHeader header, int idx, ReadOnlySpan<float> properties) {
+        static float Get(ReadOnlySpan<float> p, int elem) => elem >= 0 && elem < p.Length ? p[elem] : 0;
+        Vertices[idx] = new(Get(properties, header.XElem), Get(properties, header.YElem), Get(properties, header.ZElem));
+        if (Normals != null)
+            Normals[idx] = new(Get(properties, header.NXElem), Get(properties, header.NYElem), Get(properties, header.NZElem));
+        if (Texcoords != null)
+            Texcoords[idx] = new(Get(properties, header.UElem), Get(properties, header.VElem));
+    }
+
+    static int NumTriangles(int numFaceVertices) => numFaceVertices >= 3 ? numFaceVertices - 2 : 0;
+
+    /// <summary>
+    /// Parses the ascii data region in parallel. The text is split into chunks at line breaks. A first pass
+    /// counts the lines and triangles in each chunk, and parses the vertices. Prefix sums over the counts
+    /// give the position of each face in the index array, which a second pass fills in.
+    /// </summary>
+    /// <returns>True if there were invalid faces</returns>
+    private bool ParseAsciiData(PlyHeader header, MappedFile file, long dataStart, string path) {
+        long[] chunks = AsciiTokenizer.SplitLines(file, dataStart, AsciiTokenizer.ChunkSize(file.Length - dataStart));
+        int numChunks = chunks.Length - 1;
+
+        int[] firstLine = new int[numChunks + 1];
+        for (int c = 0; c < numChunks; ++c)
+            firstLine[c + 1] = firstLine[c] + file.Slice(chunks[c], chunks[c + 1] - chunks[c]).Count((byte)'\n');
+
+        int[] firstTriangle = new int[numChunks + 1];
+        int[] firstFaceByte = new int[numChunks];
+        int[] firstFaceLine = new int[numChunks];
+        int invalidNumbers = 0, invalidFaces = 0;
+        Parallel.For(0, numChunks, c => {
+            ReadOnlySpan<byte> text = file.Slice(chunks[c], chunks[c + 1] - chunks[c]);
+            Span<float> properties = stackalloc float[header.VertexPropCount];
+            int numTriangles = 0;
+            firstFaceByte[c] = -1;
+            int offset = 0;
+            for (int lineIdx = firstLine[c]; AsciiTokenizer.NextLine(ref text, out var line); ++lineIdx) {
+                int lineStart = offset;
+                offset += line.Length + 1;
+                if (lineIdx < header.VertexCount) {
+                    AsciiTokenizer tokens = new(line);
+                    for (int i = 0; i < properties.Length; ++i) {
+                        var token = tokens.NextToken();
+                        if (token.IsEmpty)
+                            properties[i] = 0;
+                        else if (!AsciiTokenizer.TryParseFloat(token, out properties[i]))
+                            Interlocked.Increment(ref invalidNumbers);
+                    }
+                    SetVertex(header, lineIdx, properties);
+                } else if (lineIdx < header.VertexCount + header.FaceCount) {
+                    if (firstFaceByte[c] < 0) (firstFaceByte[c], firstFaceLine[c]) = (lineStart, lineIdx);
+                    AsciiTokenizer tokens = new(line);
+                    if (!tokens.TryReadInt(out int count))
+                        Interlocked.Increment(ref invalidNumbers);
+                    numTriangles += NumTriangles(count);
+                }
+            }
+            firstTriangle[c + 1] = numTriangles;
+        });
+
+        for (int c = 0; c < numChunks; ++c)
+            firstTriangle[c + 1] += firstTriangle[c];
+        Indices = new int[firstTriangle[numChunks] * 3];
+
+        Parallel.For(0, numChunks, c => {
+            if (firstFaceByte[c] < 0) return;
+            ReadOnlySpan<byte> text = file.Slice(chunks[c] + firstFaceByte[c],
+                chunks[c + 1] - chunks[c] - firstFaceByte[c]);
+            int next = firstTriangle[c] * 3;
+            for (int lineIdx = firstFaceLine[c]; lineIdx < header.VertexCount + header.FaceCount && AsciiTokenizer.NextLine(ref text, out var line); ++lineIdx) {
+                AsciiTokenizer tokens = new(line);
+                tokens.TryReadInt(out int count);
+                if (count < 3) {
+                    Interlocked.Increment(ref invalidFaces);
+                    continue;
+                }
+
+                // Fan triangulation, only works for convex polygons
+                int pin = 0, prev = 0;
+                for (int i = 0; i < count; ++i) {
+                    if (!tokens.TryReadInt(out int idx))
+                        Interlocked.Increment(ref invalidNumbers);
+                    if (i == 0) {
+                        pin = idx;
+                    } else if (i >= 2) {
+                        Indices[next++] = pin;
+                        Indices[next++] = prev;
+                        Indices[next++] = idx;
+                    }
+                    prev = idx;
+                }
+            }
+        });
+
+        if (invalidNumbers > 0)
+            throw new MeshLoadException("Invalid number in the data of the .ply file.", path);
+
+        bool endsWithLineBreak = file.Length == dataStart || file.Slice(file.Length - 1, 1)[0] == '\n';
+        if (firstLine[numChunks] + (endsWithLineBreak ? 0 : 1) < header.VertexCount + header.FaceCount)
+            throw new MeshLoadException("Unexpected end of .ply file.", path);
+
+        return invalidFaces > 0;
+    }
+
+    /// <summary>
+    /// Parses the binary data region. All vertex properties are 32 bit floats, faces are a list of 32 bit
+    /// integers with an 8 bit count. The vertex block is brought into native byte order in vectorized
+    /// passes over slices of whole records, and decoded with fixed offsets per record. Indices are gathered
+    /// as they are and swapped in bulk.
+    /// </summary>
+    /// <returns>True if there were invalid faces</returns>
+    private unsafe bool ParseBinaryData(PlyHeader header, MappedFile file, long dataStart, string path) {
+        bool swap = header.IsBigEndian == BitConverter.IsLittleEndian;
+        int recordBytes = header.VertexPropCount * sizeof(float);
+        long vertexBytes = (long)recordBytes * header.VertexCount;
+        if (dataStart + vertexBytes > file.Length)
+            throw new MeshLoadException("Unexpected end of .ply file.", path);
+
+        // Spans cannot address the whole block of large meshes, so it is decoded in slices
+        int verticesPerSlice = Math.Max(1, (1 << 28) / recordBytes);
+        float[] swapped = swap ? new float[(long)Math.Min(verticesPerSlice, header.VertexCount) * header.VertexPropCount] : null;
+        for (int first = 0; first < header.VertexCount; first += verticesPerSlice) {
+            int count = Math.Min(verticesPerSlice, header.VertexCount - first);
+            var bytes = file.Slice(dataStart + (long)first * recordBytes, (long)count * recordBytes);
+            ReadOnlySpan<float> values = MemoryMarshal.Cast<byte, float>(bytes);
+            if (swap) {
+                var dst = swapped.AsSpan(0, values.Length);
+                BinaryPrimitives.ReverseEndianness(MemoryMarshal.Cast<float, int>(values), MemoryMarshal.Cast<float, int>(dst));
+                values = dst;
+            }
+            DecodeVertices(header, values, first);
         }
 
-        // Read per face indices
-        if (header.IndElem != 0) {
-            Logger.Log($"In '{stream.Path}' no support for multiple face properties. Assuming first entry to be the list of indices.", Verbosity.Warning);
+        byte* faces = file.Pointer + dataStart + vertexBytes;
+        long facesLength = file.Length - dataStart - vertexBytes;
+
+        // Faces have variable size, so we first count the triangles to allocate the index array
+        long numTriangles = 0;
+        long pos = 0;
+        for (int f = 0; f < header.FaceCount; ++f) {
+            if (pos >= facesLength)
+                throw new MeshLoadException("Unexpected end of .ply file.", path);
+            int count = faces[pos];
+            numTriangles += NumTriangles(count);
+            pos += 1 + count * sizeof(int);
+        }
+        if (pos > facesLength)
+            throw new MeshLoadException("Unexpected end of .ply file.", path);
+
+        Indices = new int[numTriangles * 3];
+        bool invalidFaces = false;
+        int next = 0;
+        pos = 0;
+        for (int f = 0; f < header.FaceCount; ++f) {
+            int count = faces[pos++];
+            int* face = (int*)(faces + pos);
+            pos += count * sizeof(int);
+            if (count < 3) {
+                invalidFaces = true;
+                continue;
+            }
+
+            // Fan triangulation, only works for convex polygons
+            int pin = Unsafe.ReadUnaligned<int>(face);
+            for (int i = 2; i < count; ++i) {
+                Indices[next++] = pin;
+                Indices[next++] = Unsafe.ReadUnaligned<int>(face + i - 1);
+                Indices[next++] = Unsafe.ReadUnaligned<int>(face + i);
+            }
         }
 
-        // Load faces. Will be triangulated later
-        for (int i = 0; i < header.FaceCount; ++i) {
-            Faces.Add(reader.ReadFaceLine());
+        if (swap)
+            BinaryPrimitives.ReverseEndianness(Indices, Indices);
+
+        return invalidFaces;
+    }
+
+    /// <summary>
+    /// Copies the attributes out of the fixed-stride vertex records, given in native byte order
+    /// </summary>
+    /// <param name="header">The header of the file</param>
+    /// <param name="values">The records of consecutive vertices</param>
+    /// <param name="first">Index of the first vertex in the records</param>
+    private void DecodeVertices(PlyHeader header, ReadOnlySpan<float> values, int first) {
+        int stride = header.VertexPropCount;
+        int count = values.Length / stride;
+
+        // The common layout of only tightly packed positions is a plain copy
+        if (stride == 3 && header.XElem == 0 && header.YElem == 1 && header.ZElem == 2) {
+            MemoryMarshal.Cast<float, Vector3>(values).CopyTo(Vertices.AsSpan(first, count));
+            return;
         }
 
-        return true;
+        int x = header.XElem, y = header.YElem, z = header.ZElem;
+        for (int v = 0, b = 0; v < count; ++v, b += stride)
+            Vertices[first + v] = new(values[b + x], values[b + y], values[b + z]);
+
+        if (Normals != null) {
+            int nx = header.NXElem, ny = header.NYElem, nz = header.NZElem;
+            for (int v = 0, b = 0; v < count; ++v, b += stride)
+                Normals[first + v] = new(values[b + nx], values[b + ny], values[b + nz]);
+        }
+
+        if (Texcoords != null) {
+            int u = header.UElem, w = header.VElem;
+            for (int v = 0, b = 0; v < count; ++v, b += stride)
+                Texcoords[first + v] = new(values[b + u], values[b + w]);
+        }
     }
-}
\ No newline at end of file
+}
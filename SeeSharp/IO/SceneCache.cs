@@ -0,0 +1,335 @@
+using System.IO.MemoryMappedFiles;
+using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+using System.Security.Cryptography;
+using System.Text;
+
+namespace SeeSharp.IO;
+
+/// <summary>
+/// Versioned binary cache of the meshes in a .json scene, stored next to the .json file. It holds the
+/// flat vertex, index, normal, and texture coordinate arrays of each mesh, the area CDF used to sample
+/// triangles, and the names of the material and emission of each mesh. Loading memory-maps the file and
+/// copies the arrays in bulk, no per-element parsing is done.
+///
+/// The cache is keyed by a hash of the .json content and of the size and modification time of all mesh
+/// files it references, including the .mtl files next to each .obj (they can define the emission). Any
+/// change to either causes the cache to be rebuilt on the next load.
+/// Objects whose materials are not declared in the .json (e.g., from an .mtl file) are not cached and
+/// always loaded from their source file.
+/// </summary>
+public static class SceneCache {
+    /// <summary>
+    /// Incremented whenever the file layout changes, older caches are ignored and overwritten
+    /// </summary>
+    public const int Version = 1;
+
+    const uint Magic = 0x53435353; // "SSCS"
+    const int KeySize = 32;
+    const int Alignment = 16;
+
+    enum EmitterKind : byte { None, Diffuse, Glossy }
+
+    /// <returns>The path of the cache file that belongs to the given .json scene</returns>
+    public static string GetCachePath(string jsonPath) => Path.ChangeExtension(jsonPath, ".meshcache");
+
+    /// <summary>
+    /// Computes the key that identifies a valid cache for the given scene
+    /// </summary>
+    /// <param name="jsonPath">Path to the .json scene file</param>
+    /// <param name="jsonString">Content of the .json file</param>
+    /// <param name="objects">The "objects" array in the .json</param>
+    internal static byte[] ComputeKey(string jsonPath, string jsonString, JsonElement objects) {
+        using var hash = IncrementalHash.CreateHash(HashAlgorithmName.SHA256);
+        hash.AppendData(BitConverter.GetBytes(Version));
+        hash.AppendData(Encoding.UTF8.GetBytes(jsonString));
+
+        // Hashing the content of large mesh files would defeat the purpose, their size and modification
+        // time are a good enough proxy
+        string dirname = Path.GetDirectoryName(jsonPath);
+        foreach (var obj in objects.EnumerateArray()) {
+            if (!obj.TryGetProperty("relativePath", out var relpath))
+                continue;
+            string filename = Path.Join(dirname, relpath.GetString());
+            AppendFileInfo(hash, new(filename));
+
+            // Finding the mtllib lines would require scanning the whole .obj. Instead, we conservatively
+            // include all .mtl files in the same directory, which is where they are in practice.
+            if (Path.GetExtension(filename).Equals(".obj", StringComparison.OrdinalIgnoreCase)) {
+                string objDir = Path.GetDirectoryName(Path.GetFullPath(filename));
+                if (!Directory.Exists(objDir)) continue;
+                var mtlFiles = Directory.GetFiles(objDir, "*.mtl");
+                Array.Sort(mtlFiles, StringComparer.Ordinal);
+                foreach (string mtl in mtlFiles) {
+                    hash.AppendData(Encoding.UTF8.GetBytes(Path.GetFileName(mtl)));
+                    AppendFileInfo(hash, new(mtl));
+                }
+            }
+        }
+
+        return hash.GetHashAndReset();
+    }
+
+    static void AppendFileInfo(IncrementalHash hash, FileInfo info) {
+        hash.AppendData(BitConverter.GetBytes(info.Exists ? info.Length : -1));
+        hash.AppendData(BitConverter.GetBytes(info.Exists ? info.LastWriteTimeUtc.Ticks : 0));
+    }
+
+    struct MeshRecord {
+        public int ObjectIdx;
+        public string MaterialName;
+        public EmitterKind EmitterKind;
+        public RgbColor Radiance;
+        public float Exponent;
+        public int NumVertices, NumIndices;
+        public long Vertices, Indices, Normals, TextureCoordinates, Cdf;
+    }
+
+    /// <summary>
+    /// Loads all cached objects, if the cache exists and matches the key
+    /// </summary>
+    /// <param name="cachePath">Path to the cache file</param>
+    /// <param name="key">Expected key, see <see cref="ComputeKey"/></param>
+    /// <param name="namedMaterials">Materials declared in the .json</param>
+    /// <param name="meshSets">Receives the meshes of each cached object</param>
+    /// <param name="emitterSets">Receives the emitters of each cached object</param>
+    /// <returns>
+    /// Flags which objects were loaded from the cache, or null if the cache is missing or invalid
+    /// </returns>
+    internal static unsafe bool[] TryLoad(string cachePath, byte[] key, Dictionary<string, Material> namedMaterials,
+                                          IEnumerable<Mesh>[] meshSets, IEnumerable<Emitter>[] emitterSets) {
+        if (!File.Exists(cachePath))
+            return null;
+
+        var timer = Stopwatch.StartNew();
+        try {
+            using var file = MemoryMappedFile.CreateFromFile(cachePath, FileMode.Open, null, 0,
+                MemoryMappedFileAccess.Read);
+            using var view = file.CreateViewAccessor(0, 0, MemoryMappedFileAccess.Read);
+            byte* ptr = null;
+            view.SafeMemoryMappedViewHandle.AcquirePointer(ref ptr);
+            try {
+                nint data = (nint)(ptr + view.PointerOffset);
+                long length = (long)view.SafeMemoryMappedViewHandle.ByteLength - view.PointerOffset;
+                var result = Load(data, length, key, namedMaterials, meshSets, emitterSets);
+                if (result != null)
+                    Logger.Log($"Loaded meshes from cache '{cachePath}' in {timer.ElapsedMilliseconds}ms",
+                        Verbosity.Debug);
+                return result;
+            } finally {
+                view.SafeMemoryMappedViewHandle.ReleasePointer();
+            }
+        } catch (Exception e) when (e is IOException or UnauthorizedAccessException or InvalidDataException) {
+            Logger.Log($"Ignoring invalid scene cache '{cachePath}': {e.Message}", Verbosity.Warning);
+            return null;
+        }
+    }
+
+    static unsafe bool[] Load(nint data, long length, byte[] key, Dictionary<string, Material> namedMaterials,
+                              IEnumerable<Mesh>[] meshSets, IEnumerable<Emitter>[] emitterSets) {
+        // The directory is read sequentially, it only contains offsets and a few small fields
+        long offset = 0;
+        T Read<T>() where T : unmanaged {
+            if (offset + sizeof(T) > length)
+                throw new InvalidDataException("Unexpected end of file");
+            T value = Unsafe.ReadUnaligned<T>((byte*)data + offset);
+            offset += sizeof(T);
+            return value;
+        }
+        long Skip(long numBytes) {
+            offset = (offset + Alignment - 1) / Alignment * Alignment;
+            long start = offset;
+            offset += numBytes;
+            if (offset > length)
+                throw new InvalidDataException("Unexpected end of file");
+            return start;
+        }
+
+        if (Read<uint>() != Magic || Read<int>() != Version)
+            return null;
+        for (int i = 0; i < KeySize; ++i)
+            if (Read<byte>() != key[i]) return null;
+        if (Read<int>() != meshSets.Length)
+            return null;
+
+        bool[] loaded = new bool[meshSets.Length];
+        List<MeshRecord> records = [];
+        for (int objIdx = 0; objIdx < meshSets.Length; ++objIdx) {
+            loaded[objIdx] = Read<byte>() != 0;
+            if (!loaded[objIdx]) continue;
+
+            int numMeshes = Read<int>();
+            for (int k = 0; k < numMeshes; ++k) {
+                MeshRecord r = new() { ObjectIdx = objIdx };
+                int nameLength = Read<int>();
+                long nameStart = Skip(nameLength);
+                r.MaterialName = Encoding.UTF8.GetString((byte*)data + nameStart, nameLength);
+                if (!namedMaterials.ContainsKey(r.MaterialName))
+                    throw new InvalidDataException($"Unknown material '{r.MaterialName}'");
+
+                r.EmitterKind = Read<EmitterKind>();
+                r.Radiance = new(Read<float>(), Read<float>(), Read<float>());
+                r.Exponent = Read<float>();
+                r.NumVertices = Read<int>();
+                r.NumIndices = Read<int>();
+                byte hasNormals = Read<byte>();
+                byte hasTexCoords = Read<byte>();
+
+                r.Vertices = Skip((long)r.NumVertices * sizeof(Vector3));
+                r.Indices = Skip((long)r.NumIndices * sizeof(int));
+                r.Normals = hasNormals != 0 ? Skip((long)r.NumVertices * sizeof(Vector3)) : -1;
+                r.TextureCoordinates = hasTexCoords != 0 ? Skip((long)r.NumVertices * sizeof(Vector2)) : -1;
+                r.Cdf = Skip((long)r.NumIndices / 3 * sizeof(float));
+                records.Add(r);
+            }
+        }
+
+        // Copy the arrays and create the meshes in parallel
+        var meshes = new Mesh[records.Count];
+        var emitters = new IEnumerable<Emitter>[records.Count];
+        Parallel.For(0, records.Count, i => {
+            var r = records[i];
+            T[] Copy<T>(long start, int count) where T : unmanaged
+            => start < 0 ? null : new ReadOnlySpan<T>((byte*)data + start, count).ToArray();
+
+            meshes[i] = new(
+                Copy<Vector3>(r.Vertices, r.NumVertices),
+                Copy<int>(r.Indices, r.NumIndices),
+                Copy<Vector3>(r.Normals, r.NumVertices),
+                Copy<Vector2>(r.TextureCoordinates, r.NumVertices),
+                PiecewiseConstantPDF.FromCdf(Copy<float>(r.Cdf, r.NumIndices / 3))
+            ) {
+                Material = namedMaterials[r.MaterialName]
+            };
+
+            emitters[i] = r.EmitterKind switch {
+                EmitterKind.Diffuse => DiffuseEmitter.MakeFromMesh(meshes[i], r.Radiance),
+                EmitterKind.Glossy => GlossyEmitter.MakeFromMesh(meshes[i], r.Radiance, r.Exponent),
+                _ => null
+            };
+        });
+
+        // Group the meshes and emitters by object, in the order they were stored
+        for (int i = 0; i < records.Count; ++i) {
+            int objIdx = records[i].ObjectIdx;
+            meshSets[objIdx] ??= new List<Mesh>();
+            ((List<Mesh>)meshSets[objIdx]).Add(meshes[i]);
+            if (emitters[i] != null) {
+                emitterSets[objIdx] ??= new List<Emitter>();
+                ((List<Emitter>)emitterSets[objIdx]).AddRange(emitters[i]);
+            }
+        }
+        for (int objIdx = 0; objIdx < meshSets.Length; ++objIdx)
+            if (loaded[objIdx]) meshSets[objIdx] ??= new List<Mesh>();
+
+        return loaded;
+    }
+
+    /// <summary>
+    /// Writes the cache for a freshly loaded scene. Failures are logged and otherwise ignored, the cache
+    /// is purely an optimization.
+    /// </summary>
+    /// <param name="cachePath">Path to the cache file</param>
+    /// <param name="key">The key of the scene, see <see cref="ComputeKey"/></param>
+    /// <param name="namedMaterials">Materials declared in the .json</param>
+    /// <param name="meshSets">Meshes of each object</param>
+    /// <param name="emitterSets">Emitters of each object</param>
+    internal static void Write(string cachePath, byte[] key, Dictionary<string, Material> namedMaterials,
+                               IEnumerable<Mesh>[] meshSets, IEnumerable<Emitter>[] emitterSets) {
+        Dictionary<Material, string> materialNames = [];
+        foreach (var (name, material) in namedMaterials)
+            materialNames[material] = name;
+
+        string tempPath = cachePath + ".tmp";
+        try {
+            using (var stream = new FileStream(tempPath, FileMode.Create, FileAccess.Write))
+            using (var writer = new BinaryWriter(stream)) {
+                void Pad() {
+                    while (stream.Position % Alignment != 0) writer.Write((byte)0);
+                }
+                void WriteArray<T>(ReadOnlySpan<T> values) where T : unmanaged {
+                    Pad();
+                    writer.Write(MemoryMarshal.AsBytes(values));
+                }
+
+                writer.Write(Magic);
+                writer.Write(Version);
+                writer.Write(key);
+                writer.Write(meshSets.Length);
+
+                for (int objIdx = 0; objIdx < meshSets.Length; ++objIdx) {
+                    var meshes = meshSets[objIdx]?.ToList();
+                    var emitters = emitterSets[objIdx]?.ToList() ?? [];
+                    if (meshes == null || !IsCacheable(meshes, emitters, materialNames)) {
+                        writer.Write((byte)0);
+                        continue;
+                    }
+
+                    Dictionary<Mesh, Emitter> meshEmitters = [];
+                    foreach (var emitter in emitters)
+                        meshEmitters.TryAdd(emitter.Mesh, emitter);
+
+                    writer.Write((byte)1);
+                    writer.Write(meshes.Count);
+                    foreach (var mesh in meshes) {
+                        byte[] name = Encoding.UTF8.GetBytes(materialNames[mesh.Material]);
+                        writer.Write(name.Length);
+                        Pad();
+                        writer.Write(name);
+
+                        var (kind, radiance, exponent) = meshEmitters.GetValueOrDefault(mesh) switch {
+                            DiffuseEmitter d => (EmitterKind.Diffuse, d.Radiance, 0.0f),
+                            GlossyEmitter g => (EmitterKind.Glossy, g.Radiance, g.Exponent),
+                            _ => (EmitterKind.None, RgbColor.Black, 0.0f)
+                        };
+                        writer.Write((byte)kind);
+                        writer.Write(radiance.R);
+                        writer.Write(radiance.G);
+                        writer.Write(radiance.B);
+                        writer.Write(exponent);
+
+                        writer.Write(mesh.NumVertices);
+                        writer.Write(mesh.Indices.Length);
+                        writer.Write((byte)(mesh.HasShadingNormals ? 1 : 0));
+                        writer.Write((byte)(mesh.TextureCoordinates != null ? 1 : 0));
+
+                        WriteArray<Vector3>(mesh.Vertices);
+                        WriteArray<int>(mesh.Indices);
+                        if (mesh.HasShadingNormals) WriteArray<Vector3>(mesh.ShadingNormals);
+                        if (mesh.TextureCoordinates != null) WriteArray<Vector2>(mesh.TextureCoordinates);
+                        WriteArray(mesh.TriangleDistribution.Cdf);
+                    }
+                }
+            }
+            File.Move(tempPath, cachePath, true);
+        } catch (Exception e) when (e is IOException or UnauthorizedAccessException) {
+            Logger.Log($"Could not write scene cache '{cachePath}': {e.Message}", Verbosity.Warning);
+            try { File.Delete(tempPath); } catch (IOException) { }
+        }
+    }
+
+    /// <summary>
+    /// An object can be restored from the cache if all its materials are declared in the .json and each
+    /// emissive mesh has a single kind of emitter with the same radiance (and exponent) on all its triangles.
+    /// Only the first emitter of each mesh is stored, so anything else would be restored incorrectly.
+    /// </summary>
+    static bool IsCacheable(List<Mesh> meshes, List<Emitter> emitters, Dictionary<Material, string> materialNames) {
+        foreach (var mesh in meshes)
+            if (mesh.Material == null || !materialNames.ContainsKey(mesh.Material)) return false;
+
+        Dictionary<Mesh, Emitter> first = [];
+        foreach (var emitter in emitters) {
+            if (emitter is not DiffuseEmitter and not GlossyEmitter || !meshes.Contains(emitter.Mesh))
+                return false;
+            if (!first.TryAdd(emitter.Mesh, emitter) && !HaveSameEmission(first[emitter.Mesh], emitter))
+                return false;
+        }
+        return true;
+    }
+
+    static bool HaveSameEmission(Emitter a, Emitter b) => (a, b) switch {
+        (DiffuseEmitter da, DiffuseEmitter db) => da.Radiance == db.Radiance,
+        (GlossyEmitter ga, GlossyEmitter gb) => ga.Radiance == gb.Radiance && ga.Exponent == gb.Exponent,
+        _ => false
+    };
+}
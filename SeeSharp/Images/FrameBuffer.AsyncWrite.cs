@@ -0,0 +1,289 @@
+using System.Linq;
+using System.Reflection;
+using System.Threading.Channels;
+
+namespace SeeSharp.Images;
+
+public partial class FrameBuffer {
+    /// <summary>
+    /// What to do if more writes are pending than <see cref="MaxPendingWrites"/>
+    /// </summary>
+    public enum WriteBackPressure {
+        /// <summary> Rendering waits until the oldest pending write is done </summary>
+        Wait,
+
+        /// <summary>
+        /// The oldest pending write is discarded, so rendering never waits. Some intermediate images or
+        /// checkpoints are missing if the disk cannot keep up.
+        /// </summary>
+        DropOldest,
+    }
+
+    /// <summary>
+    /// Maximum number of snapshots that wait to be written in the background, see
+    /// <see cref="Flags.WriteAsynchronously"/>. Each holds a copy of the image and all layers.
+    /// </summary>
+    public int MaxPendingWrites = 2;
+
+    /// <summary>
+    /// What happens if the background writer falls behind by more than <see cref="MaxPendingWrites"/>
+    /// </summary>
+    public WriteBackPressure BackPressure = WriteBackPressure.Wait;
+
+    /// <summary>
+    /// Timings of the writes that were done in the background
+    /// </summary>
+    public class AsyncWriteStats {
+        /// <summary> Number of completed writes </summary>
+        public int NumWrites { get; set; }
+
+        /// <summary> Number of writes that were discarded due to <see cref="WriteBackPressure.DropOldest"/> </summary>
+        public int NumDropped { get; set; }
+
+        /// <summary>
+        /// Time that rendering was paused to take snapshots. Includes the outlier layers, the meta data,
+        /// and the checkpoint data, which a synchronous write computes as well.
+        /// </summary>
+        public double SnapshotMs { get; set; }
+
+        /// <summary>
+        /// Part of <see cref="SnapshotMs"/> spent copying the image and layers. This is the only work a
+        /// synchronous write does not do.
+        /// </summary>
+        public double CopyMs { get; set; }
+
+        /// <summary> Time that rendering waited for the background writer </summary>
+        public double StallMs { get; set; }
+
+        /// <summary> Time spent encoding and writing files in the background </summary>
+        public double BackgroundMs { get; set; }
+
+        /// <summary>
+        /// Estimated frame buffer time saved compared to writing synchronously. A synchronous write would
+        /// have spent the <see cref="BackgroundMs"/> on the render thread, while the asynchronous one
+        /// added the <see cref="CopyMs"/> and <see cref="StallMs"/> instead. The remaining snapshot work is
+        /// the same in both cases and therefore not counted. Dropped writes are not counted either.
+        /// </summary>
+        public double SavedMs => BackgroundMs - CopyMs - StallMs;
+    }
+
+    /// <summary>
+    /// Timings of the background writes of the current rendering, also stored in the
+    /// <see cref="MetaData"/> as "AsyncWrites" if <see cref="Flags.WriteAsynchronously"/> is set
+    /// </summary>
+    public AsyncWriteStats AsyncWrites { get; private set; } = new();
+
+    record PendingWrite(Action Write, Action Release);
+    Channel<PendingWrite> writeQueue;
+    Task writerTask;
+
+    /// <summary>
+    /// Blocks until all pending background writes are done
+    /// </summary>
+    public void FlushWrites() {
+        if (writeQueue == null) return;
+        writeQueue.Writer.Complete();
+        writerTask.Wait();
+        writeQueue = null;
+        writerTask = null;
+    }
+
+    /// <summary>
+    /// Stores the time an integrator spent in the frame buffer as "FrameBufferTime" in the
+    /// <see cref="MetaData"/>. If <see cref="Flags.WriteAsynchronously"/> is set, waits for the pending
+    /// writes and also stores the estimated time saved by them as "FrameBufferTimeSaved", see
+    /// <see cref="AsyncWriteStats.SavedMs"/>.
+    /// </summary>
+    /// <param name="frameBufferTimeMs">Time spent on the render thread, in milliseconds</param>
+    public void SetFrameBufferTime(long frameBufferTimeMs) {
+        MetaData["FrameBufferTime"] = frameBufferTimeMs;
+        if (flags.HasFlag(Flags.WriteAsynchronously)) {
+            FlushWrites();
+            MetaData["FrameBufferTimeSaved"] = (long)AsyncWrites.SavedMs;
+        }
+    }
+
+    /// <summary>
+    /// Writes the current image like <see cref="WriteToFile"/>, but only takes a snapshot now and writes
+    /// it to disk in the background. Falls back to a synchronous write if a layer cannot be copied.
+    /// </summary>
+    void WriteToFileAsync(string fname) {
+        if (!layers.Values.All(l => l.Image is RgbImage or MonochromeImage)) {
+            WriteToFile(fname);
+            return;
+        }
+
+        var timer = Stopwatch.StartNew();
+        var snapshot = TakeSnapshot(fname, true);
+        lock (AsyncWrites) {
+            AsyncWrites.SnapshotMs += timer.Elapsed.TotalMilliseconds;
+            AsyncWrites.CopyMs += snapshot.CopyMs;
+        }
+
+        Enqueue(new(snapshot.Write, snapshot.Release));
+    }
+
+    /// <summary>
+    /// Serializes a checkpoint to memory now, and writes it to disk in the background
+    /// </summary>
+    void WriteCheckpointAsync() {
+        var timer = Stopwatch.StartNew();
+        MemoryStream buffer = new();
+        WriteCheckpointData(buffer);
+        lock (AsyncWrites) AsyncWrites.SnapshotMs += timer.Elapsed.TotalMilliseconds;
+
+        string fname = CheckpointFilename;
+        int numIterations = CurIteration;
+        Enqueue(new(() => {
+            WriteFileAtomically(fname, file => file.Write(buffer.GetBuffer(), 0, (int)buffer.Length));
+            Logger.Log($"Wrote checkpoint after {numIterations} iterations to {fname}", Verbosity.Debug);
+        }, null));
+    }
+
+    void Enqueue(PendingWrite write) {
+        if (writeQueue == null) {
+            var stats = AsyncWrites;
+            writeQueue = Channel.CreateBounded<PendingWrite>(new BoundedChannelOptions(Math.Max(MaxPendingWrites, 1)) {
+                FullMode = BackPressure == WriteBackPressure.DropOldest
+                    ? BoundedChannelFullMode.DropOldest
+                    : BoundedChannelFullMode.Wait,
+                SingleReader = true,
+                SingleWriter = true,
+            }, dropped => {
+                dropped.Release?.Invoke();
+                lock (stats) stats.NumDropped++;
+            });
+            writerTask = RunWriter(writeQueue.Reader, stats);
+        }
+
+        if (writeQueue.Writer.TryWrite(write))
+            return;
+
+        var timer = Stopwatch.StartNew();
+        writeQueue.Writer.WriteAsync(write).AsTask().Wait();
+        lock (AsyncWrites) AsyncWrites.StallMs += timer.Elapsed.TotalMilliseconds;
+    }
+
+    static Task RunWriter(ChannelReader<PendingWrite> reader, AsyncWriteStats stats) => Task.Run(async () => {
+        await foreach (var write in reader.ReadAllAsync()) {
+            var timer = Stopwatch.StartNew();
+            try {
+                write.Write();
+            } catch (Exception exc) {
+                Logger.Warning($"Background write failed: {exc.Message}");
+            } finally {
+                write.Release?.Invoke();
+            }
+            lock (stats) {
+                stats.BackgroundMs += timer.Elapsed.TotalMilliseconds;
+                stats.NumWrites++;
+            }
+
+        }
+    });
+
+    /// <summary>
+    /// Everything that <see cref="WriteToFile"/> writes, captured at one point in time
+    /// </summary>
+    sealed class OutputSnapshot {
+        public string Filename;
+        public Image MainImage;
+        public List<(string Name, Image Image)> LayerImages;
+        public List<(string Name, Image Image)> OutlierImages = [];
+        public string Json;
+
+        /// <summary> Images that were rented from the <see cref="FramePool"/> </summary>
+        public readonly List<Image> Pooled = [];
+
+        /// <summary> Time spent in <see cref="Capture"/> copying images </summary>
+        public double CopyMs;
+
+        /// <returns>A pooled copy of the image, if requested, or the image itself</returns>
+        public Image Capture(Image image, bool copy) {
+            if (!copy) return image;
+            var timer = Stopwatch.StartNew();
+            Image dst = image is RgbImage
+                ? FramePool.RentRgb(image.Width, image.Height, false)
+                : FramePool.RentMonochrome(image.Width, image.Height, false);
+            Parallel.For(0, image.Height, row => {
+                for (int col = 0; col < image.Width; ++col)
+                    for (int chan = 0; chan < image.NumChannels; ++chan)
+                        dst[col, row, chan] = image[col, row, chan];
+            });
+            Pooled.Add(dst);
+            CopyMs += timer.Elapsed.TotalMilliseconds;
+            return dst;
+        }
+
+        public void Write() {
+            string dir = Path.GetDirectoryName(Filename);
+            string basename = Path.Combine(dir, Path.GetFileNameWithoutExtension(Filename));
+
+            if (Path.GetExtension(Filename).ToLower() == ".exr") {
+                Layers.WriteToExr(Filename, [.. LayerImages, (null, MainImage), .. OutlierImages]);
+            } else {
+                // write all layers into individual files
+                MainImage.WriteToFile(Filename);
+
+                string ext = Path.GetExtension(Filename);
+                foreach (var (name, image) in LayerImages) {
+                    image.WriteToFile(basename + "-" + name + ext);
+                }
+            }
+
+            File.WriteAllText(basename + ".json", Json);
+        }
+
+        public void Release() {
+            foreach (var image in Pooled)
+                FramePool.Return(image);
+            Pooled.Clear();
+        }
+    }
+
+    /// <summary>
+    /// Captures the image, the layers, the outliers and the meta data for <see cref="WriteToFile"/>
+    /// </summary>
+    /// <param name="fname">The desired file name. If not given, uses the final image name.</param>
+    /// <param name="copy">If true, images are copied, so rendering can continue while they are written</param>
+    OutputSnapshot TakeSnapshot(string fname, bool copy) {
+        WriteTime = DateTime.Now;
+
+        OutputSnapshot snapshot = new() { Filename = fname ?? filename };
+        snapshot.MainImage = snapshot.Capture(Image, copy);
+        snapshot.LayerImages = [.. layers.Select(kv => (kv.Key, snapshot.Capture(kv.Value.Image, copy)))];
+
+        // If we are caching outlier info, create extra layers for that
+        if (OutlierCache != null) {
+            List<MonochromeImage> iterationImages = [];
+            for (int i = 0; i < NumOutliersToTrack; ++i) {
+                iterationImages.Add(FramePool.RentMonochrome(Width, Height));
+                snapshot.OutlierImages.Add(($"outlier-{i}", iterationImages[^1]));
+                snapshot.Pooled.Add(iterationImages[^1]);
+            }
+            OutlierCache.WriteIterationImages(iterationImages);
+        }
+
+        // Add error metric data if available
+        if (Errors.Count > 0)
+            MetaData["ErrorMetrics"] = Errors;
+
+        if (NaNWarnings != null)
+            MetaData["NaNWarnings"] = NaNWarnings;
+
+        MetaData["RenderStartTime"] = StartTime.ToString("dd/M/yyyy HH:mm:ss");
+        MetaData["RenderWriteTime"] = WriteTime.ToString("dd/M/yyyy HH:mm:ss");
+        MetaData["SeeSharpVersion"] =
+            typeof(FrameBuffer).Assembly
+            .GetCustomAttribute<AssemblyInformationalVersionAttribute>()
+            .InformationalVersion;
+
+        // The meta data is serialized right away, as it keeps changing during rendering
+        lock (AsyncWrites) {
+            snapshot.Json = JsonSerializer.Serialize(MetaData, options: new() {
+                WriteIndented = true,
+            });
+        }
+        return snapshot;
+    }
+}
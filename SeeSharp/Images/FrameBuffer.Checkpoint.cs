@@ -0,0 +1,300 @@
+using System.Linq;
+using System.Text;
+using System.Text.Json.Nodes;
+
+namespace SeeSharp.Images;
+
+public partial class FrameBuffer {
+    const int CheckpointVersion = 1;
+    static ReadOnlySpan<byte> CheckpointMagic => "SSCP"u8;
+
+    /// <summary>
+    /// If greater than zero, a checkpoint is written to <see cref="CheckpointFilename"/> at the end of the
+    /// first iteration after this much wall clock time has passed since the last one. Defaults to zero.
+    /// </summary>
+    public TimeSpan CheckpointInterval = TimeSpan.Zero;
+
+    /// <summary>
+    /// File that checkpoints are written to by default: the final image name with a ".checkpoint" extension
+    /// </summary>
+    public string CheckpointFilename => Basename + ".checkpoint";
+
+    /// <summary>
+    /// 0-based index of the next iteration to render: <see cref="FirstIteration"/> plus the number of
+    /// iterations restored from a checkpoint loaded by <see cref="LoadCheckpoint"/>, if it was not yet
+    /// continued. Integrators start their iteration loop at this index, so the random number sequences
+    /// continue where the checkpointed rendering stopped.
+    /// </summary>
+    public int ResumeIteration => FirstIteration + (pendingCheckpoint?.NumIterations ?? 0);
+
+    /// <summary>
+    /// Render time in milliseconds of the checkpoint loaded by <see cref="LoadCheckpoint"/>, if it was not
+    /// yet continued, and zero otherwise. Integrators count it towards their time budget.
+    /// </summary>
+    public long ResumeRenderTimeMs => pendingCheckpoint?.RenderTimeMs ?? 0;
+
+    record PendingCheckpoint(string Filename, int NumIterations, long RenderTimeMs);
+    PendingCheckpoint pendingCheckpoint;
+    long restoredRenderTimeMs;
+    DateTime lastCheckpointTime;
+
+    /// <summary>
+    /// Writes everything that is needed to continue rendering later on: the accumulated image, the state
+    /// of all layers (e.g., the moments of the <see cref="PixelVariance"/>), the number of iterations,
+    /// the outlier cache, and the timing information. The file is first written under a temporary name
+    /// and then renamed, so a crash never leaves a corrupted checkpoint behind.
+    /// </summary>
+    /// <param name="fname">Name of the checkpoint file, defaults to <see cref="CheckpointFilename"/></param>
+    public void WriteCheckpoint(string fname = null) {
+        fname ??= CheckpointFilename;
+        var timer = Stopwatch.StartNew();
+        WriteFileAtomically(fname, WriteCheckpointData);
+        Logger.Log($"Wrote checkpoint after {CurIteration} iterations to {fname} in {timer.ElapsedMilliseconds}ms",
+            Verbosity.Debug);
+    }
+
+    /// <summary>
+    /// Writes a file under a temporary name and renames it once the data is on disk, so a crash never
+    /// leaves a partially written file behind
+    /// </summary>
+    static void WriteFileAtomically(string fname, Action<Stream> write) {
+        string tempName = $"{fname}.{Environment.ProcessId}.tmp";
+        using (var file = new FileStream(tempName, FileMode.Create, FileAccess.Write, FileShare.None, 1 << 20)) {
+            write(file);
+            file.Flush(true);
+        }
+        File.Move(tempName, fname, true);
+    }
+
+    void WriteCheckpointData(Stream stream) {
+        using BinaryWriter writer = new(stream, Encoding.UTF8, true);
+        writer.Write(CheckpointMagic);
+        writer.Write(CheckpointVersion);
+        writer.Write(Width);
+        writer.Write(Height);
+        writer.Write(FirstIteration);
+        writer.Write(CurIteration);
+        writer.Write(RenderTimeMs);
+        writer.Write(StartTime.ToBinary());
+        WriteImage(writer, Image);
+
+        // Each layer is prefixed by its size, so layers that do not exist when resuming can be skipped
+        writer.Write(layers.Count);
+        foreach (var (name, layer) in layers) {
+            using MemoryStream buffer = new();
+            using (BinaryWriter layerWriter = new(buffer, Encoding.UTF8, true))
+                layer.WriteCheckpoint(layerWriter);
+            writer.Write(name);
+            writer.Write(buffer.Length);
+            writer.Write(buffer.GetBuffer(), 0, (int)buffer.Length);
+        }
+
+        OutlierCache.WriteCheckpoint(writer);
+
+        writer.Write(Errors.Count);
+        foreach (var e in Errors) {
+            writer.Write(e.TimeMS);
+            writer.Write(e.MSE);
+            writer.Write(e.RelMSE);
+            writer.Write(e.RelMSE_Outlier);
+        }
+
+        lock (AsyncWrites)
+            writer.Write(JsonSerializer.Serialize(MetaData));
+        writer.Flush();
+    }
+
+    /// <summary>
+    /// Loads a checkpoint written by <see cref="WriteCheckpoint"/>. Only the header is read immediately,
+    /// the state is restored in the next <see cref="StartIteration"/>, after the integrator had the chance
+    /// to add its layers, or by <see cref="RestorePendingCheckpoint"/>. Continuing with
+    /// <see cref="ResumeIteration"/> yields the same image as a rendering that was never interrupted.
+    /// </summary>
+    /// <param name="fname">Name of the checkpoint file, defaults to <see cref="CheckpointFilename"/></param>
+    public void LoadCheckpoint(string fname = null) {
+        fname ??= CheckpointFilename;
+        using BinaryReader reader = new(File.OpenRead(fname));
+        (FirstIteration, int numIterations) = ReadCheckpointHeader(reader, fname);
+        pendingCheckpoint = new(fname, numIterations, reader.ReadInt64());
+        CurIteration = 0;
+        Logger.Log($"Resuming from {fname} after {numIterations} iterations");
+    }
+
+    /// <returns>The index of the first iteration and the number of iterations in the checkpoint</returns>
+    (int First, int Count) ReadCheckpointHeader(BinaryReader reader, string fname) {
+        if (!reader.ReadBytes(4).AsSpan().SequenceEqual(CheckpointMagic) || reader.ReadInt32() != CheckpointVersion)
+            throw new InvalidDataException($"{fname} is not a valid checkpoint");
+        int width = reader.ReadInt32();
+        int height = reader.ReadInt32();
+        if (width != Width || height != Height)
+            throw new InvalidDataException($"{fname} has resolution {width}x{height}, expected {Width}x{Height}");
+        return (reader.ReadInt32(), reader.ReadInt32());
+    }
+
+    /// <summary>
+    /// Restores a checkpoint loaded by <see cref="LoadCheckpoint"/> right away, instead of in the next
+    /// <see cref="StartIteration"/>. Needed if the checkpoint already contains all iterations that are to be
+    /// rendered, e.g., if the process crashed after the last iteration, so that no iteration is started.
+    /// Does nothing if no checkpoint is pending.
+    /// </summary>
+    public void RestorePendingCheckpoint() {
+        if (pendingCheckpoint == null) return;
+        Debug.Assert(CurIteration == 0);
+        BeginRendering();
+    }
+
+    /// <summary>
+    /// Restores the pending checkpoint, must be called after <see cref="Initialize"/>
+    /// </summary>
+    void RestoreCheckpoint() {
+        string fname = pendingCheckpoint.Filename;
+        pendingCheckpoint = null;
+
+        using var file = new FileStream(fname, FileMode.Open, FileAccess.Read, FileShare.Read, 1 << 20);
+        using BinaryReader reader = new(file);
+        (FirstIteration, CurIteration) = ReadCheckpointHeader(reader, fname);
+        restoredRenderTimeMs = reader.ReadInt64() - stopwatch.ElapsedMilliseconds;
+        StartTime = DateTime.FromBinary(reader.ReadInt64());
+        ReadImage(reader, Image);
+        ReadCheckpointLayers(reader, file, fname, null);
+        OutlierCache.ReadCheckpoint(reader);
+
+        int numErrors = reader.ReadInt32();
+        for (int i = 0; i < numErrors; ++i)
+            Errors.Add(new(reader.ReadInt64(), reader.ReadSingle(), reader.ReadSingle(), reader.ReadSingle()));
+
+        // Keep the meta data (e.g., timings) of the interrupted rendering for reference
+        MetaData["Checkpoint"] = JsonNode.Parse(reader.ReadString());
+        MetaData["NumIterations"] = CurIteration;
+        MetaData["RenderTime"] = RenderTimeMs;
+    }
+
+    /// <summary>
+    /// Reads the layers of a checkpoint that also exist in this frame buffer, and skips all others
+    /// </summary>
+    /// <param name="weight">If set, the layers are merged with this weight instead of replaced</param>
+    void ReadCheckpointLayers(BinaryReader reader, FileStream file, string fname, float? weight) {
+        int numLayers = reader.ReadInt32();
+        for (int i = 0; i < numLayers; ++i) {
+            string name = reader.ReadString();
+            long size = reader.ReadInt64();
+            if (!layers.TryGetValue(name, out var layer)) {
+                Logger.Log($"Layer '{name}' from checkpoint {fname} does not exist, ignoring it.",
+                    weight.HasValue ? Verbosity.Debug : Verbosity.Warning);
+                file.Seek(size, SeekOrigin.Current);
+            } else if (weight.HasValue) {
+                layer.MergeCheckpoint(reader, weight.Value);
+            } else {
+                layer.ReadCheckpoint(reader);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Combines the checkpoints of renderings that each covered a different range of iterations, e.g.,
+    /// the workers of a <see cref="Experiments.DistributedRender"/>. The image and layers are averaged,
+    /// weighted by the number of iterations in each checkpoint, and the outliers of all of them are
+    /// tracked. The result is as if all iterations were rendered into this frame buffer, which must not
+    /// have been used for rendering yet. Layers that should be merged need to be added beforehand.
+    /// </summary>
+    /// <param name="fnames">The checkpoint files</param>
+    public void MergeCheckpoints(IEnumerable<string> fnames) {
+        Debug.Assert(CurIteration == 0);
+
+        // The header of each file is read first to compute the weights
+        List<(string Filename, int First, int Count)> parts = [];
+        foreach (string fname in fnames) {
+            using BinaryReader reader = new(File.OpenRead(fname));
+            var (first, count) = ReadCheckpointHeader(reader, fname);
+            parts.Add((fname, first, count));
+        }
+        int total = parts.Sum(p => p.Count);
+
+        Initialize();
+        NaNWarnings = new();
+        StartTime = DateTime.MaxValue;
+        long renderTimeMs = 0;
+        List<JsonNode> partMetaData = [];
+        foreach (var (fname, _, count) in parts) {
+            using var file = new FileStream(fname, FileMode.Open, FileAccess.Read, FileShare.Read, 1 << 20);
+            using BinaryReader reader = new(file);
+            ReadCheckpointHeader(reader, fname);
+            renderTimeMs += reader.ReadInt64();
+            var startTime = DateTime.FromBinary(reader.ReadInt64());
+            if (startTime < StartTime) StartTime = startTime;
+
+            float weight = count / (float)total;
+            AddImage(reader, Image, weight);
+            ReadCheckpointLayers(reader, file, fname, weight);
+            OutlierCache.ReadCheckpoint(reader);
+
+            // Error metrics refer to the partial image only, so they are dropped
+            int numErrors = reader.ReadInt32();
+            file.Seek(numErrors * (sizeof(long) + 3 * sizeof(float)), SeekOrigin.Current);
+
+            partMetaData.Add(JsonNode.Parse(reader.ReadString()));
+        }
+
+        FirstIteration = parts.Count > 0 ? parts.Min(p => p.First) : 0;
+        CurIteration = total;
+        restoredRenderTimeMs = renderTimeMs;
+        lastCheckpointTime = DateTime.Now;
+        MetaData["NumIterations"] = total;
+        MetaData["RenderTime"] = RenderTimeMs;
+        MetaData["MergedCheckpoints"] = partMetaData;
+    }
+
+    /// <summary>
+    /// Writes all channels of all pixels, row by row
+    /// </summary>
+    internal static void WriteImage(BinaryWriter writer, Image image) {
+        for (int row = 0; row < image.Height; ++row)
+            for (int col = 0; col < image.Width; ++col)
+                for (int chan = 0; chan < image.NumChannels; ++chan)
+                    writer.Write(image[col, row, chan]);
+    }
+
+    /// <summary>
+    /// Reads the data written by <see cref="WriteImage"/> into an image of the same size
+    /// </summary>
+    internal static void ReadImage(BinaryReader reader, Image image) {
+        for (int row = 0; row < image.Height; ++row)
+            for (int col = 0; col < image.Width; ++col)
+                for (int chan = 0; chan < image.NumChannels; ++chan)
+                    image[col, row, chan] = reader.ReadSingle();
+    }
+
+    /// <summary>
+    /// Adds the weighted data written by <see cref="WriteImage"/> to an image of the same size
+    /// </summary>
+    internal static void AddImage(BinaryReader reader, Image image, float weight) {
+        for (int row = 0; row < image.Height; ++row)
+            for (int col = 0; col < image.Width; ++col)
+                for (int chan = 0; chan < image.NumChannels; ++chan)
+                    image[col, row, chan] += weight * reader.ReadSingle();
+    }
+
+    /// <summary>
+    /// Writes a buffer of pixel values in the same format as a monochrome image in <see cref="WriteImage"/>
+    /// </summary>
+    internal static void WriteBuffer(BinaryWriter writer, NativeBuffer<float> buffer) {
+        for (long i = 0; i < buffer.Length; ++i)
+            writer.Write(buffer[i]);
+    }
+
+    /// <summary>
+    /// Reads the data written by <see cref="WriteBuffer"/> into a buffer of the same size
+    /// </summary>
+    internal static void ReadBuffer(BinaryReader reader, NativeBuffer<float> buffer) {
+        for (long i = 0; i < buffer.Length; ++i)
+            buffer[i] = reader.ReadSingle();
+    }
+
+    /// <summary>
+    /// Adds the weighted data written by <see cref="WriteBuffer"/> to a buffer of the same size
+    /// </summary>
+    internal static void AddBuffer(BinaryReader reader, NativeBuffer<float> buffer, float weight) {
+        for (long i = 0; i < buffer.Length; ++i)
+            buffer[i] += weight * reader.ReadSingle();
+    }
+}
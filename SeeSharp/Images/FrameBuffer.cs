@@ -1,5 +1,4 @@
 using System.Linq;
-using System.Reflection;
 
 namespace SeeSharp.Images;
 
@@ -8,7 +7,7 @@ namespace SeeSharp.Images;
 /// be attached to store AOVs. If tev sync is used, this needs to be disposed of correctly, e.g., via
 /// a "using" block.
 /// </summary>
-public class FrameBuffer : IDisposable {
+public partial class FrameBuffer : IDisposable {
     /// <summary>
     /// Width of the frame buffer in pixels
     /// </summary>
@@ -69,6 +68,19 @@ public class FrameBuffer : IDisposable {
     public int CurIteration { get => curIter; protected set => curIter = value; }
     int curIter = 0;
 
+    /// <summary>
+    /// 0-based index of the first iteration that is accumulated in this frame buffer. Non-zero if the frame
+    /// buffer only receives a range of iterations, e.g., in a <see cref="Experiments.DistributedRender"/>.
+    /// Integrators use this as the iteration index when seeding their random number generators.
+    /// </summary>
+    public int FirstIteration = 0;
+
+    /// <summary>
+    /// If set, integrators stop before the iteration with this 0-based index, even if they are configured
+    /// to render more iterations
+    /// </summary>
+    public int? IterationLimit = null;
+
     public DateTime StartTime;
     public DateTime WriteTime;
 
@@ -128,6 +140,20 @@ public class FrameBuffer : IDisposable {
         /// </summary>
         WriteExponentially = 32,
 
+        /// <summary>
+        /// If set, contributions splatted from within a <see cref="BeginLocalBlock" /> scope are buffered
+        /// per block and only added to the image at the end of the iteration, in a fixed order. Avoids atomics
+        /// and locks during rendering and makes the result independent of thread scheduling.
+        /// </summary>
+        LocalAccumulation = 64,
+
+        /// <summary>
+        /// If set, <see cref="WriteIntermediate" />, <see cref="WriteContinously" />, and periodic
+        /// checkpoints only take a snapshot at the end of the iteration and write it on a background thread,
+        /// while rendering continues. See <see cref="MaxPendingWrites" /> and <see cref="BackPressure" />.
+        /// </summary>
+        WriteAsynchronously = 128,
+
         /// <summary> Recommended set of flags appropriate for most use cases </summary>
         Recommended = IgnoreNanAndInf,
     }
@@ -139,6 +165,31 @@ public class FrameBuffer : IDisposable {
 
     public List<NaNWarning> NaNWarnings;
 
+    /// <summary>
+    /// Time that the garbage collector paused all threads during the rendering. Measured from the start
+    /// to the end of each iteration, including the frame buffer overhead, e.g., writing images.
+    /// </summary>
+    public class GCPauseStats {
+        /// <summary> Total pause time over all iterations </summary>
+        public double TotalMs { get; set; }
+
+        /// <summary> Longest pause time of any single iteration </summary>
+        public double MaxIterationMs { get; set; }
+
+        /// <summary> Number of full (gen2) collections since the first iteration </summary>
+        public int NumGen2Collections { get; set; }
+
+        /// <summary> Pause time of each iteration </summary>
+        public List<double> PerIterationMs { get; set; } = [];
+    }
+
+    /// <summary>
+    /// GC pause times of the current rendering, also stored in the <see cref="MetaData"/> as "GCPauses"
+    /// </summary>
+    public GCPauseStats GCPauses { get; private set; } = new();
+    TimeSpan gcPauseAtStart;
+    int gen2CountAtStart;
+
     /// <param name="width">Width in pixels</param>
     /// <param name="height">Height in pixels</param>
     /// <param name="filename">
@@ -181,15 +232,65 @@ public class FrameBuffer : IDisposable {
                 return;
         }
 
+        if (localSplats != null && localSplats.TryAdd(col, row, value))
+            return;
+
         Image.AtomicAdd(col, row, value / CurIteration);
         PixelVariance?.Splat(col, row, value);
 
         OutlierCache?.Notify(new(col, row), new() {
-            Iteration = CurIteration - 1,
+            Iteration = FirstIteration + CurIteration - 1,
+            Weight = value
+        });
+    }
+
+    /// <summary>
+    /// Adds a buffered contribution, the merge guarantees that no other thread writes to the same row
+    /// </summary>
+    void MergeLocalSplat(int col, int row, RgbColor value) {
+        Image.SetPixel(col, row, Image.GetPixel(col, row) + value / CurIteration);
+        PixelVariance?.Splat(col, row, value);
+
+        OutlierCache?.NotifyExclusive(new(col, row), new() {
+            Iteration = FirstIteration + CurIteration - 1,
             Weight = value
         });
     }
 
+    /// <summary>
+    /// Marks the calling thread as working on the given block of work until the returned scope is disposed.
+    /// If <see cref="Flags.LocalAccumulation" /> is set, all splats of the thread are buffered in that block
+    /// until the end of the iteration. Otherwise, this does nothing. The same block must not be used by
+    /// two threads at the same time, and the same block index should always correspond to the same work
+    /// for the result to be reproducible.
+    /// </summary>
+    /// <param name="blockIdx">0-based index of the block, determines the merge order</param>
+    public LocalSplatBuffer.Scope BeginLocalBlock(int blockIdx)
+    => localSplats?.Begin(blockIdx) ?? default;
+
+    /// <summary>
+    /// Runs the given function for all indices in [0, count) in parallel. Indices are grouped in blocks of
+    /// fixed size that each correspond to one <see cref="BeginLocalBlock" /> scope. Use this for loops
+    /// that splat to arbitrary pixels, e.g., light tracing.
+    /// </summary>
+    /// <param name="count">Number of indices</param>
+    /// <param name="body">Invoked once for each index</param>
+    /// <param name="blockSize">Number of consecutive indices that share a local block</param>
+    public void ParallelFor(int count, Action<int> body, int blockSize = 1024) {
+        if (localSplats == null) {
+            Parallel.For(0, count, body);
+            return;
+        }
+
+        int numBlocks = (count + blockSize - 1) / blockSize;
+        Parallel.For(0, numBlocks, blockIdx => {
+            using var _ = localSplats.Begin(blockIdx);
+            int end = Math.Min(count, (blockIdx + 1) * blockSize);
+            for (int i = blockIdx * blockSize; i < end; ++i)
+                body(i);
+        });
+    }
+
     /// <summary>
     /// Adds a contribution to the frame buffer
     /// </summary>
@@ -200,6 +301,8 @@ public class FrameBuffer : IDisposable {
 
     public OutlierReplayCache OutlierCache { get; protected set; }
 
+    LocalSplatBuffer localSplats;
+
     /// <summary>
     /// Initializes the memory for the image data and aux layers. Should be called exactly once before / at
     /// the start of the first rendering iteration.
@@ -226,7 +329,33 @@ public class FrameBuffer : IDisposable {
             }
         }
 
+        OutlierCache?.Dispose();
         OutlierCache = new(Width, Height, NumOutliersToTrack);
+
+        GCPauses = new();
+        MetaData["GCPauses"] = GCPauses;
+
+        FlushWrites();
+        AsyncWrites = new();
+        if (flags.HasFlag(Flags.WriteAsynchronously))
+            MetaData["AsyncWrites"] = AsyncWrites;
+        gen2CountAtStart = GC.CollectionCount(2);
+
+        if (flags.HasFlag(Flags.LocalAccumulation))
+            localSplats = new(Width, Height);
+    }
+
+    /// <summary>
+    /// Prepares the first iteration, and restores the pending checkpoint, if any
+    /// </summary>
+    void BeginRendering() {
+        Initialize();
+        MetaData["NumIterations"] = 0;
+        StartTime = DateTime.Now;
+        NaNWarnings = new();
+        lastCheckpointTime = StartTime;
+        if (pendingCheckpoint != null)
+            RestoreCheckpoint();
     }
 
     public virtual void Normalize() => Image.Scale((CurIteration - 1.0f) / CurIteration);
@@ -236,12 +365,8 @@ public class FrameBuffer : IDisposable {
     /// multiple equal-sized batches of samples per pixel.
     /// </summary>
     public virtual void StartIteration() {
-        if (CurIteration == 0) {
-            Initialize();
-            MetaData["NumIterations"] = 0;
-            StartTime = DateTime.Now;
-            NaNWarnings = new();
-        }
+        if (CurIteration == 0)
+            BeginRendering();
 
         CurIteration++;
 
@@ -251,6 +376,7 @@ public class FrameBuffer : IDisposable {
         foreach (var (_, layer) in layers)
             layer.OnStartIteration(CurIteration);
 
+        gcPauseAtStart = GC.GetTotalPauseDuration();
         stopwatch.Start();
     }
 
@@ -258,7 +384,7 @@ public class FrameBuffer : IDisposable {
     /// Current total time spent between <see cref="StartIteration"/> and <see cref="EndIteration"/>,
     /// i.e, the render time without frame buffer overhead.
     /// </summary>
-    public long RenderTimeMs => stopwatch.ElapsedMilliseconds;
+    public long RenderTimeMs => stopwatch.ElapsedMilliseconds + restoredRenderTimeMs;
 
     /// <summary>
     /// Notifies that the rendering iteration is finished, intermediate results can be written, and time
@@ -267,9 +393,11 @@ public class FrameBuffer : IDisposable {
     public virtual void EndIteration() {
         stopwatch.Stop();
 
-        MetaData["RenderTime"] = stopwatch.ElapsedMilliseconds;
+        MetaData["RenderTime"] = RenderTimeMs;
         MetaData["NumIterations"] += 1;
 
+        localSplats?.Merge(MergeLocalSplat);
+
         foreach (var (_, layer) in layers)
             layer.OnEndIteration(CurIteration);
 
@@ -279,15 +407,31 @@ public class FrameBuffer : IDisposable {
         if (!flags.HasFlag(Flags.WriteExponentially) || int.IsPow2(CurIteration - 1)) {
             if (flags.HasFlag(Flags.WriteIntermediate)) {
                 string name = Basename + "-iter" + CurIteration.ToString("D3")
-                    + $"-{stopwatch.ElapsedMilliseconds}ms" + Extension;
-                WriteToFile(name);
+                    + $"-{RenderTimeMs}ms" + Extension;
+                WriteIntermediateFile(name);
             }
 
             if (flags.HasFlag(Flags.WriteContinously)) // TODO maybe do this in power-of-two steps so it becomes useful for reference rendering
-                WriteToFile();
+                WriteIntermediateFile(null);
 
+            // tev reads the live images, so this has to happen on the render thread between iterations,
+            // also if the files are written in the background
             tevIpc?.UpdateImage(filename);
         }
+
+        if (CheckpointInterval > TimeSpan.Zero && DateTime.Now - lastCheckpointTime >= CheckpointInterval) {
+            if (flags.HasFlag(Flags.WriteAsynchronously))
+                WriteCheckpointAsync();
+            else
+                WriteCheckpoint();
+            lastCheckpointTime = DateTime.Now;
+        }
+
+        double pauseMs = (GC.GetTotalPauseDuration() - gcPauseAtStart).TotalMilliseconds;
+        GCPauses.TotalMs += pauseMs;
+        GCPauses.MaxIterationMs = Math.Max(GCPauses.MaxIterationMs, pauseMs);
+        GCPauses.NumGen2Collections = GC.CollectionCount(2) - gen2CountAtStart;
+        GCPauses.PerIterationMs.Add(pauseMs);
     }
 
     /// <summary>
@@ -296,6 +440,7 @@ public class FrameBuffer : IDisposable {
     public virtual void Reset() {
         CurIteration = 0;
         stopwatch.Reset();
+        restoredRenderTimeMs = 0;
     }
 
     /// <summary>
@@ -306,77 +451,41 @@ public class FrameBuffer : IDisposable {
     }
 
     /// <summary>
-    /// Writes the current rendered image to a file on disk.
+    /// Writes the current rendered image to a file on disk. Waits for pending background writes first.
     /// </summary>
     /// <param name="fname">The desired file name. If not given, uses the final image name.</param>
     public void WriteToFile(string fname = null) {
-        WriteTime = DateTime.Now;
-
-        fname ??= filename;
-
-        string dir = Path.GetDirectoryName(fname);
-        string fileBase = Path.GetFileNameWithoutExtension(fname);
-        string basename = Path.Combine(dir, fileBase);
-
-        // If we are caching outlier info, create extra layers for that
-        List<(string, Image)> outlierImages = [];
-        for (int i = 0; i < NumOutliersToTrack; ++i)
-            outlierImages.Add(($"outlier-{i}", new MonochromeImage(Width, Height)));
-        for (int row = 0; row < Height; ++row) {
-            for (int col = 0; col < Width; ++col) {
-                var outliers = OutlierCache.GetPixelOutlier(new(col, row));
-                var iterations = outliers.UnorderedItems.OrderByDescending(i => i.Priority)
-                    .Select(i => i.Element.Iteration)
-                    .ToList();
-                for (int i = 0; i < iterations.Count; ++i) {
-                    outlierImages[i].Item2[col, row, 0] = iterations[i];
-                }
-            }
-        }
-
-        if (Path.GetExtension(fname).ToLower() == ".exr") {
-            Layers.WriteToExr(fname, [.. layers.Select(kv => (kv.Key, kv.Value.Image)), (null, Image), .. outlierImages]);
-        } else {
-            // write all layers into individual files
-            Image.WriteToFile(fname);
-
-            string ext = Path.GetExtension(fname);
-            foreach (var (name, layer) in layers) {
-                layer.Image.WriteToFile(basename + "-" + name + ext);
-            }
+        FlushWrites();
+        var snapshot = TakeSnapshot(fname, false);
+        try {
+            snapshot.Write();
+        } finally {
+            snapshot.Release();
         }
+    }
 
-        // Add error metric data if available
-        if (Errors.Count > 0)
-            MetaData["ErrorMetrics"] = Errors;
-
-        if (NaNWarnings != null)
-            MetaData["NaNWarnings"] = NaNWarnings;
-
-        MetaData["RenderStartTime"] = StartTime.ToString("dd/M/yyyy HH:mm:ss");
-        MetaData["RenderWriteTime"] = WriteTime.ToString("dd/M/yyyy HH:mm:ss");
-        MetaData["SeeSharpVersion"] =
-            typeof(FrameBuffer).Assembly
-            .GetCustomAttribute<AssemblyInformationalVersionAttribute>()
-            .InformationalVersion;
-
-        // Write the metadata as json
-        string json = JsonSerializer.Serialize(MetaData, options: new() {
-            WriteIndented = true,
-        });
-        File.WriteAllText(basename + ".json", json);
+    /// <summary>
+    /// Writes intermediate results, in the background if <see cref="Flags.WriteAsynchronously"/> is set
+    /// </summary>
+    void WriteIntermediateFile(string fname) {
+        if (flags.HasFlag(Flags.WriteAsynchronously))
+            WriteToFileAsync(fname);
+        else
+            WriteToFile(fname);
     }
 
     /// <summary>
-    /// Closes the tev TCP connection, if it was set up.
+    /// Waits for pending background writes and closes the tev TCP connection, if it was set up.
     /// </summary>
     public void Dispose() {
+        FlushWrites();
         tevIpc?.Dispose();
         tevIpc = null;
+        FramePool.Trim();
     }
 
     private ErrorMetric ComputeErrorMetric() {
-        return new(stopwatch.ElapsedMilliseconds,
+        return new(RenderTimeMs,
             Metrics.MSE(Image, ReferenceImage),
             Metrics.RelMSE(Image, ReferenceImage),
             Metrics.RelMSE_OutlierRejection(Image, ReferenceImage));
@@ -1,7 +1,8 @@
-﻿namespace SeeSharp.Images;
+namespace SeeSharp.Images;
 
 /// <summary>
-/// An image texture
+/// An image texture. Lookups can be filtered over the footprint of a ray via a mip pyramid. The pyramid
+/// is built in parallel, once the filter is changed away from "Nearest" or a level is first requested.
 /// </summary>
 public class ImageTexture {
     /// <summary>
@@ -19,18 +20,52 @@ public class ImageTexture {
         Clamp
     }
 
+    /// <summary>
+    /// How the texels around a lookup position are combined
+    /// </summary>
+    public enum FilterMode {
+        /// <summary>
+        /// The closest texel in the full resolution image, ignores the footprint
+        /// </summary>
+        Nearest,
+
+        /// <summary>
+        /// Bilinear interpolation in the mip level closest to the footprint
+        /// </summary>
+        Bilinear,
+
+        /// <summary>
+        /// Bilinear interpolation in the two mip levels around the footprint, blended linearly
+        /// </summary>
+        Trilinear
+    }
+
     /// <summary>
     /// The border handling mode to be used, defaults to "Repeat"
     /// </summary>
     public BorderHandling Border = BorderHandling.Repeat;
 
-    (int, int) ApplyBorderHandling(int col, int row) {
+    /// <summary>
+    /// The filter used by lookups, defaults to "Nearest" which ignores the footprint. Filtering changes
+    /// the look of existing scenes, so it has to be enabled per texture, e.g., via "filter" in the .json.
+    /// </summary>
+    public FilterMode Filter {
+        get => filter;
+        set {
+            filter = value;
+            if (filter != FilterMode.Nearest && image != null)
+                EnsureMipPyramid();
+        }
+    }
+    FilterMode filter = FilterMode.Nearest;
+
+    (int, int) ApplyBorderHandling(int col, int row, int width, int height) {
         if (Border == BorderHandling.Repeat) {
-            row = (row % Image.Height + Image.Height) % Image.Height;
-            col = (col % Image.Width + Image.Width) % Image.Width;
+            row = (row % height + height) % height;
+            col = (col % width + width) % width;
         } else if (Border == BorderHandling.Clamp) {
-            row = System.Math.Clamp(row, 0, Image.Height - 1);
-            col = System.Math.Clamp(col, 0, Image.Width - 1);
+            row = System.Math.Clamp(row, 0, height - 1);
+            col = System.Math.Clamp(col, 0, width - 1);
         }
 
         return (col, row);
@@ -38,13 +73,125 @@ public class ImageTexture {
 
     /// <returns> The (x,y) / (col,row) coordinate of the texel. </returns>
     public (int, int) ComputeTexel(Vector2 uv) {
-        int col = (int)(uv.X * Image.Width);
-        int row = (int)(uv.Y * Image.Height);
-        return ApplyBorderHandling(col, row);
+        int col = (int)(uv.X * Width);
+        int row = (int)(uv.Y * Height);
+        return ApplyBorderHandling(col, row, Width, Height);
+    }
+
+    /// <summary>
+    /// Computes the four texels and weights for bilinear interpolation in a mip level
+    /// </summary>
+    /// <param name="uv">Texture coordinates</param>
+    /// <param name="level">Index of the mip level</param>
+    /// <returns>The texel columns and rows, and the interpolation weights of the second column / row</returns>
+    protected (int Col0, int Row0, int Col1, int Row1, float FracX, float FracY) ComputeBilinearTexels(Vector2 uv, int level) {
+        var (width, height) = GetMipLevelSize(level);
+        float x = uv.X * width - 0.5f;
+        float y = uv.Y * height - 0.5f;
+        float x0 = MathF.Floor(x), y0 = MathF.Floor(y);
+        var (col0, row0) = ApplyBorderHandling((int)x0, (int)y0, width, height);
+        var (col1, row1) = ApplyBorderHandling((int)x0 + 1, (int)y0 + 1, width, height);
+        return (col0, row0, col1, row1, x - x0, y - y0);
     }
 
     /// <summary>
-    /// The texture image
+    /// Computes the (continuous) mip level that matches a footprint
     /// </summary>
-    public Image Image;
-}
\ No newline at end of file
+    /// <param name="footprint">Width of the footprint in texture coordinates</param>
+    /// <returns>Zero for the full resolution, up to the index of the coarsest level</returns>
+    protected float ComputeMipLevel(float footprint) {
+        if (footprint <= 0) return 0;
+        float level = MathF.Log2(footprint * Math.Max(Width, Height));
+        return Math.Clamp(level, 0, NumMipLevels - 1);
+    }
+
+    /// <summary>
+    /// The texture image, null if the texture is constant or paged through a <see cref="TextureCache"/>
+    /// </summary>
+    public Image Image {
+        get => image;
+        set {
+            lock (mipLock) {
+                image = value;
+                mipLevels = null;
+            }
+            if (filter != FilterMode.Nearest && image != null)
+                EnsureMipPyramid();
+        }
+    }
+    Image image;
+
+    /// <summary>
+    /// The tiles of the texture if it is paged through a <see cref="TextureCache"/>, null otherwise
+    /// </summary>
+    public TiledTexture Tiles { get; protected set; }
+
+    /// <summary>
+    /// Width of the full resolution image
+    /// </summary>
+    public int Width => Tiles?.Width ?? image.Width;
+
+    /// <summary>
+    /// Height of the full resolution image
+    /// </summary>
+    public int Height => Tiles?.Height ?? image.Height;
+
+    /// <summary>
+    /// Number of levels in the mip pyramid, including the full resolution image
+    /// </summary>
+    public int NumMipLevels => Tiles?.NumMipLevels ?? (image == null ? 0 : EnsureMipPyramid().Length);
+
+    /// <returns>The given level of the mip pyramid, 0 is the full resolution image</returns>
+    public Image GetMipLevel(int level) => EnsureMipPyramid()[level];
+
+    /// <returns>Width and height of a level of the mip pyramid</returns>
+    public (int Width, int Height) GetMipLevelSize(int level) {
+        if (Tiles != null) return Tiles.GetLevelSize(level);
+        var mip = EnsureMipPyramid()[level];
+        return (mip.Width, mip.Height);
+    }
+
+    Image[] mipLevels;
+    readonly object mipLock = new();
+
+    /// <summary>
+    /// Builds the mip pyramid of the current image, unless that already happened. Textures that are only
+    /// looked up with "Nearest" never pay for the pyramid.
+    /// </summary>
+    Image[] EnsureMipPyramid() {
+        var levels = Volatile.Read(ref mipLevels);
+        if (levels != null) return levels;
+        lock (mipLock) {
+            mipLevels ??= BuildMipPyramid(image);
+            return mipLevels;
+        }
+    }
+
+    /// <summary>
+    /// Computes each level by averaging 2x2 texels of the previous one, until a single texel is left.
+    /// The rows of a level are computed in parallel.
+    /// </summary>
+    /// <returns>All levels, starting with the given image</returns>
+    internal static Image[] BuildMipPyramid(Image image) {
+        List<Image> levels = [image];
+        while (levels[^1].Width > 1 || levels[^1].Height > 1) {
+            var src = levels[^1];
+            int width = Math.Max(1, src.Width / 2);
+            int height = Math.Max(1, src.Height / 2);
+            Image dst = image is RgbImage ? new RgbImage(width, height) : new MonochromeImage(width, height);
+            int numChannels = Math.Min(src.NumChannels, dst.NumChannels);
+            Parallel.For(0, height, row => {
+                int r0 = Math.Min(2 * row, src.Height - 1), r1 = Math.Min(2 * row + 1, src.Height - 1);
+                for (int col = 0; col < width; ++col) {
+                    int c0 = Math.Min(2 * col, src.Width - 1), c1 = Math.Min(2 * col + 1, src.Width - 1);
+                    for (int chan = 0; chan < numChannels; ++chan) {
+                        dst[col, row, chan] = 0.25f * (src[c0, r0, chan] + src[c1, r0, chan]
+                            + src[c0, r1, chan] + src[c1, r1, chan]);
+                    }
+                }
+            });
+            levels.Add(dst);
+        }
+        return levels.ToArray();
+    }
+}
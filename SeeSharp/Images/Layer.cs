@@ -42,6 +42,32 @@ public abstract class Layer {
     /// <param name="curIteration">The 1-based index of the iteration that just finished</param>
     public virtual void OnEndIteration(int curIteration) { }
 
+    /// <summary>
+    /// Writes the accumulated state of the layer to a frame buffer checkpoint. Derived classes with
+    /// additional buffers need to override this and <see cref="ReadCheckpoint"/>.
+    /// </summary>
+    public virtual void WriteCheckpoint(BinaryWriter writer) {
+        writer.Write(frozen);
+        FrameBuffer.WriteImage(writer, Image);
+    }
+
+    /// <summary>
+    /// Restores the state written by <see cref="WriteCheckpoint"/>. Called after <see cref="Init"/>.
+    /// </summary>
+    public virtual void ReadCheckpoint(BinaryReader reader) {
+        frozen = reader.ReadBoolean();
+        FrameBuffer.ReadImage(reader, Image);
+    }
+
+    /// <summary>
+    /// Adds the weighted state written by <see cref="WriteCheckpoint"/> to this layer. Used to combine
+    /// renderings of different iterations, the weights of all merged checkpoints sum to one.
+    /// </summary>
+    public virtual void MergeCheckpoint(BinaryReader reader, float weight) {
+        frozen |= reader.ReadBoolean();
+        FrameBuffer.AddImage(reader, Image, weight);
+    }
+
     /// <summary>
     /// The 1-based index of the iteration that is currently being rendered
     /// </summary>
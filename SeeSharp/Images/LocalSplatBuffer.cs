@@ -0,0 +1,191 @@
+using System.Runtime.CompilerServices;
+
+namespace SeeSharp.Images;
+
+/// <summary>
+/// Collects frame buffer contributions in independent blocks of work instead of adding them to the image
+/// right away. Each block is only ever written by one thread at a time, so no atomics or locks are
+/// required while rendering. At the end of an iteration, all blocks are merged in order of their index.
+/// Hence, the result is bit-identical across runs, as long as the work assigned to each block is the same.
+/// </summary>
+public class LocalSplatBuffer {
+    /// <summary>
+    /// A single buffered contribution
+    /// </summary>
+    public struct Entry {
+        /// <summary> Index of the pixel, row * width + col </summary>
+        public int PixelIndex;
+
+        /// <summary> The value that was splatted </summary>
+        public RgbColor Value;
+    }
+
+    /// <summary>
+    /// Applies a buffered contribution to the final image. Called from multiple threads, but never
+    /// concurrently for the same row.
+    /// </summary>
+    public delegate void MergeFunc(int col, int row, RgbColor value);
+
+    internal class Block {
+        public readonly LocalSplatBuffer Owner;
+        public Entry[] Entries = new Entry[64];
+        public int Count;
+
+        public Block(LocalSplatBuffer owner) => Owner = owner;
+
+        public void Add(int pixelIndex, RgbColor value) {
+            if (Count == Entries.Length)
+                Array.Resize(ref Entries, Entries.Length * 2);
+            Entries[Count++] = new() { PixelIndex = pixelIndex, Value = value };
+        }
+    }
+
+    [ThreadStatic] static Block current;
+
+    /// <summary>
+    /// Marks the calling thread as working on a block until disposed
+    /// </summary>
+    public readonly struct Scope : IDisposable {
+        readonly Block previous;
+        readonly bool active;
+
+        internal Scope(Block previous) {
+            this.previous = previous;
+            active = true;
+        }
+
+        /// <summary> Restores the block the thread was working on before </summary>
+        public void Dispose() {
+            if (active) current = previous;
+        }
+    }
+
+    /// <param name="width">Width of the image in pixels</param>
+    /// <param name="height">Height of the image in pixels</param>
+    public LocalSplatBuffer(int width, int height) {
+        this.width = width;
+        numBands = Math.Clamp(Environment.ProcessorCount * 4, 1, Math.Max(height, 1));
+        rowsPerBand = (height + numBands - 1) / numBands;
+    }
+
+    /// <summary>
+    /// Routes all contributions of the calling thread to the block with the given index, until the returned
+    /// scope is disposed. Must not be called for the same block by two threads at the same time.
+    /// </summary>
+    public Scope Begin(int blockIdx) {
+        var all = blocks;
+        Block b = blockIdx < all.Length ? all[blockIdx] : null;
+        if (b == null) {
+            // Only the first use of a block index takes the lock
+            lock (this) {
+                if (blockIdx >= blocks.Length) {
+                    var grown = new Block[Math.Max(blockIdx + 1, blocks.Length * 2)];
+                    Array.Copy(blocks, grown, blocks.Length);
+                    blocks = grown;
+                }
+                b = blocks[blockIdx] ??= new Block(this);
+            }
+        }
+
+        Scope scope = new(current);
+        current = b;
+        return scope;
+    }
+
+    /// <summary>
+    /// Buffers a contribution if the calling thread is currently working on one of our blocks.
+    /// </summary>
+    /// <returns>False if the thread is not inside a scope, the caller has to add the value itself</returns>
+    public bool TryAdd(int col, int row, RgbColor value) {
+        var b = current;
+        if (b == null || b.Owner != this)
+            return false;
+        b.Add(row * width + col, value);
+        return true;
+    }
+
+    /// <summary>
+    /// Passes all buffered contributions to the given function and clears the buffers. Contributions to
+    /// the same pixel are always merged in the same order: by block index first, and by the order they
+    /// were added within each block second.
+    /// </summary>
+    public void Merge(MergeFunc func) {
+        var allBlocks = blocks;
+        int numBlocks = allBlocks.Length;
+        if (numBlocks == 0) return;
+
+        // Counting sort of all entries by the band of rows they belong to. The buffers are only ever
+        // grown, so there is no allocation in the common case.
+        if (bandCounts.Length < numBlocks * numBands)
+            bandCounts = new int[numBlocks * numBands];
+        Parallel.For(0, numBlocks, blockIdx => {
+            Span<int> counts = bandCounts.AsSpan(blockIdx * numBands, numBands);
+            counts.Clear();
+            var b = allBlocks[blockIdx];
+            if (b == null) return;
+            for (int i = 0; i < b.Count; ++i)
+                counts[b.Entries[i].PixelIndex / width / rowsPerBand]++;
+        });
+
+        if (bandOffsets.Length < numBands + 1)
+            bandOffsets = new int[numBands + 1];
+        int total = 0;
+        for (int band = 0; band < numBands; ++band) {
+            bandOffsets[band] = total;
+            for (int blockIdx = 0; blockIdx < numBlocks; ++blockIdx) {
+                int c = bandCounts[blockIdx * numBands + band];
+                bandCounts[blockIdx * numBands + band] = total; // turn counts into write offsets
+                total += c;
+            }
+        }
+        bandOffsets[numBands] = total;
+
+        if (sorted.Length < total)
+            sorted = new Entry[Math.Max(total, sorted.Length * 2)];
+        Parallel.For(0, numBlocks, blockIdx => {
+            var b = allBlocks[blockIdx];
+            if (b == null) return;
+            Span<int> offsets = bandCounts.AsSpan(blockIdx * numBands, numBands);
+            for (int i = 0; i < b.Count; ++i) {
+                ref var e = ref b.Entries[i];
+                sorted[offsets[e.PixelIndex / width / rowsPerBand]++] = e;
+            }
+            b.Count = 0;
+        });
+
+        // Each band is merged by exactly one thread, in the sorted (deterministic) order
+        Parallel.For(0, numBands, band => {
+            for (int i = bandOffsets[band]; i < bandOffsets[band + 1]; ++i) {
+                int row = sorted[i].PixelIndex / width;
+                int col = sorted[i].PixelIndex % width;
+                func(col, row, sorted[i].Value);
+            }
+        });
+    }
+
+    /// <summary>
+    /// Discards all buffered contributions, but keeps the memory
+    /// </summary>
+    public void Clear() {
+        foreach (var b in blocks)
+            if (b != null) b.Count = 0;
+    }
+
+    /// <summary>
+    /// Number of bytes currently reserved for buffered contributions
+    /// </summary>
+    public long ReservedBytes {
+        get {
+            long bytes = (long)sorted.Length * Unsafe.SizeOf<Entry>();
+            foreach (var b in blocks)
+                if (b != null) bytes += (long)b.Entries.Length * Unsafe.SizeOf<Entry>();
+            return bytes;
+        }
+    }
+
+    readonly int width, numBands, rowsPerBand;
+    Block[] blocks = [];
+    int[] bandCounts = [];
+    int[] bandOffsets = [];
+    Entry[] sorted = [];
+}
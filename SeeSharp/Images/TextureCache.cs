@@ -0,0 +1,164 @@
+using System.Collections.Concurrent;
+using System.Linq;
+
+namespace SeeSharp.Images;
+
+/// <summary>
+/// How the texels of a <see cref="TiledTexture"/> are stored on disk and in memory
+/// </summary>
+public enum TileFormat {
+    /// <summary>
+    /// 32 bit float per channel, lossless
+    /// </summary>
+    Float,
+
+    /// <summary>
+    /// 16 bit float per channel
+    /// </summary>
+    Half,
+
+    /// <summary>
+    /// 8 bit per channel with the sRGB transfer curve, values are clamped to [0, 1]
+    /// </summary>
+    Srgb8
+}
+
+/// <summary>
+/// Statistics of a <see cref="TextureCache"/>
+/// </summary>
+public struct TextureCacheStats {
+    public ulong NumHits { get; set; }
+    public ulong NumMisses { get; set; }
+    public ulong NumEvictions { get; set; }
+    public ulong ResidentBytes { get; set; }
+    public ulong PeakResidentBytes { get; set; }
+}
+
+/// <summary>
+/// Keeps the tiles of all <see cref="TiledTexture"/>s within a memory budget. Tiles are paged in from a
+/// tiled copy of each image on first touch, and the least recently used ones are evicted (approximated by
+/// the CLOCK algorithm) once the budget is exceeded. Lookups never take a lock.
+/// Disposing the cache closes the tiled files of all its textures, they cannot be used afterwards.
+/// </summary>
+public class TextureCache : IDisposable {
+    /// <summary>
+    /// The cache used by textures that are loaded from a file. Null by default, so textures are loaded
+    /// into memory completely. Setting a cache is opt-in because it writes the tiles of all mip levels to
+    /// <see cref="Directory"/>, which can take a lot of disk space for large scenes.
+    /// </summary>
+    public static TextureCache Shared { get; set; }
+
+    /// <summary>
+    /// Maximum number of bytes occupied by resident tiles
+    /// </summary>
+    public long BudgetBytes { get; set; } = 4L << 30;
+
+    /// <summary>
+    /// Width and height of a tile in texels
+    /// </summary>
+    public int TileSize { get; init; } = 64;
+
+    /// <summary>
+    /// Storage format of the tiles
+    /// </summary>
+    public TileFormat Format { get; init; } = TileFormat.Float;
+
+    /// <summary>
+    /// Directory where the tiled copies of the images are stored. They are named after a hash of the
+    /// source file path, modification time, and tile settings, so they are recreated when any of these
+    /// change.
+    /// </summary>
+    public string Directory { get; init; } = Path.Join(Path.GetTempPath(), "SeeSharpTextureCache");
+
+    /// <summary>
+    /// Creates a texture that is paged through this cache. The file is only read on first access.
+    /// </summary>
+    /// <param name="filename">Path to the image file</param>
+    /// <param name="numChannels">1 for monochrome and 3 for RGB images</param>
+    public TiledTexture Open(string filename, int numChannels) {
+        TiledTexture texture = new(this, filename, numChannels);
+        textures.Add(texture);
+        return texture;
+    }
+
+    /// <summary>
+    /// Closes the tiled files of all textures that were opened by this cache
+    /// </summary>
+    public void Dispose() {
+        while (textures.TryTake(out var texture))
+            texture.Dispose();
+        numHits.Dispose();
+        numMisses.Dispose();
+        GC.SuppressFinalize(this);
+    }
+
+    /// <summary>
+    /// Current statistics, accumulated since the last <see cref="ResetStats"/>
+    /// </summary>
+    public TextureCacheStats Stats => new() {
+        NumHits = (ulong)(numHits.Values.Sum() - hitsAtReset),
+        NumMisses = (ulong)(numMisses.Values.Sum() - missesAtReset),
+        NumEvictions = (ulong)Interlocked.Read(ref numEvictions),
+        ResidentBytes = (ulong)Interlocked.Read(ref residentBytes),
+        PeakResidentBytes = (ulong)Interlocked.Read(ref peakResidentBytes),
+    };
+
+    /// <summary>
+    /// Resets the hit, miss, and eviction counters
+    /// </summary>
+    public void ResetStats() {
+        // The per-thread counters keep running, replacing them would race with concurrent lookups
+        hitsAtReset = numHits.Values.Sum();
+        missesAtReset = numMisses.Values.Sum();
+        Interlocked.Exchange(ref numEvictions, 0);
+        Interlocked.Exchange(ref peakResidentBytes, Interlocked.Read(ref residentBytes));
+    }
+
+    internal void NotifyHit() => numHits.Value++;
+
+    /// <summary>
+    /// Accounts for a newly loaded tile and evicts others if the budget is exceeded
+    /// </summary>
+    internal void NotifyLoaded(TiledTexture texture, int slot, long bytes) {
+        numMisses.Value++;
+        long total = Interlocked.Add(ref residentBytes, bytes);
+        long peak = Interlocked.Read(ref peakResidentBytes);
+        while (total > peak) {
+            long old = Interlocked.CompareExchange(ref peakResidentBytes, total, peak);
+            if (old == peak) break;
+            peak = old;
+        }
+
+        resident.Enqueue((texture, slot));
+        if (total > BudgetBytes)
+            Evict();
+    }
+
+    void Evict() {
+        // Every tile gets a second chance if it was used since the last sweep. Two full rounds are
+        // enough to find unused tiles, unless other threads are touching them concurrently.
+        int maxSteps = 2 * resident.Count;
+        while (Interlocked.Read(ref residentBytes) > BudgetBytes && maxSteps-- > 0
+            && resident.TryDequeue(out var entry)) {
+            if (entry.Texture.ClearReferenced(entry.Slot)) {
+                resident.Enqueue(entry);
+                continue;
+            }
+
+            long freed = entry.Texture.Evict(entry.Slot);
+            if (freed > 0) {
+                Interlocked.Add(ref residentBytes, -freed);
+                Interlocked.Increment(ref numEvictions);
+            }
+        }
+    }
+
+    readonly ConcurrentQueue<(TiledTexture Texture, int Slot)> resident = new();
+    readonly ConcurrentBag<TiledTexture> textures = [];
+    readonly ThreadLocal<long> numHits = new(true);
+    readonly ThreadLocal<long> numMisses = new(true);
+    long hitsAtReset, missesAtReset;
+    long numEvictions;
+    long residentBytes;
+    long peakResidentBytes;
+}
@@ -9,11 +9,24 @@ public class TextureMono : ImageTexture {
     /// </summary>
     public TextureMono(float color) => constColor = color;
 
+    /// <summary>
+    /// Creates a texture from the given file. If <see cref="TextureCache.Shared"/> is set, the image is
+    /// paged through the cache, otherwise it is loaded into memory immediately.
+    /// </summary>
+    /// <param name="filename">Path to the monochrome image to load</param>
+    public TextureMono(string filename) : this(filename, TextureCache.Shared) { }
+
     /// <summary>
     /// Creates a texture from the given file
     /// </summary>
     /// <param name="filename">Path to the monochrome image to load</param>
-    public TextureMono(string filename) => Image = new MonochromeImage(filename);
+    /// <param name="cache">The cache that pages in the image, or null to load it into memory</param>
+    public TextureMono(string filename, TextureCache cache) {
+        if (cache != null)
+            Tiles = cache.Open(filename, 1);
+        else
+            Image = new MonochromeImage(filename);
+    }
 
     /// <summary>
     /// Creates a texture from a monochromatic image
@@ -26,15 +39,50 @@ public class TextureMono : ImageTexture {
     /// <summary>
     /// True if the texture is just a single constant value
     /// </summary>
-    public bool IsConstant => Image == null;
+    public bool IsConstant => Image == null && Tiles == null;
+
+    /// <returns>The texture value at the given uv-coordinates, at full resolution</returns>
+    public float Lookup(Vector2 uv) => Lookup(uv, 0);
 
-    /// <returns>The texture value for the given uv-coordinates.</returns>
-    public float Lookup(Vector2 uv) {
-        if (Image == null)
+    /// <param name="uv">Texture coordinates</param>
+    /// <param name="footprint">
+    /// Width of the area to filter over in texture coordinates, see <see cref="SurfacePoint.TextureFootprint"/>
+    /// </param>
+    /// <returns>The texture value filtered over the footprint around the given uv-coordinates</returns>
+    public float Lookup(Vector2 uv, float footprint) {
+        if (IsConstant)
             return constColor;
 
-        (int col, int row) = ComputeTexel(uv);
-        return (Image as MonochromeImage).GetPixel(col, row);
+        if (Filter == FilterMode.Nearest) {
+            (int col, int row) = ComputeTexel(uv);
+            return GetTexel(0, col, row);
+        }
+
+        float level = ComputeMipLevel(footprint);
+        if (Filter == FilterMode.Bilinear)
+            return LookupBilinear(uv, (int)MathF.Round(level));
+
+        int lower = (int)level;
+        float t = level - lower;
+        var value = LookupBilinear(uv, lower);
+        if (t > 0)
+            value = (1 - t) * value + t * LookupBilinear(uv, lower + 1);
+        return value;
+    }
+
+    float LookupBilinear(Vector2 uv, int level) {
+        var (c0, r0, c1, r1, fx, fy) = ComputeBilinearTexels(uv, level);
+        return (1 - fy) * ((1 - fx) * GetTexel(level, c0, r0) + fx * GetTexel(level, c1, r0))
+            + fy * ((1 - fx) * GetTexel(level, c0, r1) + fx * GetTexel(level, c1, r1));
+    }
+
+    float GetTexel(int level, int col, int row) {
+        if (Tiles == null)
+            return (GetMipLevel(level) as MonochromeImage).GetPixel(col, row);
+
+        Span<float> texel = stackalloc float[1];
+        Tiles.Fetch(level, col, row, texel);
+        return texel[0];
     }
 
     float constColor;
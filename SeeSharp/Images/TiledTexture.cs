@@ -0,0 +1,287 @@
+using System.Buffers.Binary;
+using System.Linq;
+using System.Runtime.InteropServices;
+using System.Security.Cryptography;
+using System.Text;
+using Microsoft.Win32.SafeHandles;
+
+namespace SeeSharp.Images;
+
+/// <summary>
+/// An image (and its mip pyramid) that is split into tiles, which are paged in and out by a
+/// <see cref="TextureCache"/>. On first access, the image is decoded once and written to a tiled file in
+/// the format of the cache. Afterwards, only the tiles that are actually used are kept in memory.
+/// The tiled file stays open until the texture, or the cache that opened it, is disposed.
+/// </summary>
+public sealed class TiledTexture : IDisposable {
+    const int Version = 1;
+    const int HeaderBytes = 64;
+    static ReadOnlySpan<byte> Magic => "SSTX"u8;
+
+    /// <summary>
+    /// Path to the source image
+    /// </summary>
+    public string Filename { get; }
+
+    /// <summary>
+    /// Number of channels per texel, 1 or 3
+    /// </summary>
+    public int NumChannels { get; }
+
+    /// <summary>
+    /// Width of the full resolution image, reading this opens the texture
+    /// </summary>
+    public int Width => layout.Value.Width;
+
+    /// <summary>
+    /// Height of the full resolution image, reading this opens the texture
+    /// </summary>
+    public int Height => layout.Value.Height;
+
+    /// <summary>
+    /// Number of levels in the mip pyramid, including the full resolution image
+    /// </summary>
+    public int NumMipLevels => layout.Value.Levels.Length;
+
+    /// <returns>Width and height of a mip level</returns>
+    public (int Width, int Height) GetLevelSize(int level) {
+        var l = layout.Value.Levels[level];
+        return (l.Width, l.Height);
+    }
+
+    internal TiledTexture(TextureCache cache, string filename, int numChannels) {
+        Debug.Assert(numChannels == 1 || numChannels == 3);
+        this.cache = cache;
+        Filename = filename;
+        NumChannels = numChannels;
+        tileSize = cache.TileSize;
+        format = cache.Format;
+        bytesPerChannel = format switch {
+            TileFormat.Float => 4,
+            TileFormat.Half => 2,
+            _ => 1
+        };
+        tileBytes = tileSize * tileSize * numChannels * bytesPerChannel;
+        layout = new(Open, LazyThreadSafetyMode.ExecutionAndPublication);
+    }
+
+    /// <summary>
+    /// Reads the channels of a texel, paging in its tile if needed
+    /// </summary>
+    /// <param name="level">Mip level</param>
+    /// <param name="col">Column within the mip level</param>
+    /// <param name="row">Row within the mip level</param>
+    /// <param name="texel">Receives the <see cref="NumChannels"/> values</param>
+    public void Fetch(int level, int col, int row, Span<float> texel) {
+        var l = layout.Value;
+        var lvl = l.Levels[level];
+        int slot = lvl.FirstTile + row / tileSize * lvl.NumTilesX + col / tileSize;
+
+        var tile = Volatile.Read(ref l.Tiles[slot]);
+        if (tile == null) {
+            tile = LoadTile(l, slot);
+        } else {
+            cache.NotifyHit();
+            if (l.Referenced[slot] == 0) l.Referenced[slot] = 1;
+        }
+
+        int offset = ((row % tileSize) * tileSize + col % tileSize) * NumChannels;
+        switch (format) {
+            case TileFormat.Float:
+                MemoryMarshal.Cast<byte, float>(tile).Slice(offset, NumChannels).CopyTo(texel);
+                break;
+            case TileFormat.Half:
+                var halfs = MemoryMarshal.Cast<byte, Half>(tile);
+                for (int i = 0; i < NumChannels; ++i) texel[i] = (float)halfs[offset + i];
+                break;
+            default:
+                for (int i = 0; i < NumChannels; ++i) texel[i] = srgbToLinear[tile[offset + i]];
+                break;
+        }
+    }
+
+    /// <summary>
+    /// Closes the tiled file, if it was opened
+    /// </summary>
+    public void Dispose() {
+        if (layout.IsValueCreated)
+            layout.Value.File.Dispose();
+    }
+
+    /// <summary>
+    /// Clears the reference flag of a tile that is checked by the CLOCK eviction
+    /// </summary>
+    /// <returns>True if the tile was used since the flag was last cleared</returns>
+    internal bool ClearReferenced(int slot) {
+        var referenced = layout.Value.Referenced;
+        if (referenced[slot] == 0) return false;
+        referenced[slot] = 0;
+        return true;
+    }
+
+    /// <summary>
+    /// Drops a tile from memory. Threads that are still reading from it keep a valid reference.
+    /// </summary>
+    /// <returns>Number of bytes that were freed</returns>
+    internal long Evict(int slot) => Interlocked.Exchange(ref layout.Value.Tiles[slot], null)?.Length ?? 0;
+
+    byte[] LoadTile(Layout l, int slot) {
+        var tile = new byte[tileBytes];
+        RandomAccess.Read(l.File, tile, HeaderBytes + (long)slot * tileBytes);
+
+        // Another thread might have loaded the same tile in the meantime
+        var existing = Interlocked.CompareExchange(ref l.Tiles[slot], tile, null);
+        if (existing != null) {
+            cache.NotifyHit();
+            return existing;
+        }
+        cache.NotifyLoaded(this, slot, tile.Length);
+        return tile;
+    }
+
+    record struct Level(int Width, int Height, int NumTilesX, int FirstTile);
+
+    class Layout {
+        public int Width, Height;
+        public Level[] Levels;
+        public SafeFileHandle File;
+        public byte[][] Tiles;
+        public byte[] Referenced;
+    }
+
+    Layout Open() {
+        string tiledPath = GetTiledPath();
+        if (!IsValid(tiledPath))
+            WriteTiled(tiledPath);
+
+        var file = System.IO.File.OpenHandle(tiledPath, FileMode.Open, FileAccess.Read, FileShare.Read);
+        Span<byte> header = stackalloc byte[HeaderBytes];
+        RandomAccess.Read(file, header, 0);
+        var levels = ComputeLevels(BinaryPrimitives.ReadInt32LittleEndian(header[8..]),
+            BinaryPrimitives.ReadInt32LittleEndian(header[12..]));
+        int numTiles = levels[^1].FirstTile + 1;
+        return new() {
+            Width = levels[0].Width,
+            Height = levels[0].Height,
+            Levels = levels,
+            File = file,
+            Tiles = new byte[numTiles][],
+            Referenced = new byte[numTiles],
+        };
+    }
+
+    Level[] ComputeLevels(int width, int height) {
+        List<Level> levels = [];
+        int firstTile = 0;
+        while (true) {
+            int tilesX = (width + tileSize - 1) / tileSize;
+            int tilesY = (height + tileSize - 1) / tileSize;
+            levels.Add(new(width, height, tilesX, firstTile));
+            firstTile += tilesX * tilesY;
+            if (width == 1 && height == 1) break;
+            width = Math.Max(1, width / 2);
+            height = Math.Max(1, height / 2);
+        }
+        return levels.ToArray();
+    }
+
+    string GetTiledPath() {
+        FileInfo info = new(Filename);
+        if (!info.Exists)
+            throw new FileNotFoundException("Texture image not found", Filename);
+        string key = $"{Version}|{info.FullName}|{info.Length}|{info.LastWriteTimeUtc.Ticks}|{NumChannels}|{format}|{tileSize}";
+        var hash = SHA256.HashData(Encoding.UTF8.GetBytes(key));
+        return Path.Join(cache.Directory, Convert.ToHexString(hash, 0, 16) + ".tiles");
+    }
+
+    static bool IsValid(string tiledPath) {
+        if (!System.IO.File.Exists(tiledPath))
+            return false;
+        try {
+            using var file = System.IO.File.OpenHandle(tiledPath);
+            Span<byte> header = stackalloc byte[8];
+            return RandomAccess.Read(file, header, 0) == 8 && header[..4].SequenceEqual(Magic)
+                && BinaryPrimitives.ReadInt32LittleEndian(header[4..]) == Version;
+        } catch (IOException) {
+            return false;
+        }
+    }
+
+    /// <summary>
+    /// Decodes the source image, computes its mip pyramid, and writes all tiles in parallel
+    /// </summary>
+    void WriteTiled(string tiledPath) {
+        var timer = Stopwatch.StartNew();
+        Image image = NumChannels == 3 ? new RgbImage(Filename) : new MonochromeImage(Filename);
+        var images = ImageTexture.BuildMipPyramid(image);
+        var levels = ComputeLevels(image.Width, image.Height);
+        int numTiles = levels[^1].FirstTile + 1;
+
+        System.IO.Directory.CreateDirectory(cache.Directory);
+        string tempPath = $"{tiledPath}.{Environment.ProcessId}.tmp";
+        using (var file = System.IO.File.OpenHandle(tempPath, FileMode.Create, FileAccess.Write)) {
+            Span<byte> header = stackalloc byte[HeaderBytes];
+            header.Clear();
+            Magic.CopyTo(header);
+            BinaryPrimitives.WriteInt32LittleEndian(header[4..], Version);
+            BinaryPrimitives.WriteInt32LittleEndian(header[8..], image.Width);
+            BinaryPrimitives.WriteInt32LittleEndian(header[12..], image.Height);
+            RandomAccess.Write(file, header, 0);
+
+            Parallel.For(0, levels.Length, level => {
+                var lvl = levels[level];
+                int numTilesY = (lvl.Height + tileSize - 1) / tileSize;
+                Parallel.For(0, lvl.NumTilesX * numTilesY, i => {
+                    var tile = EncodeTile(images[level], i % lvl.NumTilesX * tileSize, i / lvl.NumTilesX * tileSize);
+                    RandomAccess.Write(file, tile, HeaderBytes + (long)(lvl.FirstTile + i) * tileBytes);
+                });
+            });
+        }
+        System.IO.File.Move(tempPath, tiledPath, true);
+
+        Logger.Log($"Converted {Filename} to {numTiles} tiles in {timer.ElapsedMilliseconds}ms",
+            Verbosity.Debug);
+    }
+
+    byte[] EncodeTile(Image image, int left, int top) {
+        var tile = new byte[tileBytes];
+        var floats = MemoryMarshal.Cast<byte, float>(tile);
+        var halfs = MemoryMarshal.Cast<byte, Half>(tile);
+
+        // Texels outside the image are padding, they are never read
+        int width = Math.Min(tileSize, image.Width - left);
+        int height = Math.Min(tileSize, image.Height - top);
+        for (int row = 0; row < height; ++row) {
+            for (int col = 0; col < width; ++col) {
+                int offset = (row * tileSize + col) * NumChannels;
+                for (int chan = 0; chan < NumChannels; ++chan) {
+                    float value = image[left + col, top + row, chan];
+                    switch (format) {
+                        case TileFormat.Float: floats[offset + chan] = value; break;
+                        case TileFormat.Half: halfs[offset + chan] = (Half)value; break;
+                        default: tile[offset + chan] = LinearToSrgb8(value); break;
+                    }
+                }
+            }
+        }
+        return tile;
+    }
+
+    static byte LinearToSrgb8(float value) {
+        value = Math.Clamp(value, 0, 1);
+        float srgb = value <= 0.0031308f ? 12.92f * value : 1.055f * MathF.Pow(value, 1 / 2.4f) - 0.055f;
+        return (byte)MathF.Round(srgb * 255);
+    }
+
+    static readonly float[] srgbToLinear = Enumerable.Range(0, 256).Select(i => {
+        float srgb = i / 255.0f;
+        return srgb <= 0.04045f ? srgb / 12.92f : MathF.Pow((srgb + 0.055f) / 1.055f, 2.4f);
+    }).ToArray();
+
+    readonly TextureCache cache;
+    readonly int tileSize;
+    readonly TileFormat format;
+    readonly int bytesPerChannel;
+    readonly int tileBytes;
+    readonly Lazy<Layout> layout;
+}
@@ -1,4 +1,6 @@
-﻿namespace SeeSharp.Images;
+﻿using System.Buffers;
+
+namespace SeeSharp.Images;
 
 /// <summary>
 /// Estimates the pixel variance in the rendered image.
@@ -8,9 +10,18 @@
 /// especially not if MIS is used. It is a lower-bound approximation of that.
 /// </summary>
 public class VarianceLayer : Layer {
-    MonochromeImage momentImage;
-    MonochromeImage meanImage;
-    MonochromeImage bufferImage;
+    // The running moments are double buffered: the update reads the previous values and writes the new
+    // ones, so neighboring bands can recompute the rows they share without synchronization.
+    NativeBuffer<float> moment, mean, nextMoment, nextMean;
+    NativeBuffer<float> buffer;
+    double[] bandSums;
+    int width, height;
+
+    /// <summary>
+    /// Number of rows that are processed by one task at the end of an iteration. The rows directly above
+    /// and below a band are recomputed by it for the blur.
+    /// </summary>
+    const int BandHeight = 16;
 
     /// <summary>
     /// Average variance over the entire image
@@ -24,62 +35,232 @@ public class VarianceLayer : Layer {
     /// <param name="height">The height of the frame buffer</param>
     public override void Init(int width, int height) {
         Image = new MonochromeImage(width, height);
-        momentImage = new MonochromeImage(width, height);
-        meanImage = new MonochromeImage(width, height);
-        bufferImage = new MonochromeImage(width, height);
+        this.width = width;
+        this.height = height;
+
+        moment?.Dispose();
+        mean?.Dispose();
+        nextMoment?.Dispose();
+        nextMean?.Dispose();
+        buffer?.Dispose();
+
+        long numPixels = (long)width * height;
+        moment = new(numPixels);
+        mean = new(numPixels);
+        nextMoment = new(numPixels);
+        nextMean = new(numPixels);
+        buffer = new(numPixels);
+        bandSums = new double[(height + BandHeight - 1) / BandHeight];
     }
 
     /// <summary>
     /// Splats a new pixel value to the current pixel value buffer
     /// </summary>
     public virtual void Splat(float x, float y, RgbColor value)
-    => bufferImage.AtomicAdd((int)x, (int)y, value.Average);
+    => Atomic.AddFloat(ref buffer[(long)(int)y * width + (int)x], value.Average);
 
     /// <summary>
-    /// Normalizes and clears the internal buffers
+    /// Clears the pixel value buffer. The moments are normalized when they are updated at the end of the
+    /// iteration.
     /// </summary>
     public override void OnStartIteration(int curIteration) {
-        if (curIteration > 1) {
-            momentImage.Scale((curIteration - 1.0f) / curIteration);
-            meanImage.Scale((curIteration - 1.0f) / curIteration);
-        }
         this.curIteration = curIteration;
 
         // Each iteration needs to store the final pixel value of that iteration
-        bufferImage.Scale(0);
+        buffer.Clear();
     }
 
     /// <summary>
     /// Computes the pixel variances and their average
     /// </summary>
     public override void OnEndIteration(int curIteration) {
-        // Update the mean and moment based on the buffered image of the current iteration
-        Parallel.For(0, momentImage.Height, row => {
-            for (int col = 0; col < momentImage.Width; ++col) {
-                float val = bufferImage.GetPixel(col, row);
-                momentImage.AtomicAdd(col, row, val * val / curIteration);
-                meanImage.AtomicAdd(col, row, val / curIteration);
+        ComputeVariance(curIteration);
+        (moment, nextMoment) = (nextMoment, moment);
+        (mean, nextMean) = (nextMean, mean);
+    }
+
+    /// <summary>
+    /// Computes the variance image and its average from the mean and second moment, in a single parallel
+    /// pass over bands of rows. Each row is updated, blurred horizontally as it is loaded, and kept in a
+    /// ring of three rows for the vertical blur, so no full-size scratch images are needed.
+    /// </summary>
+    /// <param name="iteration">
+    /// If positive, the buffered values of this iteration are added to the moments first, and the updated
+    /// moments are written to the next buffers.
+    /// </param>
+    void ComputeVariance(int iteration) {
+        Parallel.For(0, bandSums.Length,
+            () => ArrayPool<float>.Shared.Rent(8 * width),
+            (band, _, scratch) => {
+                bandSums[band] = ComputeBand(band, iteration, scratch);
+                return scratch;
+            },
+            scratch => ArrayPool<float>.Shared.Return(scratch));
+
+        // Summing the per-band partial sums in order keeps the average deterministic
+        double sum = 0;
+        foreach (double s in bandSums)
+            sum += s;
+        Average = (float)(sum / ((long)width * height));
+    }
+
+    /// <returns>Sum of the variances in the band</returns>
+    double ComputeBand(int band, int iteration, float[] scratch) {
+        int first = band * BandHeight;
+        int end = Math.Min(first + BandHeight, height);
+
+        double sum = 0;
+        int next = Math.Max(first - 1, 0);
+        for (int row = first; row < end; ++row) {
+            int top = Math.Max(row - 1, 0);
+            int bottom = Math.Min(row + 1, height - 1);
+            for (; next <= bottom; ++next)
+                LoadRow(next, next >= first && next < end, iteration, scratch);
+
+            // The box filter only averages the pixels within the image
+            float norm = 1.0f / (bottom - top + 1);
+            Span<float> variances = scratch.AsSpan(6 * width, width);
+            int col = 0;
+            if (Vector.IsHardwareAccelerated) {
+                var vNorm = new Vector<float>(norm);
+                var eps = new Vector<float>(0.001f);
+                var vSum = Vector<float>.Zero;
+                for (; col + Vector<float>.Count <= width; col += Vector<float>.Count) {
+                    var m = Vector<float>.Zero;
+                    var m2 = Vector<float>.Zero;
+                    for (int r = top; r <= bottom; ++r) {
+                        m += new Vector<float>(BlurredMean(scratch, r)[col..]);
+                        m2 += new Vector<float>(BlurredMoment(scratch, r)[col..]);
+                    }
+                    m *= vNorm;
+                    m2 *= vNorm;
+                    var variance = (m2 - m * m) / (m * m + eps);
+                    variance.CopyTo(variances[col..]);
+                    vSum += variance;
+                }
+                sum += Vector.Sum(vSum);
+            }
+            for (; col < width; ++col) {
+                float m = 0, m2 = 0;
+                for (int r = top; r <= bottom; ++r) {
+                    m += BlurredMean(scratch, r)[col];
+                    m2 += BlurredMoment(scratch, r)[col];
+                }
+                m *= norm;
+                m2 *= norm;
+                variances[col] = (m2 - m * m) / (m * m + 0.001f);
+                sum += variances[col];
             }
-        });
-
-        // Blur both buffers to get a more stable estimate.
-        // TODO this could be done in-place by directly splatting in multiple pixels above
-        MonochromeImage blurredMean = new(meanImage.Width, meanImage.Height);
-        MonochromeImage blurredMoment = new(meanImage.Width, meanImage.Height);
-        Filter.Box(meanImage, blurredMean, 1);
-        Filter.Box(momentImage, blurredMoment, 1);
-
-        // Compute the final variance and update the main image
-        Average = 0;
-        Parallel.For(0, momentImage.Height, (Action<int>)(row => {
-            for (int col = 0; col < momentImage.Width; ++col) {
-                float mean = blurredMean.GetPixel(col, row);
-                float variance = blurredMoment.GetPixel(col, row) - mean * mean;
-                variance /= (mean * mean + 0.001f);
-                Image.SetPixelChannel(col, row, 0, variance);
-                Atomic.AddFloat(ref Average, variance);
+
+            for (col = 0; col < width; ++col)
+                Image.SetPixelChannel(col, row, 0, variances[col]);
+        }
+        return sum;
+    }
+
+    // Row r of the ring is stored in slot r % 3, each slot holds the blurred mean followed by the moment
+    Span<float> BlurredMean(float[] scratch, int row) => scratch.AsSpan(row % 3 * 2 * width, width);
+    Span<float> BlurredMoment(float[] scratch, int row) => scratch.AsSpan((row % 3 * 2 + 1) * width, width);
+
+    /// <summary>
+    /// Updates the mean and moment of a row with the buffered values of the iteration, if any, and blurs
+    /// them horizontally into the ring
+    /// </summary>
+    /// <param name="owned">If true, the row belongs to the band and the updated moments are stored</param>
+    void LoadRow(int row, bool owned, int iteration, float[] scratch) {
+        long offset = (long)row * width;
+        Span<float> rowMean = mean.Slice(offset, width);
+        Span<float> rowMoment = moment.Slice(offset, width);
+
+        if (iteration > 0) {
+            Span<float> updatedMean = scratch.AsSpan(6 * width, width);
+            Span<float> updatedMoment = scratch.AsSpan(7 * width, width);
+            Span<float> values = buffer.Slice(offset, width);
+
+            float keep = (iteration - 1.0f) / iteration;
+            float add = 1.0f / iteration;
+            int col = 0;
+            if (Vector.IsHardwareAccelerated) {
+                var vKeep = new Vector<float>(keep);
+                var vAdd = new Vector<float>(add);
+                for (; col + Vector<float>.Count <= width; col += Vector<float>.Count) {
+                    var val = new Vector<float>(values[col..]);
+                    (new Vector<float>(rowMean[col..]) * vKeep + val * vAdd).CopyTo(updatedMean[col..]);
+                    (new Vector<float>(rowMoment[col..]) * vKeep + val * val * vAdd).CopyTo(updatedMoment[col..]);
+                }
             }
-        }));
-        Average /= momentImage.Height * momentImage.Width;
+            for (; col < width; ++col) {
+                float val = values[col];
+                updatedMean[col] = rowMean[col] * keep + val * add;
+                updatedMoment[col] = rowMoment[col] * keep + val * val * add;
+            }
+
+            if (owned) {
+                updatedMean.CopyTo(nextMean.Slice(offset, width));
+                updatedMoment.CopyTo(nextMoment.Slice(offset, width));
+            }
+            rowMean = updatedMean;
+            rowMoment = updatedMoment;
+        }
+
+        BlurRow(rowMean, BlurredMean(scratch, row));
+        BlurRow(rowMoment, BlurredMoment(scratch, row));
+    }
+
+    /// <summary>
+    /// Horizontal part of a box filter with radius 1, only averages the pixels within the image
+    /// </summary>
+    static void BlurRow(ReadOnlySpan<float> src, Span<float> dst) {
+        int n = src.Length;
+        if (n == 1) {
+            dst[0] = src[0];
+            return;
+        }
+        dst[0] = (src[0] + src[1]) * 0.5f;
+        dst[n - 1] = (src[n - 2] + src[n - 1]) * 0.5f;
+
+        const float third = 1.0f / 3.0f;
+        int i = 1;
+        if (Vector.IsHardwareAccelerated) {
+            var vThird = new Vector<float>(third);
+            for (; i + Vector<float>.Count <= n - 1; i += Vector<float>.Count) {
+                var sum = new Vector<float>(src[(i - 1)..]) + new Vector<float>(src[i..])
+                    + new Vector<float>(src[(i + 1)..]);
+                (sum * vThird).CopyTo(dst[i..]);
+            }
+        }
+        for (; i < n - 1; ++i)
+            dst[i] = (src[i - 1] + src[i] + src[i + 1]) * third;
+    }
+
+    /// <summary>
+    /// Writes the variance image along with the running mean and second moment
+    /// </summary>
+    public override void WriteCheckpoint(BinaryWriter writer) {
+        base.WriteCheckpoint(writer);
+        FrameBuffer.WriteBuffer(writer, moment);
+        FrameBuffer.WriteBuffer(writer, mean);
+        writer.Write(Average);
+    }
+
+    /// <summary>
+    /// Restores the variance image along with the running mean and second moment
+    /// </summary>
+    public override void ReadCheckpoint(BinaryReader reader) {
+        base.ReadCheckpoint(reader);
+        FrameBuffer.ReadBuffer(reader, moment);
+        FrameBuffer.ReadBuffer(reader, mean);
+        Average = reader.ReadSingle();
+    }
+
+    /// <summary>
+    /// Adds the weighted mean and second moment, and recomputes the variance from them
+    /// </summary>
+    public override void MergeCheckpoint(BinaryReader reader, float weight) {
+        base.MergeCheckpoint(reader, weight);
+        FrameBuffer.AddBuffer(reader, moment, weight);
+        FrameBuffer.AddBuffer(reader, mean, weight);
+        reader.ReadSingle();
+        ComputeVariance(0);
     }
-}
\ No newline at end of file
+}
@@ -66,31 +66,29 @@ public abstract partial class BidirBase<CameraPayloadType> {
     }
 
     /// <summary>
-    /// Used by next event estimation to select a light source
+    /// Used by next event estimation to select a light source. The default uses the light hierarchy of
+    /// the scene to select lights based on their power, distance, and orientation.
     /// </summary>
     /// <param name="from">A point on a surface where next event is performed</param>
     /// <param name="rng">Random number generator</param>
     /// <returns>The selected light and the discrete probability of selecting that light</returns>
-    protected virtual (Emitter, float) SelectLight(in SurfacePoint from, ref RNG rng) {
-        int idx = rng.NextInt(Scene.Emitters.Count);
-        return (Scene.Emitters[idx], 1.0f / Scene.Emitters.Count);
-    }
+    protected virtual (Emitter, float) SelectLight(in SurfacePoint from, ref RNG rng)
+    => Scene.SampleEmitter(from, rng.NextFloat());
 
     /// <returns>
     /// The discrete probability of selecting the given light when performing next event at the given
     /// shading point.
     /// </returns>
-    protected virtual float SelectLightPmf(in SurfacePoint from, Emitter em) => 1.0f / Scene.Emitters.Count;
+    protected virtual float SelectLightPmf(in SurfacePoint from, Emitter em)
+    => Scene.EmitterProbability(from, em);
 
     protected virtual void TraceAllCameraPaths(uint iter) {
         CameraRandomWalk walkMod = new(this);
 
-        Parallel.For(0, Scene.FrameBuffer.Height, row => {
-            for (uint col = 0; col < Scene.FrameBuffer.Width; ++col) {
-                uint pixelIndex = (uint)(row * Scene.FrameBuffer.Width + col);
-                var rng = new RNG(BaseSeedCamera, pixelIndex, iter);
-                RenderPixel((uint)row, col, ref rng, walkMod);
-            }
+        CameraTiles.Run((col, row) => {
+            uint pixelIndex = (uint)(row * Scene.FrameBuffer.Width + col);
+            var rng = new RNG(BaseSeedCamera, pixelIndex, iter);
+            RenderPixel((uint)row, (uint)col, ref rng, walkMod);
         });
     }
 
@@ -189,16 +187,28 @@ public abstract partial class BidirBase<CameraPayloadType> {
         return (pixelIndex, -1, 1.0f);
     }
 
+    /// <summary>
+    /// A light vertex that was selected for connection, but whose visibility has not been tested yet
+    /// </summary>
+    protected struct ConnectionCandidate {
+        /// <summary> The light vertex to connect to </summary>
+        public PathVertex Vertex;
+
+        /// <summary> The predecessor of the light vertex on its path </summary>
+        public PathVertex Ancestor;
+
+        /// <summary> Probability of having selected this vertex </summary>
+        public float SelectProb;
+    }
+
+    readonly ThreadLocal<PathBuffer<ConnectionCandidate>> threadConnectionCandidates = new(() => new(16));
+
+    /// <summary>
+    /// Evaluates the connection to a light vertex that is known to be visible
+    /// </summary>
     RgbColor Connect(in SurfaceShader shader, PathVertex vertex, PathVertex ancestor, Vector3 dirToAncestor,
                      ref CameraPath path, float reversePdfJacobian, float lightVertexProb) {
-        // Only allow connections that do not exceed the maximum total path length
         int depth = vertex.Depth + path.Vertices.Count + 1;
-        if (depth > MaxDepth || depth < MinDepth)
-            return RgbColor.Black;
-
-        // Trace shadow ray
-        if (Scene.Raytracer.IsOccluded(vertex.Point, shader.Point))
-            return RgbColor.Black;
 
         // Compute connection direction
         var dirFromCamToLight = Vector3.Normalize(vertex.Point.Position - shader.Point.Position);
@@ -266,7 +276,8 @@ public abstract partial class BidirBase<CameraPayloadType> {
     }
 
     /// <summary>
-    /// Computes the contribution of inner path connections at the given camera path vertex
+    /// Computes the contribution of inner path connections at the given camera path vertex. All light
+    /// vertices are selected first, then each connection is tested for visibility and evaluated.
     /// </summary>
     /// <param name="shader">Shading info at the last vertex of the camera path</param>
     /// <param name="rng">Random number generator</param>
@@ -275,38 +286,59 @@ public abstract partial class BidirBase<CameraPayloadType> {
     /// Jacobian to convert a solid angle density at the camera vertex to a surface area density at its
     /// ancestor vertex.
     /// </param>
+    /// <param name="numConnections">How often <see cref="SelectBidirPath" /> is invoked</param>
     /// <returns>The sum of all MIS weighted contributions for inner path connections</returns>
     protected virtual RgbColor BidirConnections(in SurfaceShader shader, ref RNG rng,
-                                                ref CameraPath path, float reversePdfJacobian) {
+                                                ref CameraPath path, float reversePdfJacobian,
+                                                int numConnections = 1) {
         RgbColor result = RgbColor.Black;
         if (NumLightPaths == 0) return result;
 
-        // Select a path to connect to (based on pixel index)
-        (int lightPathIdx, int lightVertIdx, float lightVertexProb) =
-            SelectBidirPath(shader.Point, shader.Context.OutDirWorld, path.Pixel, ref rng);
-
-        if (lightVertIdx > 0) {
-            // specific vertex selected
-            var vertex = PathCache[lightVertIdx]; // TODO-PERFORMANCE this is an expensive binary search ATM --> should we instead pick a random path and vertex within? Or precompute a lookup table for this mapping?
-            if (vertex.Depth < 1)
-                return result;
-            var ancestor = PathCache[lightVertIdx - 1];
-            var dirToAncestor = Vector3.Normalize(ancestor.Point.Position - vertex.Point.Position);
-            result += Connect(shader, vertex, ancestor, dirToAncestor, ref path, reversePdfJacobian, lightVertexProb);
-        } else if (lightPathIdx >= 0) {
-            // Connect with all vertices along the path
-            int n = PathCache.Length(lightPathIdx);
-            for (int i = 1; i < n; ++i) {
-                var ancestor = PathCache[lightPathIdx, i - 1];
-                var vertex = PathCache[lightPathIdx, i];
-                var dirToAncestor = Vector3.Normalize(ancestor.Point.Position - vertex.Point.Position);
-                result += Connect(shader, vertex, ancestor, dirToAncestor, ref path, reversePdfJacobian, lightVertexProb);
+        var candidates = threadConnectionCandidates.Value;
+        candidates.Clear();
+        for (int c = 0; c < numConnections; ++c) {
+            // Select a path to connect to (based on pixel index)
+            (int lightPathIdx, int lightVertIdx, float lightVertexProb) =
+                SelectBidirPath(shader.Point, shader.Context.OutDirWorld, path.Pixel, ref rng);
+
+            if (lightVertIdx > 0) {
+                // specific vertex selected
+                var vertex = PathCache[lightVertIdx];
+                if (vertex.Depth < 1)
+                    continue;
+                AddConnectionCandidate(candidates, vertex, PathCache[lightVertIdx - 1], lightVertexProb, path);
+            } else if (lightPathIdx >= 0) {
+                // Connect with all vertices along the path
+                int n = PathCache.Length(lightPathIdx);
+                for (int i = 1; i < n; ++i) {
+                    AddConnectionCandidate(candidates, PathCache[lightPathIdx, i], PathCache[lightPathIdx, i - 1],
+                        lightVertexProb, path);
+                }
             }
         }
+        if (candidates.Count == 0) return result;
+
+        for (int i = 0; i < candidates.Count; ++i) {
+            ref var candidate = ref candidates[i];
+            if (Scene.Raytracer.IsOccluded(candidate.Vertex.Point, shader.Point))
+                continue;
+            var dirToAncestor = Vector3.Normalize(candidate.Ancestor.Point.Position - candidate.Vertex.Point.Position);
+            result += Connect(shader, candidate.Vertex, candidate.Ancestor, dirToAncestor, ref path,
+                reversePdfJacobian, candidate.SelectProb);
+        }
 
         return result;
     }
 
+    void AddConnectionCandidate(PathBuffer<ConnectionCandidate> candidates, in PathVertex vertex,
+                                in PathVertex ancestor, float selectProb, in CameraPath path) {
+        // Only allow connections that do not exceed the maximum total path length
+        int depth = vertex.Depth + path.Vertices.Count + 1;
+        if (depth > MaxDepth || depth < MinDepth)
+            return;
+        candidates.Add(new() { Vertex = vertex, Ancestor = ancestor, SelectProb = selectProb });
+    }
+
     /// <summary>
     /// Computes the MIS weight for next event estimation along a camera path
     /// </summary>
@@ -324,6 +356,8 @@ public abstract partial class BidirBase<CameraPayloadType> {
     /// <returns>The sampled emitter and point on the emitter</returns>
     protected virtual (Emitter, SurfaceSample) SampleNextEvent(SurfacePoint from, ref RNG rng) {
         var (light, lightProb) = SelectLight(from, ref rng);
+        if (light == null)
+            return (null, new SurfaceSample() { Pdf = 0 });
         var lightSample = light.SampleUniformArea(rng.NextFloat2D());
         lightSample.Pdf *= lightProb;
         return (light, lightSample);
@@ -503,7 +537,7 @@ public abstract partial class BidirBase<CameraPayloadType> {
 
         // Compute pdf values
         float pdfEmit = ComputeEmitterPdf(emitter, hit, outDir, reversePdfJacobian);
-        float pdfNextEvent = NextEventPdf(new SurfacePoint(), hit); // TODO get the actual previous point!
+        float pdfNextEvent = NextEventPdf(path.PreviousPoint, hit);
 
         int numPdfs = path.Vertices.Count;
         int lastCameraVertexIdx = numPdfs - 1;
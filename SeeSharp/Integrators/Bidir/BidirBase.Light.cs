@@ -107,8 +107,8 @@ public abstract partial class BidirBase<CameraPayloadType> {
         if (BackgroundProbability > 0 && rng.NextFloat() <= BackgroundProbability) {
             return (null, BackgroundProbability);
         } else {
-            var emitter = Scene.Emitters[rng.NextInt(Scene.Emitters.Count)];
-            return (emitter, (1 - BackgroundProbability) / Scene.Emitters.Count);
+            var (emitter, prob) = Scene.SampleEmitter(rng.NextFloat());
+            return (emitter, (1 - BackgroundProbability) * prob);
         }
     }
 
@@ -121,7 +121,7 @@ public abstract partial class BidirBase<CameraPayloadType> {
         if (em == null) { // background
             return BackgroundProbability;
         } else {
-            return (1 - BackgroundProbability) / Scene.Emitters.Count;
+            return (1 - BackgroundProbability) * Scene.EmitterProbability(em);
         }
     }
 
@@ -239,19 +239,19 @@ public abstract partial class BidirBase<CameraPayloadType> {
     /// </summary>
     /// <param name="func">Delegate invoked on each vertex</param>
     public void ForEachVertex(ProcessVertex func) {
-        Parallel.For(0, PathCache?.NumPaths ?? 0, pathIdx => {
+        Scene.FrameBuffer.ParallelFor(PathCache?.NumPaths ?? 0, pathIdx => {
+            var positions = PathCache.Positions;
             for (int i = 1; i < PathCache.Length(pathIdx); ++i) {
-                var vertex = PathCache.GetPathVertex(pathIdx, i);
-                var ancestor = PathCache.GetPathVertex(pathIdx, i - 1);
-                var dirToAncestor = Vector3.Normalize(ancestor.Point.Position - vertex.Point.Position);
-                func(vertex, ancestor, dirToAncestor);
+                int idx = PathCache.GetPathVertexIndex(pathIdx, i);
+                var dirToAncestor = Vector3.Normalize(positions[idx - 1] - positions[idx]);
+                func(PathCache.GetPathVertex(pathIdx, i), PathCache.GetPathVertex(pathIdx, i - 1), dirToAncestor);
             }
         });
     }
 
-    public ref PathVertex this[int vertexIdx] => ref PathCache.GetVertex(vertexIdx);
+    public PathVertex this[int vertexIdx] => PathCache.GetVertex(vertexIdx);
 
-    public ref PathVertex this[int pathIdx, int vertexIdx] => ref PathCache.GetPathVertex(pathIdx, vertexIdx);
+    public PathVertex this[int pathIdx, int vertexIdx] => PathCache.GetPathVertex(pathIdx, vertexIdx);
 
     /// <returns>The length of the pathIdx'th path</returns>
     public int Length(int pathIdx) => PathCache.Length(pathIdx);
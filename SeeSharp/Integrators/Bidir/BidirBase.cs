@@ -53,6 +53,11 @@ public abstract partial class BidirBase<CameraPayloadType> : Integrator {
     /// </summary>
     [JsonIgnore] protected DenoiseBuffers DenoiseBuffers;
 
+    /// <summary>
+    /// Distributes the camera paths of each iteration over the cores, created at the start of rendering
+    /// </summary>
+    [JsonIgnore] protected TileScheduler CameraTiles;
+
     /// <summary>
     /// Called once after the end of each rendering iteration (one sample per pixel)
     /// </summary>
@@ -87,20 +92,25 @@ public abstract partial class BidirBase<CameraPayloadType> : Integrator {
             NumLightPaths = scene.FrameBuffer.Width * scene.FrameBuffer.Height;
 
         if (EnableDenoiser) DenoiseBuffers = new(scene.FrameBuffer);
+        CameraTiles = MakeTileScheduler(scene);
         OnBeforeRender();
 
         ProgressBar progressBar = new(prefix: "Rendering...");
-        progressBar.Start(NumIterations);
-        RenderTimer timer = new();
+        var (firstIteration, endIteration) = GetIterationRange(scene, NumIterations);
+        // A partial range would only denoise its own iterations, the merged image is denoised instead
+        bool denoise = EnableDenoiser && !IsPartialRange(scene, NumIterations);
+        progressBar.Start((int)(endIteration - firstIteration));
+        RenderTimer timer = MakeRenderTimer(scene);
         Stopwatch lightTracerTimer = new();
         Stopwatch pathTracerTimer = new();
         ShadingStatCounter.Reset();
+        TextureCache.Shared?.ResetStats();
         scene.Raytracer.ResetStats();
-        for (uint iter = 0; iter < NumIterations; ++iter) {
+        for (uint iter = firstIteration; iter < endIteration; ++iter) {
             long nextIterTime = timer.RenderTime + timer.PerIterationCost;
             if (MaximumRenderTimeMs.HasValue && nextIterTime > MaximumRenderTimeMs.Value) {
                 Logger.Log("Maximum render time exhausted.");
-                if (EnableDenoiser) DenoiseBuffers.Denoise();
+                if (denoise) DenoiseBuffers.Denoise();
                 progressBar.Terminate();
                 break;
             }
@@ -126,7 +136,7 @@ public abstract partial class BidirBase<CameraPayloadType> : Integrator {
             OnEndIteration(iter);
             timer.EndRender();
 
-            if (iter == NumIterations - 1 && EnableDenoiser)
+            if (iter == NumIterations - 1 && denoise)
                 DenoiseBuffers.Denoise();
             scene.FrameBuffer.EndIteration();
             timer.EndFrameBuffer();
@@ -136,13 +146,19 @@ public abstract partial class BidirBase<CameraPayloadType> : Integrator {
         }
 
         scene.FrameBuffer.MetaData["RenderTime"] = timer.RenderTime;
-        scene.FrameBuffer.MetaData["FrameBufferTime"] = timer.FrameBufferTime;
+        scene.FrameBuffer.SetFrameBufferTime(timer.FrameBufferTime);
         scene.FrameBuffer.MetaData["PathTracerTime"] = pathTracerTimer.ElapsedMilliseconds;
         scene.FrameBuffer.MetaData["LightTracerTime"] = lightTracerTimer.ElapsedMilliseconds;
         scene.FrameBuffer.MetaData["ShadingStats"] = ShadingStatCounter.Current;
+        if (TextureCache.Shared != null)
+            scene.FrameBuffer.MetaData["TextureCacheStats"] = TextureCache.Shared.Stats;
         scene.FrameBuffer.MetaData["RayTracerStats"] = scene.Raytracer.Stats;
+        scene.FrameBuffer.MetaData["TileStats"] = CameraTiles.Stats;
+        if (PathCache != null)
+            scene.FrameBuffer.MetaData["PathCacheStats"] = PathCache.Stats;
 
         OnAfterRender();
+        FramePool.Trim();
     }
 
     /// <summary>
@@ -65,10 +65,13 @@ public ref struct BidirPathPdfs {
     }
 
     public void GatherCameraPdfs(PathCache cameraPathCache, in PathVertex cameraVertex, int lastCameraVertexIdx) {
+        var pdfsFromAncestor = cameraPathCache.PdfsFromAncestor;
+        var pdfsReverseAncestor = cameraPathCache.PdfsReverseAncestor;
+        int first = cameraPathCache.GetPathVertexIndex(cameraVertex.PathId, 0);
         for (int i = 0; i <= lastCameraVertexIdx; ++i) {
-            PdfsCameraToLight[i] = cameraPathCache[cameraVertex.PathId, i].PdfFromAncestor;
+            PdfsCameraToLight[i] = pdfsFromAncestor[first + i];
             if (i < lastCameraVertexIdx - 1)
-                PdfsLightToCamera[i] = cameraPathCache[cameraVertex.PathId, i + 2].PdfReverseAncestor;
+                PdfsLightToCamera[i] = pdfsReverseAncestor[first + i + 2];
         }
     }
 
@@ -82,14 +85,28 @@ public ref struct BidirPathPdfs {
     /// is filled with the forward and backward sampling pdfs along the light path.
     /// </param>
     public void GatherLightPdfs(PathCache lightPathCache, in PathVertex lightVertex, int lastCameraVertexIdx) {
-        var nextVert = lightVertex;
-        for (int i = lastCameraVertexIdx + 1; i < NumPdfs - 2; ++i) {
-            PdfsLightToCamera[i] = nextVert.PdfFromAncestor;
-            PdfsCameraToLight[i + 2] = nextVert.PdfReverseAncestor;
-            PdfNextEvent += nextVert.PdfNextEventAncestor; // All but one are zero, so we are lazy and add them up instead of picking the correct one
-            nextVert = lightPathCache[nextVert.PathId, nextVert.Depth - 1];
+        int i = lastCameraVertexIdx + 1;
+        if (i >= NumPdfs - 2) {
+            PdfsLightToCamera[^2] = lightVertex.PdfFromAncestor;
+            PdfsLightToCamera[^1] = 1;
+            return;
         }
-        PdfsLightToCamera[^2] = nextVert.PdfFromAncestor;
+
+        PdfsLightToCamera[i] = lightVertex.PdfFromAncestor;
+        PdfsCameraToLight[i + 2] = lightVertex.PdfReverseAncestor;
+        PdfNextEvent += lightVertex.PdfNextEventAncestor;
+
+        // The ancestors are stored consecutively before the vertex, so we can stream over the pdf arrays
+        var pdfsFromAncestor = lightPathCache.PdfsFromAncestor;
+        var pdfsReverseAncestor = lightPathCache.PdfsReverseAncestor;
+        var pdfsNextEventAncestor = lightPathCache.PdfsNextEventAncestor;
+        int idx = lightPathCache.GetPathVertexIndex(lightVertex.PathId, lightVertex.Depth - 1);
+        for (++i; i < NumPdfs - 2; ++i, --idx) {
+            PdfsLightToCamera[i] = pdfsFromAncestor[idx];
+            PdfsCameraToLight[i + 2] = pdfsReverseAncestor[idx];
+            PdfNextEvent += pdfsNextEventAncestor[idx]; // All but one are zero, so we are lazy and add them up instead of picking the correct one
+        }
+        PdfsLightToCamera[^2] = pdfsFromAncestor[idx];
         PdfsLightToCamera[^1] = 1;
     }
 
@@ -138,7 +138,7 @@ public class CameraStoringVCM<TLightPathData> : Integrator where TLightPathData
             maxRadius = float.Max(maxRadius, radius);
 
             for (int vertIdx = MergePrimary ? 0 : 1; vertIdx < CameraPaths.Length(pathIdx); ++vertIdx) {
-                ref var vertex = ref CameraPaths[pathIdx, vertIdx];
+                var vertex = CameraPaths[pathIdx, vertIdx];
                 if (vertex.Weight != RgbColor.Black)
                     photonMap.AddPoint(vertex.Point.Position, (pathIdx, vertIdx, radius));
             }
@@ -149,9 +149,21 @@ public class CameraStoringVCM<TLightPathData> : Integrator where TLightPathData
         photonMap.Build();
     }
 
-    public override void Render(Scene scene) => Render(scene, 0);
+    /// <summary>
+    /// Renders the iterations that are not yet in the frame buffer, see <see cref="FrameBuffer.ResumeIteration"/>
+    /// and <see cref="FrameBuffer.IterationLimit"/>
+    /// </summary>
+    public override void Render(Scene scene) {
+        var (firstIteration, endIteration) = GetIterationRange(scene, NumIterations);
+        Render(scene, (int)firstIteration, (int)(endIteration - firstIteration));
+    }
 
-    public void Render(Scene scene, int startAtIteration) {
+    /// <summary>
+    /// Renders <see cref="NumIterations"/> iterations, seeded as if the first one had the given index
+    /// </summary>
+    public void Render(Scene scene, int startAtIteration) => Render(scene, startAtIteration, NumIterations);
+
+    void Render(Scene scene, int startAtIteration, int numIterations) {
         Scene = scene;
         IsolatedPixel = null;
 
@@ -169,6 +181,7 @@ public class CameraStoringVCM<TLightPathData> : Integrator where TLightPathData
         }
 
         if (RenderTechniquePyramid) {
+            // The pyramids are public and may outlive the rendering, so they are not pooled
             TechPyramidRaw = new TechPyramid(scene.FrameBuffer.Width, scene.FrameBuffer.Height,
                                              minDepth: 1, maxDepth: MaxDepth, merges: EnableMerging);
             TechPyramidWeighted = new TechPyramid(scene.FrameBuffer.Width, scene.FrameBuffer.Height,
@@ -179,14 +192,15 @@ public class CameraStoringVCM<TLightPathData> : Integrator where TLightPathData
         photonMap ??= new();
 
         ProgressBar progressBar = new(prefix: "Rendering...");
-        progressBar.Start(NumIterations);
-        RenderTimer timer = new();
+        progressBar.Start(numIterations);
+        RenderTimer timer = MakeRenderTimer(scene);
         Stopwatch lightTracerTimer = new();
         Stopwatch pathTracerTimer = new();
         Stopwatch accelBuildTimer = new();
+        TileScheduler tiles = MakeTileScheduler(scene);
         ShadingStatCounter.Reset();
         scene.Raytracer.ResetStats();
-        for (uint iter = (uint)startAtIteration; iter - startAtIteration < NumIterations; ++iter) {
+        for (uint iter = (uint)startAtIteration; iter - startAtIteration < numIterations; ++iter) {
             long nextIterTime = timer.RenderTime + timer.PerIterationCost;
             if (MaximumRenderTimeMs.HasValue && nextIterTime > MaximumRenderTimeMs.Value) {
                 Logger.Log("Maximum render time exhausted.");
@@ -203,12 +217,10 @@ public class CameraStoringVCM<TLightPathData> : Integrator where TLightPathData
             OnStartIteration(iter);
             try {
                 pathTracerTimer.Start();
-                Parallel.For(0, Scene.FrameBuffer.Height, row => {
-                    for (uint col = 0; col < Scene.FrameBuffer.Width; ++col) {
-                        uint pixelIndex = (uint)(row * Scene.FrameBuffer.Width + col);
-                        var rng = new RNG(BaseSeedCamera, pixelIndex, iter);
-                        TraceCameraPath((uint)row, col, ref rng);
-                    }
+                tiles.Run((col, row) => {
+                    uint pixelIndex = (uint)(row * Scene.FrameBuffer.Width + col);
+                    var rng = new RNG(BaseSeedCamera, pixelIndex, iter);
+                    TraceCameraPath((uint)row, (uint)col, ref rng);
                 });
                 pathTracerTimer.Stop();
 
@@ -239,11 +251,13 @@ public class CameraStoringVCM<TLightPathData> : Integrator where TLightPathData
         }
 
         scene.FrameBuffer.MetaData["RenderTime"] = timer.RenderTime;
-        scene.FrameBuffer.MetaData["FrameBufferTime"] = timer.FrameBufferTime;
+        scene.FrameBuffer.SetFrameBufferTime(timer.FrameBufferTime);
         scene.FrameBuffer.MetaData["PathTracerTime"] = pathTracerTimer.ElapsedMilliseconds;
         scene.FrameBuffer.MetaData["LightTracerTime"] = lightTracerTimer.ElapsedMilliseconds;
         scene.FrameBuffer.MetaData["ShadingStats"] = ShadingStatCounter.Current;
         scene.FrameBuffer.MetaData["RayTracerStats"] = scene.Raytracer.Stats;
+        scene.FrameBuffer.MetaData["TileStats"] = tiles.Stats;
+        scene.FrameBuffer.MetaData["PathCacheStats"] = CameraPaths.Stats;
 
         OnAfterRender();
 
@@ -259,6 +273,7 @@ public class CameraStoringVCM<TLightPathData> : Integrator where TLightPathData
 
         photonMap.Dispose();
         photonMap = null;
+        FramePool.Trim();
     }
 
     /// <summary>
@@ -298,7 +313,7 @@ public class CameraStoringVCM<TLightPathData> : Integrator where TLightPathData
     }
 
     protected virtual void TraceLightPaths(uint iter) {
-        Parallel.For(0, NumLightPaths, idx => {
+        Scene.FrameBuffer.ParallelFor(NumLightPaths, idx => {
             var rng = new RNG(BaseSeedLight, (uint)idx, iter);
             // TODO PERFORMANCE boxing conversion of rng to ISampler causes heap allocation -> measure impact and avoid if necessary
             TraceLightPath(rng, idx, new());
@@ -454,16 +469,15 @@ public class CameraStoringVCM<TLightPathData> : Integrator where TLightPathData
     /// <param name="from">A point on a surface where next event is performed</param>
     /// <param name="primarySelect">Primary sample value used to select the light</param>
     /// <returns>The selected light and the discrete probability of selecting that light</returns>
-    public virtual (Emitter, float) SelectLight(in SurfacePoint from, float primarySelect) {
-        int idx = Math.Clamp((int)(primarySelect * Scene.Emitters.Count), 0, Scene.Emitters.Count - 1);
-        return (Scene.Emitters[idx], 1.0f / Scene.Emitters.Count);
-    }
+    public virtual (Emitter, float) SelectLight(in SurfacePoint from, float primarySelect)
+    => Scene.SampleEmitter(from, primarySelect);
 
     /// <returns>
     /// The discrete probability of selecting the given light when performing next event at the given
     /// shading point.
     /// </returns>
-    public virtual float SelectLightPmf(in SurfacePoint from, Emitter em) => 1.0f / Scene.Emitters.Count;
+    public virtual float SelectLightPmf(in SurfacePoint from, Emitter em)
+    => Scene.EmitterProbability(from, em);
 
     /// <summary>
     /// Samples an emitter and a point on its surface for next event estimation
@@ -474,6 +488,8 @@ public class CameraStoringVCM<TLightPathData> : Integrator where TLightPathData
     /// <returns>The sampled emitter and point on the emitter</returns>
     public virtual (Emitter, SurfaceSample) SampleNextEvent(SurfacePoint from, float primarySelect, Vector2 primary) {
         var (light, lightProb) = SelectLight(from, primarySelect);
+        if (light == null)
+            return (null, new SurfaceSample() { Pdf = 0 });
         var lightSample = light.SampleUniformArea(primary);
         lightSample.Pdf *= lightProb * NumShadowRays;
         return (light, lightSample);
@@ -669,7 +685,7 @@ public class CameraStoringVCM<TLightPathData> : Integrator where TLightPathData
 
         // Compute pdf values
         float pdfEmit = ComputeEmitterPdf(emitter, hit, outDir, reversePdfJacobian);
-        float pdfNextEvent = NextEventPdf(new SurfacePoint(), hit); // TODO get the actual previous point!
+        float pdfNextEvent = state.Vertices.Count > 1 ? NextEventPdf(state.Vertices[^2].Point, hit) : 0;
 
         var pathPdfs = new BidirPathPdfs(stackalloc float[state.Depth], stackalloc float[state.Depth]);
         pathPdfs.GatherCameraPdfs(state, state.Depth - 1);
@@ -1333,9 +1349,9 @@ public class CameraStoringVCM<TLightPathData> : Integrator where TLightPathData
         if (BackgroundProbability > 0 && primarySelect <= BackgroundProbability) {
             return (null, BackgroundProbability);
         } else {
-            float u = (primarySelect - BackgroundProbability) * (1 - BackgroundProbability);
-            var emitter = Scene.Emitters[Math.Clamp((int)(u * Scene.Emitters.Count), 0, Scene.Emitters.Count - 1)];
-            return (emitter, (1 - BackgroundProbability) / Scene.Emitters.Count);
+            float u = (primarySelect - BackgroundProbability) / (1 - BackgroundProbability);
+            var (emitter, prob) = Scene.SampleEmitter(Math.Clamp(u, 0, 1));
+            return (emitter, (1 - BackgroundProbability) * prob);
         }
     }
 
@@ -1348,7 +1364,7 @@ public class CameraStoringVCM<TLightPathData> : Integrator where TLightPathData
         if (em == null) { // background
             return BackgroundProbability;
         } else {
-            return (1 - BackgroundProbability) / Scene.Emitters.Count;
+            return (1 - BackgroundProbability) * Scene.EmitterProbability(em);
         }
     }
 
@@ -64,9 +64,9 @@ public class ClassicBidirBase<CameraPayloadType> : BidirBase<CameraPayloadType>
     public override void Render(Scene scene) {
         if (RenderTechniquePyramid) {
             techPyramidRaw = new TechPyramid(scene.FrameBuffer.Width, scene.FrameBuffer.Height,
-                                             minDepth: 1, maxDepth: MaxDepth, merges: false);
+                                             minDepth: 1, maxDepth: MaxDepth, merges: false, pooled: true);
             techPyramidWeighted = new TechPyramid(scene.FrameBuffer.Width, scene.FrameBuffer.Height,
-                                                  minDepth: 1, maxDepth: MaxDepth, merges: false);
+                                                  minDepth: 1, maxDepth: MaxDepth, merges: false, pooled: true);
         }
 
         if (NumLightPaths > 0 && NumLightPaths != scene.FrameBuffer.Width * scene.FrameBuffer.Height) {
@@ -82,6 +82,9 @@ public class ClassicBidirBase<CameraPayloadType> : BidirBase<CameraPayloadType>
 
             string pathWeighted = Path.Join(scene.FrameBuffer.Basename, "techs-weighted");
             techPyramidWeighted.WriteToFiles(pathWeighted);
+            techPyramidRaw.Release();
+            techPyramidWeighted.Release();
+            FramePool.Trim();
         }
     }
 
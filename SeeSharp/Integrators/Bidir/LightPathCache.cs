@@ -24,7 +24,7 @@ public class LightPathCache {
     /// <summary>
     /// The generated light paths in the current iteration
     /// </summary>
-    protected PathCache PathCache { get; set; }
+    public PathCache PathCache { get; protected set; }
 
     /// <summary>
     /// Randomly samples either the background or an emitter from the scene
@@ -34,8 +34,8 @@ public class LightPathCache {
         if (BackgroundProbability > 0 && rng.NextFloat() <= BackgroundProbability) {
             return (null, BackgroundProbability);
         } else {
-            var emitter = Scene.Emitters[rng.NextInt(Scene.Emitters.Count)];
-            return (emitter, (1 - BackgroundProbability) / Scene.Emitters.Count);
+            var (emitter, prob) = Scene.SampleEmitter(rng.NextFloat());
+            return (emitter, (1 - BackgroundProbability) * prob);
         }
     }
 
@@ -48,7 +48,7 @@ public class LightPathCache {
         if (em == null) { // background
             return BackgroundProbability;
         } else {
-            return (1 - BackgroundProbability) / Scene.Emitters.Count;
+            return (1 - BackgroundProbability) * Scene.EmitterProbability(em);
         }
     }
 
@@ -171,19 +171,19 @@ public class LightPathCache {
     /// </summary>
     /// <param name="func">Delegate invoked on each vertex</param>
     public void ForEachVertex(ProcessVertex func) {
-        Parallel.For(0, PathCache?.NumPaths ?? 0, pathIdx => {
+        Scene.FrameBuffer.ParallelFor(PathCache?.NumPaths ?? 0, pathIdx => {
+            var positions = PathCache.Positions;
             for (int i = 1; i < PathCache.Length(pathIdx); ++i) {
-                var vertex = PathCache.GetPathVertex(pathIdx, i);
-                var ancestor = PathCache.GetPathVertex(pathIdx, i - 1);
-                var dirToAncestor = Vector3.Normalize(ancestor.Point.Position - vertex.Point.Position);
-                func(vertex, ancestor, dirToAncestor);
+                int idx = PathCache.GetPathVertexIndex(pathIdx, i);
+                var dirToAncestor = Vector3.Normalize(positions[idx - 1] - positions[idx]);
+                func(PathCache.GetPathVertex(pathIdx, i), PathCache.GetPathVertex(pathIdx, i - 1), dirToAncestor);
             }
         });
     }
 
-    public ref PathVertex this[int vertexIdx] => ref PathCache.GetVertex(vertexIdx);
+    public PathVertex this[int vertexIdx] => PathCache.GetVertex(vertexIdx);
 
-    public ref PathVertex this[int pathIdx, int vertexIdx] => ref PathCache.GetPathVertex(pathIdx, vertexIdx);
+    public PathVertex this[int pathIdx, int vertexIdx] => PathCache.GetPathVertex(pathIdx, vertexIdx);
 
     /// <returns>The length of the pathIdx'th path</returns>
     public int Length(int pathIdx) => PathCache.Length(pathIdx);
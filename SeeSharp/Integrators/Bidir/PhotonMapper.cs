@@ -1,4 +1,6 @@
-﻿namespace SeeSharp.Integrators.Bidir;
+﻿using System.Linq;
+
+namespace SeeSharp.Integrators.Bidir;
 
 /// <summary>
 /// A pure photon mapper in its most naive form: merging at the first camera vertex with a fixed radius
@@ -15,6 +17,18 @@ public class PhotonMapper : Integrator {
     /// </summary>
     public int MaxNumPhotons = 10;
 
+    /// <summary>
+    /// Acceleration structure used to find the photons.
+    /// </summary>
+    public PhotonMapType MergeAccelerator = PhotonMapType.MortonTree;
+
+    /// <summary>
+    /// If true, all other acceleration structures are built over the same photons and run the same
+    /// queries, so their statistics can be compared side by side in the "MergeAccelStatsAll" metadata.
+    /// Only for benchmarking, as it makes rendering slower.
+    /// </summary>
+    public bool CompareMergeAccelerators = false;
+
     /// <summary>
     /// Number of light paths in each iteration.
     /// </summary>
@@ -40,7 +54,9 @@ public class PhotonMapper : Integrator {
     /// </summary>
     protected LightPathCache lightPaths;
 
-    NearestNeighborSearch<int> photonMap;
+    PhotonMap<(int PathIndex, int VertexIndex)> photonMap;
+    PhotonMap<(int PathIndex, int VertexIndex)>[] comparedMaps;
+    TileScheduler cameraTiles;
 
     /// <inheritdoc />
     public override void Render(Scene scene) {
@@ -56,41 +72,53 @@ public class PhotonMapper : Integrator {
             Scene = scene,
         };
 
-        if (photonMap == null) photonMap = new();
+        if (photonMap == null) photonMap = PhotonMap<(int, int)>.Create(MergeAccelerator);
+        comparedMaps = CompareMergeAccelerators ? PhotonMap<(int, int)>.CreateAllExcept(MergeAccelerator) : null;
+        cameraTiles = MakeTileScheduler(scene);
 
-        for (uint iter = 0; iter < NumIterations; ++iter) {
+        var (firstIteration, endIteration) = GetIterationRange(scene, NumIterations);
+        for (uint iter = firstIteration; iter < endIteration; ++iter) {
             scene.FrameBuffer.StartIteration();
             lightPaths.TraceAllPaths(BaseSeedLight, iter, null);
             ProcessPathCache();
             TraceAllCameraPaths(iter);
             scene.FrameBuffer.EndIteration();
             photonMap.Clear();
+            foreach (var map in comparedMaps ?? [])
+                map.Clear();
         }
 
-        photonMap.Dispose();
+        scene.FrameBuffer.MetaData["TileStats"] = cameraTiles.Stats;
+        scene.FrameBuffer.MetaData["MergeAccelStats"] = photonMap.Stats;
+        if (comparedMaps != null)
+            scene.FrameBuffer.MetaData["MergeAccelStatsAll"] =
+                comparedMaps.Select(m => m.Stats).Prepend(photonMap.Stats).ToArray();
+        if (lightPaths.PathCache != null)
+            scene.FrameBuffer.MetaData["PathCacheStats"] = lightPaths.PathCache.Stats;
+
         photonMap = null;
+        comparedMaps = null;
+        FramePool.Trim();
     }
 
-    List<(int PathIndex, int VertexIndex)> photons = new();
-
     /// <summary>
     /// Builds the photon map from the cached light paths
     /// </summary>
     protected virtual void ProcessPathCache() {
-        int index = 0;
-        photons = new();
-        for (int i = 0; i < lightPaths.NumPaths; ++i) {
-            for (int k = 1; k < lightPaths.Length(i); ++k) {
-                var vertex = lightPaths[i, k];
-                if (vertex.Depth >= 1 && vertex.Weight != RgbColor.Black) {
-                    photonMap.AddPoint(vertex.Point.Position, index++);
-                    photons.Add((i, k));
-                }
-            }
-        }
-        photonMap.Build();
+        BuildPhotonMap(photonMap);
+        foreach (var map in comparedMaps ?? [])
+            BuildPhotonMap(map);
     }
 
+    void BuildPhotonMap(PhotonMap<(int PathIndex, int VertexIndex)> map) {
+        map.MaxQueryRadius = MaxRadius;
+        map.Build(lightPaths.PathCache,
+            (in PathVertex vertex) => vertex.Depth >= 1 && vertex.Weight != RgbColor.Black,
+            (pathIdx, vertIdx) => (pathIdx, vertIdx));
+    }
+
+    float MaxRadius => scene.Radius / 1000.0f;
+
     RgbColor Merge(float radius, SurfacePoint hit, Vector3 outDir, int pathIdx, int vertIdx, float distSqr,
                    float radiusSquared) {
         // Compute the contribution of the photon
@@ -121,16 +149,18 @@ public class PhotonMapper : Integrator {
             return scene.Background?.EmittedRadiance(ray.Direction) ?? RgbColor.Black;
 
         // Gather nearby photons
-        float radius = scene.Radius / 1000.0f;
+        float radius = MaxRadius;
         float footprint = hit.Distance * MathF.Tan(0.1f * MathF.PI / 180);
         radius = MathF.Min(footprint, radius);
 
         RgbColor estimate = RgbColor.Black;
-        photonMap.ForAllNearest(hit.Position, int.MaxValue, radius, (position, idx, distance, numFound, maxDist) => {
+        photonMap.ForAllNearest(hit.Position, int.MaxValue, radius, (position, photon, distance, numFound, maxDist) => {
             float radiusSquared = numFound == MaxNumPhotons ? maxDist * maxDist : radius * radius;
-            estimate += Merge(radius, hit, -ray.Direction, photons[idx].PathIndex, photons[idx].VertexIndex,
+            estimate += Merge(radius, hit, -ray.Direction, photon.PathIndex, photon.VertexIndex,
                 distance * distance, radius * radius);
         });
+        foreach (var map in comparedMaps ?? [])
+            map.CountNearest(hit.Position, int.MaxValue, radius);
 
         // Add contribution from directly visible light sources
         var light = scene.QueryEmitter(hit);
@@ -151,13 +181,10 @@ public class PhotonMapper : Integrator {
     }
 
     private void TraceAllCameraPaths(uint iter) {
-        Parallel.For(0, scene.FrameBuffer.Height,
-            row => {
-                var rng = new RNG(BaseSeedCamera, (uint)row, iter);
-                for (uint col = 0; col < scene.FrameBuffer.Width; ++col) {
-                    RenderPixel((uint)row, col, ref rng);
-                }
-            }
-        );
+        cameraTiles.Run((col, row) => {
+            uint pixelIndex = (uint)(row * scene.FrameBuffer.Width + col);
+            var rng = new RNG(BaseSeedCamera, pixelIndex, iter);
+            RenderPixel((uint)row, (uint)col, ref rng);
+        });
     }
 }
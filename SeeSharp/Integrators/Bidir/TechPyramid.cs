@@ -18,10 +18,15 @@ public class TechPyramid {
     /// <param name="merges">If false, ignores merging techniques</param>
     /// <param name="connections">If false, ignores connections</param>
     /// <param name="lightTracer">If false, ignores light tracing</param>
+    /// <param name="pooled">
+    /// If true, the images are rented from the <see cref="FramePool" /> and must be returned via
+    /// <see cref="Release" />. Only use this if the pyramid is not handed out to callers.
+    /// </param>
     public TechPyramid(int width, int height, int minDepth, int maxDepth, bool merges,
-                       bool connections = true, bool lightTracer = true) {
+                       bool connections = true, bool lightTracer = true, bool pooled = false) {
         this.maxDepth = maxDepth;
         this.minDepth = minDepth;
+        this.pooled = pooled;
 
         // Generate the filenames
         techniqueNames = [];
@@ -67,10 +72,21 @@ public class TechPyramid {
         // Create an image for every technique
         techniqueImages = [];
         foreach (var tech in techniqueNames) {
-            techniqueImages[tech.Key] = new RgbImage(width, height);
+            techniqueImages[tech.Key] = pooled ? FramePool.RentRgb(width, height) : new RgbImage(width, height);
         }
     }
 
+    /// <summary>
+    /// Returns the images of a pooled pyramid to the <see cref="FramePool" />, so the next pyramid of the
+    /// same size can reuse them. The pyramid must not be used afterwards. Does nothing if not pooled.
+    /// </summary>
+    public void Release() {
+        if (!pooled) return;
+        foreach (var (_, image) in techniqueImages)
+            FramePool.Return(image);
+        techniqueImages.Clear();
+    }
+
     /// <summary>
     /// Logs a sample to the pyramid. Identifies the technique based on the edge counts.
     /// </summary>
@@ -108,6 +124,7 @@ public class TechPyramid {
     readonly TechniqueNames techniqueNames;
     readonly Dictionary<(int, int, int), RgbImage> techniqueImages;
     readonly int minDepth, maxDepth;
+    readonly bool pooled;
 
     public IEnumerable<(string, Image)> GetImagesForPathLength(int totalEdges) {
         List<(string, Image)> images = [];
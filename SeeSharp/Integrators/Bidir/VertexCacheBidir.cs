@@ -103,9 +103,9 @@ public class VertexCacheBidirBase<CameraPayloadType> : BidirBase<CameraPayloadTy
     public override void Render(Scene scene) {
         if (RenderTechniquePyramid) {
             techPyramidRaw = new TechPyramid(scene.FrameBuffer.Width, scene.FrameBuffer.Height,
-                                             minDepth: 1, maxDepth: MaxDepth, merges: false);
+                                             minDepth: 1, maxDepth: MaxDepth, merges: false, pooled: true);
             techPyramidWeighted = new TechPyramid(scene.FrameBuffer.Width, scene.FrameBuffer.Height,
-                                                  minDepth: 1, maxDepth: MaxDepth, merges: false);
+                                                  minDepth: 1, maxDepth: MaxDepth, merges: false, pooled: true);
         }
 
         base.Render(scene);
@@ -115,6 +115,9 @@ public class VertexCacheBidirBase<CameraPayloadType> : BidirBase<CameraPayloadTy
                 techPyramidRaw.WriteToFiles(Path.Join(scene.FrameBuffer.Basename, "techs-raw"));
             if (!string.IsNullOrEmpty(scene.FrameBuffer.Basename))
                 techPyramidWeighted.WriteToFiles(Path.Join(scene.FrameBuffer.Basename, "techs-weighted"));
+            techPyramidRaw.Release();
+            techPyramidWeighted.Release();
+            FramePool.Trim();
         }
     }
 
@@ -152,11 +155,8 @@ public class VertexCacheBidirBase<CameraPayloadType> : BidirBase<CameraPayloadTy
         }
 
         // Perform connections if the maximum depth has not yet been reached
-        if (depth < MaxDepth) {
-            for (int i = 0; i < NumConnections; ++i) {
-                value += throughput * BidirConnections(shader, ref rng, ref path, toAncestorJacobian);
-            }
-        }
+        if (depth < MaxDepth && NumConnections > 0)
+            value += throughput * BidirConnections(shader, ref rng, ref path, toAncestorJacobian, NumConnections);
 
         if (depth < MaxDepth && depth + 1 >= MinDepth) {
             for (int i = 0; i < NumShadowRays; ++i) {
@@ -28,6 +28,18 @@ public class VertexConnectionAndMergingBase<CameraPayloadType>
     /// </summary>
     public int MaxNumPhotons = 8;
 
+    /// <summary>
+    /// Acceleration structure used to find the photons for merging.
+    /// </summary>
+    public PhotonMapType MergeAccelerator = PhotonMapType.MortonTree;
+
+    /// <summary>
+    /// If true, all other acceleration structures are built over the same photons and run the same
+    /// queries, so their statistics can be compared side by side in the "MergeAccelStatsAll" metadata.
+    /// Only for benchmarking, as it makes rendering slower.
+    /// </summary>
+    public bool CompareMergeAccelerators = false;
+
     public TechPyramid TechPyramidRaw;
     public TechPyramid TechPyramidWeighted;
 
@@ -37,14 +49,13 @@ public class VertexConnectionAndMergingBase<CameraPayloadType>
     public float MaximumRadius { get; protected set; }
 
     /// <summary>
-    /// Indices of the photons in the scene. To be used in conjunction with <see cref="photonMap"/>
+    /// Acceleration structure to query photons in the scene. Stores the path and vertex index of each
+    /// photon in the <see cref="BidirBase{CameraPayloadType}.PathCache" />.
     /// </summary>
-    protected List<(int PathIndex, int VertexIndex)> photons = new();
+    protected PhotonMap<(int, int)> photonMap;
 
-    /// <summary>
-    /// Acceleration structure to query photons in the scene.
-    /// </summary>
-    protected NearestNeighborSearch<(int, int)> photonMap;
+    /// <summary> Other acceleration structures if <see cref="CompareMergeAccelerators"/> is set </summary>
+    PhotonMap<(int, int)>[] comparedMaps;
 
     ThreadLocal<ulong> totalCamPathLen;
     ThreadLocal<ulong> totalMergeOps;
@@ -155,6 +166,10 @@ public class VertexConnectionAndMergingBase<CameraPayloadType>
         Scene.FrameBuffer.MetaData["AverageLightPathLength"] = AverageLightPathLength;
         Scene.FrameBuffer.MetaData["AveragePhotonsPerQuery"] = AveragePhotonsPerQuery;
         Scene.FrameBuffer.MetaData["MergeAccelBuildTime"] = mergeBuildTimer.ElapsedMilliseconds;
+        Scene.FrameBuffer.MetaData["MergeAccelStats"] = photonMap.Stats;
+        if (comparedMaps != null)
+            Scene.FrameBuffer.MetaData["MergeAccelStatsAll"] =
+                comparedMaps.Select(m => m.Stats).Prepend(photonMap.Stats).ToArray();
     }
 
     protected override void OnBeforeRender()
@@ -219,6 +234,7 @@ public class VertexConnectionAndMergingBase<CameraPayloadType>
     {
         if (RenderTechniquePyramid)
         {
+            // The pyramids are public and may outlive the rendering, so they are not pooled
             TechPyramidRaw = new TechPyramid(
                 scene.FrameBuffer.Width,
                 scene.FrameBuffer.Height,
@@ -238,7 +254,8 @@ public class VertexConnectionAndMergingBase<CameraPayloadType>
         InitializeRadius(scene);
 
         if (photonMap == null)
-            photonMap = new();
+            photonMap = PhotonMap<(int, int)>.Create(MergeAccelerator);
+        comparedMaps = CompareMergeAccelerators ? PhotonMap<(int, int)>.CreateAllExcept(MergeAccelerator) : null;
 
         base.Render(scene);
 
@@ -258,8 +275,8 @@ public class VertexConnectionAndMergingBase<CameraPayloadType>
                 );
         }
 
-        photonMap.Dispose();
         photonMap = null;
+        comparedMaps = null;
     }
 
     Stopwatch mergeBuildTimer;
@@ -275,19 +292,24 @@ public class VertexConnectionAndMergingBase<CameraPayloadType>
         {
             mergeBuildTimer.Start();
 
-            photonMap.Clear();
-            for (int pathIdx = 0; pathIdx < NumLightPaths; ++pathIdx)
-            {
-                for (int vertIdx = 1; vertIdx < PathCache.Length(pathIdx); ++vertIdx)
-                {
-                    ref var vertex = ref PathCache[pathIdx, vertIdx];
-                    if (vertex.Weight != RgbColor.Black)
-                        photonMap.AddPoint(vertex.Point.Position, (pathIdx, vertIdx));
-                }
-            }
-            photonMap.Build();
+            photonMap.MaxQueryRadius = MaximumRadius;
+            photonMap.Build(
+                PathCache,
+                (in PathVertex vertex) => vertex.Weight != RgbColor.Black,
+                (pathIdx, vertIdx) => (pathIdx, vertIdx)
+            );
 
             mergeBuildTimer.Stop();
+
+            foreach (var map in comparedMaps ?? [])
+            {
+                map.MaxQueryRadius = MaximumRadius;
+                map.Build(
+                    PathCache,
+                    (in PathVertex vertex) => vertex.Weight != RgbColor.Black,
+                    (pathIdx, vertIdx) => (pathIdx, vertIdx)
+                );
+            }
         }
     }
 
@@ -487,6 +509,8 @@ public class VertexConnectionAndMergingBase<CameraPayloadType>
             MergeHelper,
             ref state
         );
+        foreach (var map in comparedMaps ?? [])
+            map.CountNearest(shader.Point.Position, MaxNumPhotons, localRadius);
         OnCombinedMergeSample(shader, ref rng, ref path, cameraJacobian, state.Estimate);
         return state.Estimate;
     }
@@ -552,10 +576,11 @@ public class VertexConnectionAndMergingBase<CameraPayloadType>
         // Perform connections and merging if the maximum depth has not yet been reached
         if (depth < MaxDepth)
         {
-            for (int i = 0; i < NumConnections; ++i)
+            if (NumConnections > 0)
             {
                 value +=
-                    throughput * BidirConnections(shader, ref rng, ref path, toAncestorJacobian);
+                    throughput
+                    * BidirConnections(shader, ref rng, ref path, toAncestorJacobian, NumConnections);
             }
             value += throughput * PerformMerging(shader, ref rng, ref path, toAncestorJacobian);
         }
@@ -0,0 +1,120 @@
+namespace SeeSharp.Integrators.Common;
+
+/// <summary>
+/// Photon map that bins the points into a uniform grid with a cell size of twice the
+/// <see cref="PhotonMap{T}.MaxQueryRadius" />. Cells are hashed into a table with (at least) one bucket
+/// per point. The build is a parallel counting sort of the points by bucket, so each bucket is a
+/// contiguous range in memory. The bounding box of a query within the maximum radius is at most one cell
+/// wide, so the query visits at most the 2x2x2 cells that overlap it. Much larger queries fall back to
+/// testing all points, which is logged once per build.
+/// </summary>
+/// <typeparam name="T">User data stored with each point</typeparam>
+public class HashGridPhotonMap<T> : PhotonMap<T> {
+    /// <inheritdoc />
+    public override string Backend => "HashGrid";
+
+    /// <summary> Edge length of the grid cells, set by the last build </summary>
+    public float CellSize { get; private set; }
+
+    /// <inheritdoc />
+    protected override void BuildStructure() {
+        int n = NumPoints;
+
+        Box bounds = ComputeBounds();
+        origin = bounds.Min;
+        CellSize = 2 * MaxQueryRadius;
+        if (CellSize <= 0) {
+            // Aim for a handful of points per cell if the points were uniformly distributed
+            Vector3 extent = bounds.Max - bounds.Min;
+            float maxExtent = MathF.Max(extent.X, MathF.Max(extent.Y, extent.Z));
+            CellSize = maxExtent / MathF.Cbrt(MathF.Max(n / 4.0f, 1.0f));
+            if (CellSize <= 0) CellSize = 1;
+        }
+        invCellSize = 1.0f / CellSize;
+        warnedFullScan = 0;
+
+        tableBits = Math.Max(BitOperations.Log2(BitOperations.RoundUpToPowerOf2((uint)n)), 1);
+        int tableSize = 1 << tableBits;
+        if (cellStart.Length < tableSize) {
+            cellStart = new int[tableSize];
+            cellEnd = new int[tableSize];
+        }
+
+        ParallelChunks(n, (begin, end) => {
+            for (int i = begin; i < end; ++i) {
+                var (x, y, z) = CellOf(new(posX[i], posY[i], posZ[i]));
+                keys[i] = Hash(x, y, z);
+            }
+        });
+
+        SortPointsByKey(tableBits);
+
+        // Find the range of each bucket in the sorted keys. Empty buckets keep an empty range.
+        ParallelChunks(tableSize, (begin, end) => {
+            Array.Clear(cellStart, begin, end - begin);
+            Array.Clear(cellEnd, begin, end - begin);
+        });
+        ParallelChunks(n, (begin, end) => {
+            for (int i = begin; i < end; ++i) {
+                ulong key = keys[i];
+                if (i == 0 || keys[i - 1] != key) cellStart[key] = i;
+                if (i == n - 1 || keys[i + 1] != key) cellEnd[key] = i + 1;
+            }
+        });
+    }
+
+    [ThreadStatic] static uint[] bucketBuffer;
+
+    /// <inheritdoc />
+    protected override void Collect(Vector3 pos, float radius, ref NearestSet set) {
+        var (minX, minY, minZ) = CellOf(pos - new Vector3(radius));
+        var (maxX, maxY, maxZ) = CellOf(pos + new Vector3(radius));
+
+        long numCells = (long)(maxX - minX + 1) * (maxY - minY + 1) * (maxZ - minZ + 1);
+        if (numCells > 1 << tableBits) {
+            // The radius is much larger than the cells, testing all points is cheaper
+            if (Interlocked.Exchange(ref warnedFullScan, 1) == 0)
+                Logger.Warning($"Photon map query radius {radius} is much larger than the maximum of " +
+                    $"{MaxQueryRadius}, testing all points. Further queries like this are not reported until " +
+                    "the next build.");
+            ScanRange(0, NumPoints, pos, ref set);
+            return;
+        }
+
+        if (bucketBuffer == null || bucketBuffer.Length < numCells)
+            bucketBuffer = new uint[Math.Max(numCells, 8)];
+        var buckets = bucketBuffer.AsSpan(0, (int)numCells);
+        int num = 0;
+        for (int z = minZ; z <= maxZ; ++z)
+            for (int y = minY; y <= maxY; ++y)
+                for (int x = minX; x <= maxX; ++x)
+                    buckets[num++] = Hash(x, y, z);
+
+        // Visiting the buckets in order walks the point arrays front to back. Different cells can share a
+        // bucket, which must only be visited once.
+        buckets.Sort();
+        for (int i = 0; i < num; ++i) {
+            if (i > 0 && buckets[i] == buckets[i - 1]) continue;
+            ScanRange(cellStart[buckets[i]], cellEnd[buckets[i]], pos, ref set);
+        }
+    }
+
+    (int, int, int) CellOf(Vector3 pos) {
+        Vector3 c = (pos - origin) * invCellSize;
+        c = Vector3.Clamp(c, new(-MaxCellCoordinate), new(MaxCellCoordinate));
+        return ((int)MathF.Floor(c.X), (int)MathF.Floor(c.Y), (int)MathF.Floor(c.Z));
+    }
+
+    uint Hash(int x, int y, int z) {
+        uint h = ((uint)x * 73856093u) ^ ((uint)y * 19349663u) ^ ((uint)z * 83492791u);
+        return (h ^ (h >> tableBits)) & ((1u << tableBits) - 1);
+    }
+
+    const float MaxCellCoordinate = 1 << 30;
+
+    Vector3 origin;
+    float invCellSize;
+    int tableBits;
+    int[] cellStart = [], cellEnd = [];
+    int warnedFullScan;
+}
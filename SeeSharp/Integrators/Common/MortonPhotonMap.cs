@@ -0,0 +1,121 @@
+namespace SeeSharp.Integrators.Common;
+
+/// <summary>
+/// Photon map that sorts the points along a Morton curve with a parallel radix sort and groups them into
+/// small leaves. An implicit binary tree over the leaf bounds answers k-nearest neighbor queries within a
+/// maximum radius.
+/// </summary>
+/// <typeparam name="T">User data stored with each point</typeparam>
+public class MortonPhotonMap<T> : PhotonMap<T> {
+    /// <summary> Maximum number of points in a leaf of the search tree </summary>
+    public const int LeafSize = 8;
+
+    /// <inheritdoc />
+    public override string Backend => "MortonTree";
+
+    /// <inheritdoc />
+    protected override void BuildStructure() {
+        int n = NumPoints;
+        numLeaves = (n + LeafSize - 1) / LeafSize;
+
+        // Quantize the positions within the bounding box of all points and compute their Morton codes
+        Box bounds = ComputeBounds();
+        Vector3 extent = Vector3.Max(bounds.Max - bounds.Min, new Vector3(1e-20f));
+        Vector3 scale = new Vector3(MortonResolution - 1) / extent;
+        ParallelChunks(n, (begin, end) => {
+            for (int i = begin; i < end; ++i) {
+                Vector3 p = (new Vector3(posX[i], posY[i], posZ[i]) - bounds.Min) * scale;
+                keys[i] = MortonCode((uint)p.X, (uint)p.Y, (uint)p.Z);
+            }
+        });
+
+        // Each leaf is now a contiguous range in memory
+        SortPointsByKey(3 * MortonBits);
+
+        BuildTree();
+    }
+
+    [ThreadStatic] static int[] stackBuffer;
+
+    /// <inheritdoc />
+    protected override void Collect(Vector3 pos, float radius, ref NearestSet set) {
+        stackBuffer ??= new int[64];
+        var stack = stackBuffer;
+        int stackSize = 0;
+        stack[stackSize++] = 1;
+        while (stackSize > 0) {
+            int node = stack[--stackSize];
+            if (nodes[node].DistanceSquared(pos) > set.MaxDistSqr)
+                continue;
+
+            if (node >= numInnerNodes) { // leaf
+                int begin = (node - numInnerNodes) * LeafSize;
+                ScanRange(begin, Math.Min(begin + LeafSize, NumPoints), pos, ref set);
+                continue;
+            }
+
+            // Visit the closer child first (pushed last)
+            int left = 2 * node, right = left + 1;
+            if (stackSize + 2 > stack.Length) {
+                Array.Resize(ref stackBuffer, stack.Length * 2);
+                stack = stackBuffer;
+            }
+            if (nodes[left].DistanceSquared(pos) < nodes[right].DistanceSquared(pos)) {
+                stack[stackSize++] = right;
+                stack[stackSize++] = left;
+            } else {
+                stack[stackSize++] = left;
+                stack[stackSize++] = right;
+            }
+        }
+    }
+
+    /// <summary>
+    /// Computes the bounds of all leaves, and of the inner nodes of a complete binary tree over the leaves.
+    /// Node 1 is the root, the children of node i are 2i and 2i+1. Missing leaves have empty bounds.
+    /// </summary>
+    void BuildTree() {
+        numInnerNodes = (int)BitOperations.RoundUpToPowerOf2((uint)numLeaves);
+        int numNodes = 2 * numInnerNodes;
+        if (nodes.Length < numNodes)
+            nodes = new Box[numNodes];
+
+        ParallelChunks(numInnerNodes, (begin, end) => {
+            for (int leaf = begin; leaf < end; ++leaf) {
+                Box box = Box.Empty;
+                int first = leaf * LeafSize;
+                int last = Math.Min(first + LeafSize, NumPoints);
+                for (int i = first; i < last; ++i)
+                    box = box.Grow(new(posX[i], posY[i], posZ[i]));
+                nodes[numInnerNodes + leaf] = box;
+            }
+        });
+
+        // Bottom-up, one level at a time
+        for (int levelBegin = numInnerNodes / 2; levelBegin >= 1; levelBegin /= 2) {
+            int levelStart = levelBegin;
+            ParallelChunks(levelBegin, (begin, end) => {
+                for (int i = levelStart + begin; i < levelStart + end; ++i)
+                    nodes[i] = nodes[2 * i].Grow(nodes[2 * i + 1]);
+            });
+        }
+    }
+
+    const int MortonBits = 16;
+    const uint MortonResolution = 1u << MortonBits;
+
+    static ulong MortonCode(uint x, uint y, uint z) {
+        static ulong Spread(uint v) {
+            ulong r = v & 0xFFFF;
+            r = (r | (r << 16)) & 0x0000FF0000FFul;
+            r = (r | (r << 8)) & 0x00F00F00F00Ful;
+            r = (r | (r << 4)) & 0x0C30C30C30C3ul;
+            r = (r | (r << 2)) & 0x249249249249ul;
+            return r;
+        }
+        return Spread(x) | (Spread(y) << 1) | (Spread(z) << 2);
+    }
+
+    int numLeaves, numInnerNodes;
+    Box[] nodes = [];
+}
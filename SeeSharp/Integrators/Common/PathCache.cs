@@ -1,96 +1,356 @@
+using System.Collections.Concurrent;
+using System.Runtime.CompilerServices;
+
 namespace SeeSharp.Integrators.Common;
 
 /// <summary>
-/// Stores a set of paths consisting of vertices. The capacity is pre-determined. If not all vertices of a
-/// path fit in the cache, they are discared and the next iteration uses a bigger cache.
+/// Memory statistics of a <see cref="PathCache" />
+/// </summary>
+/// <param name="NumSlabs">Number of fixed-size slabs that are currently allocated</param>
+/// <param name="AllocatedBytes">Total size of all slabs</param>
+/// <param name="UsedBytes">Size of the vertices that were committed since the last clear</param>
+/// <param name="PeakUsedBytes">Largest <paramref name="UsedBytes" /> of any iteration so far</param>
+public record struct PathCacheStats(int NumSlabs, long AllocatedBytes, long UsedBytes, long PeakUsedBytes);
+
+/// <summary>
+/// Stores a set of paths consisting of vertices. Memory is allocated in fixed-size slabs that are kept
+/// and reused across iterations. Each thread reserves chunks of consecutive vertices from the slabs and
+/// fills them without synchronization. If the slabs run out, a new one is added, so committing a path
+/// never fails and the memory grows in small steps instead of being reallocated as a whole.
+///
+/// The vertices are stored in compact structure-of-arrays layout: each attribute of a
+/// <see cref="PathVertex" /> lives in its own array per slab, meshes are referenced by an integer id, and
+/// roughness values are stored with half precision. Normals and directions stay in full precision, because
+/// they enter the jacobians and pdfs of the MIS weights, which must match the camera side exactly. Loops that only need a few attributes
+/// (e.g., positions or pdfs) can stream over the columns directly, indexed by
+/// <see cref="GetPathVertexIndex" />. The indexers assemble a full <see cref="PathVertex" /> on the fly.
 /// </summary>
 public class PathCache {
-    PathVertex[] memory;
+    const int SlabShift = 16;
+    const int SlabSize = 1 << SlabShift;
+    const int SlabMask = SlabSize - 1;
+
+    /// <summary>
+    /// Number of vertices that a thread reserves at once. Divides the slab size, so chunks never straddle
+    /// two slabs.
+    /// </summary>
+    const int ChunkSize = 1024;
+
     int next = 0;
     int[] pathIndices;
     int[] pathLengths;
     int[] cumPathLen;
+    (int Offset, int PathIdx)[] vertexIndex = [];
+
+    /// <summary>
+    /// The range of vertices that a thread currently fills. Chunks from before the last
+    /// <see cref="Clear" /> are recognized by their outdated generation.
+    /// </summary>
+    class Chunk {
+        public int Next, End, Generation = -1;
+    }
+    readonly ThreadLocal<Chunk> chunks = new(() => new());
+    int generation = 0;
+
+    int numSlabs = 0;
+    readonly object slabLock = new();
+    long peakUsedBytes = 0;
 
     public PathCache(int numPaths, int expectedPathLength) {
         NumPaths = numPaths;
         pathIndices = new int[numPaths];
         pathLengths = new int[numPaths];
         cumPathLen = new int[numPaths];
-        memory = new PathVertex[numPaths * expectedPathLength];
+        EnsureSlabs((int)(((long)numPaths * expectedPathLength + SlabSize - 1) >> SlabShift));
     }
 
     /// <returns>
-    /// A reference to the vertexIdx'th vertex along the pathIdx'th path
+    /// The vertexIdx'th vertex along the pathIdx'th path
     /// </returns>
-    public ref PathVertex GetPathVertex(int pathIdx, int vertexIdx) {
-        int p = pathIndices[pathIdx];
-        return ref memory[p + vertexIdx];
-    }
+    public PathVertex GetPathVertex(int pathIdx, int vertexIdx) => Unpack(GetPathVertexIndex(pathIdx, vertexIdx));
 
-    public ref PathVertex this[int PathIdx, int VertexIdx] => ref GetPathVertex(PathIdx, VertexIdx);
+    public PathVertex this[int PathIdx, int VertexIdx] => GetPathVertex(PathIdx, VertexIdx);
 
     /// <returns>
-    /// The global vertex index of the vertexIdx'th vertex along the pathIdx'th path
+    /// The index of the vertexIdx'th vertex along the pathIdx'th path in the attribute columns, like
+    /// <see cref="Positions" />. The vertices of a path are consecutive, so the ancestor of a vertex is at
+    /// the previous index.
     /// </returns>
     public int GetPathVertexIndex(int pathIdx, int vertexIdx) => pathIndices[pathIdx] + vertexIdx;
 
     /// <returns>
-    /// A reference to the a vertex identified by its global index in the entire cache
+    /// A vertex identified by its global index in the entire cache. Only valid after <see cref="Prepare" />.
     /// </returns>
-    public ref PathVertex GetVertex(int globalVertexIdx) {
-        int idx = Array.BinarySearch(cumPathLen, globalVertexIdx);
-        int vertexMemoryIdx;
-        if (idx < 0) {
-            idx = ~idx;
-            int offset = globalVertexIdx - (idx == 0 ? 0 : cumPathLen[idx - 1]);
-            vertexMemoryIdx = pathIndices[idx] + offset;
-        } else {
-            // Skip empty paths in-between
-            do idx++;
-            while (pathIndices[idx] == -1);
-            vertexMemoryIdx = pathIndices[idx];
-        }
-        return ref memory[vertexMemoryIdx];
+    public PathVertex GetVertex(int globalVertexIdx) => Unpack(vertexIndex[globalVertexIdx].Offset);
+
+    /// <returns>
+    /// The index of a vertex in the attribute columns, like <see cref="Positions" />, given its global index
+    /// in the entire cache. Only valid after <see cref="Prepare" />.
+    /// </returns>
+    public int GetVertexOffset(int globalVertexIdx) => vertexIndex[globalVertexIdx].Offset;
+
+    /// <returns>
+    /// The index of the path that contains the vertex with the given global index, and the index of the
+    /// vertex along that path. Only valid after <see cref="Prepare" />.
+    /// </returns>
+    public (int PathIdx, int VertexIdx) GetVertexPath(int globalVertexIdx) {
+        var (offset, pathIdx) = vertexIndex[globalVertexIdx];
+        return (pathIdx, offset - pathIndices[pathIdx]);
     }
 
-    public ref PathVertex this[int GlobalVertexIdx] => ref GetVertex(GlobalVertexIdx);
+    public PathVertex this[int GlobalVertexIdx] => GetVertex(GlobalVertexIdx);
 
     public int NumVertices => cumPathLen[NumPaths - 1];
     public int NumPaths { get; init; }
 
-    bool overflow = false;
+    /// <summary>
+    /// Read-only view of one attribute of all vertices. The index is split into a slab and a position
+    /// within that slab, so each access costs one more indirection than a flat array.
+    /// </summary>
+    public readonly struct Column<T>(T[][] slabs) {
+        public T this[int idx] => slabs[idx >> SlabShift][idx & SlabMask];
+    }
+
+    /// <summary> Positions of all vertices, see <see cref="GetPathVertexIndex" /> </summary>
+    public Column<Vector3> Positions => new(positions);
+
+    /// <summary> Accumulated path weights of all vertices, see <see cref="GetPathVertexIndex" /> </summary>
+    public Column<RgbColor> Weights => new(weights);
+
+    /// <summary> <see cref="PathVertex.PdfFromAncestor" /> of all vertices </summary>
+    public Column<float> PdfsFromAncestor => new(pdfsFromAncestor);
+
+    /// <summary> <see cref="PathVertex.PdfReverseAncestor" /> of all vertices </summary>
+    public Column<float> PdfsReverseAncestor => new(pdfsReverseAncestor);
+
+    /// <summary> <see cref="PathVertex.PdfNextEventAncestor" /> of all vertices </summary>
+    public Column<float> PdfsNextEventAncestor => new(pdfsNextEventAncestor);
+
+    /// <summary>
+    /// Memory statistics, the used bytes are updated by <see cref="Prepare" />
+    /// </summary>
+    public PathCacheStats Stats => new(numSlabs, (long)numSlabs * SlabSize * BytesPerVertex,
+        (NumPaths > 0 ? NumVertices : 0) * (long)BytesPerVertex, peakUsedBytes);
 
     public int Length(int pathIdx) => pathLengths[pathIdx];
 
     public void Commit(int pathIdx, ReadOnlySpan<PathVertex> vertices) {
         if (vertices.Length > 0) {
-            pathIndices[pathIdx] = Interlocked.Add(ref next, vertices.Length) - vertices.Length;
+            if (vertices.Length > SlabSize)
+                throw new ArgumentException($"Paths with more than {SlabSize} vertices are not supported");
+
+            int offset = Reserve(vertices.Length);
+            for (int i = 0; i < vertices.Length; ++i)
+                Pack(offset + i, vertices[i]);
+            pathIndices[pathIdx] = offset;
             pathLengths[pathIdx] = vertices.Length;
-            if (pathIndices[pathIdx] + vertices.Length >= memory.Length) {
-                overflow = true;
-                pathLengths[pathIdx] = 0;
-                pathIndices[pathIdx] = -1;
-            } else
-                vertices.CopyTo(memory.AsSpan(pathIndices[pathIdx], vertices.Length));
         } else {
             pathIndices[pathIdx] = -1;
             pathLengths[pathIdx] = 0;
         }
     }
 
+    /// <summary>
+    /// Removes all paths. The slabs are kept and refilled by the next commits.
+    /// </summary>
     public void Clear() {
         next = 0;
-        if (overflow) {
-            Logger.Warning("Overflow occured in the path cache, consider using a larger initial size.");
-            memory = new PathVertex[memory.Length * 2];
+        generation++;
+    }
+
+    /// <returns>
+    /// The offset of a range of consecutive vertices within a single slab, taken from the chunk of the
+    /// calling thread if it fits
+    /// </returns>
+    int Reserve(int count) {
+        if (count > ChunkSize)
+            return ReserveRange(count);
+
+        var chunk = chunks.Value;
+        if (chunk.Generation != generation || chunk.Next + count > chunk.End) {
+            chunk.Next = ReserveRange(ChunkSize);
+            chunk.End = chunk.Next + ChunkSize;
+            chunk.Generation = generation;
+        }
+        int offset = chunk.Next;
+        chunk.Next += count;
+        return offset;
+    }
+
+    /// <returns>
+    /// The offset of a range of consecutive vertices that is shared with no other thread. Skips to the
+    /// next slab if the range does not fit in the current one, and adds slabs as needed.
+    /// </returns>
+    int ReserveRange(int count) {
+        int start, begin;
+        do {
+            start = Volatile.Read(ref next);
+            begin = (start & SlabMask) + count > SlabSize ? ((start >> SlabShift) + 1) << SlabShift : start;
+        } while (Interlocked.CompareExchange(ref next, begin + count, start) != start);
+
+        EnsureSlabs(((begin + count - 1) >> SlabShift) + 1);
+        return begin;
+    }
+
+    /// <summary>
+    /// Adds slabs until there are at least the given number. The tables of slabs are copied on growth,
+    /// so threads that still hold the old ones continue to see the same slabs.
+    /// </summary>
+    void EnsureSlabs(int count) {
+        if (Volatile.Read(ref numSlabs) >= count) return;
+        lock (slabLock) {
+            if (numSlabs >= count) return;
+            AddSlabs(ref positions, count);
+            AddSlabs(ref normals, count);
+            AddSlabs(ref barycentricCoords, count);
+            AddSlabs(ref meshIds, count);
+            AddSlabs(ref primIds, count);
+            AddSlabs(ref errorOffsets, count);
+            AddSlabs(ref distances, count);
+            AddSlabs(ref pdfsFromAncestor, count);
+            AddSlabs(ref pdfsReverseAncestor, count);
+            AddSlabs(ref pdfsNextEventAncestor, count);
+            AddSlabs(ref dirsToAncestor, count);
+            AddSlabs(ref jacobiansToAncestor, count);
+            AddSlabs(ref weights, count);
+            AddSlabs(ref pathIds, count);
+            AddSlabs(ref depths, count);
+            AddSlabs(ref maximumRoughness, count);
+            AddSlabs(ref flags, count);
+            Volatile.Write(ref numSlabs, count);
         }
     }
 
+    static void AddSlabs<T>(ref T[][] slabs, int count) {
+        var table = new T[count][];
+        int old = slabs?.Length ?? 0;
+        if (old > 0) Array.Copy(slabs, table, old);
+        for (int i = old; i < count; ++i)
+            table[i] = new T[SlabSize];
+        Volatile.Write(ref slabs, table);
+    }
+
+    /// <summary>
+    /// Computes the global index of each vertex, must be called after all paths have been committed.
+    /// The global indices enumerate the vertices path by path, without gaps. Afterwards, each global index
+    /// maps to a memory offset in constant time.
+    /// </summary>
     public void Prepare() {
         int sum = 0;
         for (int i = 0; i < NumPaths; ++i) {
             sum += pathLengths[i];
             cumPathLen[i] = sum;
         }
+        peakUsedBytes = Math.Max(peakUsedBytes, (long)sum * BytesPerVertex);
+
+        if (vertexIndex.Length < sum)
+            vertexIndex = new (int, int)[Math.Max(sum, vertexIndex.Length * 3 / 2)];
+
+        Parallel.ForEach(Partitioner.Create(0, NumPaths), range => {
+            for (int pathIdx = range.Item1; pathIdx < range.Item2; ++pathIdx) {
+                int first = pathIdx == 0 ? 0 : cumPathLen[pathIdx - 1];
+                for (int i = 0; i < pathLengths[pathIdx]; ++i)
+                    vertexIndex[first + i] = (pathIndices[pathIdx] + i, pathIdx);
+            }
+        });
+    }
+
+    [Flags]
+    enum VertexFlags : byte {
+        None = 0,
+        FromBackground = 1,
+    }
+
+    // Surface point
+    Vector3[][] positions;
+    Vector3[][] normals;
+    Vector2[][] barycentricCoords;
+    int[][] meshIds;
+    uint[][] primIds;
+    float[][] errorOffsets;
+    float[][] distances;
+
+    // Sampling state
+    float[][] pdfsFromAncestor;
+    float[][] pdfsReverseAncestor;
+    float[][] pdfsNextEventAncestor;
+    Vector3[][] dirsToAncestor;
+    float[][] jacobiansToAncestor;
+    RgbColor[][] weights;
+    int[][] pathIds;
+    byte[][] depths;
+    Half[][] maximumRoughness;
+    VertexFlags[][] flags;
+
+    static readonly int BytesPerVertex = 3 * Unsafe.SizeOf<Vector3>()
+        + Unsafe.SizeOf<Vector2>() + 2 * sizeof(int) + sizeof(uint) + 6 * sizeof(float)
+        + Unsafe.SizeOf<RgbColor>() + sizeof(byte) + Unsafe.SizeOf<Half>() + Unsafe.SizeOf<VertexFlags>();
+
+    void Pack(int offset, in PathVertex vertex) {
+        int slab = offset >> SlabShift, idx = offset & SlabMask;
+        positions[slab][idx] = vertex.Point.Position;
+        normals[slab][idx] = vertex.Point.Normal;
+        barycentricCoords[slab][idx] = vertex.Point.BarycentricCoords;
+        meshIds[slab][idx] = GetMeshId(vertex.Point.Mesh);
+        primIds[slab][idx] = vertex.Point.PrimId;
+        errorOffsets[slab][idx] = vertex.Point.ErrorOffset;
+        distances[slab][idx] = vertex.Point.Distance;
+        pdfsFromAncestor[slab][idx] = vertex.PdfFromAncestor;
+        pdfsReverseAncestor[slab][idx] = vertex.PdfReverseAncestor;
+        pdfsNextEventAncestor[slab][idx] = vertex.PdfNextEventAncestor;
+        dirsToAncestor[slab][idx] = vertex.DirToAncestor;
+        jacobiansToAncestor[slab][idx] = vertex.JacobianToAncestor;
+        weights[slab][idx] = vertex.Weight;
+        pathIds[slab][idx] = vertex.PathId;
+        depths[slab][idx] = vertex.Depth;
+        maximumRoughness[slab][idx] = (Half)vertex.MaximumRoughness;
+        flags[slab][idx] = vertex.FromBackground ? VertexFlags.FromBackground : VertexFlags.None;
+    }
+
+    PathVertex Unpack(int offset) {
+        int slab = offset >> SlabShift, idx = offset & SlabMask;
+        int meshId = meshIds[slab][idx];
+        return new() {
+            Point = new() {
+                Position = positions[slab][idx],
+                Normal = normals[slab][idx],
+                BarycentricCoords = barycentricCoords[slab][idx],
+                Mesh = meshId < 0 ? null : meshTable[meshId],
+                PrimId = primIds[slab][idx],
+                ErrorOffset = errorOffsets[slab][idx],
+                Distance = distances[slab][idx],
+            },
+            PdfFromAncestor = pdfsFromAncestor[slab][idx],
+            PdfReverseAncestor = pdfsReverseAncestor[slab][idx],
+            PdfNextEventAncestor = pdfsNextEventAncestor[slab][idx],
+            DirToAncestor = dirsToAncestor[slab][idx],
+            JacobianToAncestor = jacobiansToAncestor[slab][idx],
+            Weight = weights[slab][idx],
+            PathId = pathIds[slab][idx],
+            Depth = depths[slab][idx],
+            MaximumRoughness = (float)maximumRoughness[slab][idx],
+            FromBackground = (flags[slab][idx] & VertexFlags.FromBackground) != 0,
+        };
+    }
+
+    readonly ConcurrentDictionary<Mesh, int> meshIdLookup = new();
+    Mesh[] meshTable = [];
+
+    /// <summary>
+    /// Maps a mesh to a small integer id, assigning a new one on first use. Thread-safe.
+    /// </summary>
+    int GetMeshId(Mesh mesh) {
+        if (mesh == null) return -1;
+        if (meshIdLookup.TryGetValue(mesh, out int id)) return id;
+        lock (meshIdLookup) {
+            if (meshIdLookup.TryGetValue(mesh, out id)) return id;
+            id = meshTable.Length;
+            var table = new Mesh[id + 1];
+            meshTable.CopyTo(table, 0);
+            table[id] = mesh;
+            meshTable = table;
+            meshIdLookup[mesh] = id;
+            return id;
+        }
     }
 }
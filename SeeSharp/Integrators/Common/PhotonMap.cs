@@ -0,0 +1,506 @@
+using System.Linq;
+
+namespace SeeSharp.Integrators.Common;
+
+/// <summary>
+/// Available acceleration structures for photon (merge) queries
+/// </summary>
+public enum PhotonMapType {
+    /// <summary>
+    /// Points sorted along a Morton curve with a tree over the leaf bounds, see
+    /// <see cref="MortonPhotonMap{T}" />. Handles arbitrary query radii and k-nearest neighbor queries well.
+    /// </summary>
+    MortonTree,
+
+    /// <summary>
+    /// Spatial hash grid with a cell size equal to the merge radius, see <see cref="HashGridPhotonMap{T}" />.
+    /// Best suited for fixed-radius queries.
+    /// </summary>
+    HashGrid,
+}
+
+/// <summary>
+/// Build and query statistics of a photon map
+/// </summary>
+/// <param name="Backend">Name of the acceleration structure</param>
+/// <param name="NumBuilds">Number of times the structure was (re-)built</param>
+/// <param name="BuildTimeMs">Total time spent filling and building the structure</param>
+/// <param name="NumQueries">Number of nearest neighbor queries</param>
+/// <param name="QueryTimeMs">
+/// Total time spent in queries, summed over all threads, excluding the callbacks
+/// </param>
+public record struct PhotonMapStats(string Backend, long NumBuilds, double BuildTimeMs, long NumQueries,
+                                    double QueryTimeMs);
+
+/// <summary>
+/// Nearest neighbor search over a set of points (e.g., the vertices of all light paths) with a parallel
+/// bulk build. The points are stored in structure-of-arrays layout and sorted by a key that depends on the
+/// acceleration structure, see <see cref="PhotonMapType" />.
+///
+/// Offers the same query interface as TinyEmbree's NearestNeighborSearch, so it can be used as a drop-in
+/// replacement. In addition to adding points one by one, the set of points can be pre-sized and filled
+/// from multiple threads, see <see cref="Resize" /> and <see cref="SetPoint" />, or built directly from a
+/// <see cref="PathCache" /> via <see cref="Build(PathCache, VertexFilter, VertexData)" />.
+/// </summary>
+/// <typeparam name="T">User data stored with each point</typeparam>
+public abstract class PhotonMap<T> {
+    /// <summary>
+    /// Called for each point found by a query
+    /// </summary>
+    /// <param name="position">Position of the point</param>
+    /// <param name="userData">Data associated with the point</param>
+    /// <param name="distance">Distance between the point and the query position</param>
+    /// <param name="numFound">Total number of points found by the query</param>
+    /// <param name="distToFurthest">Distance to the furthest point found by the query</param>
+    public delegate void Callback(Vector3 position, T userData, float distance, int numFound,
+                                  float distToFurthest);
+
+    /// <summary>
+    /// Like <see cref="Callback" />, but with an additional state passed by reference
+    /// </summary>
+    public delegate void Callback<S>(Vector3 position, T userData, float distance, int numFound,
+                                     float distToFurthest, ref S state);
+
+    /// <summary> Decides whether a path vertex is added to the map </summary>
+    public delegate bool VertexFilter(in PathVertex vertex);
+
+    /// <summary> Computes the user data to store for a path vertex </summary>
+    public delegate T VertexData(int pathIdx, int vertexIdx);
+
+    /// <summary>
+    /// Creates an empty photon map with the given acceleration structure
+    /// </summary>
+    public static PhotonMap<T> Create(PhotonMapType type) => type switch {
+        PhotonMapType.MortonTree => new MortonPhotonMap<T>(),
+        PhotonMapType.HashGrid => new HashGridPhotonMap<T>(),
+        _ => throw new ArgumentOutOfRangeException(nameof(type))
+    };
+
+    /// <summary>
+    /// Creates an empty photon map for each acceleration structure except the given one, e.g., to compare
+    /// their performance on the same points and queries
+    /// </summary>
+    public static PhotonMap<T>[] CreateAllExcept(PhotonMapType type)
+    => Enum.GetValues<PhotonMapType>().Where(t => t != type).Select(Create).ToArray();
+
+    /// <summary> Number of points in the map </summary>
+    public int NumPoints => numPoints;
+
+    /// <summary>
+    /// The largest radius that queries are expected to use. Structures that adapt to the query radius,
+    /// like the hash grid, use this during the next <see cref="Build()" />. Larger queries still work but
+    /// are slower. If zero or negative, a value is derived from the point density.
+    /// </summary>
+    public float MaxQueryRadius { get; set; }
+
+    /// <summary> Name of the acceleration structure, as reported in the <see cref="Stats" /> </summary>
+    public abstract string Backend { get; }
+
+    /// <summary>
+    /// Build and query statistics since the map was created or since the last <see cref="ResetStats" />
+    /// </summary>
+    public PhotonMapStats Stats {
+        get {
+            long ticks = 0, count = 0;
+            foreach (var c in queryCounters.Values) {
+                ticks += c.Ticks;
+                count += c.Count;
+            }
+            return new(Backend, numBuilds, buildTimer.Elapsed.TotalMilliseconds, count,
+                ticks * 1000.0 / Stopwatch.Frequency);
+        }
+    }
+
+    /// <summary> Resets all statistics to zero </summary>
+    public void ResetStats() {
+        numBuilds = 0;
+        buildTimer.Reset();
+        foreach (var c in queryCounters.Values)
+            c.Ticks = c.Count = 0;
+    }
+
+    /// <summary>
+    /// Removes all points but keeps the memory
+    /// </summary>
+    public void Clear() {
+        numPoints = 0;
+        isBuilt = false;
+    }
+
+    /// <summary>
+    /// Sets the number of points, allocating memory if needed. Afterwards, each point must be set via
+    /// <see cref="SetPoint" /> before calling <see cref="Build()" />.
+    /// </summary>
+    public void Resize(int numPoints) {
+        if (posX.Length < numPoints) {
+            int capacity = Math.Max(numPoints, posX.Length * 3 / 2);
+            Array.Resize(ref posX, capacity);
+            Array.Resize(ref posY, capacity);
+            Array.Resize(ref posZ, capacity);
+            Array.Resize(ref data, capacity);
+        }
+        this.numPoints = numPoints;
+        isBuilt = false;
+    }
+
+    /// <summary>
+    /// Sets the position and data of a point. Can be called from multiple threads, as long as each
+    /// thread sets different indices.
+    /// </summary>
+    public void SetPoint(int idx, Vector3 position, T userData) {
+        Debug.Assert(idx < numPoints);
+        posX[idx] = position.X;
+        posY[idx] = position.Y;
+        posZ[idx] = position.Z;
+        data[idx] = userData;
+    }
+
+    /// <summary>
+    /// Adds a single point. Not thread-safe. <see cref="Build()" /> must be called before querying.
+    /// </summary>
+    public void AddPoint(Vector3 position, T userData) {
+        int idx = numPoints;
+        Resize(numPoints + 1);
+        SetPoint(idx, position, userData);
+    }
+
+    /// <summary>
+    /// Fills the map with the selected vertices of all paths in the cache and builds the search
+    /// structure. The first vertex of each path (on the light source) is skipped. Both the filter and the
+    /// data callback are invoked in parallel.
+    /// </summary>
+    /// <param name="paths">The path cache to read vertices from</param>
+    /// <param name="filter">Returns true for all vertices that should be added</param>
+    /// <param name="userData">Computes the data to store with a vertex</param>
+    public void Build(PathCache paths, VertexFilter filter, VertexData userData) {
+        buildTimer.Start();
+
+        int numPaths = paths.NumPaths;
+        if (pathOffsets.Length < numPaths + 1)
+            pathOffsets = new int[numPaths + 1];
+
+        // Count the vertices of each path, then compute the offsets via a prefix sum
+        ParallelChunks(numPaths, (begin, end) => {
+            for (int i = begin; i < end; ++i) {
+                int count = 0;
+                for (int k = 1; k < paths.Length(i); ++k)
+                    if (filter(paths[i, k])) count++;
+                pathOffsets[i + 1] = count;
+            }
+        });
+        pathOffsets[0] = 0;
+        for (int i = 0; i < numPaths; ++i)
+            pathOffsets[i + 1] += pathOffsets[i];
+
+        Resize(pathOffsets[numPaths]);
+        ParallelChunks(numPaths, (begin, end) => {
+            for (int i = begin; i < end; ++i) {
+                int next = pathOffsets[i];
+                for (int k = 1; k < paths.Length(i); ++k) {
+                    var vertex = paths[i, k];
+                    if (filter(vertex))
+                        SetPoint(next++, vertex.Point.Position, userData(i, k));
+                }
+            }
+        });
+
+        BuildIfNotEmpty();
+        buildTimer.Stop();
+    }
+
+    /// <summary>
+    /// Builds the search structure over all points. Must be called after the points changed and before
+    /// any queries.
+    /// </summary>
+    public void Build() {
+        buildTimer.Start();
+        BuildIfNotEmpty();
+        buildTimer.Stop();
+    }
+
+    void BuildIfNotEmpty() {
+        numBuilds++;
+        isBuilt = numPoints > 0;
+        if (!isBuilt) return;
+        EnsureScratch(numPoints);
+        BuildStructure();
+    }
+
+    /// <summary>
+    /// Builds the acceleration structure over the first <see cref="NumPoints" /> points. Called with at
+    /// least one point, after all scratch memory has been allocated.
+    /// </summary>
+    protected abstract void BuildStructure();
+
+    /// <summary>
+    /// Finds the (up to) k nearest points within the given radius and invokes the callback for each
+    /// </summary>
+    public void ForAllNearest(Vector3 position, int k, float radius, Callback callback) {
+        var found = Query(position, k, radius, out float distToFurthest);
+        foreach (var (distSqr, idx) in found)
+            callback(new(posX[idx], posY[idx], posZ[idx]), data[idx], MathF.Sqrt(distSqr), found.Length,
+                distToFurthest);
+    }
+
+    /// <summary>
+    /// Finds the (up to) k nearest points within the given radius and invokes the callback for each
+    /// </summary>
+    public void ForAllNearest<S>(Vector3 position, int k, float radius, Callback<S> callback, ref S state) {
+        var found = Query(position, k, radius, out float distToFurthest);
+        foreach (var (distSqr, idx) in found)
+            callback(new(posX[idx], posY[idx], posZ[idx]), data[idx], MathF.Sqrt(distSqr), found.Length,
+                distToFurthest, ref state);
+    }
+
+    /// <summary>
+    /// Runs the same query as <see cref="ForAllNearest" />, but only counts the points. The query is
+    /// recorded in the <see cref="Stats" />.
+    /// </summary>
+    /// <returns>Number of points found</returns>
+    public int CountNearest(Vector3 position, int k, float radius)
+    => Query(position, k, radius, out _).Length;
+
+    /// <summary>
+    /// The (up to) k closest points found so far, as a max-heap ordered by squared distance
+    /// </summary>
+    protected struct NearestSet {
+        public (float DistSqr, int Index)[] Heap;
+        public int Size;
+        public int K;
+
+        /// <summary> Points further away than this can be ignored </summary>
+        public float MaxDistSqr;
+    }
+
+    [ThreadStatic] static (float DistSqr, int Index)[] heapBuffer;
+
+    ReadOnlySpan<(float DistSqr, int Index)> Query(Vector3 pos, int k, float radius, out float distToFurthest) {
+        distToFurthest = 0;
+        if (!isBuilt || k <= 0) return [];
+
+        long start = Stopwatch.GetTimestamp();
+
+        heapBuffer ??= new (float, int)[64];
+        NearestSet set = new() { Heap = heapBuffer, K = k, MaxDistSqr = radius * radius };
+        Collect(pos, radius, ref set);
+        heapBuffer = set.Heap;
+
+        var counter = queryCounters.Value;
+        counter.Ticks += Stopwatch.GetTimestamp() - start;
+        counter.Count++;
+
+        if (set.Size > 0) distToFurthest = MathF.Sqrt(set.Heap[0].DistSqr);
+        return set.Heap.AsSpan(0, set.Size);
+    }
+
+    /// <summary>
+    /// Finds the nearest points within the radius by calling <see cref="ScanRange" /> for all candidate
+    /// ranges of (sorted) points.
+    /// </summary>
+    protected abstract void Collect(Vector3 pos, float radius, ref NearestSet set);
+
+    /// <summary>
+    /// Tests all points in [begin, end) and adds them to the set if they are close enough
+    /// </summary>
+    protected void ScanRange(int begin, int end, Vector3 pos, ref NearestSet set) {
+        for (int i = begin; i < end; ++i) {
+            float dx = posX[i] - pos.X, dy = posY[i] - pos.Y, dz = posZ[i] - pos.Z;
+            float d = dx * dx + dy * dy + dz * dz;
+            if (d > set.MaxDistSqr) continue;
+
+            if (set.Size < set.K) {
+                if (set.Size == set.Heap.Length)
+                    Array.Resize(ref set.Heap, set.Heap.Length * 2);
+                HeapPush(set.Heap, ref set.Size, (d, i));
+                if (set.Size == set.K) set.MaxDistSqr = set.Heap[0].DistSqr;
+            } else if (d < set.Heap[0].DistSqr) {
+                HeapReplaceTop(set.Heap, set.Size, (d, i));
+                set.MaxDistSqr = set.Heap[0].DistSqr;
+            }
+        }
+    }
+
+    static void HeapPush((float DistSqr, int Index)[] heap, ref int size, (float, int) item) {
+        int i = size++;
+        heap[i] = item;
+        while (i > 0) {
+            int parent = (i - 1) / 2;
+            if (heap[parent].DistSqr >= heap[i].DistSqr) break;
+            (heap[parent], heap[i]) = (heap[i], heap[parent]);
+            i = parent;
+        }
+    }
+
+    static void HeapReplaceTop((float DistSqr, int Index)[] heap, int size, (float, int) item) {
+        heap[0] = item;
+        int i = 0;
+        while (true) {
+            int largest = i, l = 2 * i + 1, r = l + 1;
+            if (l < size && heap[l].DistSqr > heap[largest].DistSqr) largest = l;
+            if (r < size && heap[r].DistSqr > heap[largest].DistSqr) largest = r;
+            if (largest == i) break;
+            (heap[largest], heap[i]) = (heap[i], heap[largest]);
+            i = largest;
+        }
+    }
+
+    /// <summary>
+    /// Axis-aligned box used by the acceleration structures
+    /// </summary>
+    protected struct Box {
+        public Vector3 Min, Max;
+
+        public static Box Empty => new() { Min = new(float.MaxValue), Max = new(float.MinValue) };
+
+        public readonly Box Grow(Vector3 p) => new() { Min = Vector3.Min(Min, p), Max = Vector3.Max(Max, p) };
+
+        public readonly Box Grow(in Box b) => new() { Min = Vector3.Min(Min, b.Min), Max = Vector3.Max(Max, b.Max) };
+
+        public readonly float DistanceSquared(Vector3 pos) {
+            Vector3 d = Vector3.Max(Vector3.Max(Min - pos, pos - Max), Vector3.Zero);
+            return d.LengthSquared();
+        }
+    }
+
+    /// <summary> Computes the bounding box of all points in parallel </summary>
+    protected Box ComputeBounds() {
+        object mutex = new();
+        Box result = Box.Empty;
+        ParallelChunks(numPoints, (begin, end) => {
+            Box box = Box.Empty;
+            for (int i = begin; i < end; ++i)
+                box = box.Grow(new(posX[i], posY[i], posZ[i]));
+            lock (mutex) result = result.Grow(box);
+        });
+        return result;
+    }
+
+    /// <summary>
+    /// Reorders all points by their <see cref="keys" /> (which need to be set by the caller), so points
+    /// with equal or similar keys are contiguous in memory. The sort is stable, so the result is
+    /// deterministic. Afterwards, the keys are sorted as well.
+    /// </summary>
+    /// <param name="numKeyBits">Number of low bits in the keys that can be non-zero</param>
+    protected void SortPointsByKey(int numKeyBits) {
+        int n = numPoints;
+        ParallelChunks(n, (begin, end) => {
+            for (int i = begin; i < end; ++i)
+                order[i] = i;
+        });
+
+        RadixSort(n, numKeyBits);
+
+        ParallelChunks(n, (begin, end) => {
+            for (int i = begin; i < end; ++i) {
+                int src = order[i];
+                scratchX[i] = posX[src];
+                scratchY[i] = posY[src];
+                scratchZ[i] = posZ[src];
+                scratchData[i] = data[src];
+            }
+        });
+        (posX, scratchX) = (scratchX, posX);
+        (posY, scratchY) = (scratchY, posY);
+        (posZ, scratchZ) = (scratchZ, posZ);
+        (data, scratchData) = (scratchData, data);
+    }
+
+    /// <summary>
+    /// Stable parallel LSD radix sort of the keys, permuting the order array alongside
+    /// </summary>
+    void RadixSort(int n, int numKeyBits) {
+        const int RadixBits = 8;
+        const int NumBuckets = 1 << RadixBits;
+        int numChunks = NumChunks(n);
+        int chunkSize = (n + numChunks - 1) / numChunks;
+        if (histograms.Length < numChunks * NumBuckets)
+            histograms = new int[numChunks * NumBuckets];
+
+        for (int shift = 0; shift < numKeyBits; shift += RadixBits) {
+            int s = shift;
+            Parallel.For(0, numChunks, chunk => {
+                var hist = histograms.AsSpan(chunk * NumBuckets, NumBuckets);
+                hist.Clear();
+                int end = Math.Min(n, (chunk + 1) * chunkSize);
+                for (int i = chunk * chunkSize; i < end; ++i)
+                    hist[(int)(keys[i] >> s) & (NumBuckets - 1)]++;
+            });
+
+            // Turn the counts into write offsets: bucket-major, chunk-minor keeps the sort stable
+            int sum = 0;
+            for (int b = 0; b < NumBuckets; ++b) {
+                for (int chunk = 0; chunk < numChunks; ++chunk) {
+                    int c = histograms[chunk * NumBuckets + b];
+                    histograms[chunk * NumBuckets + b] = sum;
+                    sum += c;
+                }
+            }
+
+            Parallel.For(0, numChunks, chunk => {
+                var offsets = histograms.AsSpan(chunk * NumBuckets, NumBuckets);
+                int end = Math.Min(n, (chunk + 1) * chunkSize);
+                for (int i = chunk * chunkSize; i < end; ++i) {
+                    int dst = offsets[(int)(keys[i] >> s) & (NumBuckets - 1)]++;
+                    scratchKeys[dst] = keys[i];
+                    scratchOrder[dst] = order[i];
+                }
+            });
+            (keys, scratchKeys) = (scratchKeys, keys);
+            (order, scratchOrder) = (scratchOrder, order);
+        }
+    }
+
+    void EnsureScratch(int n) {
+        if (keys.Length >= n) return;
+        int capacity = posX.Length;
+        keys = new ulong[capacity];
+        scratchKeys = new ulong[capacity];
+        order = new int[capacity];
+        scratchOrder = new int[capacity];
+        scratchX = new float[capacity];
+        scratchY = new float[capacity];
+        scratchZ = new float[capacity];
+        scratchData = new T[capacity];
+    }
+
+    static int NumChunks(int n) => Math.Clamp(n / 4096, 1, Environment.ProcessorCount * 4);
+
+    /// <summary>
+    /// Splits the range [0, n) into a few large chunks and processes them in parallel. Runs on the calling
+    /// thread if the range is small.
+    /// </summary>
+    protected static void ParallelChunks(int n, Action<int, int> body) {
+        int numChunks = NumChunks(n);
+        if (numChunks == 1) {
+            body(0, n);
+            return;
+        }
+        int chunkSize = (n + numChunks - 1) / numChunks;
+        Parallel.For(0, numChunks, chunk => body(chunk * chunkSize, Math.Min(n, (chunk + 1) * chunkSize)));
+    }
+
+    class QueryCounter {
+        public long Ticks, Count;
+    }
+
+    int numPoints;
+    bool isBuilt;
+
+    /// <summary> Point positions in structure-of-arrays layout </summary>
+    protected float[] posX = [], posY = [], posZ = [];
+    T[] data = [];
+
+    /// <summary> Sort keys of the points, see <see cref="SortPointsByKey" /> </summary>
+    protected ulong[] keys = [];
+
+    int[] pathOffsets = [];
+    ulong[] scratchKeys = [];
+    int[] order = [], scratchOrder = [];
+    float[] scratchX = [], scratchY = [], scratchZ = [];
+    T[] scratchData = [];
+    int[] histograms = [];
+
+    long numBuilds;
+    readonly Stopwatch buildTimer = new();
+    readonly ThreadLocal<QueryCounter> queryCounters = new(() => new(), true);
+}
@@ -54,6 +54,12 @@ public ref struct RandomWalk<PayloadType> where PayloadType : new(), allows ref
     /// </summary>
     public RgbColor ApproxThroughput = RgbColor.White;
 
+    /// <summary>
+    /// Width of the pixel footprint along a camera path, used to filter texture lookups.
+    /// Zero for light paths.
+    /// </summary>
+    public RayFootprint Footprint;
+
     /// <summary>
     /// Initializes a new random walk
     /// </summary>
@@ -72,6 +78,7 @@ public ref struct RandomWalk<PayloadType> where PayloadType : new(), allows ref
         isOnLightSubpath = false;
         FilmPosition = filmPosition;
         Payload = payload;
+        Footprint = new(cameraRay.Differential);
         Modifier?.OnStartCamera(ref this, cameraRay, filmPosition);
 
         return ContinueWalk(cameraRay.Ray, cameraRay.Point, cameraRay.PdfRay, cameraRay.Weight, 1);
@@ -80,6 +87,7 @@ public ref struct RandomWalk<PayloadType> where PayloadType : new(), allows ref
     public RgbColor StartFromEmitter(EmitterSample emitterSample, RgbColor initialWeight, PayloadType payload) {
         isOnLightSubpath = true;
         Payload = payload;
+        Footprint = default;
         Modifier?.OnStartEmitter(ref this, emitterSample, initialWeight);
 
         Ray ray = Raytracer.SpawnRay(emitterSample.Point, emitterSample.Direction);
@@ -89,6 +97,7 @@ public ref struct RandomWalk<PayloadType> where PayloadType : new(), allows ref
     public RgbColor StartFromBackground(Ray ray, RgbColor initialWeight, float pdf, PayloadType payload) {
         isOnLightSubpath = true;
         Payload = payload;
+        Footprint = default;
         Modifier?.OnStartBackground(ref this, ray, initialWeight, pdf);
 
         // Find the first actual hitpoint on scene geometry
@@ -151,11 +160,12 @@ public ref struct RandomWalk<PayloadType> where PayloadType : new(), allows ref
     RgbColor ContinueWalk(Ray ray, SurfacePoint previousPoint, float pdfDirection, RgbColor prefixWeight, int depth) {
         RgbColor estimate = RgbColor.Black;
         while (depth < maxDepth) {
-            var hit = scene.Raytracer.Trace(ray);
+            SurfacePoint hit = scene.Raytracer.Trace(ray);
             if (!hit) {
                 estimate += Modifier?.OnInvalidHit(ref this, ray, pdfDirection, prefixWeight, depth) ?? RgbColor.Black;
                 break;
             }
+            hit.FootprintWidth = Footprint.Advance(ray, hit);
 
             SurfaceShader shader = new(hit, -ray.Direction, isOnLightSubpath);
 
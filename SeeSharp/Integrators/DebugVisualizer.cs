@@ -18,15 +18,11 @@ public class DebugVisualizer : Integrator {
     /// Renders the given scene.
     /// </summary>
     public override void Render(Scene scene) {
-        for (uint sampleIndex = 0; sampleIndex < TotalSpp; ++sampleIndex) {
+        TileScheduler tiles = MakeTileScheduler(scene);
+        var (firstIteration, endIteration) = GetIterationRange(scene, TotalSpp);
+        for (uint sampleIndex = firstIteration; sampleIndex < endIteration; ++sampleIndex) {
             scene.FrameBuffer.StartIteration();
-            Parallel.For(0, scene.FrameBuffer.Height,
-                row => {
-                    for (uint col = 0; col < scene.FrameBuffer.Width; ++col) {
-                        RenderPixel(scene, (uint)row, col, sampleIndex);
-                    }
-                }
-            );
+            tiles.Run((col, row) => RenderPixel(scene, (uint)row, (uint)col, sampleIndex));
             scene.FrameBuffer.EndIteration();
         }
     }
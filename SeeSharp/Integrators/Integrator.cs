@@ -15,12 +15,76 @@ public abstract class Integrator {
     /// </summary>
     public int MinDepth { get; set; } = 1;
 
+    /// <summary>
+    /// Width and height in pixels of the image tiles that are distributed over the cores. Default is 16.
+    /// </summary>
+    public int TileSize { get; set; } = 16;
+
+    /// <summary>
+    /// Order in which image tiles are assigned to the cores. Default is Morton (Z-curve) order.
+    /// </summary>
+    public TileOrder TileOrder { get; set; } = TileOrder.Morton;
+
+    /// <summary>
+    /// Creates a tile scheduler for the frame buffer of the given scene with the current tile settings
+    /// </summary>
+    protected TileScheduler MakeTileScheduler(Scene scene)
+    => new(scene.FrameBuffer.Width, scene.FrameBuffer.Height, TileSize, TileOrder,
+        frameBuffer: scene.FrameBuffer);
+
+    /// <summary>
+    /// Determines which iterations to render, based on the iteration range of the frame buffer and a
+    /// checkpoint that is being resumed
+    /// </summary>
+    /// <param name="scene">The scene, with the frame buffer that will be rendered to</param>
+    /// <param name="numIterations">Total number of iterations the integrator is configured for</param>
+    /// <returns>The index of the first iteration and one past the last iteration to render</returns>
+    protected static (uint First, uint End) GetIterationRange(Scene scene, int numIterations) {
+        int end = Math.Min(numIterations, scene.FrameBuffer.IterationLimit ?? numIterations);
+        int first = Math.Min(scene.FrameBuffer.ResumeIteration, end);
+        return ((uint)first, (uint)end);
+    }
+
+    /// <summary>
+    /// Whether the frame buffer only covers some of the iterations, e.g., in a distributed rendering.
+    /// Post-processing of the final image, like denoising, is then left to the merged result.
+    /// </summary>
+    /// <param name="scene">The scene, with the frame buffer that will be rendered to</param>
+    /// <param name="numIterations">Total number of iterations the integrator is configured for</param>
+    protected static bool IsPartialRange(Scene scene, int numIterations)
+    => scene.FrameBuffer.FirstIteration > 0 || scene.FrameBuffer.IterationLimit < numIterations;
+
     /// <summary>
     /// Renders a scene to the frame buffer that is specified by the <see cref="Scene" /> object.
     /// </summary>
     /// <param name="scene">The scene to render</param>
     public abstract void Render(Scene scene);
 
+    /// <summary>
+    /// Continues an interrupted rendering from a checkpoint of the frame buffer, see
+    /// <see cref="FrameBuffer.CheckpointInterval" />. The remaining iterations use the same random numbers
+    /// as they would have without the interruption, so the result is identical. If there is no checkpoint,
+    /// this is the same as <see cref="Render" />.
+    /// </summary>
+    /// <param name="scene">The scene to render, must be set up exactly as for the interrupted rendering</param>
+    /// <param name="checkpoint">The checkpoint file, defaults to <see cref="FrameBuffer.CheckpointFilename" /></param>
+    public void Resume(Scene scene, string checkpoint = null) {
+        checkpoint ??= scene.FrameBuffer.CheckpointFilename;
+        if (File.Exists(checkpoint))
+            scene.FrameBuffer.LoadCheckpoint(checkpoint);
+        Render(scene);
+
+        // If the checkpoint already covered all iterations, none were started and it is still pending
+        scene.FrameBuffer.RestorePendingCheckpoint();
+    }
+
+    /// <summary>
+    /// Creates a timer for the render loop. If a checkpoint is being resumed, its render time and
+    /// iterations count towards the time budget and the estimated cost per iteration.
+    /// </summary>
+    protected static RenderTimer MakeRenderTimer(Scene scene)
+    => new(scene.FrameBuffer.ResumeRenderTimeMs, scene.FrameBuffer.ResumeIteration - scene.FrameBuffer.FirstIteration);
+
     /// <summary>
     /// Re-renders a pixel as it was rendered in a specific iteration.
     /// </summary>
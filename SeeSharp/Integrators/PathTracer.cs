@@ -48,6 +48,34 @@ public class PathTracerBase<PayloadType> : Integrator {
     /// </summary>
     public bool EnableDenoiser = true;
 
+    /// <summary>
+    /// If true, the samples of each iteration are distributed over the pixels based on the pixel variance
+    /// estimated by the frame buffer, which requires <see cref="FrameBuffer.Flags.EstimatePixelVariance"/>.
+    /// Each iteration still takes one sample per pixel on average. Cannot be used to render only a range of
+    /// iterations, e.g., in a <see cref="Experiments.DistributedRender"/>, as the allocation depends on
+    /// the variance of all previous iterations. Resuming from a checkpoint is supported, as the variance
+    /// estimate is part of it.
+    /// </summary>
+    public bool EnableAdaptiveSampling = false;
+
+    /// <summary>
+    /// Number of iterations with one sample in every pixel before adaptive sampling starts. Counts all
+    /// iterations, including those restored from a checkpoint.
+    /// </summary>
+    public int AdaptiveWarmupIterations = 2;
+
+    /// <summary>
+    /// Fraction of the samples that is distributed uniformly by adaptive sampling, must be positive
+    /// </summary>
+    public float AdaptiveUniformFraction = 0.1f;
+
+    /// <summary>
+    /// Maximum number of samples that adaptive sampling takes in a single pixel per iteration
+    /// </summary>
+    public int AdaptiveMaxSpp = 16;
+
+    AdaptiveSampleBudget adaptiveBudget;
+
     TechPyramid techPyramidRaw;
     TechPyramid techPyramidWeighted;
 
@@ -71,6 +99,7 @@ public class PathTracerBase<PayloadType> : Integrator {
     /// <summary>
     /// Called once for each complete path from the camera to a light.
     /// The default implementation generates a technique pyramid for the MIS samplers.
+    /// The weight includes the <see cref="PathState.SampleWeight"/> of adaptive sampling.
     /// </summary>
     public virtual void RegisterSample(Pixel pixel, RgbColor weight, float misWeight, uint depth,
                                        bool isNextEvent) {
@@ -88,13 +117,15 @@ public class PathTracerBase<PayloadType> : Integrator {
     protected virtual void OnHit(in Ray ray, in Hit hit, ref PathState state) { }
 
     /// <summary>
-    /// Called whenever direct illumination was estimated via next event estimation
+    /// Called whenever direct illumination was estimated via next event estimation. Contributions that are
+    /// splatted to an image need to be multiplied by the <see cref="PathState.SampleWeight"/>.
     /// </summary>
     protected virtual void OnNextEventResult(in SurfaceShader shader, in PathState state,
                                              float misWeight, RgbColor estimate) { }
 
     /// <summary>
-    /// Called whenever an emitter was intersected
+    /// Called whenever an emitter was intersected. Contributions that are splatted to an image need to be
+    /// multiplied by the <see cref="PathState.SampleWeight"/>.
     /// </summary>
     protected virtual void OnHitLightResult(in Ray ray, in PathState state, float misWeight,
                                             RgbColor emission, bool isBackground) { }
@@ -108,6 +139,11 @@ public class PathTracerBase<PayloadType> : Integrator {
     /// <summary>
     /// Called after a path has finished tracing and its contribution was added to the corresponding pixel.
     /// </summary>
+    /// <param name="estimate">
+    ///     The contribution that was added to the pixel, already multiplied by the
+    ///     <see cref="PathState.SampleWeight"/>
+    /// </param>
+    /// <param name="state">Final state of the path</param>
     protected virtual void OnFinishedPath(RgbColor estimate, ref PathState state) { }
 
     /// <summary> Called after the scene was submitted, before rendering starts. </summary>
@@ -191,6 +227,17 @@ public class PathTracerBase<PayloadType> : Integrator {
         /// Additional per-path data defined in a derived class.
         /// </summary>
         public PayloadType UserData { get; set; }
+
+        /// <summary>
+        /// Width of the pixel footprint along the path, used to filter texture lookups
+        /// </summary>
+        public RayFootprint Footprint;
+
+        /// <summary>
+        /// Weight of this path in the pixel estimate of the current iteration, one unless adaptive sampling
+        /// takes a different number of samples per pixel
+        /// </summary>
+        public float SampleWeight;
     }
 
     /// <summary>
@@ -203,25 +250,47 @@ public class PathTracerBase<PayloadType> : Integrator {
 
         if (RenderTechniquePyramid) {
             techPyramidRaw = new TechPyramid(scene.FrameBuffer.Width, scene.FrameBuffer.Height,
-                MinDepth, MaxDepth, false, false, false);
+                MinDepth, MaxDepth, false, false, false, pooled: true);
             techPyramidWeighted = new TechPyramid(scene.FrameBuffer.Width, scene.FrameBuffer.Height,
-                MinDepth, MaxDepth, false, false, false);
+                MinDepth, MaxDepth, false, false, false, pooled: true);
         }
 
         // Add custom frame buffer layers
         if (EnableDenoiser)
             denoiseBuffers = new(scene.FrameBuffer);
 
+        adaptiveBudget = null;
+        if (EnableAdaptiveSampling) {
+            if (scene.FrameBuffer.PixelVariance == null) {
+                Logger.Warning("Adaptive sampling requires a frame buffer with the EstimatePixelVariance flag, " +
+                    "rendering with uniform sampling instead.");
+            } else if (scene.FrameBuffer.FirstIteration > 0 || scene.FrameBuffer.IterationLimit < TotalSpp) {
+                // The variance of the earlier iterations is unknown to a partial range, so the sample
+                // allocation, and thus the merged image, would differ from a single rendering
+                throw new NotSupportedException("Adaptive sampling cannot render a partial range of iterations");
+            } else {
+                adaptiveBudget = new() {
+                    UniformFraction = AdaptiveUniformFraction,
+                    MaxSamplesPerPixel = AdaptiveMaxSpp
+                };
+            }
+        }
+
         ProgressBar progressBar = new(prefix: "Rendering...");
-        progressBar.Start(TotalSpp);
-        RenderTimer timer = new();
+        var (firstIteration, endIteration) = GetIterationRange(scene, TotalSpp);
+        // A partial range would only denoise its own iterations, the merged image is denoised instead
+        bool denoise = EnableDenoiser && !IsPartialRange(scene, TotalSpp);
+        progressBar.Start((int)(endIteration - firstIteration));
+        RenderTimer timer = MakeRenderTimer(scene);
+        TileScheduler tiles = MakeTileScheduler(scene);
         ShadingStatCounter.Reset();
+        TextureCache.Shared?.ResetStats();
         scene.Raytracer.ResetStats();
-        for (uint sampleIndex = 0; sampleIndex < TotalSpp; ++sampleIndex) {
+        for (uint sampleIndex = firstIteration; sampleIndex < endIteration; ++sampleIndex) {
             long nextIterTime = timer.RenderTime + timer.PerIterationCost;
             if (MaximumRenderTimeMs.HasValue && nextIterTime > MaximumRenderTimeMs.Value) {
                 Logger.Log("Maximum render time exhausted.");
-                if (EnableDenoiser) denoiseBuffers.Denoise();
+                if (denoise) denoiseBuffers.Denoise();
                 progressBar.Terminate();
                 break;
             }
@@ -231,17 +300,19 @@ public class PathTracerBase<PayloadType> : Integrator {
             timer.EndFrameBuffer();
 
             OnPreIteration(sampleIndex);
-            Parallel.For(0, scene.FrameBuffer.Height, row => {
-                for (uint col = 0; col < scene.FrameBuffer.Width; ++col) {
+            if (adaptiveBudget != null && sampleIndex >= AdaptiveWarmupIterations) {
+                RenderAdaptiveIteration(sampleIndex);
+            } else {
+                tiles.Run((col, row) => {
                     uint pixelIndex = (uint)(row * scene.FrameBuffer.Width + col);
                     RNG rng = new(BaseSeed, pixelIndex, sampleIndex);
-                    RenderPixel((uint)row, col, ref rng, null);
-                }
-            });
+                    RenderPixel((uint)row, (uint)col, ref rng, null);
+                });
+            }
             OnPostIteration(sampleIndex);
             timer.EndRender();
 
-            if (sampleIndex == TotalSpp - 1 && EnableDenoiser)
+            if (sampleIndex == TotalSpp - 1 && denoise)
                 denoiseBuffers.Denoise();
             PostprocessIteration(sampleIndex);
             scene.FrameBuffer.EndIteration();
@@ -252,9 +323,12 @@ public class PathTracerBase<PayloadType> : Integrator {
         }
 
         scene.FrameBuffer.MetaData["RenderTime"] = timer.RenderTime;
-        scene.FrameBuffer.MetaData["FrameBufferTime"] = timer.FrameBufferTime;
+        scene.FrameBuffer.SetFrameBufferTime(timer.FrameBufferTime);
         scene.FrameBuffer.MetaData["ShadingStats"] = ShadingStatCounter.Current;
+        if (TextureCache.Shared != null)
+            scene.FrameBuffer.MetaData["TextureCacheStats"] = TextureCache.Shared.Stats;
         scene.FrameBuffer.MetaData["RayTracerStats"] = scene.Raytracer.Stats;
+        scene.FrameBuffer.MetaData["TileStats"] = tiles.Stats;
 
         OnAfterRender();
 
@@ -263,7 +337,10 @@ public class PathTracerBase<PayloadType> : Integrator {
             techPyramidRaw.WriteToFiles(pathRaw);
             string pathWeighted = Path.Join(scene.FrameBuffer.Basename, "techs-weighted");
             techPyramidWeighted.WriteToFiles(pathWeighted);
+            techPyramidRaw.Release();
+            techPyramidWeighted.Release();
         }
+        FramePool.Trim();
     }
 
     /// <summary>
@@ -282,13 +359,51 @@ public class PathTracerBase<PayloadType> : Integrator {
     }
 
     /// <summary>
-    /// Updates the estimate of one pixel. Called once per iteration for every pixel.
+    /// Renders an iteration with per-pixel sample counts that are derived from the pixel variance. Only
+    /// pixels with at least one sample are scheduled.
     /// </summary>
-    protected virtual RgbColor RenderPixel(uint row, uint col, ref RNG rng, PathGraph graph = null) {
+    void RenderAdaptiveIteration(uint sampleIndex) {
+        int width = scene.FrameBuffer.Width;
+        adaptiveBudget.Update(scene.FrameBuffer.PixelVariance, width * scene.FrameBuffer.Height,
+            RNG.HashSeed(BaseSeed, 0, AdaptiveRoundingSeed), sampleIndex);
+
+        scene.FrameBuffer.ParallelFor(adaptiveBudget.NumActive, i => {
+            int pixelIndex = adaptiveBudget.ActivePixels[i];
+            uint row = (uint)(pixelIndex / width), col = (uint)(pixelIndex % width);
+            float weight = adaptiveBudget.SampleWeights[pixelIndex];
+            for (int k = 0; k < adaptiveBudget.SampleCounts[pixelIndex]; ++k) {
+                // The first sample uses the same seed as without adaptive sampling
+                RNG rng = k == 0
+                    ? new(BaseSeed, (uint)pixelIndex, sampleIndex)
+                    : new(RNG.HashSeed(BaseSeed, (uint)pixelIndex, sampleIndex), (uint)k, AdaptiveRoundingSeed);
+                RenderPixel(row, col, ref rng, null, weight);
+            }
+        }, blockSize: 64);
+
+        scene.FrameBuffer.MetaData["AdaptiveActivePixels"] = adaptiveBudget.NumActive;
+    }
+
+    const uint AdaptiveRoundingSeed = 0xADA97u;
+
+    /// <summary>
+    /// Updates the estimate of one pixel. Called once per iteration for every pixel, or for a variable
+    /// number of times if adaptive sampling is enabled.
+    /// </summary>
+    /// <param name="row">Row of the pixel</param>
+    /// <param name="col">Column of the pixel</param>
+    /// <param name="rng">Random number generator for the sample</param>
+    /// <param name="graph">If not null, the path is stored in this graph instead of splatted to the image</param>
+    /// <param name="sampleWeight">
+    ///     Weight of the sample in the pixel estimate of this iteration, the inverse of the expected
+    ///     number of samples in this pixel
+    /// </param>
+    protected virtual RgbColor RenderPixel(uint row, uint col, ref RNG rng, PathGraph graph = null,
+                                           float sampleWeight = 1) {
         // Sample a ray from the camera
         var offset = rng.NextFloat2D();
         var pixel = new Vector2(col, row) + offset;
-        Ray primaryRay = scene.Camera.GenerateRay(pixel, ref rng).Ray;
+        var cameraSample = scene.Camera.GenerateRay(pixel, ref rng);
+        Ray primaryRay = cameraSample.Ray;
 
         PathState state = new() {
             Pixel = new((int)col, (int)row),
@@ -297,17 +412,19 @@ public class PathTracerBase<PayloadType> : Integrator {
             ApproxThroughput = RgbColor.White,
             Depth = 1,
             PreviousScatterWeight = RgbColor.White,
-            PreviousSurvivalProbability = 1
+            PreviousSurvivalProbability = 1,
+            Footprint = new(cameraSample.Differential),
+            SampleWeight = sampleWeight
         };
 
         graph?.Roots.Add(new(primaryRay.Origin));
 
         OnStartPath(ref state);
         var estimate = EstimateIncidentRadiance(primaryRay, ref state, graph?.Roots[^1]);
-        OnFinishedPath(estimate, ref state);
+        OnFinishedPath(estimate * sampleWeight, ref state);
 
         if (graph == null)
-            scene.FrameBuffer.Splat(state.Pixel, estimate);
+            scene.FrameBuffer.Splat(state.Pixel, estimate * sampleWeight);
 
         return estimate;
     }
@@ -316,7 +433,7 @@ public class PathTracerBase<PayloadType> : Integrator {
         RgbColor radianceEstimate = RgbColor.Black;
 
         while (state.Depth <= MaxDepth) {
-            var hit = scene.Raytracer.Trace(ray);
+            SurfacePoint hit = scene.Raytracer.Trace(ray);
 
             // Did the ray leave the scene?
             if (!hit) {
@@ -328,6 +445,7 @@ public class PathTracerBase<PayloadType> : Integrator {
 
                 break;
             }
+            hit.FootprintWidth = state.Footprint.Advance(ray, hit);
 
             OnHit(ray, hit, ref state);
 
@@ -335,7 +453,8 @@ public class PathTracerBase<PayloadType> : Integrator {
 
             if (state.Depth == 1 && EnableDenoiser) {
                 var albedo = shader.GetScatterStrength();
-                denoiseBuffers.LogPrimaryHit(state.Pixel, albedo, hit.ShadingNormal);
+                denoiseBuffers.LogPrimaryHit(state.Pixel, albedo * state.SampleWeight,
+                    hit.ShadingNormal * state.SampleWeight);
             }
 
             // Check if a light source was hit.
@@ -394,7 +513,7 @@ public class PathTracerBase<PayloadType> : Integrator {
         }
 
         var emission = scene.Background.EmittedRadiance(ray.Direction);
-        RegisterSample(state.Pixel, emission * state.PrefixWeight, misWeight, state.Depth, false);
+        RegisterSample(state.Pixel, emission * state.PrefixWeight * state.SampleWeight, misWeight, state.Depth, false);
         OnHitLightResult(ray, state, misWeight, emission, true);
         return (misWeight, emission);
     }
@@ -405,7 +524,8 @@ public class PathTracerBase<PayloadType> : Integrator {
         if (state.Depth > 1) { // directly visible emitters are not explicitely connected
                                // Compute the solid angle pdf of next event
             var jacobian = SampleWarp.SurfaceAreaToSolidAngle(state.PreviousHit.Value, hit);
-            pdfNextEvt = light.PdfUniformArea(hit) / scene.Emitters.Count * NumShadowRays / jacobian;
+            float lightSelectProb = SelectLightPmf(state.PreviousHit.Value, light);
+            pdfNextEvt = light.PdfUniformArea(hit) * lightSelectProb * NumShadowRays / jacobian;
 
             // Compute balance heuristic MIS weights
             float pdfRatio = pdfNextEvt / state.PreviousPdf;
@@ -415,7 +535,7 @@ public class PathTracerBase<PayloadType> : Integrator {
         }
 
         var emission = light.EmittedRadiance(hit, -ray.Direction);
-        RegisterSample(state.Pixel, emission * state.PrefixWeight, misWeight, state.Depth, false);
+        RegisterSample(state.Pixel, emission * state.PrefixWeight * state.SampleWeight, misWeight, state.Depth, false);
         OnHitLightResult(ray, state, misWeight, emission, false);
         return (misWeight, emission);
     }
@@ -425,79 +545,113 @@ public class PathTracerBase<PayloadType> : Integrator {
             return RgbColor.Black; // There is no background
 
         var sample = scene.Background.SampleDirection(state.Rng.NextFloat2D());
-        if (scene.Raytracer.LeavesScene(shader.Point, sample.Direction)) {
-            var bsdfTimesCosine = shader.EvaluateWithCosine(sample.Direction);
-            var pdfBsdf = DirectionPdf(shader, sample.Direction, state);
+        if (scene.Raytracer.LeavesScene(shader.Point, sample.Direction))
+            return EvaluateBackgroundNextEvent(shader, state, graphVertex, sample);
+        return RgbColor.Black;
+    }
+
+    /// <summary>
+    /// Computes the MIS weighted contribution of a background next event sample that is known to be
+    /// unoccluded
+    /// </summary>
+    protected virtual RgbColor EvaluateBackgroundNextEvent(in SurfaceShader shader, in PathState state,
+                                                           PathGraphNode graphVertex, BackgroundSample sample) {
+        var bsdfTimesCosine = shader.EvaluateWithCosine(sample.Direction);
+        var pdfBsdf = DirectionPdf(shader, sample.Direction, state);
 
-            // Prevent NaN / Inf
-            if (pdfBsdf == 0 || sample.Pdf == 0)
-                return RgbColor.Black;
+        // Prevent NaN / Inf
+        if (pdfBsdf == 0 || sample.Pdf == 0)
+            return RgbColor.Black;
 
-            // Since the densities are in solid angle unit, no need for any conversions here
-            float misWeight = EnableBsdfDI ? 1 / (1.0f + pdfBsdf / (sample.Pdf * NumShadowRays)) : 1;
-            var contrib = sample.Weight * bsdfTimesCosine / NumShadowRays;
+        // Since the densities are in solid angle unit, no need for any conversions here
+        float misWeight = EnableBsdfDI ? 1 / (1.0f + pdfBsdf / (sample.Pdf * NumShadowRays)) : 1;
+        var contrib = sample.Weight * bsdfTimesCosine / NumShadowRays;
 
-            Debug.Assert(float.IsFinite(contrib.Average));
-            Debug.Assert(float.IsFinite(misWeight));
+        Debug.Assert(float.IsFinite(contrib.Average));
+        Debug.Assert(float.IsFinite(misWeight));
 
-            RegisterSample(state.Pixel, contrib * state.PrefixWeight, misWeight, state.Depth + 1, true);
-            OnNextEventResult(shader, state, misWeight, contrib);
+        RegisterSample(state.Pixel, contrib * state.PrefixWeight * state.SampleWeight, misWeight, state.Depth + 1, true);
+        OnNextEventResult(shader, state, misWeight, contrib);
 
-            if (contrib != RgbColor.Black)
-                graphVertex?.AddSuccessor(new NextEventNode(sample.Direction, graphVertex, sample.Weight * sample.Pdf, sample.Pdf, bsdfTimesCosine, misWeight, state.PrefixWeight));
+        if (contrib != RgbColor.Black)
+            graphVertex?.AddSuccessor(new NextEventNode(sample.Direction, graphVertex, sample.Weight * sample.Pdf, sample.Pdf, bsdfTimesCosine, misWeight, state.PrefixWeight));
 
-            return misWeight * contrib;
-        }
-        return RgbColor.Black;
+        return misWeight * contrib;
     }
 
+    /// <summary>
+    /// Used by next event estimation to select a light source. The default uses the light hierarchy of
+    /// the scene to select lights based on their power, distance, and orientation.
+    /// </summary>
+    /// <param name="from">A point on a surface where next event is performed</param>
+    /// <param name="rng">Random number generator</param>
+    /// <returns>The selected light and the discrete probability of selecting that light</returns>
+    protected virtual (Emitter, float) SelectLight(in SurfacePoint from, ref RNG rng)
+    => scene.SampleEmitter(from, rng.NextFloat());
+
+    /// <returns>
+    /// The discrete probability of selecting the given light when performing next event at the given
+    /// shading point.
+    /// </returns>
+    protected virtual float SelectLightPmf(in SurfacePoint from, Emitter em)
+    => scene.EmitterProbability(from, em);
+
     protected virtual RgbColor PerformNextEventEstimation(in SurfaceShader shader, ref PathState state, PathGraphNode graphVertex) {
         if (scene.Emitters.Count == 0)
             return RgbColor.Black;
 
         // Select a light source
-        int idx = state.Rng.NextInt(scene.Emitters.Count);
-        var light = scene.Emitters[idx];
-        float lightSelectProb = 1.0f / scene.Emitters.Count;
+        var (light, lightSelectProb) = SelectLight(shader.Point, ref state.Rng);
+        if (light == null)
+            return RgbColor.Black;
 
         // Sample a point on the light source
         var lightSample = light.SampleUniformArea(state.Rng.NextFloat2D());
-        Vector3 lightToSurface = Vector3.Normalize(shader.Point.Position - lightSample.Point.Position);
 
-        if (!scene.Raytracer.IsOccluded(shader.Point, lightSample.Point)) {
-            var emission = light.EmittedRadiance(lightSample.Point, lightToSurface);
+        if (!scene.Raytracer.IsOccluded(shader.Point, lightSample.Point))
+            return EvaluateNextEvent(shader, state, graphVertex, light, lightSample, lightSelectProb);
+        return RgbColor.Black;
+    }
+
+    /// <summary>
+    /// Computes the MIS weighted contribution of a next event sample on an emitter that is known to be
+    /// unoccluded
+    /// </summary>
+    protected virtual RgbColor EvaluateNextEvent(in SurfaceShader shader, in PathState state,
+                                                 PathGraphNode graphVertex, Emitter light,
+                                                 SurfaceSample lightSample, float lightSelectProb) {
+        Vector3 lightToSurface = Vector3.Normalize(shader.Point.Position - lightSample.Point.Position);
+        var emission = light.EmittedRadiance(lightSample.Point, lightToSurface);
 
-            // Compute the jacobian for surface area -> solid angle
-            // (Inverse of the jacobian for solid angle pdf -> surface area pdf)
-            float jacobian = SampleWarp.SurfaceAreaToSolidAngle(shader.Point, lightSample.Point);
-            var bsdfCos = shader.EvaluateWithCosine(-lightToSurface);
+        // Compute the jacobian for surface area -> solid angle
+        // (Inverse of the jacobian for solid angle pdf -> surface area pdf)
+        float jacobian = SampleWarp.SurfaceAreaToSolidAngle(shader.Point, lightSample.Point);
+        var bsdfCos = shader.EvaluateWithCosine(-lightToSurface);
 
-            // Compute surface area PDFs
-            float pdfNextEvt = lightSample.Pdf * lightSelectProb * NumShadowRays;
-            float pdfBsdfSolidAngle = DirectionPdf(shader, -lightToSurface, state);
-            float pdfBsdf = pdfBsdfSolidAngle * jacobian;
+        // Compute surface area PDFs
+        float pdfNextEvt = lightSample.Pdf * lightSelectProb * NumShadowRays;
+        float pdfBsdfSolidAngle = DirectionPdf(shader, -lightToSurface, state);
+        float pdfBsdf = pdfBsdfSolidAngle * jacobian;
 
-            // Avoid Inf / NaN
-            if (jacobian == 0) return RgbColor.Black;
+        // Avoid Inf / NaN
+        if (jacobian == 0) return RgbColor.Black;
 
-            // Compute the resulting balance heuristic weights
-            float pdfRatio = pdfBsdf / pdfNextEvt;
-            float misWeight = EnableBsdfDI ? 1.0f / (pdfRatio + 1) : 1;
+        // Compute the resulting balance heuristic weights
+        float pdfRatio = pdfBsdf / pdfNextEvt;
+        float misWeight = EnableBsdfDI ? 1.0f / (pdfRatio + 1) : 1;
 
-            // Compute the final sample weight, account for the change of variables from light source area
-            // to the hemisphere about the shading point.
-            var pdf = lightSample.Pdf / jacobian * lightSelectProb * NumShadowRays;
-            var contrib = emission / pdf * bsdfCos;
+        // Compute the final sample weight, account for the change of variables from light source area
+        // to the hemisphere about the shading point.
+        var pdf = lightSample.Pdf / jacobian * lightSelectProb * NumShadowRays;
+        var contrib = emission / pdf * bsdfCos;
 
-            RegisterSample(state.Pixel, contrib * state.PrefixWeight, misWeight, state.Depth + 1, true);
-            OnNextEventResult(shader, state, misWeight, contrib);
+        RegisterSample(state.Pixel, contrib * state.PrefixWeight * state.SampleWeight, misWeight, state.Depth + 1, true);
+        OnNextEventResult(shader, state, misWeight, contrib);
 
-            if (contrib != RgbColor.Black)
-                graphVertex?.AddSuccessor(new NextEventNode(lightSample.Point, emission, pdf, bsdfCos, misWeight, state.PrefixWeight));
+        if (contrib != RgbColor.Black)
+            graphVertex?.AddSuccessor(new NextEventNode(lightSample.Point, emission, pdf, bsdfCos, misWeight, state.PrefixWeight));
 
-            return misWeight * contrib;
-        }
-        return RgbColor.Black;
+        return misWeight * contrib;
     }
 
     /// <summary>
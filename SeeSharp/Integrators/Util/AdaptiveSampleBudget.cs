@@ -0,0 +1,110 @@
+namespace SeeSharp.Integrators.Util;
+
+/// <summary>
+/// Distributes a fixed number of samples over the pixels of an image, proportional to the standard
+/// deviation estimated by a <see cref="VarianceLayer"/>. Fractional sample counts are rounded randomly,
+/// and each sample is weighted by the inverse of the expected count, so the per-pixel estimates stay
+/// unbiased even for pixels that receive no sample in an iteration.
+/// </summary>
+public class AdaptiveSampleBudget {
+    /// <summary>
+    /// Fraction of the budget that is distributed uniformly. Must be positive, otherwise pixels with an
+    /// estimated variance of zero are never sampled again, which would introduce bias.
+    /// </summary>
+    public float UniformFraction = 0.1f;
+
+    /// <summary>
+    /// Upper bound on the expected number of samples in a single pixel
+    /// </summary>
+    public float MaxSamplesPerPixel = 16;
+
+    /// <summary>
+    /// Number of pixels that receive at least one sample
+    /// </summary>
+    public int NumActive { get; private set; }
+
+    /// <summary>
+    /// Indices (row * width + col) of the pixels that receive at least one sample. Only the first
+    /// <see cref="NumActive"/> entries are valid.
+    /// </summary>
+    public int[] ActivePixels { get; private set; }
+
+    /// <summary>
+    /// Number of samples in each pixel
+    /// </summary>
+    public int[] SampleCounts { get; private set; }
+
+    /// <summary>
+    /// Weight of each sample in each pixel, the inverse of the expected sample count
+    /// </summary>
+    public float[] SampleWeights { get; private set; }
+
+    /// <summary>
+    /// Total number of samples over all pixels
+    /// </summary>
+    public long TotalSamples { get; private set; }
+
+    /// <summary>
+    /// Computes the sample counts for the next iteration
+    /// </summary>
+    /// <param name="variance">Variance estimate of the previous iterations</param>
+    /// <param name="budget">Expected total number of samples</param>
+    /// <param name="seed">Seed for the random rounding of the sample counts</param>
+    /// <param name="iteration">Index of the iteration, used to seed the random rounding</param>
+    public void Update(VarianceLayer variance, int budget, uint seed, uint iteration) {
+        var image = variance.Image;
+        int width = image.Width, height = image.Height;
+        int numPixels = width * height;
+        if (SampleCounts == null || SampleCounts.Length != numPixels) {
+            ActivePixels = new int[numPixels];
+            SampleCounts = new int[numPixels];
+            SampleWeights = new float[numPixels];
+        }
+
+        // Sum per row, then over all rows in a fixed order, so the result does not depend on the scheduling
+        var rowSums = new double[height];
+        Parallel.For(0, height, row => {
+            double sum = 0;
+            for (int col = 0; col < width; ++col)
+                sum += StdDev(image[col, row, 0]);
+            rowSums[row] = sum;
+        });
+        double total = 0;
+        foreach (double s in rowSums)
+            total += s;
+
+        float uniform = total > 0 ? UniformFraction : 1.0f;
+        float scale = total > 0 ? (float)((1 - uniform) / total) : 0.0f;
+        Parallel.For(0, height, row => {
+            for (int col = 0; col < width; ++col) {
+                int idx = row * width + col;
+                float expected = budget * (StdDev(image[col, row, 0]) * scale + uniform / numPixels);
+                expected = Math.Min(expected, MaxSamplesPerPixel);
+
+                RNG rng = new(seed, (uint)idx, iteration);
+                int count = (int)expected;
+                if (rng.NextFloat() < expected - count)
+                    count++;
+
+                SampleCounts[idx] = count;
+                SampleWeights[idx] = expected > 0 ? 1 / expected : 0;
+            }
+        });
+
+        int numActive = 0;
+        long totalSamples = 0;
+        for (int idx = 0; idx < numPixels; ++idx) {
+            if (SampleCounts[idx] == 0) continue;
+            ActivePixels[numActive++] = idx;
+            totalSamples += SampleCounts[idx];
+        }
+        NumActive = numActive;
+        TotalSamples = totalSamples;
+    }
+
+    /// <summary>
+    /// Minimizing the total variance for a fixed number of samples requires sample counts that are
+    /// proportional to the standard deviation, not the variance.
+    /// </summary>
+    static float StdDev(float variance) => float.IsFinite(variance) && variance > 0 ? MathF.Sqrt(variance) : 0;
+}
@@ -1,23 +1,116 @@
 namespace SeeSharp.Integrators.Util;
 
-public class OutlierReplayCache {
+/// <summary>
+/// Tracks the n largest contributions to each pixel. The outliers of all pixels are stored in flat native
+/// buffers in structure-of-arrays layout, as a small min-heap per pixel, so the cache adds no objects
+/// for the garbage collector to trace regardless of the resolution.
+///
+/// Most contributions are smaller than all tracked outliers of their pixel. These are rejected by
+/// comparing against a per-pixel threshold, without taking the lock of the pixel.
+/// </summary>
+public sealed class OutlierReplayCache : IDisposable {
     public struct PathReplayInfo {
         public RgbColor Weight;
         public int Iteration;
     }
 
-    public void Notify(in Pixel pixel, in PathReplayInfo info) {
-        float w = info.Weight.Average;
+    /// <summary>
+    /// The tracked outliers of a single pixel, in no particular order. The priority of an outlier is the
+    /// average of its weight.
+    /// </summary>
+    public readonly ref struct PixelOutliers {
+        public readonly ReadOnlySpan<float> Priorities;
+        public readonly ReadOnlySpan<int> Iterations;
+        public readonly ReadOnlySpan<RgbColor> Weights;
 
-        if (!float.IsFinite(w)) {
-            // NaN / Inf replay info is logged by the FrameBuffer already
-            return;
+        public int Count => Priorities.Length;
+
+        internal PixelOutliers(ReadOnlySpan<float> priorities, ReadOnlySpan<int> iterations,
+                               ReadOnlySpan<RgbColor> weights) {
+            Priorities = priorities;
+            Iterations = iterations;
+            Weights = weights;
         }
+    }
+
+    public void Notify(in Pixel pixel, in PathReplayInfo info) {
+        if (!IsCandidate(pixel, info, out float w, out int pixelIdx))
+            return;
+
+        ref int pixelLock = ref locks[pixelIdx];
+        SpinWait spin = default;
+        while (Interlocked.CompareExchange(ref pixelLock, 1, 0) != 0)
+            spin.SpinOnce();
 
-        var q = pixelHeaps[pixel.Row * width + pixel.Col];
-        lock (q) {
-            if (q.Count < nMax) q.Enqueue(info, w);
-            else q.EnqueueDequeue(info, w);
+        Insert(pixelIdx, info, w);
+
+        Volatile.Write(ref pixelLock, 0);
+    }
+
+    /// <summary>
+    /// Like <see cref="Notify" />, but without locking. Only safe if no other thread adds outliers to
+    /// the same pixel at the same time, e.g., when merging local splats that are sorted by rows.
+    /// </summary>
+    public void NotifyExclusive(in Pixel pixel, in PathReplayInfo info) {
+        if (IsCandidate(pixel, info, out float w, out int pixelIdx))
+            Insert(pixelIdx, info, w);
+    }
+
+    bool IsCandidate(in Pixel pixel, in PathReplayInfo info, out float w, out int pixelIdx) {
+        w = info.Weight.Average;
+        pixelIdx = pixel.Row * width + pixel.Col;
+
+        // NaN / Inf replay info is logged by the FrameBuffer already
+        if (!float.IsFinite(w) || nMax == 0)
+            return false;
+
+        // The threshold is the smallest tracked outlier once the heap is full. It only ever grows and is
+        // published before the count, so a stale value at worst lets a contribution pass that is rejected
+        // later on.
+        return Volatile.Read(ref counts[pixelIdx]) < nMax || w > Volatile.Read(ref thresholds[pixelIdx]);
+    }
+
+    void Insert(int pixelIdx, in PathReplayInfo info, float w) {
+        long first = (long)pixelIdx * nMax;
+        var prios = priorities.Slice(first, nMax);
+        var iters = iterations.Slice(first, nMax);
+        var wgts = weights.Slice(first, nMax);
+
+        int count = counts[pixelIdx];
+        if (count < nMax) {
+            // Sift up
+            int idx = count;
+            while (idx > 0) {
+                int parent = (idx - 1) / 2;
+                if (prios[parent] <= w) break;
+                prios[idx] = prios[parent];
+                iters[idx] = iters[parent];
+                wgts[idx] = wgts[parent];
+                idx = parent;
+            }
+            prios[idx] = w;
+            iters[idx] = info.Iteration;
+            wgts[idx] = info.Weight;
+            if (count + 1 == nMax)
+                Volatile.Write(ref thresholds[pixelIdx], prios[0]);
+            Volatile.Write(ref counts[pixelIdx], count + 1);
+        } else if (w > prios[0]) {
+            // Replace the smallest and sift down
+            int idx = 0;
+            while (true) {
+                int child = 2 * idx + 1;
+                if (child >= nMax) break;
+                if (child + 1 < nMax && prios[child + 1] < prios[child]) child++;
+                if (prios[child] >= w) break;
+                prios[idx] = prios[child];
+                iters[idx] = iters[child];
+                wgts[idx] = wgts[child];
+                idx = child;
+            }
+            prios[idx] = w;
+            iters[idx] = info.Iteration;
+            wgts[idx] = info.Weight;
+            Volatile.Write(ref thresholds[pixelIdx], prios[0]);
         }
     }
 
@@ -25,14 +118,115 @@ public class OutlierReplayCache {
         this.width = width;
         nMax = n;
 
-        pixelHeaps = new PriorityQueue<PathReplayInfo, float>[width * height];
-        for (int i = 0; i < width * height; ++i)
-            pixelHeaps[i] = new(n + 1);
+        int numPixels = width * height;
+        priorities = new((long)numPixels * n);
+        iterations = new((long)numPixels * n);
+        weights = new((long)numPixels * n);
+        thresholds = new(numPixels);
+        counts = new(numPixels);
+        locks = new(numPixels);
+    }
+
+    /// <returns>
+    /// The tracked outliers of a pixel. Must not be called while other threads are still adding outliers.
+    /// </returns>
+    public PixelOutliers GetOutliers(in Pixel pixel) {
+        int pixelIdx = pixel.Row * width + pixel.Col;
+        long first = (long)pixelIdx * nMax;
+        int count = counts[pixelIdx];
+        return new(priorities.Slice(first, count), iterations.Slice(first, count), weights.Slice(first, count));
+    }
+
+    /// <returns>
+    /// A copy of the tracked outliers of a pixel, as a priority queue that dequeues the smallest first
+    /// </returns>
+    public PriorityQueue<PathReplayInfo, float> GetPixelOutlier(in Pixel pixel) {
+        var outliers = GetOutliers(pixel);
+        PriorityQueue<PathReplayInfo, float> queue = new(outliers.Count);
+        for (int i = 0; i < outliers.Count; ++i)
+            queue.Enqueue(new() { Weight = outliers.Weights[i], Iteration = outliers.Iterations[i] },
+                outliers.Priorities[i]);
+        return queue;
+    }
+
+    /// <summary>
+    /// Writes the iteration indices of the outliers, sorted from the largest to the smallest, into one
+    /// image per rank. Pixels with fewer outliers are left untouched. Runs in parallel over the rows and
+    /// does not allocate.
+    /// </summary>
+    /// <param name="images">One image per tracked outlier, of the same resolution as the cache</param>
+    public void WriteIterationImages(IReadOnlyList<MonochromeImage> images) {
+        Debug.Assert(images.Count >= nMax);
+        int height = (int)(counts.Length / Math.Max(width, 1));
+        Parallel.For(0, height, row => {
+            for (int col = 0; col < width; ++col) {
+                var outliers = GetOutliers(new(col, row));
+                var prios = outliers.Priorities;
+                for (int i = 0; i < prios.Length; ++i) {
+                    // The rank is the number of larger outliers, ties are broken by the position in the heap
+                    int rank = 0;
+                    for (int k = 0; k < prios.Length; ++k) {
+                        if (prios[k] > prios[i] || (prios[k] == prios[i] && k < i))
+                            rank++;
+                    }
+                    images[rank][col, row, 0] = outliers.Iterations[i];
+                }
+            }
+        });
     }
 
-    public PriorityQueue<PathReplayInfo, float> GetPixelOutlier(in Pixel pixel)
-    => pixelHeaps[pixel.Row * width + pixel.Col];
+    /// <summary>
+    /// Writes the tracked outliers of all pixels to a frame buffer checkpoint
+    /// </summary>
+    public void WriteCheckpoint(BinaryWriter writer) {
+        writer.Write((int)counts.Length);
+        for (int i = 0; i < counts.Length; ++i) {
+            var outliers = GetOutliers(new(i % width, i / width));
+            writer.Write(outliers.Count);
+            for (int k = 0; k < outliers.Count; ++k) {
+                writer.Write(outliers.Weights[k].R);
+                writer.Write(outliers.Weights[k].G);
+                writer.Write(outliers.Weights[k].B);
+                writer.Write(outliers.Iterations[k]);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Adds the outliers from a checkpoint. If fewer outliers are tracked now, only the largest ones are kept.
+    /// </summary>
+    public void ReadCheckpoint(BinaryReader reader) {
+        int numPixels = reader.ReadInt32();
+        Debug.Assert(numPixels == counts.Length);
+        for (int i = 0; i < numPixels; ++i) {
+            int count = reader.ReadInt32();
+            for (int k = 0; k < count; ++k) {
+                PathReplayInfo info = new() {
+                    Weight = new(reader.ReadSingle(), reader.ReadSingle(), reader.ReadSingle()),
+                    Iteration = reader.ReadInt32()
+                };
+                NotifyExclusive(new(i % width, i / width), info);
+            }
+        }
+    }
+
+    /// <summary>
+    /// Releases the native memory, the cache must not be used afterwards
+    /// </summary>
+    public void Dispose() {
+        priorities.Dispose();
+        iterations.Dispose();
+        weights.Dispose();
+        thresholds.Dispose();
+        counts.Dispose();
+        locks.Dispose();
+    }
 
-    PriorityQueue<PathReplayInfo, float>[] pixelHeaps;
-    int width, nMax;
+    readonly NativeBuffer<float> priorities;
+    readonly NativeBuffer<int> iterations;
+    readonly NativeBuffer<RgbColor> weights;
+    readonly NativeBuffer<float> thresholds;
+    readonly NativeBuffer<int> counts;
+    readonly NativeBuffer<int> locks;
+    readonly int width, nMax;
 }
@@ -29,6 +29,15 @@ public class RenderTimer {
     Stopwatch timer = new();
     int numIter = 0;
 
+    /// <param name="renderTimeMs">Render time of earlier iterations, e.g., restored from a checkpoint</param>
+    /// <param name="numIterations">Number of these earlier iterations</param>
+    public RenderTimer(long renderTimeMs = 0, int numIterations = 0) {
+        RenderTime = renderTimeMs;
+        numIter = numIterations;
+        if (numIterations > 0)
+            PerIterationCost = renderTimeMs / numIterations;
+    }
+
     /// <summary>
     /// Adds the elapsed time to the frame buffer cost and resets the timer
     /// </summary>
@@ -0,0 +1,283 @@
+namespace SeeSharp.Integrators.Util;
+
+/// <summary>
+/// Order in which the image tiles are handed out to the worker threads
+/// </summary>
+public enum TileOrder {
+    /// <summary> Row by row, left to right </summary>
+    Scanline,
+
+    /// <summary> Z-order curve over the tile grid </summary>
+    Morton,
+
+    /// <summary> Hilbert curve over the tile grid, slightly better locality than Morton order </summary>
+    Hilbert,
+}
+
+/// <summary>
+/// Timing statistics of the tiles rendered by a <see cref="TileScheduler" />, summed over all runs
+/// since the last reset.
+/// </summary>
+/// <param name="NumTiles">Number of tiles the image is split into</param>
+/// <param name="TileSize">Width and height of a tile in pixels</param>
+/// <param name="NumWorkers">Number of worker threads</param>
+/// <param name="MeanTileMs">Average total time spent in a tile</param>
+/// <param name="MaxTileMs">Total time spent in the most expensive tile</param>
+/// <param name="MeanWorkerMs">Average total time a worker spent rendering tiles</param>
+/// <param name="MaxWorkerMs">Total time spent rendering by the busiest worker</param>
+/// <param name="NumSteals">How often a worker took a tile from another worker's queue</param>
+public record struct TileStats(int NumTiles, int TileSize, int NumWorkers, double MeanTileMs,
+                               double MaxTileMs, double MeanWorkerMs, double MaxWorkerMs, long NumSteals) {
+    /// <summary>
+    /// Ratio of the busiest worker's time and the average worker time. 1 means perfect balance.
+    /// </summary>
+    public readonly double Imbalance => MeanWorkerMs > 0 ? MaxWorkerMs / MeanWorkerMs : 1;
+}
+
+/// <summary>
+/// Distributes the pixels of an image over all cores in square tiles. The tiles are sorted along a
+/// space-filling curve and each worker starts with a contiguous range of that sequence, so neighboring
+/// pixels are rendered by the same thread for better cache coherence. Workers that run out of tiles steal
+/// from the back of another worker's range.
+/// </summary>
+public class TileScheduler {
+    /// <summary>
+    /// A rectangular block of pixels, the max coordinates are exclusive
+    /// </summary>
+    public readonly record struct Tile(int MinCol, int MinRow, int MaxCol, int MaxRow) {
+        /// <summary> Number of pixels in the tile </summary>
+        public int NumPixels => (MaxCol - MinCol) * (MaxRow - MinRow);
+    }
+
+    /// <summary>
+    /// Called for every pixel, in arbitrary order and in parallel
+    /// </summary>
+    public delegate void PixelFunc(int col, int row);
+
+    /// <summary> Called for every tile, in arbitrary order and in parallel </summary>
+    public delegate void TileFunc(in Tile tile);
+
+    /// <summary> Width of the image in pixels </summary>
+    public int Width { get; }
+
+    /// <summary> Height of the image in pixels </summary>
+    public int Height { get; }
+
+    /// <summary> Width and height of a tile in pixels </summary>
+    public int TileSize { get; }
+
+    /// <summary> Number of worker threads a run is distributed over </summary>
+    public int NumWorkers { get; }
+
+    /// <summary> All tiles, in the order they are processed </summary>
+    public ReadOnlySpan<Tile> Tiles => tiles;
+
+    /// <summary>
+    /// Total time, in milliseconds, spent in each tile since the last <see cref="ResetStats"/>. Indices
+    /// match <see cref="Tiles" />.
+    /// </summary>
+    public ReadOnlySpan<double> TileTimesMs {
+        get {
+            double[] result = new double[tiles.Length];
+            for (int i = 0; i < tiles.Length; ++i)
+                result[i] = tileTicks[i] * 1000.0 / Stopwatch.Frequency;
+            return result;
+        }
+    }
+
+    /// <summary>
+    /// Splits an image into tiles
+    /// </summary>
+    /// <param name="width">Width of the image in pixels</param>
+    /// <param name="height">Height of the image in pixels</param>
+    /// <param name="tileSize">Width and height of each tile in pixels</param>
+    /// <param name="order">Order along which tiles are assigned to the workers</param>
+    /// <param name="numWorkers">Number of worker threads, defaults to the number of logical cores</param>
+    /// <param name="frameBuffer">
+    /// If given, each tile is rendered inside its own local block of this frame buffer, see
+    /// <see cref="FrameBuffer.BeginLocalBlock" />. The block index is the position of the tile in
+    /// <see cref="Tiles" />.
+    /// </param>
+    public TileScheduler(int width, int height, int tileSize = 16, TileOrder order = TileOrder.Morton,
+                         int? numWorkers = null, FrameBuffer frameBuffer = null) {
+        if (tileSize <= 0)
+            throw new ArgumentOutOfRangeException(nameof(tileSize), "Tile size must be positive");
+
+        Width = width;
+        Height = height;
+        TileSize = tileSize;
+        this.frameBuffer = frameBuffer;
+
+        int numTilesX = (width + tileSize - 1) / tileSize;
+        int numTilesY = (height + tileSize - 1) / tileSize;
+        tiles = new Tile[numTilesX * numTilesY];
+        var keys = new ulong[tiles.Length];
+        for (int ty = 0; ty < numTilesY; ++ty) {
+            for (int tx = 0; tx < numTilesX; ++tx) {
+                int i = ty * numTilesX + tx;
+                tiles[i] = new(tx * tileSize, ty * tileSize,
+                    Math.Min((tx + 1) * tileSize, width), Math.Min((ty + 1) * tileSize, height));
+                keys[i] = order switch {
+                    TileOrder.Morton => MortonCode((uint)tx, (uint)ty),
+                    TileOrder.Hilbert => HilbertCode((uint)tx, (uint)ty, Math.Max(numTilesX, numTilesY)),
+                    _ => (ulong)i,
+                };
+            }
+        }
+        Array.Sort(keys, tiles);
+
+        NumWorkers = Math.Clamp(numWorkers ?? Environment.ProcessorCount, 1, Math.Max(tiles.Length, 1));
+        ranges = new long[NumWorkers];
+        tileTicks = new long[tiles.Length];
+        workerTicks = new long[NumWorkers];
+    }
+
+    /// <summary>
+    /// Calls the given function once for every tile and blocks until all tiles are done.
+    /// </summary>
+    public void Run(TileFunc func) {
+        // Assign each worker a contiguous range of the tile sequence. Begin and end are packed into a single
+        // 64 bit integer so the owner (popping from the front) and thieves (popping from the back) can
+        // both update it with a single compare-exchange.
+        for (int w = 0; w < NumWorkers; ++w) {
+            int begin = (int)((long)tiles.Length * w / NumWorkers);
+            int end = (int)((long)tiles.Length * (w + 1) / NumWorkers);
+            ranges[w] = Pack(begin, end);
+        }
+
+        Parallel.For(0, NumWorkers, new ParallelOptions { MaxDegreeOfParallelism = NumWorkers }, worker => {
+            long busy = 0;
+            while (true) {
+                int tileIdx = PopFront(worker);
+                if (tileIdx < 0) {
+                    tileIdx = Steal(worker);
+                    if (tileIdx < 0) break;
+                }
+
+                long start = Stopwatch.GetTimestamp();
+                if (frameBuffer != null) {
+                    using var _ = frameBuffer.BeginLocalBlock(tileIdx);
+                    func(tiles[tileIdx]);
+                } else {
+                    func(tiles[tileIdx]);
+                }
+                long ticks = Stopwatch.GetTimestamp() - start;
+
+                tileTicks[tileIdx] += ticks; // Each tile is rendered exactly once per run
+                busy += ticks;
+            }
+            workerTicks[worker] += busy;
+        });
+    }
+
+    /// <summary>
+    /// Calls the given function once for every pixel and blocks until all pixels are done.
+    /// </summary>
+    public void Run(PixelFunc func) => Run((in Tile tile) => {
+        for (int row = tile.MinRow; row < tile.MaxRow; ++row)
+            for (int col = tile.MinCol; col < tile.MaxCol; ++col)
+                func(col, row);
+    });
+
+    /// <summary>
+    /// Summary of the tile and worker timings since the last reset
+    /// </summary>
+    public TileStats Stats {
+        get {
+            double toMs = 1000.0 / Stopwatch.Frequency;
+            long maxTile = 0, sumTile = 0, maxWorker = 0, sumWorker = 0;
+            foreach (long t in tileTicks) {
+                maxTile = Math.Max(maxTile, t);
+                sumTile += t;
+            }
+            foreach (long t in workerTicks) {
+                maxWorker = Math.Max(maxWorker, t);
+                sumWorker += t;
+            }
+            return new(tiles.Length, TileSize, NumWorkers,
+                tiles.Length > 0 ? sumTile * toMs / tiles.Length : 0, maxTile * toMs,
+                sumWorker * toMs / NumWorkers, maxWorker * toMs, Interlocked.Read(ref numSteals));
+        }
+    }
+
+    /// <summary>
+    /// Resets all timing statistics to zero
+    /// </summary>
+    public void ResetStats() {
+        Array.Clear(tileTicks);
+        Array.Clear(workerTicks);
+        numSteals = 0;
+    }
+
+    static long Pack(int begin, int end) => ((long)begin << 32) | (uint)end;
+    static (int Begin, int End) Unpack(long range) => ((int)(range >> 32), (int)range);
+
+    int PopFront(int worker) {
+        while (true) {
+            long old = Volatile.Read(ref ranges[worker]);
+            var (begin, end) = Unpack(old);
+            if (begin >= end) return -1;
+            if (Interlocked.CompareExchange(ref ranges[worker], Pack(begin + 1, end), old) == old)
+                return begin;
+        }
+    }
+
+    int PopBack(int worker) {
+        while (true) {
+            long old = Volatile.Read(ref ranges[worker]);
+            var (begin, end) = Unpack(old);
+            if (begin >= end) return -1;
+            if (Interlocked.CompareExchange(ref ranges[worker], Pack(begin, end - 1), old) == old)
+                return end - 1;
+        }
+    }
+
+    int Steal(int thief) {
+        for (int i = 1; i < NumWorkers; ++i) {
+            int idx = PopBack((thief + i) % NumWorkers);
+            if (idx >= 0) {
+                Interlocked.Increment(ref numSteals);
+                return idx;
+            }
+        }
+        return -1;
+    }
+
+    static ulong MortonCode(uint x, uint y) {
+        static ulong Spread(uint v) {
+            ulong r = v;
+            r = (r | (r << 16)) & 0x0000FFFF0000FFFFul;
+            r = (r | (r << 8)) & 0x00FF00FF00FF00FFul;
+            r = (r | (r << 4)) & 0x0F0F0F0F0F0F0F0Ful;
+            r = (r | (r << 2)) & 0x3333333333333333ul;
+            r = (r | (r << 1)) & 0x5555555555555555ul;
+            return r;
+        }
+        return Spread(x) | (Spread(y) << 1);
+    }
+
+    static ulong HilbertCode(uint x, uint y, int gridSize) {
+        uint n = BitOperations.RoundUpToPowerOf2((uint)Math.Max(gridSize, 1));
+        ulong d = 0;
+        for (uint s = n / 2; s > 0; s /= 2) {
+            uint rx = (x & s) > 0 ? 1u : 0u;
+            uint ry = (y & s) > 0 ? 1u : 0u;
+            d += (ulong)s * s * ((3 * rx) ^ ry);
+            if (ry == 0) { // rotate the quadrant
+                if (rx == 1) {
+                    x = n - 1 - x;
+                    y = n - 1 - y;
+                }
+                (x, y) = (y, x);
+            }
+        }
+        return d;
+    }
+
+    readonly FrameBuffer frameBuffer;
+    readonly Tile[] tiles;
+    readonly long[] ranges;
+    readonly long[] tileTicks;
+    readonly long[] workerTicks;
+    long numSteals;
+}
@@ -0,0 +1,448 @@
+namespace SeeSharp.Integrators;
+
+/// <summary>
+/// Breadth-first variant of the <see cref="PathTracer" />. All paths of an image tile are advanced one
+/// bounce at a time: the extension rays of all active paths are traced as one batch, the hits are sorted by
+/// material and shaded, and the shadow rays of all next event estimates are tested as a second batch.
+/// The path state is kept in structure-of-arrays queues that are reused across tiles.
+///
+/// Produces the same estimates as the <see cref="PathTracer" /> with default settings (same random
+/// numbers, MIS weights, Russian roulette, and texture footprints). Light selection can be customized in
+/// the same way, but the other per-vertex virtual hooks and path replay are not available.
+/// </summary>
+public class WavefrontPathTracer : Integrator {
+    /// <summary>
+    /// Used to compute the seeds for all random samplers.
+    /// </summary>
+    public uint BaseSeed = 0xC030114;
+
+    /// <summary>
+    /// Number of samples per pixel to render
+    /// </summary>
+    public int TotalSpp = 20;
+
+    /// <summary>
+    /// The maximum time in milliseconds that should be spent rendering.
+    /// Excludes framebuffer overhead and other operations that are not part of the core rendering logic.
+    /// </summary>
+    public long? MaximumRenderTimeMs;
+
+    /// <summary>
+    /// Number of shadow rays to use for next event estimation at each vertex
+    /// </summary>
+    public int NumShadowRays = 1;
+
+    /// <summary>
+    /// Can be set to false to disable BSDF samples for direct illumination (typically a bad idea to turn
+    /// this off unless to experiment)
+    /// </summary>
+    public bool EnableBsdfDI = true;
+
+    /// <summary>
+    /// If set to true (default) runs Intel Open Image Denoise after the end of the last rendering iteration
+    /// </summary>
+    public bool EnableDenoiser = true;
+
+    /// <summary>
+    /// Sets a larger default tile size than the other integrators, so each wavefront holds enough paths
+    /// to amortize the per-bounce overhead.
+    /// </summary>
+    public WavefrontPathTracer() {
+        TileSize = 64;
+    }
+
+    /// <summary>
+    /// Structure-of-arrays state of all paths in a tile, plus the ray and shadow ray queues
+    /// </summary>
+    class PathQueue {
+        public readonly int Capacity;
+
+        public readonly Pixel[] Pixels;
+        public readonly RNG[] Rngs;
+        public readonly Ray[] Rays;
+        public readonly RayFootprint[] Footprints;
+        public readonly Hit[] Hits;
+        public readonly Ray[] BatchRays;
+        public readonly Hit[] BatchHits;
+        public readonly RgbColor[] PrefixWeights;
+        public readonly RgbColor[] ApproxThroughputs;
+        public readonly RgbColor[] Estimates;
+        public readonly SurfacePoint[] PreviousHits;
+        public readonly float[] PreviousPdfs;
+
+        // Prefix weight and survival probability at the current bounce, applied to the next event
+        // estimates once the shadow rays are resolved
+        public readonly RgbColor[] NextEventPrefixWeights;
+        public readonly float[] SurvivalProbs;
+
+        // Indices of the paths that are still alive, and the same indices sorted by material
+        public int[] Active, NextActive;
+        public int NumActive;
+        public readonly int[] Sorted;
+        public readonly int[] MaterialKeys;
+        public int[] MaterialCounts = [];
+
+        public ShadowRay[] ShadowRays = [];
+        public RgbColor[] ShadowContribs = [];
+        public int[] ShadowPaths = [];
+        public bool[] Occluded = [];
+        public int NumShadowRays;
+
+        public PathQueue(int capacity) {
+            Capacity = capacity;
+            Pixels = new Pixel[capacity];
+            Rngs = new RNG[capacity];
+            Rays = new Ray[capacity];
+            Footprints = new RayFootprint[capacity];
+            Hits = new Hit[capacity];
+            BatchRays = new Ray[capacity];
+            BatchHits = new Hit[capacity];
+            PrefixWeights = new RgbColor[capacity];
+            ApproxThroughputs = new RgbColor[capacity];
+            Estimates = new RgbColor[capacity];
+            PreviousHits = new SurfacePoint[capacity];
+            PreviousPdfs = new float[capacity];
+            NextEventPrefixWeights = new RgbColor[capacity];
+            SurvivalProbs = new float[capacity];
+            Active = new int[capacity];
+            NextActive = new int[capacity];
+            Sorted = new int[capacity];
+            MaterialKeys = new int[capacity];
+        }
+
+        public void AddShadowRay(in ShadowRay ray, RgbColor contrib, int path) {
+            if (NumShadowRays == ShadowRays.Length) {
+                int size = Math.Max(2 * ShadowRays.Length, Capacity);
+                Array.Resize(ref ShadowRays, size);
+                Array.Resize(ref ShadowContribs, size);
+                Array.Resize(ref ShadowPaths, size);
+                Array.Resize(ref Occluded, size);
+            }
+            ShadowRays[NumShadowRays] = ray;
+            ShadowContribs[NumShadowRays] = contrib;
+            ShadowPaths[NumShadowRays] = path;
+            NumShadowRays++;
+        }
+    }
+
+    /// <summary>
+    /// The scene that is being rendered.
+    /// </summary>
+    protected Scene scene;
+
+    DenoiseBuffers denoiseBuffers;
+    Dictionary<Material, int> materialIds;
+    ThreadLocal<PathQueue> queues;
+
+    /// <summary>
+    /// Renders a scene with the current settings. Only one scene can be rendered at a time.
+    /// </summary>
+    public override void Render(Scene scene) {
+        this.scene = scene;
+
+        if (EnableDenoiser)
+            denoiseBuffers = new(scene.FrameBuffer);
+
+        // Dense material indices used as sort keys for coherent shading
+        materialIds = new(ReferenceEqualityComparer.Instance);
+        foreach (var mesh in scene.Meshes)
+            materialIds.TryAdd(mesh.Material, materialIds.Count);
+
+        ProgressBar progressBar = new(prefix: "Rendering...");
+        var (firstIteration, endIteration) = GetIterationRange(scene, TotalSpp);
+        // A partial range would only denoise its own iterations, the merged image is denoised instead
+        bool denoise = EnableDenoiser && !IsPartialRange(scene, TotalSpp);
+        progressBar.Start((int)(endIteration - firstIteration));
+        RenderTimer timer = MakeRenderTimer(scene);
+        TileScheduler tiles = MakeTileScheduler(scene);
+        queues = new(() => new(TileSize * TileSize));
+        ShadingStatCounter.Reset();
+        TextureCache.Shared?.ResetStats();
+        scene.Raytracer.ResetStats();
+        for (uint sampleIndex = firstIteration; sampleIndex < endIteration; ++sampleIndex) {
+            long nextIterTime = timer.RenderTime + timer.PerIterationCost;
+            if (MaximumRenderTimeMs.HasValue && nextIterTime > MaximumRenderTimeMs.Value) {
+                Logger.Log("Maximum render time exhausted.");
+                if (denoise) denoiseBuffers.Denoise();
+                progressBar.Terminate();
+                break;
+            }
+            timer.StartIteration();
+
+            scene.FrameBuffer.StartIteration();
+            timer.EndFrameBuffer();
+
+            tiles.Run((in TileScheduler.Tile tile) => RenderTile(tile, sampleIndex, queues.Value));
+            timer.EndRender();
+
+            if (sampleIndex == TotalSpp - 1 && denoise)
+                denoiseBuffers.Denoise();
+            scene.FrameBuffer.EndIteration();
+            timer.EndFrameBuffer();
+
+            progressBar.ReportDone(1);
+            timer.EndIteration();
+        }
+
+        scene.FrameBuffer.MetaData["RenderTime"] = timer.RenderTime;
+        scene.FrameBuffer.SetFrameBufferTime(timer.FrameBufferTime);
+        scene.FrameBuffer.MetaData["ShadingStats"] = ShadingStatCounter.Current;
+        if (TextureCache.Shared != null)
+            scene.FrameBuffer.MetaData["TextureCacheStats"] = TextureCache.Shared.Stats;
+        scene.FrameBuffer.MetaData["RayTracerStats"] = scene.Raytracer.Stats;
+        scene.FrameBuffer.MetaData["TileStats"] = tiles.Stats;
+
+        queues.Dispose();
+        queues = null;
+        FramePool.Trim();
+    }
+
+    void RenderTile(in TileScheduler.Tile tile, uint sampleIndex, PathQueue q) {
+        // Generate the camera rays of all pixels in the tile
+        int numPaths = 0;
+        for (int row = tile.MinRow; row < tile.MaxRow; ++row) {
+            for (int col = tile.MinCol; col < tile.MaxCol; ++col) {
+                int p = numPaths++;
+                uint pixelIndex = (uint)(row * scene.FrameBuffer.Width + col);
+                q.Rngs[p] = new(BaseSeed, pixelIndex, sampleIndex);
+                var offset = q.Rngs[p].NextFloat2D();
+                var cameraSample = scene.Camera.GenerateRay(new Vector2(col, row) + offset, ref q.Rngs[p]);
+                q.Rays[p] = cameraSample.Ray;
+                q.Footprints[p] = new(cameraSample.Differential);
+                q.Pixels[p] = new(col, row);
+                q.PrefixWeights[p] = RgbColor.White;
+                q.ApproxThroughputs[p] = RgbColor.White;
+                q.Estimates[p] = RgbColor.Black;
+                q.Active[p] = p;
+            }
+        }
+        q.NumActive = numPaths;
+
+        for (uint depth = 1; depth <= MaxDepth && q.NumActive > 0; ++depth) {
+            TraceExtensionRays(q);
+            HandleMisses(q, depth);
+            SortByMaterial(q);
+            Shade(q, depth);
+            TraceShadowRays(q);
+        }
+
+        for (int p = 0; p < numPaths; ++p)
+            scene.FrameBuffer.Splat(q.Pixels[p], q.Estimates[p]);
+    }
+
+    /// <summary>
+    /// Gathers the rays of all active paths into a dense batch, traces them, and scatters the hits back
+    /// </summary>
+    void TraceExtensionRays(PathQueue q) {
+        int n = q.NumActive;
+        for (int i = 0; i < n; ++i)
+            q.BatchRays[i] = q.Rays[q.Active[i]];
+        scene.Raytracer.Trace(q.BatchRays.AsSpan(0, n), q.BatchHits.AsSpan(0, n));
+        for (int i = 0; i < n; ++i)
+            q.Hits[q.Active[i]] = q.BatchHits[i];
+    }
+
+    /// <summary>
+    /// Adds the background contribution of all paths that left the scene and removes them from the queue
+    /// </summary>
+    void HandleMisses(PathQueue q, uint depth) {
+        int numAlive = 0;
+        for (int i = 0; i < q.NumActive; ++i) {
+            int p = q.Active[i];
+            if (q.Hits[p]) {
+                q.Active[numAlive++] = p;
+                continue;
+            }
+
+            if (depth < MinDepth || scene.Background == null || !EnableBsdfDI)
+                continue;
+
+            Vector3 dir = q.Rays[p].Direction;
+            float misWeight = 1.0f;
+            if (depth > 1) {
+                float pdfNextEvent = scene.Background.DirectionPdf(dir) * NumShadowRays;
+                misWeight = 1 / (1 + pdfNextEvent / q.PreviousPdfs[p]);
+            }
+            var emission = scene.Background.EmittedRadiance(dir);
+            q.Estimates[p] += q.PrefixWeights[p] * misWeight * emission;
+        }
+        q.NumActive = numAlive;
+    }
+
+    /// <summary>
+    /// Stable counting sort of the active paths by the material at their hit point
+    /// </summary>
+    void SortByMaterial(PathQueue q) {
+        int numMaterials = materialIds.Count;
+        if (q.MaterialCounts.Length < numMaterials + 1)
+            q.MaterialCounts = new int[numMaterials + 1];
+        var counts = q.MaterialCounts.AsSpan(0, numMaterials + 1);
+        counts.Clear();
+
+        for (int i = 0; i < q.NumActive; ++i) {
+            int p = q.Active[i];
+            int key = materialIds[((SurfacePoint)q.Hits[p]).Material];
+            q.MaterialKeys[p] = key;
+            counts[key + 1]++;
+        }
+        for (int k = 1; k <= numMaterials; ++k)
+            counts[k] += counts[k - 1];
+        for (int i = 0; i < q.NumActive; ++i) {
+            int p = q.Active[i];
+            q.Sorted[counts[q.MaterialKeys[p]]++] = p;
+        }
+    }
+
+    /// <summary>
+    /// Handles emitter hits, Russian roulette, next event, and BSDF sampling for all active paths, in
+    /// material order. Next event only queues shadow rays, their contribution is added by
+    /// <see cref="TraceShadowRays" />.
+    /// </summary>
+    void Shade(PathQueue q, uint depth) {
+        q.NumShadowRays = 0;
+        int numAlive = 0;
+        for (int i = 0; i < q.NumActive; ++i) {
+            int p = q.Sorted[i];
+            ref RNG rng = ref q.Rngs[p];
+            SurfacePoint hit = q.Hits[p];
+            hit.FootprintWidth = q.Footprints[p].Advance(q.Rays[p], hit);
+            Vector3 outDir = -q.Rays[p].Direction;
+            SurfaceShader shader = new(hit, outDir, false);
+
+            if (depth == 1 && EnableDenoiser) {
+                var albedo = shader.GetScatterStrength();
+                denoiseBuffers.LogPrimaryHit(q.Pixels[p], albedo, hit.ShadingNormal);
+            }
+
+            // Check if a light source was hit
+            Emitter light = scene.QueryEmitter(hit);
+            if (light != null && depth >= MinDepth) {
+                float misWeight = 1.0f;
+                if (depth > 1) {
+                    var jacobian = SampleWarp.SurfaceAreaToSolidAngle(q.PreviousHits[p], hit);
+                    float lightSelectProb = SelectLightPmf(q.PreviousHits[p], light);
+                    float pdfNextEvt = light.PdfUniformArea(hit) * lightSelectProb * NumShadowRays / jacobian;
+                    misWeight = EnableBsdfDI ? 1 / (pdfNextEvt / q.PreviousPdfs[p] + 1) : 0;
+                }
+                var emission = light.EmittedRadiance(hit, outDir);
+                q.Estimates[p] += q.PrefixWeights[p] * misWeight * emission;
+            }
+
+            // Path termination with Russian roulette
+            float survivalProb = depth > 4 ? Math.Clamp(q.ApproxThroughputs[p].Average, 0.05f, 0.95f) : 1.0f;
+            if (rng.NextFloat() > survivalProb || depth == MaxDepth)
+                continue;
+
+            q.NextEventPrefixWeights[p] = q.PrefixWeights[p];
+            q.SurvivalProbs[p] = survivalProb;
+            if (depth + 1 >= MinDepth) {
+                for (int k = 0; k < NumShadowRays; ++k) {
+                    QueueBackgroundNextEvent(q, p, shader);
+                    QueueNextEvent(q, p, shader);
+                }
+            }
+
+            // Sample a direction to continue the random walk
+            var bsdfSample = shader.Sample(rng.NextFloat(), rng.NextFloat2D());
+            if (bsdfSample.Pdf == 0 || bsdfSample.Weight == RgbColor.Black)
+                continue;
+
+            q.PrefixWeights[p] *= bsdfSample.Weight / survivalProb;
+            q.ApproxThroughputs[p] *= bsdfSample.Weight / survivalProb;
+            q.PreviousHits[p] = hit;
+            q.PreviousPdfs[p] = bsdfSample.Pdf * survivalProb;
+            q.Rays[p] = Raytracer.SpawnRay(hit, bsdfSample.Direction);
+            q.NextActive[numAlive++] = p;
+        }
+
+        (q.Active, q.NextActive) = (q.NextActive, q.Active);
+        q.NumActive = numAlive;
+    }
+
+    /// <summary>
+    /// Used by next event estimation to select a light source. The default uses the light hierarchy of
+    /// the scene to select lights based on their power, distance, and orientation.
+    /// </summary>
+    /// <param name="from">A point on a surface where next event is performed</param>
+    /// <param name="rng">Random number generator</param>
+    /// <returns>The selected light and the discrete probability of selecting that light</returns>
+    protected virtual (Emitter, float) SelectLight(in SurfacePoint from, ref RNG rng)
+    => scene.SampleEmitter(from, rng.NextFloat());
+
+    /// <returns>
+    /// The discrete probability of selecting the given light when performing next event at the given
+    /// shading point.
+    /// </returns>
+    protected virtual float SelectLightPmf(in SurfacePoint from, Emitter em)
+    => scene.EmitterProbability(from, em);
+
+    void QueueBackgroundNextEvent(PathQueue q, int p, in SurfaceShader shader) {
+        if (scene.Background == null)
+            return;
+
+        var sample = scene.Background.SampleDirection(q.Rngs[p].NextFloat2D());
+        var bsdfTimesCosine = shader.EvaluateWithCosine(sample.Direction);
+        var pdfBsdf = shader.Pdf(sample.Direction).Pdf;
+        if (pdfBsdf == 0 || sample.Pdf == 0)
+            return;
+
+        float misWeight = EnableBsdfDI ? 1 / (1.0f + pdfBsdf / (sample.Pdf * NumShadowRays)) : 1;
+        var contrib = sample.Weight * bsdfTimesCosine / NumShadowRays;
+        if (contrib == RgbColor.Black)
+            return;
+
+        q.AddShadowRay(Raytracer.MakeBackgroundShadowRay(shader.Point, sample.Direction), misWeight * contrib, p);
+    }
+
+    void QueueNextEvent(PathQueue q, int p, in SurfaceShader shader) {
+        if (scene.Emitters.Count == 0)
+            return;
+
+        ref RNG rng = ref q.Rngs[p];
+        var (light, lightSelectProb) = SelectLight(shader.Point, ref rng);
+        if (light == null)
+            return;
+
+        var lightSample = light.SampleUniformArea(rng.NextFloat2D());
+        Vector3 lightToSurface = Vector3.Normalize(shader.Point.Position - lightSample.Point.Position);
+        float jacobian = SampleWarp.SurfaceAreaToSolidAngle(shader.Point, lightSample.Point);
+        if (jacobian == 0)
+            return;
+
+        var emission = light.EmittedRadiance(lightSample.Point, lightToSurface);
+        var bsdfCos = shader.EvaluateWithCosine(-lightToSurface);
+
+        float pdfNextEvt = lightSample.Pdf * lightSelectProb * NumShadowRays;
+        float pdfBsdf = shader.Pdf(-lightToSurface).Pdf * jacobian;
+        float misWeight = EnableBsdfDI ? 1.0f / (pdfBsdf / pdfNextEvt + 1) : 1;
+
+        var pdf = lightSample.Pdf / jacobian * lightSelectProb * NumShadowRays;
+        var contrib = emission / pdf * bsdfCos;
+        if (contrib == RgbColor.Black)
+            return;
+
+        q.AddShadowRay(Raytracer.MakeShadowRay(shader.Point, lightSample.Point), misWeight * contrib, p);
+    }
+
+    /// <summary>
+    /// Tests all queued shadow rays in one batch and adds the next event contributions that are visible
+    /// </summary>
+    void TraceShadowRays(PathQueue q) {
+        int n = q.NumShadowRays;
+        if (n == 0) return;
+
+        scene.Raytracer.IsOccluded(q.ShadowRays.AsSpan(0, n), q.Occluded.AsSpan(0, n));
+
+        // Shadow rays of a path are queued back-to-back, in the same order the PathTracer adds them
+        int first = 0;
+        while (first < n) {
+            int p = q.ShadowPaths[first];
+            RgbColor sum = RgbColor.Black;
+            int i = first;
+            for (; i < n && q.ShadowPaths[i] == p; ++i)
+                if (!q.Occluded[i]) sum += q.ShadowContribs[i];
+            q.Estimates[p] += q.NextEventPrefixWeights[p] * sum / q.SurvivalProbs[p];
+            first = i;
+        }
+    }
+}
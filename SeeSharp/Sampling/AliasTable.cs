@@ -0,0 +1,99 @@
+namespace SeeSharp.Sampling;
+
+/// <summary>
+/// Discrete distribution that can be sampled in constant time via Walker's alias method. Cannot be
+/// inverted like <see cref="PiecewiseConstantPDF" />, but is much faster for large numbers of bins.
+/// </summary>
+public class AliasTable {
+    struct Bin {
+        public float Threshold;
+        public int Alias;
+        public float Probability;
+    }
+
+    /// <summary>
+    /// Builds the table from the given non-normalized weights. If all weights are zero, the distribution
+    /// is uniform.
+    /// </summary>
+    /// <param name="weights">The non-normalized weight of each bin, must not be negative</param>
+    public AliasTable(params ReadOnlySpan<float> weights) {
+        int n = weights.Length;
+        bins = new Bin[n];
+        if (n == 0) return;
+
+        double total = 0;
+        foreach (float w in weights) {
+            Debug.Assert(w >= 0 && float.IsFinite(w));
+            total += w;
+        }
+
+        // Vose's method: split into bins with more and with less than average weight, and fill up each
+        // underfull bin with the remainder of an overfull one.
+        var scaled = new double[n];
+        var small = new Stack<int>();
+        var large = new Stack<int>();
+        for (int i = 0; i < n; ++i) {
+            double p = total > 0 ? weights[i] / total : 1.0 / n;
+            bins[i].Probability = (float)p;
+            scaled[i] = p * n;
+            if (scaled[i] < 1) small.Push(i);
+            else large.Push(i);
+        }
+
+        while (small.Count > 0 && large.Count > 0) {
+            int s = small.Pop();
+            int l = large.Peek();
+            bins[s].Threshold = (float)scaled[s];
+            bins[s].Alias = l;
+            scaled[l] = scaled[l] + scaled[s] - 1;
+            if (scaled[l] < 1) {
+                large.Pop();
+                small.Push(l);
+            }
+        }
+
+        // Remaining bins are (up to rounding errors) exactly full
+        foreach (int i in large) {
+            bins[i].Threshold = 1;
+            bins[i].Alias = i;
+        }
+        foreach (int i in small) {
+            bins[i].Threshold = 1;
+            bins[i].Alias = i;
+        }
+    }
+
+    /// <summary>
+    /// Number of bins in the distribution
+    /// </summary>
+    public int Count => bins.Length;
+
+    /// <summary>
+    /// Selects a bin with probability proportional to its weight
+    /// </summary>
+    /// <param name="primarySample">A primary sample in [0,1)</param>
+    /// <returns>Index of the selected bin</returns>
+    public int Sample(float primarySample) {
+        float scaled = primarySample * bins.Length;
+        int idx = Math.Min((int)scaled, bins.Length - 1);
+        ref var bin = ref bins[idx];
+        return scaled - idx < bin.Threshold ? idx : bin.Alias;
+    }
+
+    /// <summary>
+    /// Selects a bin for each primary sample, see <see cref="Sample(float)"/>
+    /// </summary>
+    /// <param name="primarySamples">Primary samples in [0,1)</param>
+    /// <param name="binIndices">Receives the index of the selected bin for each sample</param>
+    public void Sample(ReadOnlySpan<float> primarySamples, Span<int> binIndices) {
+        Debug.Assert(binIndices.Length >= primarySamples.Length);
+        for (int i = 0; i < primarySamples.Length; ++i)
+            binIndices[i] = Sample(primarySamples[i]);
+    }
+
+    /// <param name="idx">Index of a bin</param>
+    /// <returns>The probability that <see cref="Sample(float)" /> returns this bin</returns>
+    public float Probability(int idx) => bins[idx].Probability;
+
+    readonly Bin[] bins;
+}
@@ -0,0 +1,204 @@
+using System.Linq;
+
+namespace SeeSharp.Sampling;
+
+/// <summary>
+/// A piecewise constant 2D pdf on a regular grid over the unit square, sampled by hierarchical sample
+/// warping: a sum pyramid (like a mip map) of the grid is traversed from the coarsest level down, and the
+/// primary sample is rescaled at each split. Sampling and inversion take O(log n) steps through flat
+/// arrays, and the warp is continuous and invertible.
+/// </summary>
+public class HierarchicalGrid2d {
+    /// <param name="resX">Number of columns</param>
+    /// <param name="resY">Number of rows</param>
+    public HierarchicalGrid2d(int resX, int resY) {
+        numCols = resX;
+        numRows = resY;
+        density = new float[resX * resY];
+    }
+
+    /// <summary>
+    /// Records a density value in a grid cell.
+    /// The distribution will no longer be normalized after calling this function.
+    /// </summary>
+    public void Splat(int col, int row, float value) => density[row * numCols + col] += value;
+
+    /// <summary>
+    /// Builds the sum pyramid. Must be called after all values have been splatted and before sampling.
+    /// If the grid is all zero, it is replaced by a uniform density.
+    /// </summary>
+    public void Normalize() {
+        // The finest level is padded to powers of two with zeros, so each level halves the previous one
+        int cols = (int)BitOperations.RoundUpToPowerOf2((uint)numCols);
+        int rows = (int)BitOperations.RoundUpToPowerOf2((uint)numRows);
+        List<(float[], int, int)> result = [];
+
+        var finest = new float[cols * rows];
+        Parallel.For(0, numRows, row => {
+            Array.Copy(density, row * numCols, finest, row * cols, numCols);
+        });
+        result.Add((finest, cols, rows));
+
+        while (cols > 1 || rows > 1) {
+            var (child, childCols, childRows) = result[^1];
+            cols = Math.Max(1, cols / 2);
+            rows = Math.Max(1, rows / 2);
+            var level = new float[cols * rows];
+            int dx = childCols / cols, dy = childRows / rows;
+            int width = cols;
+            Parallel.For(0, rows, row => {
+                for (int col = 0; col < width; ++col) {
+                    float sum = 0;
+                    for (int y = 0; y < dy; ++y)
+                        for (int x = 0; x < dx; ++x)
+                            sum += child[(row * dy + y) * childCols + col * dx + x];
+                    level[row * width + col] = sum;
+                }
+            });
+            result.Add((level, cols, rows));
+        }
+
+        if (result[^1].Item1[0] <= 0) {
+            Array.Fill(density, 1.0f);
+            Normalize();
+            return;
+        }
+
+        levels = result.Select(l => l.Item1).ToArray();
+        levelCols = result.Select(l => l.Item2).ToArray();
+        levelRows = result.Select(l => l.Item3).ToArray();
+        total = levels[^1][0];
+    }
+
+    /// <summary>
+    /// Applies a clipping operation to alter the PDF to only sample the strongest regions. This only makes
+    /// sense when used in an MIS / mixture combination.
+    /// Applies the logic of: Karlik et al. 2019. MIS Compensation (SIGGRAPH Asia)
+    /// The PDF is correctly normalized at the end.
+    /// </summary>
+    public void ApplyMISCompensation() {
+        float avg = 0;
+        foreach (float v in density)
+            avg += v;
+        avg /= density.Length;
+
+        for (int i = 0; i < density.Length; ++i)
+            density[i] = Math.Max(density[i] - avg, 0.0f);
+
+        Normalize();
+    }
+
+    /// <summary>
+    /// Applies the primary space sample warp that is described by this grid.
+    /// </summary>
+    /// <param name="primary">Primary space sample location</param>
+    /// <returns>The sample position in the 2d unit square</returns>
+    public Vector2 Sample(Vector2 primary) {
+        float u = primary.X, v = primary.Y;
+        int col = 0, row = 0;
+        for (int l = levels.Length - 1; l > 0; --l) {
+            var child = levels[l - 1];
+            int childCols = levelCols[l - 1];
+            bool splitX = childCols > levelCols[l];
+            bool splitY = levelRows[l - 1] > levelRows[l];
+            if (splitX) col *= 2;
+            if (splitY) row *= 2;
+
+            if (splitX) {
+                float left = child[row * childCols + col];
+                float right = child[row * childCols + col + 1];
+                if (splitY) {
+                    left += child[(row + 1) * childCols + col];
+                    right += child[(row + 1) * childCols + col + 1];
+                }
+                float pLeft = SplitRatio(left, right);
+                if (u < pLeft) {
+                    u /= pLeft;
+                } else {
+                    u = (u - pLeft) / (1 - pLeft);
+                    col++;
+                }
+                u = Math.Min(u, OneMinusEpsilon);
+            }
+
+            if (splitY) {
+                float top = child[row * childCols + col];
+                float bottom = child[(row + 1) * childCols + col];
+                float pTop = SplitRatio(top, bottom);
+                if (v < pTop) {
+                    v /= pTop;
+                } else {
+                    v = (v - pTop) / (1 - pTop);
+                    row++;
+                }
+                v = Math.Min(v, OneMinusEpsilon);
+            }
+        }
+
+        return new((col + u) / numCols, (row + v) / numRows);
+    }
+
+    /// <summary>
+    /// Inverts the sample warp, i.e., computes the primary sample that is mapped to the given position
+    /// </summary>
+    public Vector2 SampleInverse(Vector2 sample) {
+        float x = Math.Clamp(sample.X * numCols, 0, numCols * OneMinusEpsilon);
+        float y = Math.Clamp(sample.Y * numRows, 0, numRows * OneMinusEpsilon);
+        int col = (int)x, row = (int)y;
+        float u = x - col, v = y - row;
+
+        for (int l = 1; l < levels.Length; ++l) {
+            var child = levels[l - 1];
+            int childCols = levelCols[l - 1];
+            bool splitX = childCols > levelCols[l];
+            bool splitY = levelRows[l - 1] > levelRows[l];
+            int col0 = splitX ? col & ~1 : col;
+            int row0 = splitY ? row & ~1 : row;
+
+            // Undo the splits in the opposite order of Sample()
+            if (splitY) {
+                float top = child[row0 * childCols + col];
+                float bottom = child[(row0 + 1) * childCols + col];
+                float pTop = SplitRatio(top, bottom);
+                v = row == row0 ? v * pTop : pTop + v * (1 - pTop);
+            }
+
+            if (splitX) {
+                float left = child[row0 * childCols + col0];
+                float right = child[row0 * childCols + col0 + 1];
+                if (splitY) {
+                    left += child[(row0 + 1) * childCols + col0];
+                    right += child[(row0 + 1) * childCols + col0 + 1];
+                }
+                float pLeft = SplitRatio(left, right);
+                u = col == col0 ? u * pLeft : pLeft + u * (1 - pLeft);
+            }
+
+            col = splitX ? col / 2 : col;
+            row = splitY ? row / 2 : row;
+        }
+        return new(u, v);
+    }
+
+    /// <returns>The density of sampling the given position on the unit square</returns>
+    public float Pdf(Vector2 pos) {
+        int row = Math.Clamp((int)(pos.Y * numRows), 0, numRows - 1);
+        int col = Math.Clamp((int)(pos.X * numCols), 0, numCols - 1);
+        return levels[0][row * levelCols[0] + col] / total * (numRows * numCols);
+    }
+
+    /// <summary>
+    /// Fraction of the primary sample space assigned to the first of two cells. Zero-density cells can
+    /// only be reached by the inverse, which splits them evenly.
+    /// </summary>
+    static float SplitRatio(float first, float second) => first + second > 0 ? first / (first + second) : 0.5f;
+
+    const float OneMinusEpsilon = 0.99999994f;
+
+    readonly float[] density;
+    readonly int numCols, numRows;
+
+    float[][] levels;
+    int[] levelCols, levelRows;
+    float total;
+}
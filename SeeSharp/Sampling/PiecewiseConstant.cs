@@ -1,4 +1,7 @@
-﻿namespace SeeSharp.Sampling;
+﻿using System.Runtime.CompilerServices;
+using System.Runtime.InteropServices;
+
+namespace SeeSharp.Sampling;
 
 /// <summary>
 /// A piece-wise constant PDF / discrete probability to sample from
@@ -11,15 +14,15 @@ public class PiecewiseConstantPDF {
     /// <param name="weights">The non-normalized weights of each bin</param>
     public PiecewiseConstantPDF(params ReadOnlySpan<float> weights) {
         // Compute unnormalized cdf
-        cdf = new List<float>(weights.Length);
+        cdf = new float[weights.Length];
         float sum = 0;
-        foreach (float w in weights) {
-            cdf.Add(sum += w);
+        for (int i = 0; i < weights.Length; ++i) {
+            cdf[i] = sum += weights[i];
         }
 
         // Normalize
         float total = cdf[^1];
-        for (int i = 0; i < cdf.Count && total > 0.0f; ++i) {
+        for (int i = 0; i < cdf.Length && total > 0.0f; ++i) {
             cdf[i] /= total;
             Debug.Assert(float.IsFinite(cdf[i]));
         }
@@ -28,6 +31,21 @@ public class PiecewiseConstantPDF {
         cdf[^1] = 1.0f;
     }
 
+    PiecewiseConstantPDF(float[] cdf) {
+        this.cdf = cdf;
+    }
+
+    /// <summary>
+    /// Creates the distribution from a previously computed CDF, e.g., one loaded from a cache
+    /// </summary>
+    /// <param name="cdf">
+    /// The normalized CDF, as returned by <see cref="Cdf"/>. The array is used directly, not copied.
+    /// </param>
+    public static PiecewiseConstantPDF FromCdf(float[] cdf) {
+        Debug.Assert(cdf.Length > 0 && cdf[^1] == 1.0f);
+        return new(cdf);
+    }
+
     /// <summary>
     /// Transforms a primary sample to one distributed according to the
     /// piecewise constant density encoded by this object.
@@ -35,22 +53,108 @@ public class PiecewiseConstantPDF {
     /// <param name="primarySample">A primary sample in [0,1]</param>
     /// <returns>The bin index, and the relative position within the bin.</returns>
     public (int BinIndex, float RelativePosition) Sample(float primarySample) {
-        // Find the index of the next greater (or exact) match in the CDF
-        int idx = cdf.BinarySearch(primarySample);
-        if (idx < 0) idx = ~idx;
-        else // Make sure we find the first element, some might have zero probability!
-            for (; idx > 0 && cdf[idx - 1] == primarySample; --idx) { }
+        // The first bin whose CDF is greater or equal, this skips over bins with zero probability
+        int idx = LowerBound(cdf, primarySample);
+        return (idx, RelativePosition(idx, primarySample));
+    }
+
+    /// <summary>
+    /// Samples a batch of bins. Four searches are interleaved, so their memory accesses overlap.
+    /// </summary>
+    /// <param name="primarySamples">Primary samples in [0,1]</param>
+    /// <param name="binIndices">Receives the bin index for each primary sample</param>
+    public void Sample(ReadOnlySpan<float> primarySamples, Span<int> binIndices) {
+        Debug.Assert(binIndices.Length >= primarySamples.Length);
+
+        int i = 0;
+        if (cdf.Length > SmallSize) {
+            for (; i + 4 <= primarySamples.Length; i += 4)
+                LowerBound4(cdf, primarySamples.Slice(i, 4), binIndices.Slice(i, 4));
+        }
+        for (; i < primarySamples.Length; ++i)
+            binIndices[i] = LowerBound(cdf, primarySamples[i]);
+    }
+
+    /// <summary>
+    /// Samples a batch of bins and the positions within them, see <see cref="Sample(float)"/>
+    /// </summary>
+    /// <param name="primarySamples">Primary samples in [0,1]</param>
+    /// <param name="binIndices">Receives the bin index for each primary sample</param>
+    /// <param name="relativePositions">Receives the relative position within each bin</param>
+    public void Sample(ReadOnlySpan<float> primarySamples, Span<int> binIndices, Span<float> relativePositions) {
+        Sample(primarySamples, binIndices);
+        for (int i = 0; i < primarySamples.Length; ++i)
+            relativePositions[i] = RelativePosition(binIndices[i], primarySamples[i]);
+    }
 
-        // Compute the relative position within the constant region
+    float RelativePosition(int idx, float primarySample) {
         float lo = idx == 0 ? 0 : cdf[idx - 1];
         float delta = cdf[idx] - lo;
-        float relative = (primarySample - lo) / delta;
+        return (primarySample - lo) / delta;
+    }
+
+    /// <summary>
+    /// Below this size, the bins are counted with SIMD instead of searching
+    /// </summary>
+    const int SmallSize = 32;
+
+    /// <returns>Index of the first CDF value that is greater or equal to the sample, clamped to the last</returns>
+    static int LowerBound(float[] cdf, float u) {
+        ref float start = ref MemoryMarshal.GetArrayDataReference(cdf);
+        int n = cdf.Length;
+
+        int idx;
+        if (n <= SmallSize && Vector.IsHardwareAccelerated) {
+            // The CDF is sorted, so the number of values below u is the lower bound
+            var uVec = new Vector<float>(u);
+            var count = Vector<int>.Zero;
+            int i = 0;
+            for (; i + Vector<float>.Count <= n; i += Vector<float>.Count) {
+                var values = Vector.LoadUnsafe(ref start, (nuint)i);
+                count -= Vector.LessThan(values, uVec);
+            }
+            idx = Vector.Sum(count);
+            for (; i < n; ++i)
+                idx += Unsafe.Add(ref start, i) < u ? 1 : 0;
+        } else {
+            // Branchless binary search: the loop has a fixed number of iterations and the comparison
+            // compiles to a conditional move
+            int lo = 0;
+            while (n > 1) {
+                int half = n >> 1;
+                lo = Unsafe.Add(ref start, lo + half) < u ? lo + half : lo;
+                n -= half;
+            }
+            idx = lo + (Unsafe.Add(ref start, lo) < u ? 1 : 0);
+        }
+        return Math.Min(idx, cdf.Length - 1);
+    }
 
-        return (idx, relative);
+    /// <summary>
+    /// Four branchless binary searches in lockstep
+    /// </summary>
+    static void LowerBound4(float[] cdf, ReadOnlySpan<float> u, Span<int> result) {
+        ref float start = ref MemoryMarshal.GetArrayDataReference(cdf);
+        float u0 = u[0], u1 = u[1], u2 = u[2], u3 = u[3];
+        int lo0 = 0, lo1 = 0, lo2 = 0, lo3 = 0;
+        int n = cdf.Length;
+        while (n > 1) {
+            int half = n >> 1;
+            lo0 = Unsafe.Add(ref start, lo0 + half) < u0 ? lo0 + half : lo0;
+            lo1 = Unsafe.Add(ref start, lo1 + half) < u1 ? lo1 + half : lo1;
+            lo2 = Unsafe.Add(ref start, lo2 + half) < u2 ? lo2 + half : lo2;
+            lo3 = Unsafe.Add(ref start, lo3 + half) < u3 ? lo3 + half : lo3;
+            n -= half;
+        }
+        int last = cdf.Length - 1;
+        result[0] = Math.Min(lo0 + (Unsafe.Add(ref start, lo0) < u0 ? 1 : 0), last);
+        result[1] = Math.Min(lo1 + (Unsafe.Add(ref start, lo1) < u1 ? 1 : 0), last);
+        result[2] = Math.Min(lo2 + (Unsafe.Add(ref start, lo2) < u2 ? 1 : 0), last);
+        result[3] = Math.Min(lo3 + (Unsafe.Add(ref start, lo3) < u3 ? 1 : 0), last);
     }
 
     /// <summary>
-    /// Performs the inverse of the transform used by <see cref="Sample"/>.
+    /// Performs the inverse of the transform used by <see cref="Sample(float)"/>.
     /// </summary>
     /// <param name="idx">The bin index</param>
     /// <param name="relative">Position within the bin</param>
@@ -73,5 +177,10 @@ public class PiecewiseConstantPDF {
     /// <returns>The CDF value of the given bin</returns>
     public float CumulativeProbability(int idx) => cdf[idx];
 
-    List<float> cdf;
+    /// <summary>
+    /// The normalized CDF, the last value is always one
+    /// </summary>
+    public ReadOnlySpan<float> Cdf => cdf;
+
+    readonly float[] cdf;
 }
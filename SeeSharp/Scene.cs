@@ -92,6 +92,8 @@ public class Scene : IDisposable {
         cpy.Camera = Camera.Copy();
         cpy.FrameBuffer = null;
         cpy.Raytracer = null;
+        cpy.emitterDistribution = null;
+        cpy.lightBvh = null;
         cpy.Name = Name;
         return cpy;
     }
@@ -161,6 +163,14 @@ public class Scene : IDisposable {
         for (int i = 0; i < Emitters.Count; ++i)
             emitterToIdxTemp.Add(Emitters[i], i);
         emitterToIdx = emitterToIdxTemp.ToFrozenDictionary();
+
+        // Build the distribution to select emitters proportional to their power
+        float[] emitterPower = new float[Emitters.Count];
+        Parallel.For(0, Emitters.Count, i => emitterPower[i] = Emitters[i].ComputeTotalPower().Average);
+        emitterDistribution = new(emitterPower);
+
+        // Build the light hierarchy for spatially varying selection in next event estimation
+        lightBvh = new(Emitters);
     }
 
     /// <summary>
@@ -220,6 +230,42 @@ public class Scene : IDisposable {
     /// <returns>Index of this emitter in the <see cref="Emitters"/> list</returns>
     public int GetEmitterIndex(Emitter emitter) => emitterToIdx[emitter];
 
+    /// <summary>
+    /// Selects one of the <see cref="Emitters"/> with probability proportional to its total power.
+    /// The distribution is computed by <see cref="Prepare"/>.
+    /// </summary>
+    /// <param name="primarySample">A primary sample in [0,1)</param>
+    /// <returns>The selected emitter and its selection probability</returns>
+    public (Emitter Emitter, float Probability) SampleEmitter(float primarySample) {
+        int idx = emitterDistribution.Sample(primarySample);
+        return (Emitters[idx], emitterDistribution.Probability(idx));
+    }
+
+    /// <returns>The probability that <see cref="SampleEmitter"/> selects the given emitter</returns>
+    public float EmitterProbability(Emitter emitter) => emitterDistribution.Probability(emitterToIdx[emitter]);
+
+    /// <summary>
+    /// Selects one of the <see cref="Emitters"/> with probability proportional to an estimate of its
+    /// contribution to the given point, based on power, distance, and orientation. Takes logarithmic time
+    /// in the number of emitters. The light hierarchy is built by <see cref="Prepare"/>.
+    /// </summary>
+    /// <param name="from">The shading point that is to be illuminated</param>
+    /// <param name="primarySample">A primary sample in [0,1)</param>
+    /// <returns>
+    /// The selected emitter and its selection probability. The emitter is null if no emitter can
+    /// illuminate the point.
+    /// </returns>
+    public (Emitter Emitter, float Probability) SampleEmitter(in SurfacePoint from, float primarySample) {
+        var (idx, prob) = lightBvh.Sample(from.Position, from.ShadingNormal, primarySample);
+        return idx < 0 ? (null, 0) : (Emitters[idx], prob);
+    }
+
+    /// <returns>
+    /// The probability that <see cref="SampleEmitter(in SurfacePoint, float)"/> selects the given emitter
+    /// </returns>
+    public float EmitterProbability(in SurfacePoint from, Emitter emitter)
+    => lightBvh.Probability(from.Position, from.ShadingNormal, emitterToIdx[emitter]);
+
     /// <summary>
     /// Loads a .json file and parses it as a scene. Assumes the file has been validated against
     /// the correct schema.
@@ -242,6 +288,8 @@ public class Scene : IDisposable {
 
     FrozenDictionary<Mesh, FrozenDictionary<int, Emitter>> meshToEmitter;
     FrozenDictionary<Emitter, int> emitterToIdx;
+    AliasTable emitterDistribution;
+    LightBvh lightBvh;
 
     /// <summary>
     /// Convenience function to cast a ray through the center of a pixel and query its primary hit point.
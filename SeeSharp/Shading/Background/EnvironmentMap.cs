@@ -19,10 +19,26 @@ public class EnvironmentMap : Background {
     public override RgbColor EmittedRadiance(Vector3 direction) {
         var sphericalDir = WorldToSpherical(direction);
         var pixelCoords = SphericalToPixel(sphericalDir);
+        return LookupBilinear(pixelCoords);
+    }
 
-        var col = pixelCoords.X * Image.Width;
-        var row = pixelCoords.Y * Image.Height;
-        return Image.GetPixel((int)col, (int)row);
+    /// <summary>
+    /// Bilinear interpolation between the pixel centers. Wraps around horizontally and clamps at the poles.
+    /// </summary>
+    /// <param name="pixelCoords">Position on the image, in [0,1]^2</param>
+    RgbColor LookupBilinear(Vector2 pixelCoords) {
+        float x = pixelCoords.X * Image.Width - 0.5f;
+        float y = pixelCoords.Y * Image.Height - 0.5f;
+        float x0 = MathF.Floor(x), y0 = MathF.Floor(y);
+        float fx = x - x0, fy = y - y0;
+
+        int col0 = ((int)x0 % Image.Width + Image.Width) % Image.Width;
+        int col1 = (col0 + 1) % Image.Width;
+        int row0 = Math.Clamp((int)y0, 0, Image.Height - 1);
+        int row1 = Math.Clamp((int)y0 + 1, 0, Image.Height - 1);
+
+        return (1 - fy) * ((1 - fx) * Image.GetPixel(col0, row0) + fx * Image.GetPixel(col1, row0))
+            + fy * ((1 - fx) * Image.GetPixel(col0, row1) + fx * Image.GetPixel(col1, row1));
     }
 
     public override RgbColor ComputeTotalPower() {
@@ -57,13 +73,9 @@ public class EnvironmentMap : Background {
             };
         }
         pdf /= jacobian;
-        // TODO we could (and should) pre-multiply the pdf by the sine, to avoid oversampling regions that will receive zero weight
 
-        // Compute the sample weight
-        var weight = Image.GetPixel(
-            (int)(pixelPrimary.X * Image.Width),
-            (int)(pixelPrimary.Y * Image.Height)
-        ) / pdf;
+        // Compute the sample weight, with the radiance evaluated exactly like EmittedRadiance()
+        var weight = EmittedRadiance(direction) / pdf;
 
         return new BackgroundSample {
             Direction = direction,
@@ -132,18 +144,35 @@ public class EnvironmentMap : Background {
     }
 
     /// <summary>
-    /// Forms a tabulated pdf to importance sample the environment map.
+    /// Forms a tabulated pdf to importance sample the environment map. The density of each pixel is the
+    /// integral of the bilinearly interpolated luminance over the pixel, multiplied by the sine of the
+    /// latitude, so it is proportional to the radiance per solid angle and nonzero wherever the radiance is.
     /// </summary>
     /// <param name="useMisCompensation">If true, applies MIS compensation to the PDF (Karlík et al. 2019)</param>
     /// <returns>Tabulated pdf for the image.</returns>
-    public virtual RegularGrid2d BuildSamplingGrid(bool useMisCompensation) {
-        var result = new RegularGrid2d(Image.Width, Image.Height);
-
-        for (int row = 0; row < Image.Height; ++row) {
-            for (int col = 0; col < Image.Width; ++col) {
-                result.Splat(col, row, Image.GetPixel(col, row).Luminance);
+    public virtual HierarchicalGrid2d BuildSamplingGrid(bool useMisCompensation) {
+        int width = Image.Width, height = Image.Height;
+        var result = new HierarchicalGrid2d(width, height);
+
+        // Integrating the bilinear interpolation over a pixel is a separable [1/8, 3/4, 1/8] filter
+        var luminance = new float[width * height];
+        Parallel.For(0, height, row => {
+            for (int col = 0; col < width; ++col) {
+                int left = (col + width - 1) % width, right = (col + 1) % width;
+                luminance[row * width + col] = 0.125f * Image.GetPixel(left, row).Luminance
+                    + 0.75f * Image.GetPixel(col, row).Luminance
+                    + 0.125f * Image.GetPixel(right, row).Luminance;
             }
-        }
+        });
+        Parallel.For(0, height, row => {
+            int above = Math.Max(row - 1, 0), below = Math.Min(row + 1, height - 1);
+            float sinTheta = MathF.Sin((row + 0.5f) / height * MathF.PI);
+            for (int col = 0; col < width; ++col) {
+                float value = 0.125f * luminance[above * width + col] + 0.75f * luminance[row * width + col]
+                    + 0.125f * luminance[below * width + col];
+                result.Splat(col, row, value * sinTheta);
+            }
+        });
 
         if (useMisCompensation)
             result.ApplyMISCompensation();
@@ -185,5 +214,5 @@ public class EnvironmentMap : Background {
     /// </summary>
     public readonly RgbImage Image;
 
-    RegularGrid2d directionSampler;
+    HierarchicalGrid2d directionSampler;
 }
\ No newline at end of file
@@ -79,7 +79,7 @@ public class DiffuseEmitter : Emitter {
     }
 
     public override RgbColor ComputeTotalPower()
-    => Radiance * 2.0f * MathF.PI * Mesh.SurfaceArea;
+    => Radiance * 2.0f * MathF.PI * Triangle.SurfaceArea;
 
     /// <summary>
     /// The radiance that is emitted in all directions
@@ -86,7 +86,17 @@ public class GlossyEmitter : Emitter {
     }
 
     public override RgbColor ComputeTotalPower()
-    => radiance * 2.0f * MathF.PI * Mesh.SurfaceArea;
+    => radiance * 2.0f * MathF.PI * Triangle.SurfaceArea;
+
+    /// <summary>
+    /// Radiance emitted in the direction of the surface normal
+    /// </summary>
+    public RgbColor Radiance => radiance;
+
+    /// <summary>
+    /// Exponent of the cosine lobe
+    /// </summary>
+    public float Exponent => exponent;
 
     RgbColor radiance;
     float exponent;
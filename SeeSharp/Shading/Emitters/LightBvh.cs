@@ -0,0 +1,374 @@
+namespace SeeSharp.Shading.Emitters;
+
+/// <summary>
+/// Bounding volume hierarchy over all emitters in a scene that stores the emitted power and a cone
+/// bounding the emission directions of each subtree. Used to select emitters for next event estimation
+/// proportional to an estimate of their contribution to a given shading point, in logarithmic time.
+/// Based on "Importance Sampling of Many Lights with Adaptive Tree Splitting" (Estevez and Kulla 2018)
+/// and its variant in PBRT v4.
+/// </summary>
+public class LightBvh {
+    /// <summary>
+    /// Spatial and directional bounds of a set of emitters
+    /// </summary>
+    struct LightBounds {
+        public BoundingBox Box;
+
+        /// <summary> Center of the cone bounding the surface normals </summary>
+        public Vector3 Axis;
+
+        /// <summary> Cosine of the spread of the normals around the axis </summary>
+        public float CosThetaO;
+
+        /// <summary> Cosine of the maximum angle between a normal and the emitted directions </summary>
+        public float CosThetaE;
+
+        public float Power;
+
+        public static LightBounds Empty => new() {
+            Box = BoundingBox.Empty,
+            CosThetaO = 1,
+            CosThetaE = 1,
+            Power = 0,
+        };
+
+        public readonly bool IsEmpty => Box.Min.X > Box.Max.X;
+
+        public static LightBounds Union(in LightBounds a, in LightBounds b) {
+            if (a.IsEmpty) return b;
+            if (b.IsEmpty) return a;
+            var (axis, cosThetaO) = UnionCones(a.Axis, a.CosThetaO, b.Axis, b.CosThetaO);
+            return new() {
+                Box = a.Box.GrowToContain(b.Box),
+                Axis = axis,
+                CosThetaO = cosThetaO,
+                CosThetaE = MathF.Min(a.CosThetaE, b.CosThetaE),
+                Power = a.Power + b.Power,
+            };
+        }
+    }
+
+    struct Node {
+        public LightBounds Bounds;
+
+        /// <summary> Index of the second child, the first child is the next node. -1 for leaves </summary>
+        public int SecondChild;
+
+        /// <summary> Index of the emitter if this is a leaf </summary>
+        public int EmitterIdx;
+
+        public int Parent;
+
+        public readonly bool IsLeaf => SecondChild < 0;
+    }
+
+    struct BuildItem {
+        public LightBounds Bounds;
+        public Vector3 Centroid;
+        public int EmitterIdx;
+    }
+
+    const int NumBuckets = 12;
+    const int MaxSahDepth = 64;
+
+    /// <summary>
+    /// Builds the hierarchy over the given emitters. The emitter indices used by the sampling functions
+    /// correspond to the position in this list.
+    /// </summary>
+    public LightBvh(IReadOnlyList<Emitter> emitters) {
+        var items = new BuildItem[emitters.Count];
+        Parallel.For(0, emitters.Count, i => {
+            var bounds = ComputeBounds(emitters[i]);
+            items[i] = new() { Bounds = bounds, Centroid = bounds.Box.Center, EmitterIdx = i };
+        });
+
+        nodes = new Node[Math.Max(2 * items.Length - 1, 0)];
+        emitterToLeaf = new int[items.Length];
+        if (items.Length > 0) {
+            int numNodes = 0;
+            Build(items, 0, items.Length, -1, 0, ref numNodes);
+            Debug.Assert(numNodes == nodes.Length);
+        }
+    }
+
+    static LightBounds ComputeBounds(Emitter emitter) {
+        var mesh = emitter.Mesh;
+        int face = emitter.Triangle.FaceIndex;
+        var v1 = mesh.Vertices[mesh.Indices[face * 3 + 0]];
+        var v2 = mesh.Vertices[mesh.Indices[face * 3 + 1]];
+        var v3 = mesh.Vertices[mesh.Indices[face * 3 + 2]];
+        var normal = mesh.FaceNormals[face];
+
+        // Emission is defined by the interpolated shading normal, so the cone has to contain all of them
+        float cosThetaO = 1;
+        if (mesh.HasShadingNormals) {
+            for (int i = 0; i < 3; ++i) {
+                var n = Vector3.Normalize(mesh.ShadingNormals[mesh.Indices[face * 3 + i]]);
+                cosThetaO = MathF.Min(cosThetaO, Vector3.Dot(n, normal));
+            }
+        }
+
+        return new() {
+            Box = BoundingBox.Empty.GrowToContain(v1).GrowToContain(v2).GrowToContain(v3),
+            Axis = normal,
+            CosThetaO = cosThetaO,
+            CosThetaE = 0, // All emitters emit into the hemisphere around their normal
+            Power = emitter.ComputeTotalPower().Average,
+        };
+    }
+
+    int Build(Span<BuildItem> allItems, int begin, int end, int parent, int depth, ref int numNodes) {
+        int nodeIdx = numNodes++;
+        nodes[nodeIdx].Parent = parent;
+
+        if (end - begin == 1) {
+            nodes[nodeIdx].Bounds = allItems[begin].Bounds;
+            nodes[nodeIdx].SecondChild = -1;
+            nodes[nodeIdx].EmitterIdx = allItems[begin].EmitterIdx;
+            emitterToLeaf[allItems[begin].EmitterIdx] = nodeIdx;
+            return nodeIdx;
+        }
+
+        var items = allItems[begin..end];
+        LightBounds bounds = LightBounds.Empty;
+        BoundingBox centroidBounds = BoundingBox.Empty;
+        foreach (var item in items) {
+            bounds = LightBounds.Union(bounds, item.Bounds);
+            centroidBounds = centroidBounds.GrowToContain(item.Centroid);
+        }
+
+        int mid = depth < MaxSahDepth ? FindSplit(items, bounds, centroidBounds) : -1;
+        if (mid <= 0 || mid >= items.Length) {
+            // Fall back to a median split along the largest axis, which bounds the tree depth
+            int axis = MaxAxis(centroidBounds.Diagonal);
+            items.Sort((a, b) => Component(a.Centroid, axis).CompareTo(Component(b.Centroid, axis)));
+            mid = items.Length / 2;
+        }
+
+        nodes[nodeIdx].Bounds = bounds;
+        nodes[nodeIdx].EmitterIdx = -1;
+        Build(allItems, begin, begin + mid, nodeIdx, depth + 1, ref numNodes);
+        nodes[nodeIdx].SecondChild = Build(allItems, begin + mid, end, nodeIdx, depth + 1, ref numNodes);
+        return nodeIdx;
+    }
+
+    /// <summary>
+    /// Binned surface area orientation heuristic. Partitions the items in-place.
+    /// </summary>
+    /// <returns>Number of items in the first half, or -1 if no useful split was found</returns>
+    static int FindSplit(Span<BuildItem> items, in LightBounds bounds, in BoundingBox centroidBounds) {
+        Vector3 diagonal = bounds.Box.Diagonal;
+        float maxExtent = MathF.Max(diagonal.X, MathF.Max(diagonal.Y, diagonal.Z));
+
+        float bestCost = float.MaxValue;
+        int bestAxis = -1, bestBucket = -1;
+        Span<LightBounds> buckets = stackalloc LightBounds[NumBuckets];
+        Span<LightBounds> below = stackalloc LightBounds[NumBuckets];
+        for (int axis = 0; axis < 3; ++axis) {
+            float lo = Component(centroidBounds.Min, axis);
+            float hi = Component(centroidBounds.Max, axis);
+            if (hi <= lo) continue;
+
+            buckets.Fill(LightBounds.Empty);
+            foreach (var item in items) {
+                int b = BucketIndex(item.Centroid, axis, lo, hi);
+                buckets[b] = LightBounds.Union(buckets[b], item.Bounds);
+            }
+
+            below[0] = buckets[0];
+            for (int b = 1; b < NumBuckets; ++b)
+                below[b] = LightBounds.Union(below[b - 1], buckets[b]);
+
+            // Penalize splits along axes where the bounds are thin
+            float regularization = maxExtent / MathF.Max(Component(diagonal, axis), 1e-6f * maxExtent);
+            LightBounds above = LightBounds.Empty;
+            for (int b = NumBuckets - 1; b > 0; --b) {
+                above = LightBounds.Union(above, buckets[b]);
+                if (above.IsEmpty || below[b - 1].IsEmpty) continue;
+                float cost = regularization * (Cost(below[b - 1]) + Cost(above));
+                if (cost < bestCost) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestBucket = b;
+                }
+            }
+        }
+
+        if (bestAxis < 0) return -1;
+
+        float bestLo = Component(centroidBounds.Min, bestAxis);
+        float bestHi = Component(centroidBounds.Max, bestAxis);
+        int mid = 0;
+        for (int i = 0; i < items.Length; ++i) {
+            if (BucketIndex(items[i].Centroid, bestAxis, bestLo, bestHi) < bestBucket) {
+                (items[i], items[mid]) = (items[mid], items[i]);
+                mid++;
+            }
+        }
+        return mid;
+    }
+
+    static int BucketIndex(Vector3 centroid, int axis, float lo, float hi)
+    => Math.Clamp((int)(NumBuckets * (Component(centroid, axis) - lo) / (hi - lo)), 0, NumBuckets - 1);
+
+    static float Cost(in LightBounds b) {
+        if (b.IsEmpty) return 0;
+        float thetaO = MathF.Acos(Math.Clamp(b.CosThetaO, -1, 1));
+        float thetaE = MathF.Acos(Math.Clamp(b.CosThetaE, -1, 1));
+        float thetaW = MathF.Min(thetaO + thetaE, MathF.PI);
+        float sinThetaO = SafeSqrt(1 - b.CosThetaO * b.CosThetaO);
+        float orientation = 2 * MathF.PI * (1 - b.CosThetaO) + MathF.PI / 2 *
+            (2 * thetaW * sinThetaO - MathF.Cos(thetaO - 2 * thetaW) - 2 * thetaO * sinThetaO + b.CosThetaO);
+        return b.Power * orientation * b.Box.SurfaceArea;
+    }
+
+    /// <summary>
+    /// Selects an emitter proportional to the estimated contribution to a shading point
+    /// </summary>
+    /// <param name="position">Position of the shading point</param>
+    /// <param name="normal">Shading normal at the point, or zero if there is none</param>
+    /// <param name="primarySample">Primary sample in [0,1)</param>
+    /// <returns>Index of the emitter and its selection probability, or (-1, 0) if no emitter can contribute</returns>
+    public (int EmitterIdx, float Probability) Sample(Vector3 position, Vector3 normal, float primarySample) {
+        if (nodes.Length == 0) return (-1, 0);
+
+        int nodeIdx = 0;
+        float pmf = 1;
+        if (Importance(nodes[0].Bounds, position, normal) == 0)
+            return (-1, 0);
+
+        float u = primarySample;
+        while (!nodes[nodeIdx].IsLeaf) {
+            int first = nodeIdx + 1;
+            int second = nodes[nodeIdx].SecondChild;
+            float i0 = Importance(nodes[first].Bounds, position, normal);
+            float i1 = Importance(nodes[second].Bounds, position, normal);
+            if (i0 == 0 && i1 == 0)
+                return (-1, 0);
+
+            float p0 = i0 / (i0 + i1);
+            if (u < p0) {
+                nodeIdx = first;
+                u = MathF.Min(u / p0, OneMinusEpsilon);
+                pmf *= p0;
+            } else {
+                nodeIdx = second;
+                u = MathF.Min((u - p0) / (1 - p0), OneMinusEpsilon);
+                pmf *= 1 - p0;
+            }
+        }
+        return (nodes[nodeIdx].EmitterIdx, pmf);
+    }
+
+    /// <returns>The probability that <see cref="Sample" /> selects the given emitter</returns>
+    public float Probability(Vector3 position, Vector3 normal, int emitterIdx) {
+        int nodeIdx = emitterToLeaf[emitterIdx];
+        if (Importance(nodes[nodeIdx].Bounds, position, normal) == 0)
+            return 0;
+
+        // Walk up to the root and multiply the probabilities of each decision along the way
+        float pmf = 1;
+        while (nodes[nodeIdx].Parent >= 0) {
+            int parent = nodes[nodeIdx].Parent;
+            int first = parent + 1;
+            int second = nodes[parent].SecondChild;
+            float i0 = Importance(nodes[first].Bounds, position, normal);
+            float i1 = Importance(nodes[second].Bounds, position, normal);
+            if (i0 + i1 == 0) return 0;
+            pmf *= (nodeIdx == first ? i0 : i1) / (i0 + i1);
+            nodeIdx = parent;
+        }
+        return pmf;
+    }
+
+    /// <summary>
+    /// Conservative estimate of the contribution of all emitters within the bounds to a shading point.
+    /// Only zero if the emitters cannot illuminate the point.
+    /// </summary>
+    static float Importance(in LightBounds b, Vector3 position, Vector3 normal) {
+        if (b.Power == 0) return 0;
+
+        Vector3 center = b.Box.Center;
+        float distSqr = MathF.Max(Vector3.DistanceSquared(position, center), b.Box.Diagonal.Length() / 2);
+
+        // Angle between the cone axis and the direction to the shading point
+        Vector3 toPoint = position - center;
+        float len = toPoint.Length();
+        Vector3 wi = len > 0 ? toPoint / len : b.Axis;
+        float cosThetaW = Vector3.Dot(wi, b.Axis);
+        float sinThetaW = SafeSqrt(1 - cosThetaW * cosThetaW);
+
+        // Bound the angle subtended by the box as seen from the shading point
+        float radius = b.Box.Diagonal.Length() / 2;
+        float cosThetaB, sinThetaB;
+        if (len <= radius) {
+            cosThetaB = -1;
+            sinThetaB = 0;
+        } else {
+            float sinSqr = radius * radius / (len * len);
+            cosThetaB = SafeSqrt(1 - sinSqr);
+            sinThetaB = MathF.Sqrt(sinSqr);
+        }
+
+        // Minimum angle between the point and the emission cone, reduced by the extent of the box
+        float sinThetaO = SafeSqrt(1 - b.CosThetaO * b.CosThetaO);
+        float cosThetaX = CosSubClamped(sinThetaW, cosThetaW, sinThetaO, b.CosThetaO);
+        float sinThetaX = SinSubClamped(sinThetaW, cosThetaW, sinThetaO, b.CosThetaO);
+        float cosThetaP = CosSubClamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+        if (cosThetaP <= b.CosThetaE)
+            return 0;
+
+        float importance = b.Power * cosThetaP / distSqr;
+
+        // Account for the cosine at the shading point. Uses the absolute value to support transmission.
+        if (normal != Vector3.Zero) {
+            float cosThetaI = MathF.Abs(Vector3.Dot(-wi, normal) / normal.Length());
+            float sinThetaI = SafeSqrt(1 - cosThetaI * cosThetaI);
+            importance *= CosSubClamped(sinThetaI, cosThetaI, sinThetaB, cosThetaB);
+        }
+
+        return MathF.Max(importance, 0);
+    }
+
+    /// <returns>cos(max(0, a - b)) given the sines and cosines of a and b</returns>
+    static float CosSubClamped(float sinA, float cosA, float sinB, float cosB)
+    => cosA > cosB ? 1 : cosA * cosB + sinA * sinB;
+
+    /// <returns>sin(max(0, a - b)) given the sines and cosines of a and b</returns>
+    static float SinSubClamped(float sinA, float cosA, float sinB, float cosB)
+    => cosA > cosB ? 0 : sinA * cosB - cosA * sinB;
+
+    static (Vector3 Axis, float CosTheta) UnionCones(Vector3 axisA, float cosA, Vector3 axisB, float cosB) {
+        float thetaA = MathF.Acos(Math.Clamp(cosA, -1, 1));
+        float thetaB = MathF.Acos(Math.Clamp(cosB, -1, 1));
+        float thetaD = AngleBetween(axisA, axisB);
+        if (MathF.Min(thetaD + thetaB, MathF.PI) <= thetaA) return (axisA, cosA);
+        if (MathF.Min(thetaD + thetaA, MathF.PI) <= thetaB) return (axisB, cosB);
+
+        float thetaO = (thetaA + thetaD + thetaB) / 2;
+        if (thetaO >= MathF.PI) return (axisA, -1);
+
+        // Rotate the first axis towards the second one, so the new cone just contains both
+        Vector3 rotAxis = Vector3.Cross(axisA, axisB);
+        if (rotAxis.LengthSquared() == 0) return (axisA, -1);
+        var rotation = Quaternion.CreateFromAxisAngle(Vector3.Normalize(rotAxis), thetaO - thetaA);
+        return (Vector3.Normalize(Vector3.Transform(axisA, rotation)), MathF.Cos(thetaO));
+    }
+
+    static float AngleBetween(Vector3 a, Vector3 b) {
+        if (Vector3.Dot(a, b) < 0)
+            return MathF.PI - 2 * MathF.Asin(Math.Clamp((a + b).Length() / 2, -1, 1));
+        return 2 * MathF.Asin(Math.Clamp((a - b).Length() / 2, -1, 1));
+    }
+
+    static float SafeSqrt(float v) => MathF.Sqrt(MathF.Max(v, 0));
+
+    static float Component(Vector3 v, int axis) => axis == 0 ? v.X : (axis == 1 ? v.Y : v.Z);
+
+    static int MaxAxis(Vector3 v) => v.X > v.Y ? (v.X > v.Z ? 0 : 2) : (v.Y > v.Z ? 1 : 2);
+
+    const float OneMinusEpsilon = 0.99999994f;
+
+    readonly Node[] nodes;
+    readonly int[] emitterToLeaf;
+}
@@ -35,7 +35,7 @@ public class DiffuseMaterial : Material {
 
     /// <returns>The base color</returns>
     public override RgbColor GetScatterStrength(in SurfacePoint hit)
-    => MaterialParameters.BaseColor.Lookup(hit.TextureCoordinates);
+    => MaterialParameters.BaseColor.Lookup(hit.TextureCoordinates, hit.TextureFootprint);
 
     public struct DiffuseBsdf {
         RgbColor reflectance;
@@ -112,7 +112,7 @@ public class DiffuseMaterial : Material {
         bool shouldReflect = ShouldReflect(context.Point, context.OutDirWorld, inDir);
         inDir = context.WorldToShading(inDir);
 
-        var baseColor = MaterialParameters.BaseColor.Lookup(context.Point.TextureCoordinates);
+        var baseColor = MaterialParameters.BaseColor.Lookup(context.Point.TextureCoordinates, context.Point.TextureFootprint);
         if (MaterialParameters.Transmitter && !shouldReflect) {
             return new DiffuseTransmission(baseColor).Evaluate(context.OutDir, inDir, context.IsOnLightSubpath);
         } else if (shouldReflect) {
@@ -127,7 +127,7 @@ public class DiffuseMaterial : Material {
     public override BsdfSample Sample(in ShadingContext context, float primaryComponent, Vector2 primarySample, ref ComponentWeights componentWeights) {
         ShadingStatCounter.NotifySample();
 
-        var baseColor = MaterialParameters.BaseColor.Lookup(context.Point.TextureCoordinates);
+        var baseColor = MaterialParameters.BaseColor.Lookup(context.Point.TextureCoordinates, context.Point.TextureFootprint);
         Vector3? sample;
         if (MaterialParameters.Transmitter) {
             // Pick either transmission or reflection
@@ -169,7 +169,7 @@ public class DiffuseMaterial : Material {
 
         inDir = context.WorldToShading(inDir);
 
-        var baseColor = MaterialParameters.BaseColor.Lookup(context.Point.TextureCoordinates);
+        var baseColor = MaterialParameters.BaseColor.Lookup(context.Point.TextureCoordinates, context.Point.TextureFootprint);
         var reflectPdf = new DiffuseBsdf(baseColor).Pdf(context.OutDir, inDir, context.IsOnLightSubpath);
         if (MaterialParameters.Transmitter) {
             var transmitPdf = new DiffuseTransmission(baseColor).Pdf(context.OutDir, inDir, context.IsOnLightSubpath);
@@ -61,8 +61,10 @@ public partial class GenericMaterial  : Material
     }
 
     public override float GetIndexOfRefractionRatio(in SurfacePoint hit) => parameters.IndexOfRefraction;
-    public override float GetRoughness(in SurfacePoint hit) => parameters.Roughness.Lookup(hit.TextureCoordinates);
-    public override RgbColor GetScatterStrength(in SurfacePoint hit) => parameters.BaseColor.Lookup(hit.TextureCoordinates);
+    public override float GetRoughness(in SurfacePoint hit)
+    => parameters.Roughness.Lookup(hit.TextureCoordinates, hit.TextureFootprint);
+    public override RgbColor GetScatterStrength(in SurfacePoint hit)
+    => parameters.BaseColor.Lookup(hit.TextureCoordinates, hit.TextureFootprint);
     public override bool IsTransmissive(in SurfacePoint hit) => parameters.SpecularTransmittance > 0;
     public override int MaxSamplingComponents => 3;
 
@@ -356,13 +358,13 @@ public partial class GenericMaterial  : Material
         LocalParams result = new();
 
         // Compute colors and tints
-        var baseColor = parameters.BaseColor.Lookup(shadingContext.Point.TextureCoordinates);
+        var baseColor = parameters.BaseColor.Lookup(shadingContext.Point.TextureCoordinates, shadingContext.Point.TextureFootprint);
         float luminance = baseColor.Luminance;
         result.colorTint = luminance > 0 ? (baseColor / luminance) : RgbColor.White;
         result.specularTint = RgbColor.Lerp(parameters.SpecularTintStrength, RgbColor.White, result.colorTint);
 
         // Microfacet distribution parameters
-        result.roughness = parameters.Roughness.Lookup(shadingContext.Point.TextureCoordinates);
+        result.roughness = parameters.Roughness.Lookup(shadingContext.Point.TextureCoordinates, shadingContext.Point.TextureFootprint);
         float aspect = MathF.Sqrt(1 - parameters.Anisotropic * .9f);
         result.alphaX = Math.Max(.001f, result.roughness * result.roughness / aspect);
         result.alphaY = Math.Max(.001f, result.roughness * result.roughness * aspect);